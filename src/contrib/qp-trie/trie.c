@@ -1,4 +1,4 @@
-/*  Copyright (C) 2019 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+/*  Copyright (C) 2021 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
     Copyright (C) 2018 Tony Finch <dot@dotat.at>
 
     This program is free software: you can redistribute it and/or modify
@@ -490,6 +490,54 @@ trie_val_t* trie_get_try_wildcard(trie_t *tbl, const trie_key_t *key, uint32_t l
 	return trie_get_try(tbl, wild_key, wild_len);
 }
 
+/*! \brief Check that the leaf key is a prefix of the key, comparing the bytes
+ * from *matched further and updating *matched on success. */
+static bool key_is_prefix(const tkey_t *lkey, const trie_key_t *key, uint32_t len,
+                          uint32_t *matched)
+{
+	assert(*matched <= lkey->len);
+	if (lkey->len > len)
+		return false;
+	if (memcmp(key + *matched, lkey->chars + *matched, lkey->len - *matched) != 0)
+		return false;
+	*matched = lkey->len;
+	return true;
+}
+
+/* A key ending at a branch node is stored in its NOBYTE twig, and it is
+ * a prefix of all keys below the branch.  Thus the prefix candidates met
+ * during the descent form a chain of prefixes, and it's enough to compare
+ * each byte of the searched key once. */
+trie_val_t* trie_get_lpm(trie_t *tbl, const trie_key_t *key, uint32_t len,
+                         uint32_t *prefix_len)
+{
+	assert(tbl);
+	if (!tbl->weight)
+		return NULL;
+	trie_val_t *best = NULL;
+	uint32_t matched = 0;
+	node_t *t = &tbl->root;
+	while (isbranch(t)) {
+		__builtin_prefetch(twigs(t));
+		if (hastwig(t, BMP_NOBYTE)) {
+			node_t *leaf = twig(t, 0);
+			if (!key_is_prefix(tkey(leaf), key, len, &matched))
+				goto finish; // No longer key can match either.
+			best = tvalp(leaf);
+		}
+		bitmap_t b = twigbit(t, key, len);
+		if (b == BMP_NOBYTE || !hastwig(t, b))
+			goto finish;
+		t = twig(t, twigoff(t, b));
+	}
+	if (key_is_prefix(tkey(t), key, len, &matched))
+		best = tvalp(t);
+finish:
+	if (best != NULL && prefix_len != NULL)
+		*prefix_len = matched;
+	return best;
+}
+
 /*! \brief Delete leaf t with parent p; b is the bit for t under p.
  * Optionally return the deleted value via val.  The function can't fail. */
 static void del_found(trie_t *tbl, node_t *t, node_t *p, bitmap_t b, trie_val_t *val)
@@ -1015,6 +1063,41 @@ int trie_apply(trie_t *tbl, int (*f)(trie_val_t *, void *), void *d)
 	return apply_nodes(&tbl->root, f, d);
 }
 
+size_t trie_split(trie_t *tbl, trie_sub_t **subs, size_t max)
+{
+	assert(tbl && subs);
+	if (!tbl->weight || max == 0)
+		return 0;
+	size_t count = 1;
+	subs[0] = &tbl->root;
+	// Replace branches by their twigs, one level per pass, while they fit.
+	bool split = true;
+	while (split && count < max) {
+		split = false;
+		for (size_t i = 0; i < count; ) {
+			node_t *t = subs[i];
+			if (!isbranch(t) || count + branch_weight(t) - 1 > max) {
+				++i;
+				continue;
+			}
+			uint n = branch_weight(t);
+			memmove(subs + i + n, subs + i + 1, sizeof(*subs) * (count - i - 1));
+			for (uint j = 0; j < n; ++j)
+				subs[i + j] = twig(t, j);
+			count += n - 1;
+			i += n;
+			split = true;
+		}
+	}
+	return count;
+}
+
+int trie_sub_apply(trie_sub_t *sub, int (*f)(trie_val_t *, void *), void *d)
+{
+	assert(sub && f);
+	return apply_nodes(sub, f, d);
+}
+
 /* These are all thin wrappers around static Tns* functions. */
 trie_it_t* trie_it_begin(trie_t *tbl)
 {
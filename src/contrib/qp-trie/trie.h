@@ -1,4 +1,4 @@
-/*  Copyright (C) 2019 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+/*  Copyright (C) 2021 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
     Copyright (C) 2018 Tony Finch <dot@dotat.at>
 
     This program is free software: you can redistribute it and/or modify
@@ -39,6 +39,9 @@ typedef uint8_t trie_key_t;
 /*! \brief Opaque structure holding a QP-trie. */
 typedef struct trie trie_t;
 
+/*! \brief Opaque type for a subtrie, i.e. a contiguous range of keys of a QP-trie. */
+typedef struct node trie_sub_t;
+
 /*! \brief Opaque type for holding a QP-trie iterator. */
 typedef struct trie_it trie_it_t;
 
@@ -85,6 +88,20 @@ trie_val_t* trie_get_try(trie_t *tbl, const trie_key_t *key, uint32_t len);
  */
 trie_val_t* trie_get_try_wildcard(trie_t *tbl, const trie_key_t *key, uint32_t len);
 
+/*!
+ * \brief Search for the longest key which is a prefix of the searched key.
+ *
+ * The trie is descended only once, each byte of the key is compared once.
+ *
+ * \param tbl         Trie.
+ * \param key         Searched key.
+ * \param len         Key length.
+ * \param prefix_len  (optional) Length of the found key.
+ * \return Value of the longest prefix key, or NULL if not found.
+ */
+trie_val_t* trie_get_lpm(trie_t *tbl, const trie_key_t *key, uint32_t len,
+                         uint32_t *prefix_len);
+
 /*! \brief Search the trie, inserting NULL trie_val_t on failure. */
 trie_val_t* trie_get_ins(trie_t *tbl, const trie_key_t *key, uint32_t len);
 
@@ -107,6 +124,24 @@ int trie_get_leq(trie_t *tbl, const trie_key_t *key, uint32_t len, trie_val_t **
  */
 int trie_apply(trie_t *tbl, int (*f)(trie_val_t *, void *), void *d);
 
+/*!
+ * \brief Split the trie into at most \a max disjoint subtries, in key order.
+ *
+ * The trie is split by its top branches, level by level, so the subtries
+ * are as balanced as its branching allows. The subtries together cover all
+ * the elements; they are valid until the trie is modified.
+ *
+ * \return Number of subtries stored into \a subs (zero for an empty trie).
+ */
+size_t trie_split(trie_t *tbl, trie_sub_t **subs, size_t max);
+
+/*!
+ * \brief Apply a function to every trie_val_t of a subtrie, in order.
+ *
+ * \return KNOT_EOK if success or KNOT_E* if error.
+ */
+int trie_sub_apply(trie_sub_t *sub, int (*f)(trie_val_t *, void *), void *d);
+
 /*!
  * \brief Remove an item, returning KNOT_EOK if succeeded or KNOT_ENOENT if not found.
  *
@@ -1,4 +1,4 @@
-/*  Copyright (C) 2019 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+/*  Copyright (C) 2021 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
 
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU General Public License as published by
@@ -14,49 +14,282 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
-#include <sys/time.h>
+#include <sched.h>
+#include <stddef.h>
 #include <stdlib.h>
-#include <stdio.h>
 #include <string.h>
+#include <time.h>
 #include <assert.h>
 
 #include "libknot/libknot.h"
 #include "knot/server/dthreads.h"
 #include "knot/common/evsched.h"
+#include "contrib/macros.h"
+
+/*
+ * # Timer wheel
+ *
+ * The wheel has EVSCHED_LEVELS levels of EVSCHED_SLOTS slots, the slots of
+ * the level L span 2^(L * EVSCHED_SLOT_BITS) milliseconds, so the wheel
+ * covers the whole uint32_t range of the relative event time. An event is
+ * placed on the lowest level whose span covers the time remaining to its
+ * expiration. Whenever the tick crosses a slot boundary of a higher level,
+ * the events of the corresponding slot are cascaded to the lower levels.
+ * Ticks that can't contain any event are skipped.
+ *
+ * # Insertion buffers
+ *
+ * Scheduling an event only appends it to the insertion buffer of the
+ * current CPU (or updates the requested time if the event is already
+ * buffered). The buffers are merged into the wheel by the scheduler thread
+ * before each expiration round. The scheduler thread is woken up only if
+ * the new event expires sooner than the planned wake-up.
+ *
+ * # Locking
+ *
+ * Lock order: wheel_lock -> buffer lock. The callbacks of all the events
+ * expired in one round are run in a batch with wheel_lock held, so
+ * evsched_cancel() waits for a running callback to finish.
+ */
+
+#ifdef HAVE_ATOMIC
+ #define ATOMIC_SET(dst, val) __atomic_store_n(&(dst), (val), __ATOMIC_SEQ_CST)
+ #define ATOMIC_GET(src)      __atomic_load_n(&(src), __ATOMIC_SEQ_CST)
+#else
+ #define ATOMIC_SET(dst, val) ((dst) = (val))
+ #define ATOMIC_GET(src)      (src)
+#endif
+
+#define SLOT_MASK	(EVSCHED_SLOTS - 1)
+#define NO_TIME		UINT64_MAX
+#define NONE		(-1)
+
+#define EVENT_OF(node, member) ((event_t *)((uint8_t *)(node) - offsetof(event_t, member)))
 
-/*! \brief Some implementations of timercmp >= are broken, this is for compat.*/
-static inline int timercmp_ge(struct timeval *a, struct timeval *b) {
-	return timercmp(a, b, >) || timercmp(a, b, ==);
+/*! \brief Get the monotonic time in milliseconds, rounded down or up. */
+static uint64_t time_now(bool round_up)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	uint64_t ms = ts.tv_sec * 1000ULL + ts.tv_nsec / 1000000;
+	if (round_up && ts.tv_nsec % 1000000 != 0) {
+		ms++;
+	}
+
+	return ms;
 }
 
-static int compare_event_heap_nodes(void *e1, void *e2)
+static unsigned level_shift(int level)
 {
-	if (timercmp(&((event_t *)e1)->tv, &((event_t *)e2)->tv, <)) return -1;
-	if (timercmp(&((event_t *)e1)->tv, &((event_t *)e2)->tv, >)) return 1;
-	return 0;
+	return level * EVSCHED_SLOT_BITS;
 }
 
-/*!
- * \brief Get time T (now) + dt milliseconds.
- */
-static struct timeval timeval_in(uint32_t dt)
+/*! \brief Get the first tick >= 'tick' aligned to the slot span of the level. */
+static uint64_t level_boundary(uint64_t tick, int level)
+{
+	uint64_t span = (uint64_t)1 << level_shift(level);
+	return (tick + span - 1) & ~(span - 1);
+}
+
+static void wheel_remove(evsched_t *sched, event_t *ev)
+{
+	assert(ev->level != NONE);
+	rem_node(&ev->n);
+	sched->counts[ev->level]--;
+	ev->level = NONE;
+}
+
+static void wheel_insert(evsched_t *sched, event_t *ev)
+{
+	// Expired events go to the slot of the next tick.
+	uint64_t delta = (ev->when > sched->tick) ? ev->when - sched->tick : 0;
+
+	// Too distant events are placed to the last slot and re-cascaded.
+	uint64_t max_delta = ((uint64_t)1 << level_shift(EVSCHED_LEVELS)) - 1;
+	uint64_t at = sched->tick + MIN(delta, max_delta);
+
+	int level = 0;
+	while (level < EVSCHED_LEVELS - 1 &&
+	       (at - sched->tick) >> level_shift(level + 1) > 0) {
+		level++;
+	}
+
+	unsigned slot = (at >> level_shift(level)) & SLOT_MASK;
+	add_tail(&sched->wheel[level][slot], &ev->n);
+	sched->counts[level]++;
+	ev->level = level;
+}
+
+/*! \brief Move the events of the higher level slots starting at the tick. */
+static void wheel_cascade(evsched_t *sched)
+{
+	for (int level = 1; level < EVSCHED_LEVELS; level++) {
+		unsigned slot = (sched->tick >> level_shift(level)) & SLOT_MASK;
+		list_t *list = &sched->wheel[level][slot];
+
+		node_t *n;
+		WALK_LIST_FIRST(n, *list) {
+			event_t *ev = EVENT_OF(n, n);
+			wheel_remove(sched, ev);
+			wheel_insert(sched, ev);
+		}
+
+		// Continue only if the slot boundary of this level was crossed too.
+		if (slot != 0) {
+			break;
+		}
+	}
+}
+
+/*! \brief Get the first tick that may contain an expiring event. */
+static uint64_t wheel_next(const evsched_t *sched)
+{
+	// Cascading is needed at the slot boundary of the lowest non-empty level.
+	uint64_t limit = NO_TIME;
+	for (int level = 1; level < EVSCHED_LEVELS; level++) {
+		if (sched->counts[level] > 0) {
+			limit = level_boundary(sched->tick, level);
+			break;
+		}
+	}
+
+	if (sched->counts[0] > 0) {
+		for (uint64_t tick = sched->tick; tick < limit; tick++) {
+			if (!EMPTY_LIST(sched->wheel[0][tick & SLOT_MASK])) {
+				return tick;
+			}
+		}
+	}
+
+	return limit;
+}
+
+/*! \brief Collect the events expired until now (inclusive). */
+static void wheel_advance(evsched_t *sched, uint64_t now, list_t *expired)
+{
+	while (sched->tick <= now) {
+		if ((sched->tick & SLOT_MASK) == 0) {
+			wheel_cascade(sched);
+		}
+
+		list_t *list = &sched->wheel[0][sched->tick & SLOT_MASK];
+		node_t *n;
+		WALK_LIST_FIRST(n, *list) {
+			wheel_remove(sched, EVENT_OF(n, n));
+			add_tail(expired, n);
+		}
+
+		sched->tick++;
+		sched->tick = MIN(wheel_next(sched), now + 1);
+	}
+}
+
+/*! \brief Merge the insertion buffers into the wheel. */
+static void buffers_drain(evsched_t *sched)
+{
+	for (unsigned i = 0; i < sched->buf_count; i++) {
+		evsched_buf_t *buf = &sched->bufs[i];
+		if (ATOMIC_GET(buf->count) == 0) {
+			continue;
+		}
+
+		pthread_mutex_lock(&buf->lock);
+		node_t *n;
+		WALK_LIST_FIRST(n, buf->events) {
+			event_t *ev = EVENT_OF(n, buf_n);
+			rem_node(n);
+			ATOMIC_SET(ev->buf, NONE);
+
+			if (ev->level != NONE) {
+				wheel_remove(sched, ev);
+			}
+			ev->when = ev->pending;
+			wheel_insert(sched, ev);
+		}
+		ATOMIC_SET(buf->count, 0);
+		pthread_mutex_unlock(&buf->lock);
+	}
+}
+
+static bool buffers_empty(evsched_t *sched)
 {
-	struct timeval tv = { 0 };
-	gettimeofday(&tv, NULL);
+	for (unsigned i = 0; i < sched->buf_count; i++) {
+		if (ATOMIC_GET(sched->bufs[i].count) > 0) {
+			return false;
+		}
+	}
 
-	/* Add number of seconds. */
-	tv.tv_sec += dt / 1000;
+	return true;
+}
 
-	/* Add the number of microseconds. */
-	tv.tv_usec += (dt % 1000) * 1000;
+static evsched_buf_t *buffer_local(evsched_t *sched)
+{
+#ifdef HAVE_SCHED_GETCPU
+	int cpu = sched_getcpu();
+	if (cpu >= 0) {
+		return &sched->bufs[cpu % sched->buf_count];
+	}
+#endif
+	static __thread unsigned local = 0;
+	static unsigned last = 0;
+	if (local == 0) {
+#ifdef HAVE_ATOMIC
+		local = __atomic_add_fetch(&last, 1, __ATOMIC_RELAXED);
+#else
+		local = ++last;
+#endif
+	}
+
+	return &sched->bufs[local % sched->buf_count];
+}
+
+/*! \brief Lock the buffer the event is in, or NULL if not buffered. */
+static evsched_buf_t *buffer_lock_event(event_t *ev)
+{
+	while (true) {
+		int idx = ATOMIC_GET(ev->buf);
+		if (idx == NONE) {
+			return NULL;
+		}
 
-	/* Check for overflow. */
-	while (tv.tv_usec > 999999) {
-		tv.tv_sec += 1;
-		tv.tv_usec -= 1 * 1000 * 1000;
+		evsched_buf_t *buf = &ev->sched->bufs[idx];
+		pthread_mutex_lock(&buf->lock);
+		if (ev->buf == idx) {
+			return buf;
+		}
+		pthread_mutex_unlock(&buf->lock);
 	}
+}
 
-	return tv;
+static void notify(evsched_t *sched)
+{
+	pthread_mutex_lock(&sched->notify_lock);
+	sched->notified = true;
+	pthread_cond_signal(&sched->notify);
+	pthread_mutex_unlock(&sched->notify_lock);
+}
+
+static void wait_until(evsched_t *sched, uint64_t next)
+{
+	pthread_mutex_lock(&sched->notify_lock);
+	if (!sched->notified) {
+		if (next == NO_TIME) {
+			pthread_cond_wait(&sched->notify, &sched->notify_lock);
+		} else {
+			uint64_t now = time_now(false);
+			if (next > now) {
+				struct timespec ts;
+				clock_gettime(CLOCK_REALTIME, &ts);
+				uint64_t nsec = ts.tv_nsec + (next - now) * 1000000;
+				ts.tv_sec += nsec / 1000000000;
+				ts.tv_nsec = nsec % 1000000000;
+				pthread_cond_timedwait(&sched->notify, &sched->notify_lock, &ts);
+			}
+		}
+	}
+	sched->notified = false;
+	pthread_mutex_unlock(&sched->notify_lock);
 }
 
 /*! \brief Event scheduler loop. */
@@ -68,33 +301,45 @@ static int evsched_run(dthread_t *thread)
 	}
 
 	/* Run event loop. */
-	pthread_mutex_lock(&sched->heap_lock);
 	while (!dt_is_cancelled(thread)) {
-		if (!!EMPTY_HEAP(&sched->heap) || sched->paused) {
-			pthread_cond_wait(&sched->notify, &sched->heap_lock);
+		pthread_mutex_lock(&sched->wheel_lock);
+
+		if (sched->paused) {
+			ATOMIC_SET(sched->next, NO_TIME);
+			pthread_mutex_unlock(&sched->wheel_lock);
+			wait_until(sched, NO_TIME);
 			continue;
 		}
 
-		/* Get current time. */
-		struct timeval dt;
-		gettimeofday(&dt, 0);
+		buffers_drain(sched);
+
+		list_t expired;
+		init_list(&expired);
+		wheel_advance(sched, time_now(false), &expired);
+
+		/* Run the expired events in a batch. */
+		node_t *n;
+		WALK_LIST_FIRST(n, expired) {
+			rem_node(n);
+			event_t *ev = EVENT_OF(n, n);
+			/* Skip the event if re-scheduled meanwhile. */
+			if (ATOMIC_GET(ev->buf) == NONE) {
+				ev->cb(ev);
+			}
+		}
 
-		/* Get next event. */
-		event_t *ev = *((event_t**)HHEAD(&sched->heap));
-		assert(ev != NULL);
+		uint64_t next = wheel_next(sched);
+		ATOMIC_SET(sched->next, next);
 
-		if (timercmp_ge(&dt, &ev->tv)) {
-			heap_delmin(&sched->heap);
-			ev->cb(ev);
-		} else {
-			/* Wait for next event or interrupt. Unlock calendar. */
-			struct timespec ts;
-			ts.tv_sec = ev->tv.tv_sec;
-			ts.tv_nsec = ev->tv.tv_usec * 1000L;
-			pthread_cond_timedwait(&sched->notify, &sched->heap_lock, &ts);
+		pthread_mutex_unlock(&sched->wheel_lock);
+
+		/* Events buffered before the wake-up time was published. */
+		if (!buffers_empty(sched)) {
+			continue;
 		}
+
+		wait_until(sched, next);
 	}
-	pthread_mutex_unlock(&sched->heap_lock);
 
 	return KNOT_EOK;
 }
@@ -105,9 +350,28 @@ int evsched_init(evsched_t *sched, void *ctx)
 	sched->ctx = ctx;
 
 	/* Initialize event calendar. */
-	pthread_mutex_init(&sched->heap_lock, 0);
-	pthread_cond_init(&sched->notify, 0);
-	heap_init(&sched->heap, compare_event_heap_nodes, 0);
+	pthread_mutex_init(&sched->wheel_lock, NULL);
+	pthread_mutex_init(&sched->notify_lock, NULL);
+	pthread_cond_init(&sched->notify, NULL);
+	for (int level = 0; level < EVSCHED_LEVELS; level++) {
+		for (int slot = 0; slot < EVSCHED_SLOTS; slot++) {
+			init_list(&sched->wheel[level][slot]);
+		}
+	}
+	sched->tick = time_now(false);
+	sched->next = NO_TIME;
+
+	sched->buf_count = MAX(dt_online_cpus(), 1);
+	sched->bufs = calloc(sched->buf_count, sizeof(*sched->bufs));
+	if (sched->bufs == NULL) {
+		sched->buf_count = 0;
+		evsched_deinit(sched);
+		return KNOT_ENOMEM;
+	}
+	for (unsigned i = 0; i < sched->buf_count; i++) {
+		pthread_mutex_init(&sched->bufs[i].lock, NULL);
+		init_list(&sched->bufs[i].events);
+	}
 
 	sched->thread = dt_create(1, evsched_run, NULL, sched);
 
@@ -126,16 +390,31 @@ void evsched_deinit(evsched_t *sched)
 	}
 
 	/* Deinitialize event calendar. */
-	pthread_mutex_destroy(&sched->heap_lock);
+	pthread_mutex_destroy(&sched->wheel_lock);
+	pthread_mutex_destroy(&sched->notify_lock);
 	pthread_cond_destroy(&sched->notify);
 
-	while (!EMPTY_HEAP(&sched->heap)) {
-		event_t *e = (event_t *)*HHEAD(&sched->heap);
-		heap_delmin(&sched->heap);
-		evsched_event_free(e);
+	/* Events both in the wheel and in a buffer are freed with the buffer. */
+	for (int level = 0; level < EVSCHED_LEVELS; level++) {
+		for (int slot = 0; slot < EVSCHED_SLOTS; slot++) {
+			node_t *n, *nxt;
+			WALK_LIST_DELSAFE(n, nxt, sched->wheel[level][slot]) {
+				event_t *ev = EVENT_OF(n, n);
+				if (ev->buf == NONE) {
+					evsched_event_free(ev);
+				}
+			}
+		}
 	}
 
-	heap_deinit(&sched->heap);
+	for (unsigned i = 0; i < sched->buf_count; i++) {
+		node_t *n, *nxt;
+		WALK_LIST_DELSAFE(n, nxt, sched->bufs[i].events) {
+			evsched_event_free(EVENT_OF(n, buf_n));
+		}
+		pthread_mutex_destroy(&sched->bufs[i].lock);
+	}
+	free(sched->bufs);
 
 	if (sched->thread != NULL) {
 		dt_delete(&sched->thread);
@@ -163,7 +442,8 @@ event_t *evsched_event_create(evsched_t *sched, event_cb_t cb, void *data)
 	e->sched = sched;
 	e->cb = cb;
 	e->data = data;
-	e->hpos.pos=0;
+	e->buf = NONE;
+	e->level = NONE;
 
 	return e;
 }
@@ -183,26 +463,30 @@ int evsched_schedule(event_t *ev, uint32_t dt)
 		return KNOT_EINVAL;
 	}
 
-	struct timeval new_time = timeval_in(dt);
-
 	evsched_t *sched = ev->sched;
-
-	/* Lock calendar. */
-	pthread_mutex_lock(&sched->heap_lock);
-
-	ev->tv = new_time;
-
-	/* Make sure it's not already enqueued. */
-	int found = heap_find(&sched->heap, (heap_val_t *)ev);
-	if (found > 0) {
-		heap_replace(&sched->heap, found, (heap_val_t *)ev);
-	} else {
-		heap_insert(&sched->heap, (heap_val_t *)ev);
+	uint64_t when = time_now(true) + dt;
+
+	/* Update the time if already buffered, otherwise buffer locally. */
+	evsched_buf_t *buf = buffer_lock_event(ev);
+	while (buf == NULL) {
+		buf = buffer_local(sched);
+		pthread_mutex_lock(&buf->lock);
+		if (ev->buf == NONE) {
+			add_tail(&buf->events, &ev->buf_n);
+			ATOMIC_SET(ev->buf, (int)(buf - sched->bufs));
+			ATOMIC_SET(buf->count, buf->count + 1);
+			break;
+		}
+		pthread_mutex_unlock(&buf->lock);
+		buf = buffer_lock_event(ev);
 	}
+	ev->pending = when;
+	pthread_mutex_unlock(&buf->lock);
 
-	/* Unlock calendar. */
-	pthread_cond_signal(&sched->notify);
-	pthread_mutex_unlock(&sched->heap_lock);
+	/* Wake up the scheduler thread if needed. */
+	if (when < ATOMIC_GET(sched->next)) {
+		notify(sched);
+	}
 
 	return KNOT_EOK;
 }
@@ -215,20 +499,20 @@ int evsched_cancel(event_t *ev)
 
 	evsched_t *sched = ev->sched;
 
-	/* Lock calendar. */
-	pthread_mutex_lock(&sched->heap_lock);
-
-	int found = heap_find(&sched->heap, (heap_val_t *)ev);
-	if (found > 0) {
-		heap_delete(&sched->heap, found);
+	evsched_buf_t *buf = buffer_lock_event(ev);
+	if (buf != NULL) {
+		rem_node(&ev->buf_n);
+		ATOMIC_SET(ev->buf, NONE);
+		ATOMIC_SET(buf->count, buf->count - 1);
+		pthread_mutex_unlock(&buf->lock);
 	}
 
-	/* Unlock calendar. */
-	pthread_cond_signal(&sched->notify);
-	pthread_mutex_unlock(&sched->heap_lock);
-
-	/* Reset event timer. */
-	memset(&ev->tv, 0, sizeof(struct timeval));
+	/* Also waits for the running callbacks. */
+	pthread_mutex_lock(&sched->wheel_lock);
+	if (ev->level != NONE) {
+		wheel_remove(sched, ev);
+	}
+	pthread_mutex_unlock(&sched->wheel_lock);
 
 	return KNOT_EOK;
 }
@@ -240,10 +524,8 @@ void evsched_start(evsched_t *sched)
 
 void evsched_stop(evsched_t *sched)
 {
-	pthread_mutex_lock(&sched->heap_lock);
 	dt_stop(sched->thread);
-	pthread_cond_signal(&sched->notify);
-	pthread_mutex_unlock(&sched->heap_lock);
+	notify(sched);
 }
 
 void evsched_join(evsched_t *sched)
@@ -253,15 +535,15 @@ void evsched_join(evsched_t *sched)
 
 void evsched_pause(evsched_t *sched)
 {
-	pthread_mutex_lock(&sched->heap_lock);
+	pthread_mutex_lock(&sched->wheel_lock);
 	sched->paused = true;
-	pthread_mutex_unlock(&sched->heap_lock);
+	pthread_mutex_unlock(&sched->wheel_lock);
 }
 
 void evsched_resume(evsched_t *sched)
 {
-	pthread_mutex_lock(&sched->heap_lock);
+	pthread_mutex_lock(&sched->wheel_lock);
 	sched->paused = false;
-	pthread_cond_signal(&sched->notify);
-	pthread_mutex_unlock(&sched->heap_lock);
+	pthread_mutex_unlock(&sched->wheel_lock);
+	notify(sched);
 }
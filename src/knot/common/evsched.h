@@ -1,4 +1,4 @@
-/*  Copyright (C) 2019 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+/*  Copyright (C) 2021 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
 
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU General Public License as published by
@@ -16,6 +16,12 @@
 
 /*!
  * \brief Event scheduler.
+ *
+ * Events are kept in a hierarchical timer wheel with a millisecond tick,
+ * so scheduling and canceling an event are O(1) regardless of the number
+ * of the scheduled events. The events are scheduled via per-CPU insertion
+ * buffers, which are merged into the wheel by the scheduler thread, so the
+ * scheduling threads don't contend on the wheel lock.
  */
 
 #pragma once
@@ -23,10 +29,13 @@
 #include <pthread.h>
 #include <stdbool.h>
 #include <stdint.h>
-#include <sys/time.h>
 
 #include "knot/server/dthreads.h"
-#include "contrib/ucw/heap.h"
+#include "contrib/ucw/lists.h"
+
+#define EVSCHED_LEVELS		4	/*!< Timer wheel levels. */
+#define EVSCHED_SLOT_BITS	8
+#define EVSCHED_SLOTS		(1 << EVSCHED_SLOT_BITS) /*!< Slots per level. */
 
 /* Forward decls. */
 struct evsched;
@@ -51,22 +60,42 @@ typedef void (*event_cb_t)(struct event *);
  * \brief Event structure.
  */
 typedef struct event {
-	struct heap_val hpos;
-	struct timeval tv; /*!< Event scheduled time. */
+	node_t n;          /*!< Node in the timer wheel slot. */
+	node_t buf_n;      /*!< Node in the insertion buffer. */
+	uint64_t when;     /*!< Expiration time in the wheel (monotonic ms). */
+	uint64_t pending;  /*!< Requested expiration time in the buffer. */
+	int buf;           /*!< Insertion buffer index or -1. */
+	int level;         /*!< Timer wheel level or -1. */
 	void *data;        /*!< Usable data ptr. */
 	event_cb_t cb;     /*!< Event callback. */
 	struct evsched *sched; /*!< Scheduler for this event. */
 } event_t;
 
+/*!
+ * \brief Insertion buffer of newly (re)scheduled events.
+ */
+typedef struct {
+	pthread_mutex_t lock; /*!< Buffer locking. */
+	list_t events;        /*!< Buffered events. */
+	unsigned count;       /*!< Number of the buffered events. */
+} evsched_buf_t;
+
 /*!
  * \brief Event scheduler structure.
  */
 typedef struct evsched {
-	volatile bool paused;      /*!< Temporarily stop processing events. */
-	pthread_mutex_t heap_lock; /*!< Event heap locking. */
-	pthread_cond_t notify;     /*!< Event heap notification. */
-	struct heap heap;          /*!< Event heap. */
-	void *ctx;                 /*!< Scheduler context. */
+	volatile bool paused;       /*!< Temporarily stop processing events. */
+	pthread_mutex_t wheel_lock; /*!< Timer wheel and running callbacks locking. */
+	pthread_mutex_t notify_lock;/*!< Scheduler thread wake-up locking. */
+	pthread_cond_t notify;      /*!< Scheduler thread wake-up notification. */
+	bool notified;              /*!< Wake-up requested. */
+	uint64_t next;              /*!< Planned wake-up time (monotonic ms). */
+	uint64_t tick;              /*!< Next tick to be processed (monotonic ms). */
+	unsigned counts[EVSCHED_LEVELS]; /*!< Number of events on each level. */
+	list_t wheel[EVSCHED_LEVELS][EVSCHED_SLOTS]; /*!< Timer wheel slots. */
+	evsched_buf_t *bufs;        /*!< Per-CPU insertion buffers. */
+	unsigned buf_count;         /*!< Number of the insertion buffers. */
+	void *ctx;                  /*!< Scheduler context. */
 	dt_unit_t *thread;
 } evsched_t;
 
@@ -114,6 +143,9 @@ void evsched_event_free(event_t *ev);
  *       then it replaces this timer with the newer value.
  *       Running events are not canceled or waited for.
  *
+ * \note The event is run no sooner than after the given time, with
+ *       the millisecond precision.
+ *
  * \param ev Prepared event.
  * \param dt Time difference in milliseconds from now (dt is relative).
  *
@@ -189,6 +189,39 @@ int fdset_remove(fdset_t *set, const unsigned idx)
 	return KNOT_EOK;
 }
 
+int fdset_set_events(fdset_t *set, const unsigned idx, const fdset_event_t events)
+{
+	if (set == NULL || idx >= set->n) {
+		return KNOT_EINVAL;
+	}
+
+	const int fd = fdset_get_fd(set, idx);
+#ifdef HAVE_EPOLL
+	set->ev[idx].events = events;
+	struct epoll_event ev = {
+		.data.u64 = idx,
+		.events = events
+	};
+	if (epoll_ctl(set->pfd, EPOLL_CTL_MOD, fd, &ev) != 0) {
+		return knot_map_errno();
+	}
+#elif HAVE_KQUEUE
+	/* Filters can't be combined, replace the watched one. */
+	struct kevent ev[2];
+	EV_SET(&ev[0], fd, set->ev[idx].filter, EV_DELETE, 0, 0, NULL);
+	EV_SET(&set->ev[idx], fd, events, EV_ADD, 0, 0, (void *)(intptr_t)idx);
+	ev[1] = set->ev[idx];
+	if (kevent(set->pfd, ev, 2, NULL, 0, NULL) < 0) {
+		return knot_map_errno();
+	}
+#else
+	(void)fd;
+	set->pfd[idx].events = events;
+#endif
+
+	return KNOT_EOK;
+}
+
 int fdset_poll(fdset_t *set, fdset_it_t *it, const unsigned offset, const int timeout_ms)
 {
 	if (it == NULL) {
@@ -325,8 +358,7 @@ void fdset_sweep(fdset_t *set, const fdset_sweep_cb_t cb, void *data)
 	while (idx < set->n) {
 		/* Check sweep state, remove if requested. */
 		if (set->timeout[idx] > 0 && set->timeout[idx] <= now.tv_sec) {
-			const int fd = fdset_get_fd(set, idx);
-			if (cb(set, fd, data) == FDSET_SWEEP) {
+			if (cb(set, idx, data) == FDSET_SWEEP) {
 				(void)fdset_remove(set, idx);
 				continue;
 			}
@@ -138,6 +138,19 @@ int fdset_add(fdset_t *set, const int fd, const fdset_event_t events, void *ctx)
  */
 int fdset_remove(fdset_t *set, const unsigned idx);
 
+/*!
+ * \brief Change the watched events of a file descriptor.
+ *
+ * \note With kqueue, only one of the events can be watched at a time.
+ *
+ * \param set     Target set.
+ * \param idx     Index of the file descriptor.
+ * \param events  Mask of watched events.
+ *
+ * \return Error code, KNOT_EOK if success.
+ */
+int fdset_set_events(fdset_t *set, const unsigned idx, const fdset_event_t events);
+
 /*!
  * \brief Wait for receive events.
  *
@@ -201,6 +214,21 @@ inline static int fdset_get_fd(const fdset_t *set, const unsigned idx)
 #endif
 }
 
+/*!
+ * \brief Returns context of the file descriptor based on index.
+ *
+ * \param set  Target set.
+ * \param idx  Index of the file descriptor.
+ *
+ * \return Context passed to fdset_add().
+ */
+inline static void *fdset_get_ctx(const fdset_t *set, const unsigned idx)
+{
+	assert(set && idx < set->n);
+
+	return set->ctx[idx];
+}
+
 /*!
  * \brief Returns number of file descriptors stored in set.
  *
@@ -361,6 +389,26 @@ inline static bool fdset_it_is_pollin(const fdset_it_t *it)
 #endif
 }
 
+/*!
+ * \brief Decide if event referenced by iterator is POLLOUT event.
+ *
+ * \param it  Target iterator.
+ *
+ * \retval Logical flag represents 'POLLOUT' event received.
+ */
+inline static bool fdset_it_is_pollout(const fdset_it_t *it)
+{
+	assert(it);
+
+#ifdef HAVE_EPOLL
+	return it->ptr->events & EPOLLOUT;
+#elif HAVE_KQUEUE
+	return it->ptr->filter == EVFILT_WRITE;
+#else
+	return it->set->pfd[it->idx].revents & POLLOUT;
+#endif
+}
+
 /*!
  * \brief Decide if event referenced by iterator is error event.
  *
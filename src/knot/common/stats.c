@@ -24,6 +24,8 @@
 #include "knot/common/stats.h"
 #include "knot/common/log.h"
 #include "knot/nameserver/query_module.h"
+#include "knot/nameserver/resp_cache.h"
+#include "libknot/xdp.h"
 
 struct {
 	bool active_dumper;
@@ -51,8 +53,137 @@ uint64_t server_zone_count(server_t *server)
 	return knot_zonedb_size(server->zone_db);
 }
 
+static void resp_cache_stats_cb(zone_t *zone, resp_cache_stats_t *cache_stats)
+{
+	resp_cache_stats(rcu_dereference(zone->contents), cache_stats);
+}
+
+static resp_cache_stats_t server_resp_cache_stats(server_t *server)
+{
+	resp_cache_stats_t cache_stats = { 0 };
+
+	rcu_read_lock();
+	knot_zonedb_foreach(server->zone_db, resp_cache_stats_cb, &cache_stats);
+	rcu_read_unlock();
+
+	return cache_stats;
+}
+
+static uint64_t server_resp_cache_hits(server_t *server)
+{
+	return server_resp_cache_stats(server).hits;
+}
+
+static uint64_t server_resp_cache_misses(server_t *server)
+{
+	return server_resp_cache_stats(server).misses;
+}
+
+static uint64_t server_resp_cache_size(server_t *server)
+{
+	return server_resp_cache_stats(server).size;
+}
+
+static knot_lmdb_batch_stats_t server_journal_stats(server_t *server)
+{
+	knot_lmdb_batch_stats_t journal_stats;
+	knot_lmdb_batch_stats(&server->journaldb, &journal_stats);
+	return journal_stats;
+}
+
+static uint64_t server_journal_commits(server_t *server)
+{
+	return server_journal_stats(server).commits;
+}
+
+static uint64_t server_journal_writes(server_t *server)
+{
+	return server_journal_stats(server).writes;
+}
+
+static uint64_t server_journal_batch_max(server_t *server)
+{
+	return server_journal_stats(server).max_writes;
+}
+
+static uint64_t server_journal_commit_avg(server_t *server)
+{
+	knot_lmdb_batch_stats_t journal_stats = server_journal_stats(server);
+	return (journal_stats.commits > 0) ?
+	       journal_stats.commit_usec / journal_stats.commits : 0;
+}
+
+static uint64_t server_journal_commit_max(server_t *server)
+{
+	return server_journal_stats(server).max_commit_usec;
+}
+
+#ifdef ENABLE_XDP
+static knot_xdp_stats_t server_xdp_stats(server_t *server)
+{
+	knot_xdp_stats_t sum = { 0 };
+
+	for (size_t i = 0; i < server->n_ifaces; i++) {
+		const iface_t *iface = &server->ifaces[i];
+		for (unsigned j = 0; j < iface->fd_xdp_count; j++) {
+			knot_xdp_stats_t sock_stats;
+			if (knot_xdp_stats(iface->xdp_sockets[j], &sock_stats) != KNOT_EOK) {
+				continue;
+			}
+			sum.rx_ring_full += sock_stats.rx_ring_full;
+			sum.fill_ring_empty += sock_stats.fill_ring_empty;
+			sum.tx_ring_empty += sock_stats.tx_ring_empty;
+			sum.tx_alloc_fail += sock_stats.tx_alloc_fail;
+			sum.rx_dropped += sock_stats.rx_dropped;
+		}
+	}
+
+	return sum;
+}
+
+static uint64_t server_xdp_rx_ring_full(server_t *server)
+{
+	return server_xdp_stats(server).rx_ring_full;
+}
+
+static uint64_t server_xdp_fill_ring_empty(server_t *server)
+{
+	return server_xdp_stats(server).fill_ring_empty;
+}
+
+static uint64_t server_xdp_tx_ring_empty(server_t *server)
+{
+	return server_xdp_stats(server).tx_ring_empty;
+}
+
+static uint64_t server_xdp_tx_alloc_fail(server_t *server)
+{
+	return server_xdp_stats(server).tx_alloc_fail;
+}
+
+static uint64_t server_xdp_rx_dropped(server_t *server)
+{
+	return server_xdp_stats(server).rx_dropped;
+}
+#endif
+
 const stats_item_t server_stats[] = {
 	{ "zone-count", server_zone_count },
+	{ "response-cache-hits", server_resp_cache_hits },
+	{ "response-cache-misses", server_resp_cache_misses },
+	{ "response-cache-size", server_resp_cache_size },
+	{ "journal-batch-commits", server_journal_commits },
+	{ "journal-batch-writes", server_journal_writes },
+	{ "journal-batch-max-writes", server_journal_batch_max },
+	{ "journal-commit-avg-usec", server_journal_commit_avg },
+	{ "journal-commit-max-usec", server_journal_commit_max },
+#ifdef ENABLE_XDP
+	{ "xdp-rx-ring-full", server_xdp_rx_ring_full },
+	{ "xdp-fill-ring-empty", server_xdp_fill_ring_empty },
+	{ "xdp-tx-ring-empty", server_xdp_tx_ring_empty },
+	{ "xdp-tx-alloc-fail", server_xdp_tx_alloc_fail },
+	{ "xdp-rx-dropped", server_xdp_rx_dropped },
+#endif
 	{ 0 }
 };
 
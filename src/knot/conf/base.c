@@ -195,6 +195,9 @@ static void init_cache(
 	val = conf_get(conf, C_XDP, C_TCP_IDLE_RESET);
 	conf->cache.xdp_tcp_idle_reset = conf_int(&val);
 
+	val = conf_get(conf, C_XDP, C_TCP_RESEND);
+	conf->cache.xdp_tcp_resend = conf_int(&val);
+
 	conf->cache.xdp_tcp = running_xdp_tcp;
 
 	conf->cache.xdp_route_check = running_route_check;
@@ -221,6 +224,9 @@ static void init_cache(
 
 	val = conf_get(conf, C_SRV, C_ANS_ROTATION);
 	conf->cache.srv_ans_rotate = conf_bool(&val);
+
+	val = conf_get(conf, C_SRV, C_XFR_FULL_COMPR);
+	conf->cache.srv_xfr_full_compr = conf_bool(&val);
 }
 
 int conf_new(
@@ -28,6 +28,7 @@
 #define C_ANY			"\x03""any"
 #define C_APPEND		"\x06""append"
 #define C_ASYNC_START		"\x0B""async-start"
+#define C_AXFR_CACHE_MAX_SIZE	"\x13""axfr-cache-max-size"
 #define C_BACKEND		"\x07""backend"
 #define C_BG_WORKERS		"\x12""background-workers"
 #define C_BLOCK_NOTIFY_XFR	"\x1B""block-notify-after-transfer"
@@ -54,12 +55,15 @@
 #define C_DS_PUSH		"\x07""ds-push"
 #define C_ECS			"\x12""edns-client-subnet"
 #define C_FILE			"\x04""file"
+#define C_FRAME_SIZE		"\x0A""frame-size"
 #define C_GLOBAL_MODULE		"\x0D""global-module"
+#define C_HUGEPAGES		"\x09""hugepages"
 #define C_ID			"\x02""id"
 #define C_IDENT			"\x08""identity"
 #define C_INCL			"\x07""include"
 #define C_JOURNAL_CONTENT	"\x0F""journal-content"
 #define C_JOURNAL_DB		"\x0A""journal-db"
+#define C_JOURNAL_DB_BATCH	"\x17""journal-db-batch-window"
 #define C_JOURNAL_DB_MAX_SIZE	"\x13""journal-db-max-size"
 #define C_JOURNAL_DB_MODE	"\x0F""journal-db-mode"
 #define C_JOURNAL_MAX_DEPTH	"\x11""journal-max-depth"
@@ -94,11 +98,13 @@
 #define C_REFRESH_MAX_INTERVAL	"\x14""refresh-max-interval"
 #define C_REFRESH_MIN_INTERVAL	"\x14""refresh-min-interval"
 #define C_REPRO_SIGNING		"\x14""reproducible-signing"
+#define C_RESP_CACHE_MAX_SIZE	"\x17""response-cache-max-size"
 #define C_RMT			"\x06""remote"
 #define C_RMTS			"\x07""remotes"
 #define C_RMT_POOL_LIMIT	"\x11""remote-pool-limit"
 #define C_RMT_POOL_TIMEOUT	"\x13""remote-pool-timeout"
 #define C_RMT_RETRY_DELAY	"\x12""remote-retry-delay"
+#define C_RING_SIZE		"\x09""ring-size"
 #define C_ROUTE_CHECK		"\x0B""route-check"
 #define C_RRSIG_LIFETIME	"\x0E""rrsig-lifetime"
 #define C_RRSIG_PREREFRESH	"\x11""rrsig-pre-refresh"
@@ -109,6 +115,7 @@
 #define C_SEM_CHECKS		"\x0F""semantic-checks"
 #define C_SERIAL_POLICY		"\x0D""serial-policy"
 #define C_SERVER		"\x06""server"
+#define C_SHARED_UMEM		"\x0B""shared-umem"
 #define C_SIGNING_THREADS	"\x0F""signing-threads"
 #define C_SINGLE_TYPE_SIGNING	"\x13""single-type-signing"
 #define C_SOCKET_AFFINITY	"\x0F""socket-affinity"
@@ -124,6 +131,7 @@
 #define C_TCP_INBUF_MAX_SIZE	"\x12""tcp-inbuf-max-size"
 #define C_TCP_IO_TIMEOUT	"\x0E""tcp-io-timeout"
 #define C_TCP_MAX_CLIENTS	"\x0F""tcp-max-clients"
+#define C_TCP_RESEND		"\x12""tcp-resend-timeout"
 #define C_TCP_REUSEPORT		"\x0D""tcp-reuseport"
 #define C_TCP_RMT_IO_TIMEOUT	"\x15""tcp-remote-io-timeout"
 #define C_TCP_WORKERS		"\x0B""tcp-workers"
@@ -145,7 +153,9 @@
 #define C_VERSION		"\x07""version"
 #define C_VIA			"\x03""via"
 #define C_XDP			"\x03""xdp"
+#define C_XFR_FULL_COMPR	"\x14""xfr-full-compression"
 #define C_ZONE			"\x04""zone"
+#define C_ZONEFILE_IMAGE	"\x0E""zonefile-image"
 #define C_ZONEFILE_LOAD		"\x0D""zonefile-load"
 #define C_ZONEFILE_SYNC		"\x0D""zonefile-sync"
 #define C_ZONEMD_GENERATE	"\x0F""zonemd-generate"
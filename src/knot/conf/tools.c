@@ -509,6 +509,21 @@ int check_xdp(
 	                                     C_SRV, C_LISTEN);
 	conf_val_t tcp = conf_get_txn(args->extra->conf, args->extra->txn, C_XDP,
 	                              C_TCP);
+	conf_val_t ring_size = conf_get_txn(args->extra->conf, args->extra->txn,
+	                                    C_XDP, C_RING_SIZE);
+	int64_t ring = conf_int(&ring_size);
+	if ((ring & (ring - 1)) != 0) {
+		args->err_str = "ring size must be a power of 2";
+		return KNOT_EINVAL;
+	}
+	conf_val_t frame_size = conf_get_txn(args->extra->conf, args->extra->txn,
+	                                     C_XDP, C_FRAME_SIZE);
+	int64_t frame = conf_int(&frame_size);
+	if (frame != 2048 && frame != 4096) {
+		args->err_str = "frame size must be 2048 or 4096";
+		return KNOT_EINVAL;
+	}
+
 	if (xdp_listen.code == KNOT_EOK) {
 		if (srv_listen.code != KNOT_EOK && tcp.code != KNOT_EOK) {
 			CONF_LOG(LOG_WARNING, "TCP processing not available");
@@ -1597,6 +1597,28 @@ static int ctl_zone(ctl_args_t *args, ctl_cmd_t cmd)
 	}
 }
 
+static int background_status(worker_pool_t *pool, char *buff, size_t size)
+{
+	size_t len = 0;
+	for (worker_class_t cls = 0; cls < WORKER_CLASS_COUNT; cls++) {
+		worker_class_stats_t stats;
+		worker_pool_stats(pool, cls, &stats);
+		uint64_t wait_avg = (stats.executed > 0) ? stats.wait_usec / stats.executed : 0;
+
+		int ret = snprintf(buff + len, size - len, "%s%s tasks: queued %"PRIu64
+		                   ", running %"PRIu64", executed %"PRIu64", wait avg %"PRIu64
+		                   " us, wait max %"PRIu64" us", (len > 0) ? "\n" : "",
+		                   worker_class_name(cls), stats.queued, stats.running,
+		                   stats.executed, wait_avg, stats.wait_max_usec);
+		if (ret <= 0 || ret >= size - len) {
+			return ret;
+		}
+		len += ret;
+	}
+
+	return len;
+}
+
 static int server_status(ctl_args_t *args)
 {
 	const char *type = args->data[KNOT_CTL_IDX_TYPE];
@@ -1612,12 +1634,14 @@ static int server_status(ctl_args_t *args)
 		ret = snprintf(buff, sizeof(buff), "Version: %s", PACKAGE_VERSION);
 	} else if (strcasecmp(type, "workers") == 0) {
 		int running_bkg_wrk, wrk_queue;
-		worker_pool_status(args->server->workers, false, &running_bkg_wrk, &wrk_queue);
+		worker_pool_status(args->server->workers, &running_bkg_wrk, &wrk_queue);
 		ret = snprintf(buff, sizeof(buff), "UDP workers: %zu, TCP workers: %zu, "
 		               "XDP workers: %zu, background workers: %zu (running: %d, pending: %d)",
 		               conf()->cache.srv_udp_threads, conf()->cache.srv_tcp_threads,
 		               conf()->cache.srv_xdp_threads, conf()->cache.srv_bg_threads,
 		               running_bkg_wrk, wrk_queue);
+	} else if (strcasecmp(type, "background") == 0) {
+		ret = background_status(args->server->workers, buff, sizeof(buff));
 	} else if (strcasecmp(type, "configure") == 0) {
 		ret = snprintf(buff, sizeof(buff), "%s", CONFIGURE_SUMMARY);
 	} else {
@@ -1,4 +1,4 @@
-/*  Copyright (C) 2020 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+/*  Copyright (C) 2021 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
 
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU General Public License as published by
@@ -69,18 +69,16 @@ int knot_create_nsec3_owner(uint8_t *out, size_t out_size,
 		.size = knot_dname_size(owner)
 	};
 
-	dnssec_binary_t hash = { 0 };
+	// Base32hex encoded hash has to fit into a single label.
+	uint8_t hash[KNOT_DNAME_MAXLABELLEN * 5 / 8];
+	size_t hash_size = dnssec_nsec3_hash_length(params->algorithm);
 
-	int ret = dnssec_nsec3_hash(&data, params, &hash);
+	int ret = dnssec_nsec3_hash_raw(&data, params, hash, sizeof(hash));
 	if (ret != DNSSEC_EOK) {
 		return knot_error_from_libdnssec(ret);
 	}
 
-	ret = knot_nsec3_hash_to_dname(out, out_size, hash.data, hash.size, zone_apex);
-
-	dnssec_binary_free(&hash);
-
-	return ret;
+	return knot_nsec3_hash_to_dname(out, out_size, hash, hash_size, zone_apex);
 }
 
 knot_dname_t *node_nsec3_hash(zone_node_t *node, const zone_contents_t *zone)
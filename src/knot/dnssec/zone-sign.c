@@ -497,14 +497,11 @@ static int sign_node_rrsets(const zone_node_t *node,
  * \brief Struct to carry data for 'sign_data' callback function.
  */
 typedef struct {
-	zone_tree_t *tree;
+	zone_tree_split_t *split;
 	zone_sign_ctx_t *sign_ctx;
 	changeset_t changeset;
 	knot_time_t expires_at;
 	dnssec_validation_hint_t *hint;
-	size_t num_threads;
-	size_t thread_index;
-	size_t rrset_index;
 	int errcode;
 	int thread_init_errcode;
 	pthread_t thread;
@@ -527,10 +524,6 @@ static int sign_node(zone_node_t *node, void *data)
 		return KNOT_EOK;
 	}
 
-	if (args->rrset_index++ % args->num_threads != args->thread_index) {
-		return KNOT_EOK;
-	}
-
 	int result = sign_node_rrsets(node, args->sign_ctx,
 	                              &args->changeset, &args->expires_at,
 	                              args->hint);
@@ -541,7 +534,7 @@ static int sign_node(zone_node_t *node, void *data)
 static void *tree_sign_thread(void *_arg)
 {
 	node_sign_args_t *arg = _arg;
-	arg->errcode = zone_tree_apply(arg->tree, sign_node, _arg);
+	arg->errcode = zone_tree_split_apply(arg->split, sign_node, _arg);
 	return NULL;
 }
 
@@ -574,14 +567,20 @@ static int zone_tree_sign(zone_tree_t *tree,
 	assert(dnssec_ctx);
 	assert(update || dnssec_ctx->validation_mode);
 
-	int ret = KNOT_EOK;
 	node_sign_args_t args[num_threads];
 	memset(args, 0, sizeof(args));
 	*expires_at = knot_time_plus(dnssec_ctx->now, dnssec_ctx->policy->rrsig_lifetime);
 
+	// split the tree so that each node is visited by one thread only
+	zone_tree_split_t split;
+	int ret = zone_tree_split_init(tree, num_threads, &split);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
 	// init context structures
 	for (size_t i = 0; i < num_threads; i++) {
-		args[i].tree = tree;
+		args[i].split = &split;
 		args[i].sign_ctx = dnssec_ctx->validation_mode
 		                 ? zone_validation_ctx(dnssec_ctx)
 		                 : zone_sign_ctx(zone_keys, dnssec_ctx);
@@ -595,9 +594,6 @@ static int zone_tree_sign(zone_tree_t *tree,
 		}
 		args[i].expires_at = 0;
 		args[i].hint = &update->validation_hint;
-		args[i].num_threads = num_threads;
-		args[i].thread_index = i;
-		args[i].rrset_index = 0;
 		args[i].errcode = KNOT_EOK;
 		args[i].thread_init_errcode = -1;
 	}
@@ -606,6 +602,7 @@ static int zone_tree_sign(zone_tree_t *tree,
 			changeset_clear(&args[i].changeset);
 			zone_sign_ctx_free(args[i].sign_ctx);
 		}
+		zone_tree_split_deinit(&split);
 		return ret;
 	}
 
@@ -644,6 +641,7 @@ static int zone_tree_sign(zone_tree_t *tree,
 		changeset_clear(&args[i].changeset);
 		zone_sign_ctx_free(args[i].sign_ctx);
 	}
+	zone_tree_split_deinit(&split);
 
 	return ret;
 }
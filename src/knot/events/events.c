@@ -28,6 +28,7 @@
 #include "knot/zone/zone.h"
 
 #define ZONE_EVENT_IMMEDIATE 1 /* Fast-track to worker queue. */
+#define ZONE_EVENT_RETRY 1000 /* Delay (ms) if the event couldn't be queued. */
 
 typedef int (*zone_event_cb)(conf_t *conf, zone_t *zone);
 
@@ -35,22 +36,23 @@ typedef struct event_info {
 	zone_event_type_t type;
 	const zone_event_cb callback;
 	const char *name;
+	worker_class_t cls;
 } event_info_t;
 
 static const event_info_t EVENT_INFO[] = {
-	{ ZONE_EVENT_LOAD,         event_load,        "load" },
-	{ ZONE_EVENT_REFRESH,      event_refresh,     "refresh" },
-	{ ZONE_EVENT_UPDATE,       event_update,      "update" },
-	{ ZONE_EVENT_EXPIRE,       event_expire,      "expiration" },
-	{ ZONE_EVENT_FLUSH,        event_flush,       "journal flush" },
-	{ ZONE_EVENT_BACKUP,       event_backup,      "backup/restore" },
-	{ ZONE_EVENT_NOTIFY,       event_notify,      "notify" },
-	{ ZONE_EVENT_DNSSEC,       event_dnssec,      "DNSSEC re-sign" },
-	{ ZONE_EVENT_UFREEZE,      event_ufreeze,     "update freeze" },
-	{ ZONE_EVENT_UTHAW,        event_uthaw,       "update thaw" },
-	{ ZONE_EVENT_NSEC3RESALT,  event_nsec3resalt, "NSEC3 resalt" },
-	{ ZONE_EVENT_DS_CHECK,     event_ds_check,    "DS check" },
-	{ ZONE_EVENT_DS_PUSH,      event_ds_push,     "DS push" },
+	{ ZONE_EVENT_LOAD,         event_load,        "load",           WORKER_CLASS_HEAVY },
+	{ ZONE_EVENT_REFRESH,      event_refresh,     "refresh",        WORKER_CLASS_URGENT },
+	{ ZONE_EVENT_UPDATE,       event_update,      "update",         WORKER_CLASS_NORMAL },
+	{ ZONE_EVENT_EXPIRE,       event_expire,      "expiration",     WORKER_CLASS_URGENT },
+	{ ZONE_EVENT_FLUSH,        event_flush,       "journal flush",  WORKER_CLASS_NORMAL },
+	{ ZONE_EVENT_BACKUP,       event_backup,      "backup/restore", WORKER_CLASS_HEAVY },
+	{ ZONE_EVENT_NOTIFY,       event_notify,      "notify",         WORKER_CLASS_URGENT },
+	{ ZONE_EVENT_DNSSEC,       event_dnssec,      "DNSSEC re-sign", WORKER_CLASS_HEAVY },
+	{ ZONE_EVENT_UFREEZE,      event_ufreeze,     "update freeze",  WORKER_CLASS_URGENT },
+	{ ZONE_EVENT_UTHAW,        event_uthaw,       "update thaw",    WORKER_CLASS_URGENT },
+	{ ZONE_EVENT_NSEC3RESALT,  event_nsec3resalt, "NSEC3 resalt",   WORKER_CLASS_HEAVY },
+	{ ZONE_EVENT_DS_CHECK,     event_ds_check,    "DS check",       WORKER_CLASS_URGENT },
+	{ ZONE_EVENT_DS_PUSH,      event_ds_push,     "DS push",        WORKER_CLASS_NORMAL },
 	{ 0 }
 };
 
@@ -266,12 +268,27 @@ static void event_dispatch(event_t *event)
 
 	zone_events_t *events = event->data;
 
+	int ret = KNOT_EOK;
 	pthread_mutex_lock(&events->mx);
 	if (!events->running && !events->frozen) {
+		zone_event_type_t type = get_next_event(events);
 		events->running = true;
-		worker_pool_assign(events->pool, &events->task);
+		events->task.cls = valid_event(type) ? get_event_info(type)->cls :
+		                                       WORKER_CLASS_NORMAL;
+		ret = worker_pool_assign(events->pool, &events->task);
+		if (ret != KNOT_EOK) {
+			events->running = false;
+		}
 	}
 	pthread_mutex_unlock(&events->mx);
+
+	/* The event stays planned, try to queue it again later. */
+	if (ret != KNOT_EOK) {
+		zone_t *zone = events->task.ctx;
+		log_zone_warning(zone->name, "failed to queue zone event (%s)",
+		                 knot_strerror(ret));
+		evsched_schedule(events->event, ZONE_EVENT_RETRY);
+	}
 }
 
 int zone_events_init(zone_t *zone)
@@ -425,8 +442,16 @@ void zone_events_enqueue(zone_t *zone, zone_event_type_t type)
 		events->running = true;
 		events->type = type;
 		event_set_time(events, type, ZONE_EVENT_IMMEDIATE);
-		worker_pool_assign(events->pool, &events->task);
+		events->task.cls = get_event_info(type)->cls;
+		if (worker_pool_assign(events->pool, &events->task) == KNOT_EOK) {
+			pthread_mutex_unlock(&events->mx);
+			return;
+		}
+		/* Not queued, leave the planned event to the scheduler. */
+		events->running = false;
+		events->type = ZONE_EVENT_INVALID;
 		pthread_mutex_unlock(&events->mx);
+		reschedule(events);
 		return;
 	}
 
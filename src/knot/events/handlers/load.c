@@ -95,7 +95,13 @@ int event_load(conf_t *conf, zone_t *zone)
 					   zone->zonefile.mtime.tv_sec == mtime.tv_sec &&
 					   zone->zonefile.mtime.tv_nsec == mtime.tv_nsec);
 		if (ret == KNOT_EOK) {
-			ret = zone_load_contents(conf, zone->name, &zf_conts, false);
+			ret = zone_load_image(conf, zone->name, &zf_conts);
+			if (ret == KNOT_ENOENT) {
+				ret = zone_load_contents(conf, zone->name, &zf_conts, false);
+				if (ret == KNOT_EOK) {
+					(void)zone_store_image(conf, zone->name, &mtime, zf_conts);
+				}
+			}
 		}
 		if (ret != KNOT_EOK) {
 			zf_conts = NULL;
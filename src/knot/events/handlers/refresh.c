@@ -118,6 +118,7 @@ struct refresh_data {
 
 	struct {
 		zone_contents_t *zone;    //!< AXFR result, new zone.
+		zcreator_t zc;            //!< Zone creator filling the new zone.
 	} axfr;
 
 	struct {
@@ -196,11 +197,17 @@ static int axfr_init(struct refresh_data *data)
 	}
 
 	data->axfr.zone = new_zone;
+	data->axfr.zc = (zcreator_t) {
+		.z = new_zone,
+		.master = false,
+		.ret = KNOT_EOK
+	};
 	return KNOT_EOK;
 }
 
 static void axfr_cleanup(struct refresh_data *data)
 {
+	zcreator_clear(&data->axfr.zc);
 	zone_contents_deep_free(data->axfr.zone);
 	data->axfr.zone = NULL;
 }
@@ -306,20 +313,17 @@ static int axfr_consume_rr(const knot_rrset_t *rr, struct refresh_data *data)
 	assert(data);
 	assert(data->axfr.zone);
 
-	// zc is stateless structure which can be initialized for each rr
-	// the changes are stored only in data->axfr.zone (aka zc.z)
-	zcreator_t zc = {
-		.z = data->axfr.zone,
-		.master = false,
-		.ret = KNOT_EOK
-	};
+	// The changes are stored only in data->axfr.zone (aka zc.z), consecutive
+	// RRs of one RRSet are inserted at once.
+	zcreator_t *zc = &data->axfr.zc;
 
 	if (rr->type == KNOT_RRTYPE_SOA &&
-	    node_rrtype_exists(zc.z->apex, KNOT_RRTYPE_SOA)) {
-		return KNOT_STATE_DONE;
+	    node_rrtype_exists(zc->z->apex, KNOT_RRTYPE_SOA)) {
+		data->ret = zcreator_flush(zc);
+		return (data->ret == KNOT_EOK) ? KNOT_STATE_DONE : KNOT_STATE_FAIL;
 	}
 
-	data->ret = zcreator_step(&zc, rr);
+	data->ret = zcreator_batch(zc, rr);
 	if (data->ret != KNOT_EOK) {
 		return KNOT_STATE_FAIL;
 	}
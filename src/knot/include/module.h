@@ -29,6 +29,7 @@
 #include <stdint.h>
 #include <syslog.h>
 #include <sys/socket.h>
+#include <time.h>
 
 #include <libknot/libknot.h>
 #include <libknot/yparser/ypschema.h>
@@ -101,6 +102,8 @@ typedef enum {
 	KNOTD_MOD_FLAG_SCOPE_ZONE   = 1 << 2, /*!< Can be specified as zone module. */
 	KNOTD_MOD_FLAG_SCOPE_ANY    = KNOTD_MOD_FLAG_SCOPE_GLOBAL |
 	                              KNOTD_MOD_FLAG_SCOPE_ZONE,
+	KNOTD_MOD_FLAG_CACHEABLE    = 1 << 3, /*!< Doesn't modify answer sections,
+	                                           responses can be cached. */
 } knotd_mod_flag_t;
 
 /*! Module API. */
@@ -404,6 +407,8 @@ typedef struct {
 	unsigned thread_id;                    /*!< Current thread id. */
 	void *server;                          /*!< Server object private item. */
 	const struct knot_xdp_msg *xdp_msg;    /*!< Possible XDP message context. */
+	const struct cmsghdr *pktinfo;         /*!< Possible UDP destination address info. */
+	struct timespec begin;                 /*!< Query reception time (CLOCK_MONOTONIC) or zero. */
 } knotd_qdata_params_t;
 
 /*! Query processing data context. */
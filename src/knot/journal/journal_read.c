@@ -32,6 +32,8 @@ struct journal_read {
 	const knot_dname_t *zone;
 	wire_ctx_t wire;
 	uint32_t next;
+	journal_rr_t rr;      // Header of the RRSet being read by journal_read_rr().
+	uint16_t rr_left;     // Remaining RRs of the RRSet being read by journal_read_rr().
 };
 
 int journal_read_get_error(const journal_read_t *ctx, int another_error)
@@ -161,6 +163,44 @@ bool journal_read_rrset(journal_read_t *ctx, knot_rrset_t *rrset, bool allow_nex
 	}
 }
 
+bool journal_read_rr(journal_read_t *ctx, journal_rr_t *rr, bool allow_next_changeset)
+{
+	if (ctx->rr_left == 0) {
+		if (!make_data_available(ctx)) {
+			if (!allow_next_changeset || !go_next_changeset(ctx, false, ctx->zone)) {
+				return false;
+			}
+		}
+		ctx->rr.owner = ctx->wire.position;
+		wire_ctx_skip(&ctx->wire, knot_dname_size(ctx->rr.owner));
+		ctx->rr.type = wire_ctx_read_u16(&ctx->wire);
+		ctx->rr.rclass = wire_ctx_read_u16(&ctx->wire);
+		ctx->rr_left = wire_ctx_read_u16(&ctx->wire);
+		if (ctx->rr_left == 0 && ctx->wire.error == KNOT_EOK) {
+			ctx->wire.error = KNOT_EMALF;
+		}
+	}
+	if (ctx->wire.error == KNOT_EOK && !make_data_available(ctx)) {
+		ctx->wire.error = KNOT_EFEWDATA;
+	}
+	ctx->rr.ttl = wire_ctx_read_u32(&ctx->wire);
+	ctx->rr.len = wire_ctx_read_u16(&ctx->wire);
+	ctx->rr.data = ctx->wire.position;
+	wire_ctx_skip(&ctx->wire, ctx->rr.len);
+	ctx->rr_left--;
+
+	if (ctx->txn.ret == KNOT_EOK) {
+		ctx->txn.ret = ctx->wire.error == KNOT_ERANGE ? KNOT_EMALF : ctx->wire.error;
+	}
+	if (ctx->txn.ret == KNOT_EOK) {
+		*rr = ctx->rr;
+		return true;
+	} else {
+		ctx->rr_left = 0;
+		return false;
+	}
+}
+
 void journal_read_clear_rrset(knot_rrset_t *rr)
 {
 	knot_rrset_clear(rr, NULL);
@@ -20,6 +20,16 @@
 
 typedef struct journal_read journal_read_t;
 
+/*! \brief Single RR pointing directly into the serialized journal data. */
+typedef struct {
+	const knot_dname_t *owner;  /*!< Uncompressed owner. */
+	uint16_t type;
+	uint16_t rclass;
+	uint32_t ttl;
+	uint16_t len;               /*!< Rdata length. */
+	const uint8_t *data;        /*!< Rdata in wire format. */
+} journal_rr_t;
+
 typedef int (*journal_read_cb_t)(bool in_remove_section, const knot_rrset_t *rr, void *ctx);
 
 typedef int (*journal_walk_cb_t)(bool special, const changeset_t *ch, void *ctx);
@@ -54,6 +64,22 @@ bool journal_read_rrset(journal_read_t *ctx, knot_rrset_t *rr, bool allow_next_c
  */
 void journal_read_clear_rrset(knot_rrset_t *rr);
 
+/*!
+ * \brief Read a single RR from a journal changeset without copying it.
+ *
+ * The RRSets are returned RR by RR in the serialized order. The returned data
+ * point into the database and stay valid until journal_read_end().
+ *
+ * \note Don't mix with journal_read_rrset() within one RRSet.
+ *
+ * \param ctx                    Journal reading context.
+ * \param rr                     Output: RR pointing to the serialized data.
+ * \param allow_next_changeset   True to allow jumping to next changeset.
+ *
+ * \return False if no more RR in this changeset/journal, or failure.
+ */
+bool journal_read_rr(journal_read_t *ctx, journal_rr_t *rr, bool allow_next_changeset);
+
 // TODO move somewhere. Libknot?
 inline static bool rr_is_apex_soa(const knot_rrset_t *rr, const knot_dname_t *apex)
 {
@@ -212,64 +212,69 @@ void journal_fix_occupation(zone_journal_t j, knot_lmdb_txn_t *txn, journal_meta
 	}
 }
 
-int journal_insert_zone(zone_journal_t j, const zone_contents_t *z)
+/*! \brief Parameters of an insert performed in a batched write transaction. */
+typedef struct {
+	zone_journal_t j;
+	const changeset_t *ch;
+	const changeset_t *extra;
+	const zone_contents_t *zone;
+	size_t ch_size;
+	size_t max_usage;
+} insert_ctx_t;
+
+static void insert_zone_cb(knot_lmdb_txn_t *txn, void *ctx)
 {
-	changeset_t fake_ch = { .add = (zone_contents_t *)z };
-	size_t ch_size = changeset_serialized_size(&fake_ch);
-	size_t max_usage = journal_conf_max_usage(j);
-	if (ch_size >= max_usage) {
-		return KNOT_ESPACE;
-	}
-	int ret = knot_lmdb_open(j.db);
-	if (ret != KNOT_EOK) {
-		return ret;
-	}
-	knot_lmdb_txn_t txn = { 0 };
-	knot_lmdb_begin(j.db, &txn, true);
+	insert_ctx_t *ins = ctx;
+	const knot_dname_t *zone = ins->j.zone;
+	const zone_contents_t *z = ins->zone;
 
-	update_last_inserter(&txn, j.zone);
-	journal_del_zone_txn(&txn, j.zone);
+	update_last_inserter(txn, zone);
+	journal_del_zone_txn(txn, zone);
 
-	journal_write_zone(&txn, z);
+	journal_write_zone(txn, z);
 
 	journal_metadata_t md = { 0 };
 	md.flags = JOURNAL_SERIAL_TO_VALID;
 	md.serial_to = zone_contents_serial(z);
 	md.first_serial = md.serial_to;
-	journal_store_metadata(&txn, j.zone, &md);
-
-	knot_lmdb_commit(&txn);
-	return txn.ret;
+	journal_store_metadata(txn, zone, &md);
 }
 
-int journal_insert(zone_journal_t j, const changeset_t *ch, const changeset_t *extra)
+int journal_insert_zone(zone_journal_t j, const zone_contents_t *z)
 {
-	size_t ch_size = changeset_serialized_size(ch);
+	changeset_t fake_ch = { .add = (zone_contents_t *)z };
+	size_t ch_size = changeset_serialized_size(&fake_ch);
 	size_t max_usage = journal_conf_max_usage(j);
 	if (ch_size >= max_usage) {
 		return KNOT_ESPACE;
 	}
-	if (extra != NULL && (changeset_to(extra) != changeset_to(ch) ||
-	     changeset_from(extra) == changeset_from(ch))) {
-		return KNOT_EINVAL;
-	}
 	int ret = knot_lmdb_open(j.db);
 	if (ret != KNOT_EOK) {
 		return ret;
 	}
-	knot_lmdb_txn_t txn = { 0 };
+
+	insert_ctx_t ctx = { .j = j, .zone = z };
+	return knot_lmdb_batch_write(j.db, j.zone, ch_size, insert_zone_cb, &ctx);
+}
+
+static void insert_cb(knot_lmdb_txn_t *txn, void *ctx)
+{
+	insert_ctx_t *ins = ctx;
+	zone_journal_t j = ins->j;
+	const changeset_t *ch = ins->ch, *extra = ins->extra;
+	size_t ch_size = ins->ch_size;
+
 	journal_metadata_t md = { 0 };
-	knot_lmdb_begin(j.db, &txn, true);
-	journal_load_metadata(&txn, j.zone, &md);
+	journal_load_metadata(txn, j.zone, &md);
 
-	update_last_inserter(&txn, j.zone);
+	update_last_inserter(txn, j.zone);
 
 	if (extra != NULL) {
-		if (journal_contains(&txn, true, 0, j.zone)) {
-			txn.ret = KNOT_ESEMCHECK;
+		if (journal_contains(txn, true, 0, j.zone)) {
+			txn->ret = KNOT_ESEMCHECK;
 		}
 		uint64_t merged_freed = 0;
-		delete_merged(&txn, j.zone, &md, &merged_freed);
+		delete_merged(txn, j.zone, &md, &merged_freed);
 		ch_size += changeset_serialized_size(extra);
 		ch_size -= merged_freed;
 		md.flushed_upto = md.serial_to; // set temporarily
@@ -277,32 +282,57 @@ int journal_insert(zone_journal_t j, const changeset_t *ch, const changeset_t *e
 	}
 
 	size_t chs_limit = journal_conf_max_changesets(j);
-	journal_fix_occupation(j, &txn, &md, max_usage - ch_size, chs_limit - 1);
+	journal_fix_occupation(j, txn, &md, ins->max_usage - ch_size, chs_limit - 1);
 
 	// avoid discontinuity
 	if ((md.flags & JOURNAL_SERIAL_TO_VALID) && md.serial_to != changeset_from(ch)) {
-		if (journal_contains(&txn, true, 0, j.zone)) {
-			txn.ret = KNOT_ESEMCHECK;
+		if (journal_contains(txn, true, 0, j.zone)) {
+			txn->ret = KNOT_ESEMCHECK;
 		} else {
-			journal_del_zone_txn(&txn, j.zone);
+			journal_del_zone_txn(txn, j.zone);
 			memset(&md, 0, sizeof(md));
 		}
 	}
 
 	// avoid cycle
-	if (journal_contains(&txn, false, changeset_to(ch), j.zone)) {
-		journal_fix_occupation(j, &txn, &md, INT64_MAX, 1);
+	if (journal_contains(txn, false, changeset_to(ch), j.zone)) {
+		journal_fix_occupation(j, txn, &md, INT64_MAX, 1);
 	}
 
-	journal_write_changeset(&txn, ch);
+	journal_write_changeset(txn, ch);
 	journal_metadata_after_insert(&md, changeset_from(ch), changeset_to(ch));
 
 	if (extra != NULL) {
-		journal_write_changeset(&txn, extra);
+		journal_write_changeset(txn, extra);
 		journal_metadata_after_extra(&md, changeset_from(extra), changeset_to(extra));
 	}
 
-	journal_store_metadata(&txn, j.zone, &md);
-	knot_lmdb_commit(&txn);
-	return txn.ret;
+	journal_store_metadata(txn, j.zone, &md);
+}
+
+int journal_insert(zone_journal_t j, const changeset_t *ch, const changeset_t *extra)
+{
+	size_t ch_size = changeset_serialized_size(ch);
+	size_t max_usage = journal_conf_max_usage(j);
+	if (ch_size >= max_usage) {
+		return KNOT_ESPACE;
+	}
+	if (extra != NULL && (changeset_to(extra) != changeset_to(ch) ||
+	     changeset_from(extra) == changeset_from(ch))) {
+		return KNOT_EINVAL;
+	}
+	int ret = knot_lmdb_open(j.db);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	insert_ctx_t ctx = {
+		.j = j,
+		.ch = ch,
+		.extra = extra,
+		.ch_size = ch_size,
+		.max_usage = max_usage
+	};
+	size_t batch_size = ch_size + (extra != NULL ? changeset_serialized_size(extra) : 0);
+	return knot_lmdb_batch_write(j.db, j.zone, batch_size, insert_cb, &ctx);
 }
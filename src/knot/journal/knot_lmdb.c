@@ -18,12 +18,14 @@
 #include <stdio.h> // snprintf
 #include <stdlib.h>
 #include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "knot/journal/knot_lmdb.h"
 
 #include "knot/conf/conf.h"
 #include "contrib/files.h"
+#include "contrib/macros.h"
 #include "contrib/wire_ctx.h"
 #include "libknot/dname.h"
 #include "libknot/endian.h"
@@ -32,6 +34,20 @@
 #define LMDB_DIR_MODE   0770
 #define LMDB_FILE_MODE  0660
 
+#define LMDB_BATCH_MAX_WRITES  256
+#define LMDB_BATCH_MAX_SIZE    (16 * 1024 * 1024)
+
+/*! \brief Write operation waiting for a batch. */
+typedef struct {
+	node_t n;
+	const knot_dname_t *name;
+	size_t size;
+	knot_lmdb_batch_cb cb;
+	void *ctx;
+	int ret;
+	bool done;
+} batch_req_t;
+
 static void err_to_knot(int *err)
 {
 	switch (*err) {
@@ -81,6 +97,12 @@ void knot_lmdb_init(knot_lmdb_db_t *db, const char *path, size_t mapsize, unsign
 	pthread_mutex_init(&db->opening_mutex, NULL);
 	db->maxdbs = 2;
 	db->maxreaders = conf_lmdb_readers(conf());
+	db->batch_window = 0;
+	pthread_mutex_init(&db->batch_mutex, NULL);
+	pthread_cond_init(&db->batch_cond, NULL);
+	init_list(&db->batch_queue);
+	db->batch_leader = false;
+	memset(&db->batch_stats, 0, sizeof(db->batch_stats));
 }
 
 static int lmdb_stat(const char *lmdb_path, struct stat *st)
@@ -267,6 +289,8 @@ void knot_lmdb_deinit(knot_lmdb_db_t *db)
 {
 	knot_lmdb_close(db);
 	pthread_mutex_destroy(&db->opening_mutex);
+	pthread_mutex_destroy(&db->batch_mutex);
+	pthread_cond_destroy(&db->batch_cond);
 	free(db->path);
 }
 
@@ -319,6 +343,174 @@ void knot_lmdb_commit(knot_lmdb_txn_t *txn)
 	txn->opened = false;
 }
 
+static uint64_t usec_since(const struct timespec *begin)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - begin->tv_sec) * 1000000 +
+	       (now.tv_nsec - begin->tv_nsec) / 1000;
+}
+
+static void batch_single(knot_lmdb_db_t *db, batch_req_t *req)
+{
+	knot_lmdb_txn_t txn = { 0 };
+	knot_lmdb_begin(db, &txn, true);
+	if (txn.ret == KNOT_EOK) {
+		req->cb(&txn, req->ctx);
+	}
+	knot_lmdb_commit(&txn);
+	req->ret = txn.ret;
+}
+
+static bool batch_conflicts(list_t *batch, const batch_req_t *req)
+{
+	batch_req_t *taken;
+	WALK_LIST(taken, *batch) {
+		if (knot_dname_is_equal(taken->name, req->name)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// Must be called with db->batch_mutex locked.
+static size_t batch_take(knot_lmdb_db_t *db, list_t *batch)
+{
+	size_t count = 0, size = 0;
+	batch_req_t *req, *nxt;
+	WALK_LIST_DELSAFE(req, nxt, db->batch_queue) {
+		if (count >= LMDB_BATCH_MAX_WRITES) {
+			break;
+		}
+		if ((count > 0 && size + req->size > LMDB_BATCH_MAX_SIZE) ||
+		    batch_conflicts(batch, req)) {
+			continue;
+		}
+		rem_node(&req->n);
+		add_tail(batch, &req->n);
+		size += req->size;
+		count++;
+	}
+	return count;
+}
+
+static int batch_run(knot_lmdb_db_t *db, list_t *batch, uint64_t *commit_usec)
+{
+	knot_lmdb_txn_t txn = { 0 };
+	knot_lmdb_begin(db, &txn, true);
+
+	batch_req_t *req;
+	WALK_LIST(req, *batch) {
+		if (txn.ret != KNOT_EOK) {
+			req->ret = txn.ret;
+			continue;
+		}
+
+		// Nested transaction, so that a failed operation doesn't affect the others.
+		knot_lmdb_txn_t nested = { 0 };
+		nested.ret = mdb_txn_begin(db->env, txn.txn, 0, &nested.txn);
+		err_to_knot(&nested.ret);
+		if (nested.ret == KNOT_EOK) {
+			nested.opened = true;
+			nested.db = db;
+			nested.is_rw = true;
+			req->cb(&nested, req->ctx);
+		}
+		knot_lmdb_commit(&nested);
+		req->ret = nested.ret;
+	}
+
+	struct timespec begin;
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	knot_lmdb_commit(&txn);
+	*commit_usec = usec_since(&begin);
+
+	WALK_LIST(req, *batch) {
+		if (req->ret == KNOT_EOK) {
+			req->ret = txn.ret;
+		}
+	}
+
+	return txn.ret;
+}
+
+// Must be called with db->batch_mutex locked.
+static void batch_stats_add(knot_lmdb_db_t *db, size_t count, uint64_t commit_usec)
+{
+	knot_lmdb_batch_stats_t *stats = &db->batch_stats;
+	stats->commits++;
+	stats->writes += count;
+	stats->max_writes = MAX(stats->max_writes, count);
+	stats->commit_usec += commit_usec;
+	stats->max_commit_usec = MAX(stats->max_commit_usec, commit_usec);
+}
+
+int knot_lmdb_batch_write(knot_lmdb_db_t *db, const knot_dname_t *name, size_t size,
+                          knot_lmdb_batch_cb cb, void *ctx)
+{
+	if (db == NULL || name == NULL || cb == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	batch_req_t req = { .name = name, .size = size, .cb = cb, .ctx = ctx };
+
+	// Nothing to save without disk synchronization, nested txns unsupported.
+	if (db->env_flags & (MDB_WRITEMAP | MDB_NOSYNC | MDB_MAPASYNC)) {
+		batch_single(db, &req);
+		return req.ret;
+	}
+
+	pthread_mutex_lock(&db->batch_mutex);
+	add_tail(&db->batch_queue, &req.n);
+	while (!req.done) {
+		if (db->batch_leader) {
+			pthread_cond_wait(&db->batch_cond, &db->batch_mutex);
+			continue;
+		}
+
+		// Become the leader and perform the batch including the pending operations.
+		db->batch_leader = true;
+		if (db->batch_window > 0) {
+			pthread_mutex_unlock(&db->batch_mutex);
+			struct timespec window = {
+				.tv_sec = db->batch_window / 1000,
+				.tv_nsec = (db->batch_window % 1000) * 1000000
+			};
+			(void)nanosleep(&window, NULL);
+			pthread_mutex_lock(&db->batch_mutex);
+		}
+
+		list_t batch;
+		init_list(&batch);
+		size_t count = batch_take(db, &batch);
+		pthread_mutex_unlock(&db->batch_mutex);
+
+		uint64_t commit_usec = 0;
+		int ret = batch_run(db, &batch, &commit_usec);
+
+		pthread_mutex_lock(&db->batch_mutex);
+		if (ret == KNOT_EOK) {
+			batch_stats_add(db, count, commit_usec);
+		}
+		batch_req_t *done;
+		WALK_LIST(done, batch) {
+			done->done = true;
+		}
+		db->batch_leader = false;
+		pthread_cond_broadcast(&db->batch_cond);
+	}
+	pthread_mutex_unlock(&db->batch_mutex);
+
+	return req.ret;
+}
+
+void knot_lmdb_batch_stats(knot_lmdb_db_t *db, knot_lmdb_batch_stats_t *stats)
+{
+	pthread_mutex_lock(&db->batch_mutex);
+	*stats = db->batch_stats;
+	pthread_mutex_unlock(&db->batch_mutex);
+}
+
 // save the programmer's frequent checking for ENOMEM when creating search keys
 static bool txn_enomem(knot_lmdb_txn_t *txn, const MDB_val *tocheck)
 {
@@ -23,6 +23,18 @@
 #include <stdlib.h>
 #include <pthread.h>
 
+#include "contrib/ucw/lists.h"
+#include "libknot/dname.h"
+
+/*! \brief Statistics of the batched write transactions. */
+typedef struct {
+	uint64_t commits;          /*!< Number of committed batches. */
+	uint64_t writes;           /*!< Number of batched write operations. */
+	uint64_t max_writes;       /*!< The largest number of operations in a batch. */
+	uint64_t commit_usec;      /*!< Total duration of the batch commits. */
+	uint64_t max_commit_usec;  /*!< The longest batch commit. */
+} knot_lmdb_batch_stats_t;
+
 typedef struct knot_lmdb_db {
 	MDB_dbi dbi;
 	MDB_env *env;
@@ -31,12 +43,20 @@ typedef struct knot_lmdb_db {
 	// those are static options. Set them after knot_lmdb_init().
 	unsigned maxdbs;
 	unsigned maxreaders;
+	unsigned batch_window; // Time in milliseconds to collect batched writes.
 
 	// those are internal options. Please don't touch them directly.
 	size_t mapsize;
 	unsigned env_flags; // MDB_NOTLS, MDB_RDONLY, MDB_WRITEMAP, MDB_DUPSORT, MDB_NOSYNC, MDB_MAPASYNC
 	const char *dbname;
 	char *path;
+
+	// write batching, see knot_lmdb_batch_write()
+	pthread_mutex_t batch_mutex;
+	pthread_cond_t batch_cond;
+	list_t batch_queue;
+	bool batch_leader;
+	knot_lmdb_batch_stats_t batch_stats;
 } knot_lmdb_db_t;
 
 typedef struct {
@@ -58,6 +78,13 @@ typedef enum {
 	KNOT_LMDB_FORCE = 4,   /*! \brief If no matching key found, consider it a transaction failure (KNOT_ENOENT). */
 } knot_lmdb_find_t;
 
+/*!
+ * \brief Callback used in batched writes.
+ *
+ * \note The error code shall be stored in txn->ret.
+ */
+typedef void (*knot_lmdb_batch_cb)(knot_lmdb_txn_t *txn, void *ctx);
+
 /*!
  * \brief Callback used in sweep functions.
  *
@@ -188,6 +215,38 @@ void knot_lmdb_abort(knot_lmdb_txn_t *txn);
  */
 void knot_lmdb_commit(knot_lmdb_txn_t *txn);
 
+/*!
+ * \brief Perform a write operation in a transaction shared with concurrent writers.
+ *
+ * The operations queued by concurrent threads are executed by one of them in
+ * a common transaction, each in its own nested transaction, and committed
+ * at once, so the disk synchronization is paid once per batch. Operations
+ * with equal names are never put into the same batch. The function returns
+ * when the batch with the operation has been committed.
+ *
+ * \note Without nested transaction support (MDB_WRITEMAP) or disk
+ *       synchronization (MDB_NOSYNC, MDB_MAPASYNC), the operation is
+ *       simply performed in its own transaction.
+ *
+ * \param db     The database.
+ * \param name   Name of the written object (e.g. zone name).
+ * \param size   Estimated size of the written data.
+ * \param cb     Callback performing the write operation.
+ * \param ctx    Arbitrary context for the callback.
+ *
+ * \return KNOT_E* of the operation and the commit.
+ */
+int knot_lmdb_batch_write(knot_lmdb_db_t *db, const knot_dname_t *name, size_t size,
+                          knot_lmdb_batch_cb cb, void *ctx);
+
+/*!
+ * \brief Get the statistics of the batched writes.
+ *
+ * \param db      The database.
+ * \param stats   Output: statistics.
+ */
+void knot_lmdb_batch_stats(knot_lmdb_db_t *db, knot_lmdb_batch_stats_t *stats);
+
 /*!
  * \brief Find a key in database. The matched key will be in txn->cur_key and its value in txn->cur_val.
  *
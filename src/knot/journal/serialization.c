@@ -358,6 +358,7 @@ int deserialize_rrset(wire_ctx_t *wire, knot_rrset_t *rrset)
 	}
 	knot_rrset_init(rrset, owner, type, rclass, 0);
 
+	size_t capacity = 0;
 	for (size_t phase = 0; phase < rrcount && wire_ctx_available(wire) > 0; phase++) {
 		uint32_t ttl = wire_ctx_read_u32(wire);
 		uint32_t rdata_size = wire_ctx_read_u16(wire);
@@ -366,8 +367,8 @@ int deserialize_rrset(wire_ctx_t *wire, knot_rrset_t *rrset)
 		}
 		if (wire->error != KNOT_EOK ||
 		    wire_ctx_available(wire) < rdata_size ||
-		    knot_rrset_add_rdata(rrset, wire->position, rdata_size,
-					 NULL) != KNOT_EOK) {
+		    knot_rrset_append_rdata(rrset, wire->position, rdata_size,
+		                            &capacity, NULL) != KNOT_EOK) {
 			knot_rrset_clear(rrset, NULL);
 			return KNOT_EMALF;
 		}
@@ -375,6 +376,12 @@ int deserialize_rrset(wire_ctx_t *wire, knot_rrset_t *rrset)
 		assert(wire->error == KNOT_EOK);
 	}
 
+	int ret = knot_rdataset_sort(&rrset->rrs, NULL);
+	if (ret != KNOT_EOK) {
+		knot_rrset_clear(rrset, NULL);
+		return ret;
+	}
+
 	return KNOT_EOK;
 }
 
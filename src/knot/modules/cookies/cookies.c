@@ -303,5 +303,6 @@ void cookies_unload(knotd_mod_t *mod)
 	free(ctx);
 }
 
-KNOTD_MOD_API(cookies, KNOTD_MOD_FLAG_SCOPE_ANY | KNOTD_MOD_FLAG_OPT_CONF,
+KNOTD_MOD_API(cookies, KNOTD_MOD_FLAG_SCOPE_ANY | KNOTD_MOD_FLAG_OPT_CONF |
+                       KNOTD_MOD_FLAG_CACHEABLE,
               cookies_load, cookies_unload, cookies_conf, cookies_conf_check);
@@ -0,0 +1,577 @@
+/*  Copyright (C) 2021 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define __APPLE_USE_RFC_3542
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "knot/modules/dnsproxy/async_fwd.h"
+#include "contrib/net.h"
+#include "contrib/sockaddr.h"
+#include "contrib/ucw/lists.h"
+#include "libdnssec/random.h"
+#include "libknot/attribute.h"
+#include "libknot/libknot.h"
+
+#define ASYNC_FWD_SOCKETS	4
+#define ASYNC_FWD_MAX_PENDING	4096 /* Per socket, must be far below 65536. */
+
+#if defined(IP_PKTINFO) || defined(IP_SENDSRCADDR)
+  #define ASYNC_FWD_SRCADDR4
+#endif
+
+typedef struct {
+	node_t n;
+	struct timespec deadline;
+	struct sockaddr_storage client;
+	struct sockaddr_storage local; /*!< Response source if the socket is a wildcard one. */
+	int client_fd;         /*!< Forwarder's own socket to answer from. */
+	uint16_t id;           /*!< Upstream message ID. */
+	uint16_t question_len; /*!< Length of the header and the question. */
+	uint16_t opt_len;      /*!< Length of the response OPT, 0 if no EDNS. */
+	uint8_t question[];    /*!< Original header and question, response OPT. */
+} fwd_query_t;
+
+/*!
+ * \brief Forwarder's duplicate of a server socket.
+ *
+ * The duplicate stays valid until the forwarder is freed, even if the server
+ * closes its socket (e.g. during shutdown) and the descriptor number is reused.
+ */
+typedef struct {
+	struct sockaddr_storage addr;
+	int fd;
+} fwd_local_t;
+
+/*! \brief Control message to fit IP_PKTINFO, IP_SENDSRCADDR, or IPV6_PKTINFO. */
+typedef union {
+	struct cmsghdr cmsg;
+	uint8_t buf[CMSG_SPACE(sizeof(struct in6_pktinfo))];
+} fwd_pktinfo_t;
+
+typedef struct {
+	int fd;
+	pthread_mutex_t lock;
+	list_t pending;        /*!< Pending queries ordered by deadline. */
+	size_t count;
+	fwd_query_t **ids;     /*!< Pending queries indexed by the upstream ID. */
+} fwd_upstream_t;
+
+struct async_fwd {
+	int timeout_ms;
+	int wake[2];           /*!< Pipe to wake up the thread. */
+	volatile bool stop;
+	pthread_t thread;
+	fwd_upstream_t upstreams[ASYNC_FWD_SOCKETS];
+	pthread_mutex_t locals_lock;
+	unsigned locals_count;
+	unsigned locals_max;
+	fwd_local_t *locals;
+};
+
+static void timespec_add_ms(struct timespec *ts, int ms)
+{
+	ts->tv_sec += ms / 1000;
+	ts->tv_nsec += (ms % 1000) * 1000000L;
+	if (ts->tv_nsec >= 1000000000L) {
+		ts->tv_sec += 1;
+		ts->tv_nsec -= 1000000000L;
+	}
+}
+
+static bool timespec_passed(const struct timespec *ts, const struct timespec *now)
+{
+	return now->tv_sec > ts->tv_sec ||
+	       (now->tv_sec == ts->tv_sec && now->tv_nsec >= ts->tv_nsec);
+}
+
+static void wake_up(async_fwd_t *fwd)
+{
+	uint8_t byte = 0;
+	_unused_ ssize_t ret = write(fwd->wake[1], &byte, sizeof(byte));
+}
+
+/*! \brief Set the source address of a response sent from a wildcard socket. */
+static void set_source(struct msghdr *msg, fwd_pktinfo_t *pktinfo,
+                       const struct sockaddr_storage *src)
+{
+	memset(pktinfo, 0, sizeof(*pktinfo));
+	struct cmsghdr *cmsg = &pktinfo->cmsg;
+	msg->msg_control = pktinfo->buf;
+
+	if (src->ss_family == AF_INET6) {
+		cmsg->cmsg_level = IPPROTO_IPV6;
+		cmsg->cmsg_type = IPV6_PKTINFO;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(struct in6_pktinfo));
+		struct in6_pktinfo *info = (struct in6_pktinfo *)CMSG_DATA(cmsg);
+		info->ipi6_addr = ((const struct sockaddr_in6 *)src)->sin6_addr;
+		msg->msg_controllen = CMSG_SPACE(sizeof(struct in6_pktinfo));
+	} else {
+#if defined(IP_PKTINFO)
+		cmsg->cmsg_level = IPPROTO_IP;
+		cmsg->cmsg_type = IP_PKTINFO;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(struct in_pktinfo));
+		struct in_pktinfo *info = (struct in_pktinfo *)CMSG_DATA(cmsg);
+		info->ipi_spec_dst = ((const struct sockaddr_in *)src)->sin_addr;
+		msg->msg_controllen = CMSG_SPACE(sizeof(struct in_pktinfo));
+#elif defined(IP_SENDSRCADDR)
+		cmsg->cmsg_level = IPPROTO_IP;
+		cmsg->cmsg_type = IP_SENDSRCADDR;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(struct in_addr));
+		struct in_addr *addr = (struct in_addr *)CMSG_DATA(cmsg);
+		*addr = ((const struct sockaddr_in *)src)->sin_addr;
+		msg->msg_controllen = CMSG_SPACE(sizeof(struct in_addr));
+#endif
+	}
+}
+
+static void send_to_client(const fwd_query_t *q, const uint8_t *wire, size_t len)
+{
+	struct iovec iov = { .iov_base = (uint8_t *)wire, .iov_len = len };
+	struct msghdr msg = {
+		.msg_name = (void *)&q->client,
+		.msg_namelen = sockaddr_len(&q->client),
+		.msg_iov = &iov,
+		.msg_iovlen = 1
+	};
+
+	fwd_pktinfo_t pktinfo;
+	if (q->local.ss_family != AF_UNSPEC) {
+		set_source(&msg, &pktinfo, &q->local);
+	}
+
+	(void)sendmsg(q->client_fd, &msg, 0);
+}
+
+/*! \brief Unlink the query from its upstream, must be called under the lock. */
+static void query_unlink(fwd_upstream_t *up, fwd_query_t *q)
+{
+	up->ids[q->id] = NULL;
+	rem_node(&q->n);
+	up->count--;
+}
+
+static bool question_match(const fwd_query_t *q, const uint8_t *wire, size_t len)
+{
+	if (len < q->question_len || knot_wire_get_qdcount(wire) != 1) {
+		return false;
+	}
+
+	const uint8_t *qname = q->question + KNOT_WIRE_HEADER_SIZE;
+	const uint8_t *rname = wire + KNOT_WIRE_HEADER_SIZE;
+	if (knot_dname_wire_check(rname, wire + len, NULL) != knot_dname_size(qname) ||
+	    !knot_dname_is_case_equal(qname, rname)) {
+		return false;
+	}
+
+	// Compare QTYPE and QCLASS.
+	size_t qtype_pos = q->question_len - 2 * sizeof(uint16_t);
+	return memcmp(q->question + qtype_pos, wire + qtype_pos, 2 * sizeof(uint16_t)) == 0;
+}
+
+static void upstream_response(fwd_upstream_t *up, uint8_t *wire, size_t len)
+{
+	if (len < KNOT_WIRE_HEADER_SIZE || !knot_wire_get_qr(wire)) {
+		return;
+	}
+
+	pthread_mutex_lock(&up->lock);
+	fwd_query_t *q = up->ids[knot_wire_get_id(wire)];
+	if (q == NULL || !question_match(q, wire, len)) {
+		pthread_mutex_unlock(&up->lock);
+		return;
+	}
+	query_unlink(up, q);
+	pthread_mutex_unlock(&up->lock);
+
+	// Restore the original message ID and the QNAME case.
+	knot_wire_set_id(wire, knot_wire_get_id(q->question));
+	memcpy(wire + KNOT_WIRE_HEADER_SIZE, q->question + KNOT_WIRE_HEADER_SIZE,
+	       q->question_len - KNOT_WIRE_HEADER_SIZE);
+
+	send_to_client(q, wire, len);
+	free(q);
+}
+
+static void query_servfail(fwd_query_t *q)
+{
+	uint8_t *wire = q->question;
+	knot_wire_set_qr(wire);
+	knot_wire_clear_aa(wire);
+	knot_wire_clear_tc(wire);
+	knot_wire_set_rcode(wire, KNOT_RCODE_SERVFAIL);
+	knot_wire_set_ancount(wire, 0);
+	knot_wire_set_nscount(wire, 0);
+	knot_wire_set_arcount(wire, (q->opt_len > 0) ? 1 : 0);
+
+	send_to_client(q, wire, q->question_len + q->opt_len);
+}
+
+/*!
+ * \brief Answer timed-out queries with SERVFAIL.
+ *
+ * \return Milliseconds until the next deadline, -1 if nothing is pending.
+ */
+static int expire_queries(async_fwd_t *fwd)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	int next = -1;
+	for (int i = 0; i < ASYNC_FWD_SOCKETS; i++) {
+		fwd_upstream_t *up = &fwd->upstreams[i];
+
+		list_t expired;
+		init_list(&expired);
+
+		pthread_mutex_lock(&up->lock);
+		fwd_query_t *q, *nxt;
+		WALK_LIST_DELSAFE(q, nxt, up->pending) {
+			if (!timespec_passed(&q->deadline, &now)) {
+				int ms = (q->deadline.tv_sec - now.tv_sec) * 1000 +
+				         (q->deadline.tv_nsec - now.tv_nsec) / 1000000 + 1;
+				next = (next < 0 || ms < next) ? ms : next;
+				break;
+			}
+			query_unlink(up, q);
+			add_tail(&expired, &q->n);
+		}
+		pthread_mutex_unlock(&up->lock);
+
+		WALK_LIST_DELSAFE(q, nxt, expired) {
+			query_servfail(q);
+			free(q);
+		}
+	}
+
+	return next;
+}
+
+static void *fwd_thread(void *arg)
+{
+	async_fwd_t *fwd = arg;
+
+	struct pollfd pfd[ASYNC_FWD_SOCKETS + 1];
+	for (int i = 0; i < ASYNC_FWD_SOCKETS; i++) {
+		pfd[i].fd = fwd->upstreams[i].fd;
+		pfd[i].events = POLLIN;
+	}
+	pfd[ASYNC_FWD_SOCKETS].fd = fwd->wake[0];
+	pfd[ASYNC_FWD_SOCKETS].events = POLLIN;
+
+	uint8_t buf[KNOT_WIRE_MAX_PKTSIZE];
+	int timeout = -1;
+	while (!fwd->stop) {
+		int ret = poll(pfd, ASYNC_FWD_SOCKETS + 1, timeout);
+		if (ret < 0 && errno != EINTR) {
+			break;
+		}
+
+		if (ret > 0 && (pfd[ASYNC_FWD_SOCKETS].revents & POLLIN)) {
+			while (read(fwd->wake[0], buf, sizeof(buf)) > 0) {
+				// Drain the pipe.
+			}
+		}
+
+		for (int i = 0; ret > 0 && i < ASYNC_FWD_SOCKETS; i++) {
+			if (!(pfd[i].revents & POLLIN)) {
+				continue;
+			}
+			ssize_t len;
+			while ((len = recv(pfd[i].fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0) {
+				upstream_response(&fwd->upstreams[i], buf, len);
+			}
+		}
+
+		timeout = expire_queries(fwd);
+	}
+
+	return NULL;
+}
+
+static int pipe_nonblock(int fds[2])
+{
+	if (pipe(fds) != 0) {
+		return knot_map_errno();
+	}
+
+	for (int i = 0; i < 2; i++) {
+		if (fcntl(fds[i], F_SETFL, O_NONBLOCK) != 0) {
+			int ret = knot_map_errno();
+			close(fds[0]);
+			close(fds[1]);
+			return ret;
+		}
+	}
+
+	return KNOT_EOK;
+}
+
+/*!
+ * \brief Get the forwarder's own socket with the same local address as \a fd.
+ *
+ * \param fwd       Forwarder.
+ * \param fd        Server socket.
+ * \param wildcard  Output indication of a socket bound to a wildcard address.
+ *
+ * \return Socket or KNOT_E* if error.
+ */
+static int local_socket(async_fwd_t *fwd, int fd, bool *wildcard)
+{
+	struct sockaddr_storage addr;
+	socklen_t addr_len = sizeof(addr);
+	if (getsockname(fd, (struct sockaddr *)&addr, &addr_len) != 0) {
+		return knot_map_errno();
+	}
+	*wildcard = sockaddr_is_any(&addr);
+
+	pthread_mutex_lock(&fwd->locals_lock);
+	for (unsigned i = 0; i < fwd->locals_count; i++) {
+		if (sockaddr_cmp(&fwd->locals[i].addr, &addr, false) == 0) {
+			int own_fd = fwd->locals[i].fd;
+			pthread_mutex_unlock(&fwd->locals_lock);
+			return own_fd;
+		}
+	}
+
+	if (fwd->locals_count == fwd->locals_max) {
+		unsigned new_max = (fwd->locals_max > 0) ? 2 * fwd->locals_max : 8;
+		fwd_local_t *new_locals = realloc(fwd->locals, new_max * sizeof(*new_locals));
+		if (new_locals == NULL) {
+			pthread_mutex_unlock(&fwd->locals_lock);
+			return KNOT_ENOMEM;
+		}
+		fwd->locals = new_locals;
+		fwd->locals_max = new_max;
+	}
+
+	int own_fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+	if (own_fd < 0) {
+		own_fd = knot_map_errno();
+	} else {
+		fwd_local_t *local = &fwd->locals[fwd->locals_count++];
+		memcpy(&local->addr, &addr, sizeof(addr));
+		local->fd = own_fd;
+	}
+	pthread_mutex_unlock(&fwd->locals_lock);
+
+	return own_fd;
+}
+
+static void locals_deinit(async_fwd_t *fwd)
+{
+	for (unsigned i = 0; i < fwd->locals_count; i++) {
+		close(fwd->locals[i].fd);
+	}
+	free(fwd->locals);
+	pthread_mutex_destroy(&fwd->locals_lock);
+}
+
+static void upstreams_deinit(async_fwd_t *fwd)
+{
+	for (int i = 0; i < ASYNC_FWD_SOCKETS; i++) {
+		fwd_upstream_t *up = &fwd->upstreams[i];
+		if (up->ids == NULL) {
+			continue;
+		}
+
+		fwd_query_t *q, *nxt;
+		WALK_LIST_DELSAFE(q, nxt, up->pending) {
+			free(q);
+		}
+		free(up->ids);
+		if (up->fd >= 0) {
+			close(up->fd);
+		}
+		pthread_mutex_destroy(&up->lock);
+	}
+}
+
+async_fwd_t *async_fwd_new(const struct sockaddr_storage *remote,
+                           const struct sockaddr_storage *via,
+                           int timeout_ms)
+{
+	if (remote == NULL || timeout_ms < 0) {
+		return NULL;
+	}
+
+	async_fwd_t *fwd = calloc(1, sizeof(*fwd));
+	if (fwd == NULL) {
+		return NULL;
+	}
+	fwd->timeout_ms = timeout_ms;
+	pthread_mutex_init(&fwd->locals_lock, NULL);
+
+	if (pipe_nonblock(fwd->wake) != KNOT_EOK) {
+		locals_deinit(fwd);
+		free(fwd);
+		return NULL;
+	}
+
+	for (int i = 0; i < ASYNC_FWD_SOCKETS; i++) {
+		fwd_upstream_t *up = &fwd->upstreams[i];
+		up->ids = calloc(UINT16_MAX + 1, sizeof(*up->ids));
+		if (up->ids == NULL) {
+			goto fail;
+		}
+		pthread_mutex_init(&up->lock, NULL);
+		init_list(&up->pending);
+		up->fd = net_connected_socket(SOCK_DGRAM, remote, via, false);
+		if (up->fd < 0) {
+			goto fail;
+		}
+	}
+
+	if (pthread_create(&fwd->thread, NULL, fwd_thread, fwd) != 0) {
+		goto fail;
+	}
+
+	return fwd;
+fail:
+	upstreams_deinit(fwd);
+	locals_deinit(fwd);
+	close(fwd->wake[0]);
+	close(fwd->wake[1]);
+	free(fwd);
+	return NULL;
+}
+
+void async_fwd_free(async_fwd_t *fwd)
+{
+	if (fwd == NULL) {
+		return;
+	}
+
+	fwd->stop = true;
+	wake_up(fwd);
+	pthread_join(fwd->thread, NULL);
+
+	upstreams_deinit(fwd);
+	locals_deinit(fwd);
+	close(fwd->wake[0]);
+	close(fwd->wake[1]);
+	free(fwd);
+}
+
+int async_fwd_query(async_fwd_t *fwd, unsigned thread_id, const knot_pkt_t *query,
+                    const knot_dname_t *orig_qname, const knot_rrset_t *opt_rr,
+                    int fd, const struct sockaddr_storage *local,
+                    const struct sockaddr_storage *client)
+{
+	if (fwd == NULL || query == NULL || client == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	size_t question_len = KNOT_WIRE_HEADER_SIZE + query->qname_size + 2 * sizeof(uint16_t);
+	if (query->qname_size == 0 || query->size < question_len) {
+		return KNOT_EMALF;
+	}
+
+	bool wildcard = false;
+	int client_fd = local_socket(fwd, fd, &wildcard);
+	if (client_fd < 0) {
+		return client_fd;
+	}
+	if (wildcard && (local == NULL || sockaddr_is_any(local))) {
+		return KNOT_ENOTSUP;
+	}
+#ifndef ASYNC_FWD_SRCADDR4
+	if (wildcard && local->ss_family == AF_INET) {
+		return KNOT_ENOTSUP;
+	}
+#endif
+
+	size_t opt_len = knot_rrset_empty(opt_rr) ? 0 : knot_rrset_size(opt_rr);
+	fwd_query_t *q = malloc(sizeof(*q) + question_len + opt_len);
+	if (q == NULL) {
+		return KNOT_ENOMEM;
+	}
+	memcpy(q->question, query->wire, question_len);
+	if (orig_qname != NULL && orig_qname[0] != '\0') {
+		memcpy(q->question + KNOT_WIRE_HEADER_SIZE, orig_qname, query->qname_size);
+	}
+	q->question_len = question_len;
+	q->opt_len = 0;
+	if (opt_len > 0) {
+		int ret = knot_rrset_to_wire(opt_rr, q->question + question_len, opt_len, NULL);
+		q->opt_len = (ret > 0) ? ret : 0;
+	}
+	memcpy(&q->client, client, sockaddr_len(client));
+	if (wildcard) {
+		memcpy(&q->local, local, sockaddr_len(local));
+	} else {
+		q->local.ss_family = AF_UNSPEC;
+	}
+	q->client_fd = client_fd;
+	clock_gettime(CLOCK_MONOTONIC, &q->deadline);
+	timespec_add_ms(&q->deadline, fwd->timeout_ms);
+
+	fwd_upstream_t *up = &fwd->upstreams[thread_id % ASYNC_FWD_SOCKETS];
+
+	pthread_mutex_lock(&up->lock);
+	if (up->count >= ASYNC_FWD_MAX_PENDING) {
+		pthread_mutex_unlock(&up->lock);
+		free(q);
+		return KNOT_ELIMIT;
+	}
+	uint16_t id = dnssec_random_uint16_t();
+	while (up->ids[id] != NULL) {
+		id++;
+	}
+	q->id = id;
+	up->ids[id] = q;
+	add_tail(&up->pending, &q->n);
+	bool was_idle = (up->count++ == 0);
+	pthread_mutex_unlock(&up->lock);
+
+	// The thread may be sleeping without any deadline.
+	if (was_idle) {
+		wake_up(fwd);
+	}
+
+	// Send the query with the upstream message ID.
+	uint8_t header[KNOT_WIRE_HEADER_SIZE];
+	memcpy(header, query->wire, sizeof(header));
+	knot_wire_set_id(header, id);
+	struct iovec iov[2] = {
+		{ .iov_base = header, .iov_len = sizeof(header) },
+		{ .iov_base = query->wire + sizeof(header), .iov_len = query->size - sizeof(header) }
+	};
+	struct msghdr msg = { .msg_iov = iov, .msg_iovlen = 2 };
+	if (sendmsg(up->fd, &msg, 0) < 0) {
+		int ret = knot_map_errno();
+		pthread_mutex_lock(&up->lock);
+		bool unlinked = (up->ids[id] == q);
+		if (unlinked) {
+			query_unlink(up, q);
+		}
+		pthread_mutex_unlock(&up->lock);
+		if (unlinked) {
+			free(q);
+			return ret;
+		}
+	}
+
+	return KNOT_EOK;
+}
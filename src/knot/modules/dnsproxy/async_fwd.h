@@ -0,0 +1,81 @@
+/*  Copyright (C) 2021 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <sys/socket.h>
+
+#include "libknot/packet/pkt.h"
+#include "libknot/rrset.h"
+
+/*!
+ * \brief Asynchronous UDP forwarder.
+ *
+ * Forwarded queries are multiplexed over a few connected upstream UDP sockets
+ * and identified by a unique upstream message ID. A background thread
+ * receives the upstream responses, restores the original message ID and
+ * QNAME case, and sends the responses to the clients directly, possibly
+ * out of order. Timed-out queries are answered with SERVFAIL.
+ *
+ * The responses are sent through the forwarder's own duplicates of the server
+ * sockets, so they stay valid while the forwarder exists. If a socket is bound
+ * to a wildcard address, the response source is set to the query destination
+ * address via IP_PKTINFO (IP_SENDSRCADDR) or IPV6_PKTINFO.
+ */
+typedef struct async_fwd async_fwd_t;
+
+/*!
+ * \brief Create the forwarder and start its thread.
+ *
+ * \param remote      Upstream server address.
+ * \param via         Source address (or AF_UNSPEC).
+ * \param timeout_ms  Upstream response timeout in milliseconds.
+ *
+ * \return Forwarder or NULL if error.
+ */
+async_fwd_t *async_fwd_new(const struct sockaddr_storage *remote,
+                           const struct sockaddr_storage *via,
+                           int timeout_ms);
+
+/*!
+ * \brief Stop the forwarder thread and free the forwarder.
+ *
+ * \note Pending queries are dropped without any response.
+ */
+void async_fwd_free(async_fwd_t *fwd);
+
+/*!
+ * \brief Forward a parsed UDP query.
+ *
+ * \param fwd         Forwarder.
+ * \param thread_id   Calling thread identifier (selects the upstream socket).
+ * \param query       Parsed query.
+ * \param orig_qname  QNAME in the original letter case (or NULL).
+ * \param opt_rr      Response OPT put into the SERVFAIL on timeout (or NULL).
+ * \param fd          Socket the query was received on.
+ * \param local       Destination address of the query (required for wildcard sockets).
+ * \param client      Client address.
+ *
+ * \retval KNOT_EOK if the query was sent, the response will be sent later.
+ * \retval KNOT_ENOTSUP if the socket is a wildcard one and the destination
+ *         address isn't known or can't be set as the response source.
+ * \retval KNOT_ELIMIT if too many queries are pending.
+ * \return KNOT_E* if error.
+ */
+int async_fwd_query(async_fwd_t *fwd, unsigned thread_id, const knot_pkt_t *query,
+                    const knot_dname_t *orig_qname, const knot_rrset_t *opt_rr,
+                    int fd, const struct sockaddr_storage *local,
+                    const struct sockaddr_storage *client);
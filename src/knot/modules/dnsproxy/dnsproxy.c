@@ -16,6 +16,7 @@
 
 #include "contrib/net.h"
 #include "knot/include/module.h"
+#include "knot/modules/dnsproxy/async_fwd.h"
 #include "knot/conf/schema.h"
 #include "knot/query/capture.h" // Forces static module!
 #include "knot/query/requestor.h" // Forces static module!
@@ -27,6 +28,7 @@
 #define MOD_TIMEOUT		"\x07""timeout"
 #define MOD_FALLBACK		"\x08""fallback"
 #define MOD_CATCH_NXDOMAIN	"\x0E""catch-nxdomain"
+#define MOD_ASYNC		"\x05""async"
 
 const yp_item_t dnsproxy_conf[] = {
 	{ MOD_REMOTE,         YP_TREF,  YP_VREF = { C_RMT }, YP_FNONE,
@@ -36,6 +38,7 @@ const yp_item_t dnsproxy_conf[] = {
 	{ MOD_FALLBACK,       YP_TBOOL, YP_VBOOL = { true } },
 	{ MOD_TCP_FASTOPEN,   YP_TBOOL, YP_VNONE },
 	{ MOD_CATCH_NXDOMAIN, YP_TBOOL, YP_VNONE },
+	{ MOD_ASYNC,          YP_TBOOL, YP_VNONE },
 	{ NULL }
 };
 
@@ -58,8 +61,21 @@ typedef struct {
 	bool tfo;
 	bool catch_nxdomain;
 	int timeout;
+	async_fwd_t *async;
 } dnsproxy_t;
 
+/*!
+ * \brief Check if the query can be forwarded asynchronously.
+ *
+ * The response is sent by the forwarder thread, which is possible only for
+ * UDP sockets. The forwarder refuses a wildcard socket only if the destination
+ * address of the query isn't known or can't be used as the response source.
+ */
+static bool async_usable(knotd_qdata_t *qdata)
+{
+	return qdata->params->xdp_msg == NULL && !net_is_stream(qdata->params->socket);
+}
+
 static knotd_state_t dnsproxy_fwd(knotd_state_t state, knot_pkt_t *pkt,
                                   knotd_qdata_t *qdata, knotd_mod_t *mod)
 {
@@ -87,6 +103,22 @@ static knotd_state_t dnsproxy_fwd(knotd_state_t state, knot_pkt_t *pkt,
 		                 qdata->query->max_size, qdata->query->tsig_rr);
 	}
 
+	/* Forward asynchronously, the worker doesn't wait for the response. */
+	if (proxy->async != NULL && async_usable(qdata)) {
+		struct sockaddr_storage buff;
+		int ret = async_fwd_query(proxy->async, qdata->params->thread_id,
+		                          qdata->query, knotd_qdata_orig_qname(qdata),
+		                          &qdata->opt_rr, qdata->params->socket,
+		                          knotd_qdata_local_addr(qdata, &buff),
+		                          knotd_qdata_remote_addr(qdata));
+		if (ret == KNOT_EOK) {
+			return KNOTD_STATE_NOOP; /* Response is sent by the forwarder. */
+		} else if (ret != KNOT_ENOTSUP) {
+			qdata->rcode = KNOT_RCODE_SERVFAIL;
+			return KNOTD_STATE_FAIL; /* Forwarding failed, SERVFAIL. */
+		}
+	}
+
 	/* Capture layer context. */
 	const knot_layer_api_t *capture = query_capture_api();
 	struct capture_param capture_param = {
@@ -171,6 +203,16 @@ int dnsproxy_load(knotd_mod_t *mod)
 	conf = knotd_conf_mod(mod, MOD_CATCH_NXDOMAIN);
 	proxy->catch_nxdomain = conf.single.boolean;
 
+	conf = knotd_conf_mod(mod, MOD_ASYNC);
+	if (conf.single.boolean) {
+		proxy->async = async_fwd_new(&proxy->remote, &proxy->via, proxy->timeout);
+		if (proxy->async == NULL) {
+			knotd_conf_free(&proxy->addr);
+			free(proxy);
+			return KNOT_ENOMEM;
+		}
+	}
+
 	knotd_mod_ctx_set(mod, proxy);
 
 	if (proxy->fallback) {
@@ -184,6 +226,7 @@ void dnsproxy_unload(knotd_mod_t *mod)
 {
 	dnsproxy_t *ctx = knotd_mod_ctx(mod);
 	if (ctx != NULL) {
+		async_fwd_free(ctx->async);
 		knotd_conf_free(&ctx->addr);
 	}
 	free(ctx);
@@ -368,5 +368,5 @@ void dnstap_unload(knotd_mod_t *mod)
 	free(ctx);
 }
 
-KNOTD_MOD_API(dnstap, KNOTD_MOD_FLAG_SCOPE_ANY,
+KNOTD_MOD_API(dnstap, KNOTD_MOD_FLAG_SCOPE_ANY | KNOTD_MOD_FLAG_CACHEABLE,
               dnstap_load, dnstap_unload, dnstap_conf, dnstap_conf_check);
@@ -111,5 +111,6 @@ void noudp_unload(knotd_mod_t *mod)
 	free(ctx);
 }
 
-KNOTD_MOD_API(noudp, KNOTD_MOD_FLAG_SCOPE_ANY | KNOTD_MOD_FLAG_OPT_CONF,
+KNOTD_MOD_API(noudp, KNOTD_MOD_FLAG_SCOPE_ANY | KNOTD_MOD_FLAG_OPT_CONF |
+                     KNOTD_MOD_FLAG_CACHEABLE,
               noudp_load, noudp_unload, noudp_conf, noudp_conf_check);
@@ -17,11 +17,14 @@
 #include <assert.h>
 #include <stddef.h>
 #include <string.h>
+#include <urcu.h>
 
 #include "contrib/string.h"
+#include "contrib/time.h"
 #include "libdnssec/error.h"
 #include "knot/include/module.h"
 #include "knot/modules/onlinesign/nsec_next.h"
+#include "knot/modules/onlinesign/rrsig_cache.h"
 // Next dependencies force static module!
 #include "knot/dnssec/ds_query.h"
 #include "knot/dnssec/key-events.h"
@@ -31,9 +34,15 @@
 #include "knot/dnssec/zone-sign.h"
 #include "knot/nameserver/query_module.h"
 #include "knot/nameserver/process_query.h"
+#include "knot/server/server.h"
+#include "knot/zone/zonedb.h"
 
 #define MOD_POLICY	"\x06""policy"
 #define MOD_NSEC_BITMAP	"\x0B""nsec-bitmap"
+#define MOD_CACHE_SIZE	"\x0A""cache-size"
+#define MOD_CACHE_VALID	"\x0E""cache-validity"
+
+#define EVENT_RETRY_MS	1000 /* Retry delay if the key event can't be queued. */
 
 int policy_check(knotd_conf_check_args_t *args)
 {
@@ -60,6 +69,8 @@ int bitmap_check(knotd_conf_check_args_t *args)
 const yp_item_t online_sign_conf[] = {
 	{ MOD_POLICY,      YP_TREF, YP_VREF = { C_POLICY }, YP_FNONE, { policy_check } },
 	{ MOD_NSEC_BITMAP, YP_TSTR, YP_VNONE, YP_FMULTI, { bitmap_check } },
+	{ MOD_CACHE_SIZE,  YP_TINT, YP_VINT = { 0, 1 << 24, 0 } },
+	{ MOD_CACHE_VALID, YP_TINT, YP_VINT = { 1, 100, 10 } },
 	{ NULL }
 };
 
@@ -79,17 +90,56 @@ static const uint16_t NSEC_FORCE_TYPES[] = {
 	0
 };
 
+/*!
+ * Signing keys with their own DNSSEC context, the keyset refers to the keys
+ * of the context's KASP zone.
+ */
+typedef struct {
+	kdnssec_ctx_t dnssec;
+	zone_keyset_t keyset;
+} online_keys_t;
+
+/*!
+ * Key events (rollover, parent DS query) are planned in the server event
+ * scheduler and executed by a background worker. The worker works on its own
+ * DNSSEC context and, if the keys changed, publishes it RCU-style. The query
+ * processing only reads the published keys, the old ones are freed once no
+ * query can be using them.
+ */
 typedef struct {
 	knot_time_t event_rollover;
 	knot_time_t event_parent_ds_q;
-	pthread_mutex_t event_mutex;
-	pthread_rwlock_t signing_mutex;
+	pthread_mutex_t event_mutex; // Guards the event state, not used by queries.
+	pthread_mutex_t event_reschedule_lock;
+	pthread_cond_t event_done;
+	event_t *event;
+	worker_task_t event_task;
+	bool event_running; // Queued or running.
+	bool event_frozen;
+
+	online_keys_t *keys; // Current keys, NULL if the zone is doomed.
 
 	uint16_t *nsec_force_types;
 
-	bool zone_doomed;
+	rrsig_cache_t *rrsig_cache;
+	unsigned cache_validity;
 } online_sign_ctx_t;
 
+/*!
+ * Per-section signing state, the DNSSEC context is a snapshot with the
+ * current time.
+ */
+typedef struct {
+	const zone_keyset_t *keyset;
+	kdnssec_ctx_t dnssec;
+	zone_sign_ctx_t *sign_ctx; // Created on the first cache miss.
+} online_signer_t;
+
+enum {
+	CTR_CACHE_HIT,
+	CTR_CACHE_MISS,
+};
+
 static bool want_dnssec(knotd_qdata_t *qdata)
 {
 	return knot_pkt_has_dnssec(qdata->query);
@@ -233,41 +283,72 @@ static knot_rrset_t *synth_nsec(knot_pkt_t *pkt, knotd_qdata_t *qdata, knotd_mod
 static knot_rrset_t *sign_rrset(const knot_dname_t *owner,
                                 const knot_rrset_t *cover,
                                 knotd_mod_t *mod,
-                                zone_sign_ctx_t *sign_ctx,
+                                knotd_qdata_t *qdata,
+                                online_signer_t *signer,
                                 knot_mm_t *mm)
 {
+	online_sign_ctx_t *ctx = knotd_mod_ctx(mod);
+
+	// resulting RRSIG
+
+	knot_rrset_t *rrsig = knot_rrset_new(owner, KNOT_RRTYPE_RRSIG, cover->rclass,
+	                                     cover->ttl, mm);
+	if (!rrsig) {
+		return NULL;
+	}
+
+	// try cached signatures
+
+	knot_rrset_t lookup;
+	knot_rrset_init(&lookup, (knot_dname_t *)owner, cover->type, cover->rclass,
+	                cover->ttl);
+	lookup.rrs = cover->rrs;
+
+	if (ctx->rrsig_cache != NULL) {
+		if (rrsig_cache_get(ctx->rrsig_cache, &lookup, signer->dnssec.now,
+		                    &rrsig->rrs, mm)) {
+			knotd_mod_stats_incr(mod, qdata->params->thread_id, CTR_CACHE_HIT, 0, 1);
+			return rrsig;
+		}
+		knotd_mod_stats_incr(mod, qdata->params->thread_id, CTR_CACHE_MISS, 0, 1);
+	}
+
 	// copy of RR set with replaced owner name
 
 	knot_rrset_t *copy = knot_rrset_new(owner, cover->type, cover->rclass,
 	                                    cover->ttl, NULL);
 	if (!copy) {
+		knot_rrset_free(rrsig, mm);
 		return NULL;
 	}
 
 	if (knot_rdataset_copy(&copy->rrs, &cover->rrs, NULL) != KNOT_EOK) {
 		knot_rrset_free(copy, NULL);
+		knot_rrset_free(rrsig, mm);
 		return NULL;
 	}
 
-	// resulting RRSIG
-
-	knot_rrset_t *rrsig = knot_rrset_new(owner, KNOT_RRTYPE_RRSIG, copy->rclass,
-	                                     copy->ttl, mm);
-	if (!rrsig) {
-		knot_rrset_free(copy, NULL);
-		return NULL;
+	if (signer->sign_ctx == NULL) {
+		signer->sign_ctx = zone_sign_ctx(signer->keyset, &signer->dnssec);
+	}
+	int ret = KNOT_ENOMEM;
+	if (signer->sign_ctx != NULL) {
+		ret = knot_sign_rrset2(rrsig, copy, signer->sign_ctx, mm);
 	}
-
-	online_sign_ctx_t *ctx = knotd_mod_ctx(mod);
-	pthread_rwlock_rdlock(&ctx->signing_mutex);
-	int ret = knot_sign_rrset2(rrsig, copy, sign_ctx, mm);
-	pthread_rwlock_unlock(&ctx->signing_mutex);
 	if (ret != KNOT_EOK) {
 		knot_rrset_free(copy, NULL);
 		knot_rrset_free(rrsig, mm);
 		return NULL;
 	}
 
+	// The cache is flushed only after no query can use the old keyset.
+	if (ctx->rrsig_cache != NULL) {
+		knot_timediff_t valid = (knot_timediff_t)signer->dnssec.policy->rrsig_lifetime *
+		                        ctx->cache_validity / 100;
+		rrsig_cache_put(ctx->rrsig_cache, &lookup, &rrsig->rrs,
+		                signer->dnssec.now + valid);
+	}
+
 	knot_rrset_free(copy, NULL);
 
 	return rrsig;
@@ -313,10 +394,16 @@ static knotd_in_state_t sign_section(knotd_in_state_t state, knot_pkt_t *pkt,
 	const knot_pktsection_t *section = knot_pkt_section(pkt, pkt->current);
 	assert(section);
 
-	zone_sign_ctx_t *sign_ctx = zone_sign_ctx(mod->keyset, mod->dnssec);
-	if (sign_ctx == NULL) {
+	online_sign_ctx_t *ctx = knotd_mod_ctx(mod);
+	const online_keys_t *keys = rcu_dereference(ctx->keys);
+	if (keys == NULL) {
 		return KNOTD_IN_STATE_ERROR;
 	}
+	online_signer_t signer = {
+		.keyset = &keys->keyset,
+		.dnssec = keys->dnssec,
+	};
+	signer.dnssec.now = knot_time();
 
 	uint16_t count_unsigned = section->count;
 	for (int i = 0; i < count_unsigned; i++) {
@@ -331,7 +418,8 @@ static knotd_in_state_t sign_section(knotd_in_state_t state, knot_pkt_t *pkt,
 		knot_dname_unpack(owner, pkt->wire + rr_pos, sizeof(owner), pkt->wire);
 		knot_dname_to_lower(owner);
 
-		knot_rrset_t *rrsig = sign_rrset(owner, rr, mod, sign_ctx, &pkt->mm);
+		knot_rrset_t *rrsig = sign_rrset(owner, rr, mod, qdata, &signer,
+		                                 &pkt->mm);
 		if (!rrsig) {
 			state = KNOTD_IN_STATE_ERROR;
 			break;
@@ -345,7 +433,7 @@ static knotd_in_state_t sign_section(knotd_in_state_t state, knot_pkt_t *pkt,
 		}
 	}
 
-	zone_sign_ctx_free(sign_ctx);
+	zone_sign_ctx_free(signer.sign_ctx);
 
 	return state;
 }
@@ -391,24 +479,28 @@ static knot_rrset_t *synth_dnskey(knotd_qdata_t *qdata, knotd_mod_t *mod,
 
 	dnssec_binary_t rdata = { 0 };
 	online_sign_ctx_t *ctx = knotd_mod_ctx(mod);
-	pthread_rwlock_rdlock(&ctx->signing_mutex);
-	for (size_t i = 0; i < mod->keyset->count; i++) {
-		if (!mod->keyset->keys[i].is_public) {
+	const online_keys_t *keys = rcu_dereference(ctx->keys);
+	if (keys == NULL) {
+		knot_rrset_free(dnskey, mm);
+		return NULL;
+	}
+
+	const zone_keyset_t *keyset = &keys->keyset;
+	for (size_t i = 0; i < keyset->count; i++) {
+		if (!keyset->keys[i].is_public) {
 			continue;
 		}
 
-		dnssec_key_get_rdata(mod->keyset->keys[i].key, &rdata);
+		dnssec_key_get_rdata(keyset->keys[i].key, &rdata);
 		assert(rdata.size > 0 && rdata.data);
 
 		int r = knot_rrset_add_rdata(dnskey, rdata.data, rdata.size, mm);
 		if (r != KNOT_EOK) {
 			knot_rrset_free(dnskey, mm);
-			pthread_rwlock_unlock(&ctx->signing_mutex);
 			return NULL;
 		}
 	}
 
-	pthread_rwlock_unlock(&ctx->signing_mutex);
 	return dnskey;
 }
 
@@ -424,14 +516,18 @@ static knot_rrset_t *synth_cdnskey(knotd_qdata_t *qdata, knotd_mod_t *mod,
 
 	dnssec_binary_t rdata = { 0 };
 	online_sign_ctx_t *ctx = knotd_mod_ctx(mod);
-	pthread_rwlock_rdlock(&ctx->signing_mutex);
-	keyptr_dynarray_t kcdnskeys = knot_zone_sign_get_cdnskeys(mod->dnssec, mod->keyset);
+	online_keys_t *keys = rcu_dereference(ctx->keys);
+	if (keys == NULL) {
+		knot_rrset_free(dnskey, mm);
+		return NULL;
+	}
+
+	keyptr_dynarray_t kcdnskeys = knot_zone_sign_get_cdnskeys(&keys->dnssec, &keys->keyset);
 	knot_dynarray_foreach(keyptr, zone_key_t *, ksk_for_cdnskey, kcdnskeys) {
 		dnssec_key_get_rdata((*ksk_for_cdnskey)->key, &rdata);
 		assert(rdata.size > 0 && rdata.data);
 		(void)knot_rrset_add_rdata(dnskey, rdata.data, rdata.size, mm);
 	}
-	pthread_rwlock_unlock(&ctx->signing_mutex);
 
 	return dnskey;
 }
@@ -448,14 +544,18 @@ static knot_rrset_t *synth_cds(knotd_qdata_t *qdata, knotd_mod_t *mod,
 
 	dnssec_binary_t rdata = { 0 };
 	online_sign_ctx_t *ctx = knotd_mod_ctx(mod);
-	pthread_rwlock_rdlock(&ctx->signing_mutex);
-	keyptr_dynarray_t kcdnskeys = knot_zone_sign_get_cdnskeys(mod->dnssec, mod->keyset);
+	online_keys_t *keys = rcu_dereference(ctx->keys);
+	if (keys == NULL) {
+		knot_rrset_free(ds, mm);
+		return NULL;
+	}
+
+	keyptr_dynarray_t kcdnskeys = knot_zone_sign_get_cdnskeys(&keys->dnssec, &keys->keyset);
 	knot_dynarray_foreach(keyptr, zone_key_t *, ksk_for_cds, kcdnskeys) {
-		zone_key_calculate_ds(*ksk_for_cds, mod->dnssec->policy->cds_dt, &rdata);
+		zone_key_calculate_ds(*ksk_for_cds, keys->dnssec.policy->cds_dt, &rdata);
 		assert(rdata.size > 0 && rdata.data);
 		(void)knot_rrset_add_rdata(ds, rdata.data, rdata.size, mm);
 	}
-	pthread_rwlock_unlock(&ctx->signing_mutex);
 
 	return ds;
 }
@@ -475,55 +575,12 @@ static knotd_in_state_t pre_routine(knotd_in_state_t state, knot_pkt_t *pkt,
                                     knotd_qdata_t *qdata, knotd_mod_t *mod)
 {
 	online_sign_ctx_t *ctx = knotd_mod_ctx(mod);
-	zone_sign_reschedule_t resch = { 0 };
 
 	(void)pkt, (void)qdata;
 
-	pthread_mutex_lock(&ctx->event_mutex);
-	if (ctx->zone_doomed) {
-		pthread_mutex_unlock(&ctx->event_mutex);
+	if (rcu_dereference(ctx->keys) == NULL) {
 		return KNOTD_IN_STATE_ERROR;
 	}
-	mod->dnssec->now = time(NULL);
-	int ret = KNOT_ESEMCHECK;
-	if (knot_time_cmp(ctx->event_parent_ds_q, mod->dnssec->now) <= 0) {
-		pthread_rwlock_rdlock(&ctx->signing_mutex);
-		ret = knot_parent_ds_query(mod->dnssec, mod->keyset, 1000);
-		pthread_rwlock_unlock(&ctx->signing_mutex);
-		if (ret != KNOT_EOK && ret != KNOT_NO_READY_KEY && mod->dnssec->policy->ksk_sbm_check_interval > 0) {
-			ctx->event_parent_ds_q = mod->dnssec->now + mod->dnssec->policy->ksk_sbm_check_interval;
-		} else {
-			ctx->event_parent_ds_q = 0;
-		}
-	}
-	if (ret == KNOT_EOK || knot_time_cmp(ctx->event_rollover, mod->dnssec->now) <= 0) {
-		update_policy_from_zone(mod->dnssec->policy, qdata->extra->contents);
-		ret = knot_dnssec_key_rollover(mod->dnssec, KEY_ROLL_ALLOW_KSK_ROLL | KEY_ROLL_ALLOW_ZSK_ROLL, &resch);
-		if (ret != KNOT_EOK) {
-			ctx->event_rollover = knot_dnssec_failover_delay(mod->dnssec);
-		}
-	}
-	if (ret == KNOT_EOK) {
-		if (resch.plan_ds_check && mod->dnssec->policy->ksk_sbm_check_interval > 0) {
-			ctx->event_parent_ds_q = mod->dnssec->now + mod->dnssec->policy->ksk_sbm_check_interval;
-		} else {
-			ctx->event_parent_ds_q = 0;
-		}
-
-		ctx->event_rollover = resch.next_rollover;
-
-		pthread_rwlock_wrlock(&ctx->signing_mutex);
-		knotd_mod_dnssec_unload_keyset(mod);
-		ret = knotd_mod_dnssec_load_keyset(mod, true);
-		if (ret != KNOT_EOK) {
-			ctx->zone_doomed = true;
-			state = KNOTD_IN_STATE_ERROR;
-		} else {
-			ctx->event_rollover = knot_time_min(ctx->event_rollover, knot_get_next_zone_key_event(mod->keyset));
-		}
-		pthread_rwlock_unlock(&ctx->signing_mutex);
-	}
-	pthread_mutex_unlock(&ctx->event_mutex);
 
 	return state;
 }
@@ -600,11 +657,255 @@ static knotd_in_state_t synth_answer(knotd_in_state_t state, knot_pkt_t *pkt,
 	return state;
 }
 
+static void keys_free(online_keys_t *keys)
+{
+	if (keys == NULL) {
+		return;
+	}
+
+	free_zone_keys(&keys->keyset);
+	kdnssec_ctx_deinit(&keys->dnssec);
+	free(keys);
+}
+
+/*!
+ * \brief Create a new DNSSEC context of the module, the keyset isn't loaded.
+ */
+static int keys_new(knotd_mod_t *mod, online_keys_t **keys_ptr)
+{
+	online_keys_t *keys = calloc(1, sizeof(*keys));
+	if (keys == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	knot_lmdb_db_t *kaspdb = &mod->server->kaspdb;
+	kasp_db_ensure_init(kaspdb, mod->config);
+
+	int ret = kdnssec_ctx_init(mod->config, &keys->dnssec, mod->zone, kaspdb, mod->id);
+	if (ret != KNOT_EOK) {
+		free(keys);
+		return ret;
+	}
+
+	// Historically, the default scheme is Single-Type signing.
+	if (keys->dnssec.policy->sts_default) {
+		keys->dnssec.policy->single_type_signing = true;
+	}
+
+	*keys_ptr = keys;
+
+	return KNOT_EOK;
+}
+
+static int keys_load(online_keys_t *keys, bool verbose)
+{
+	free_zone_keys(&keys->keyset);
+	return load_zone_keys(&keys->dnssec, &keys->keyset, verbose);
+}
+
+/*!
+ * \brief Replace the current keys, wait until they aren't used by any query.
+ */
+static void keys_publish(online_sign_ctx_t *ctx, online_keys_t *keys)
+{
+	online_keys_t *old_keys = ctx->keys;
+	rcu_assign_pointer(ctx->keys, keys);
+	synchronize_rcu();
+	rrsig_cache_clear(ctx->rrsig_cache);
+	keys_free(old_keys);
+}
+
+static void events_schedule(online_sign_ctx_t *ctx, knot_time_t now)
+{
+	knot_time_t next = knot_time_min(ctx->event_rollover, ctx->event_parent_ds_q);
+	if (next == 0) {
+		return;
+	}
+
+	knot_timediff_t diff = knot_time_diff(next, now);
+	uint32_t diff_ms = (diff <= 0) ? 0 : MIN(diff, UINT32_MAX / 1000) * 1000;
+
+	evsched_schedule(ctx->event, diff_ms);
+}
+
+/*!
+ * \brief Mark the event task finished and plan the next event.
+ */
+static void events_done(online_sign_ctx_t *ctx, knot_time_t now)
+{
+	pthread_mutex_lock(&ctx->event_reschedule_lock);
+	pthread_mutex_lock(&ctx->event_mutex);
+	bool frozen = ctx->event_frozen;
+	ctx->event_running = false;
+	pthread_cond_broadcast(&ctx->event_done);
+	pthread_mutex_unlock(&ctx->event_mutex);
+
+	// No more events for a doomed zone.
+	if (!frozen && ctx->keys != NULL) {
+		events_schedule(ctx, now);
+	}
+	pthread_mutex_unlock(&ctx->event_reschedule_lock);
+}
+
+/*!
+ * \brief Key events, executed by a background worker.
+ *
+ * Only the policy update reads the zone, the DS query and the key rollover
+ * run outside of the RCU read lock.
+ */
+static void events_run(worker_task_t *task)
+{
+	knotd_mod_t *mod = task->ctx;
+	online_sign_ctx_t *ctx = knotd_mod_ctx(mod);
+	zone_sign_reschedule_t resch = { 0 };
+
+	online_keys_t *keys = NULL;
+	int ret = keys_new(mod, &keys);
+	if (ret != KNOT_EOK) {
+		knotd_mod_log(mod, LOG_ERR, "failed to initialize signing context (%s)",
+		              knot_strerror(ret));
+		kdnssec_ctx_t failed = { .now = knot_time() };
+		ctx->event_rollover = knot_dnssec_failover_delay(&failed);
+		events_done(ctx, failed.now);
+		return;
+	}
+	kdnssec_ctx_t *dnssec = &keys->dnssec;
+
+	ret = KNOT_ESEMCHECK;
+	if (knot_time_cmp(ctx->event_parent_ds_q, dnssec->now) <= 0) {
+		ret = keys_load(keys, false);
+		if (ret == KNOT_EOK) {
+			ret = knot_parent_ds_query(dnssec, &keys->keyset, 1000);
+		}
+		if (ret != KNOT_EOK && ret != KNOT_NO_READY_KEY && dnssec->policy->ksk_sbm_check_interval > 0) {
+			ctx->event_parent_ds_q = dnssec->now + dnssec->policy->ksk_sbm_check_interval;
+		} else {
+			ctx->event_parent_ds_q = 0;
+		}
+	}
+	if (ret == KNOT_EOK || knot_time_cmp(ctx->event_rollover, dnssec->now) <= 0) {
+		rcu_read_lock();
+		zone_t *zone = knot_zonedb_find(mod->server->zone_db, mod->zone);
+		zone_contents_t *contents = (zone != NULL) ? rcu_dereference(zone->contents) : NULL;
+		if (contents != NULL) {
+			update_policy_from_zone(dnssec->policy, contents);
+		}
+		rcu_read_unlock();
+
+		if (contents != NULL) {
+			ret = knot_dnssec_key_rollover(dnssec, KEY_ROLL_ALLOW_KSK_ROLL | KEY_ROLL_ALLOW_ZSK_ROLL, &resch);
+		} else {
+			ret = KNOT_ENOZONE;
+		}
+		if (ret != KNOT_EOK) {
+			ctx->event_rollover = knot_dnssec_failover_delay(dnssec);
+		}
+	}
+
+	if (ret == KNOT_EOK) {
+		if (resch.plan_ds_check && dnssec->policy->ksk_sbm_check_interval > 0) {
+			ctx->event_parent_ds_q = dnssec->now + dnssec->policy->ksk_sbm_check_interval;
+		} else {
+			ctx->event_parent_ds_q = 0;
+		}
+
+		ctx->event_rollover = resch.next_rollover;
+
+		// The rollover might have changed the keys, the keyset is reloaded.
+		ret = keys_load(keys, true);
+		if (ret != KNOT_EOK) {
+			knotd_mod_log(mod, LOG_ERR, "failed to load signing keys (%s)",
+			              knot_strerror(ret));
+			keys_free(keys);
+			keys = NULL;
+		} else {
+			ctx->event_rollover = knot_time_min(ctx->event_rollover,
+			                                    knot_get_next_zone_key_event(&keys->keyset));
+		}
+		keys_publish(ctx, keys);
+	} else {
+		keys_free(keys);
+	}
+
+	events_done(ctx, knot_time());
+}
+
+/*!
+ * \brief Called by the scheduler thread if the key event occurs.
+ */
+static void events_dispatch(event_t *event)
+{
+	knotd_mod_t *mod = event->data;
+	online_sign_ctx_t *ctx = knotd_mod_ctx(mod);
+
+	int ret = KNOT_EOK;
+	pthread_mutex_lock(&ctx->event_mutex);
+	if (!ctx->event_running && !ctx->event_frozen) {
+		ctx->event_running = true;
+		ret = worker_pool_assign(mod->server->workers, &ctx->event_task);
+		if (ret != KNOT_EOK) {
+			ctx->event_running = false;
+		}
+	}
+	pthread_mutex_unlock(&ctx->event_mutex);
+
+	// Try again later, the event callback can't wait for a free queue slot.
+	if (ret != KNOT_EOK) {
+		knotd_mod_log(mod, LOG_WARNING, "failed to queue key event (%s)",
+		              knot_strerror(ret));
+		evsched_schedule(ctx->event, EVENT_RETRY_MS);
+	}
+}
+
+static int events_start(knotd_mod_t *mod, online_sign_ctx_t *ctx)
+{
+	ctx->event = evsched_event_create(&mod->server->sched, events_dispatch, mod);
+	if (ctx->event == NULL) {
+		return KNOT_ENOMEM;
+	}
+	ctx->event_task.ctx = mod;
+	ctx->event_task.run = events_run;
+
+	events_schedule(ctx, knot_time());
+
+	return KNOT_EOK;
+}
+
+static void events_stop(knotd_mod_t *mod, online_sign_ctx_t *ctx)
+{
+	if (ctx->event == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&ctx->event_mutex);
+	ctx->event_frozen = true;
+	// A task not taken by a worker yet is dropped, a running one is waited for.
+	// No worker pool means no task can run anymore.
+	if (ctx->event_running &&
+	    (mod->server->workers == NULL ||
+	     worker_pool_cancel(mod->server->workers, &ctx->event_task))) {
+		ctx->event_running = false;
+	}
+	while (ctx->event_running) {
+		pthread_cond_wait(&ctx->event_done, &ctx->event_mutex);
+	}
+	pthread_mutex_unlock(&ctx->event_mutex);
+
+	pthread_mutex_lock(&ctx->event_reschedule_lock);
+	evsched_cancel(ctx->event);
+	pthread_mutex_unlock(&ctx->event_reschedule_lock);
+	evsched_event_free(ctx->event);
+	ctx->event = NULL;
+}
+
 static void online_sign_ctx_free(online_sign_ctx_t *ctx)
 {
 	pthread_mutex_destroy(&ctx->event_mutex);
-	pthread_rwlock_destroy(&ctx->signing_mutex);
+	pthread_mutex_destroy(&ctx->event_reschedule_lock);
+	pthread_cond_destroy(&ctx->event_done);
 
+	keys_free(ctx->keys);
+	rrsig_cache_free(ctx->rrsig_cache);
 	free(ctx->nsec_force_types);
 	free(ctx);
 }
@@ -616,20 +917,20 @@ static int online_sign_ctx_new(online_sign_ctx_t **ctx_ptr, knotd_mod_t *mod)
 		return KNOT_ENOMEM;
 	}
 
-	int ret = knotd_mod_dnssec_init(mod);
+	online_keys_t *keys = NULL;
+	int ret = keys_new(mod, &keys);
 	if (ret != KNOT_EOK) {
 		free(ctx);
 		return ret;
 	}
 
-	// Historically, the default scheme is Single-Type signing.
-	if (mod->dnssec->policy->sts_default) {
-		mod->dnssec->policy->single_type_signing = true;
-	}
-
 	zone_sign_reschedule_t resch = { 0 };
-	ret = knot_dnssec_key_rollover(mod->dnssec, KEY_ROLL_ALLOW_KSK_ROLL | KEY_ROLL_ALLOW_ZSK_ROLL, &resch);
+	ret = knot_dnssec_key_rollover(&keys->dnssec, KEY_ROLL_ALLOW_KSK_ROLL | KEY_ROLL_ALLOW_ZSK_ROLL, &resch);
+	if (ret == KNOT_EOK) {
+		ret = keys_load(keys, true);
+	}
 	if (ret != KNOT_EOK) {
+		keys_free(keys);
 		free(ctx);
 		return ret;
 	}
@@ -637,18 +938,13 @@ static int online_sign_ctx_new(online_sign_ctx_t **ctx_ptr, knotd_mod_t *mod)
 	if (resch.plan_ds_check) {
 		ctx->event_parent_ds_q = time(NULL);
 	}
-	ctx->event_rollover = resch.next_rollover;
-
-	ret = knotd_mod_dnssec_load_keyset(mod, true);
-	if (ret != KNOT_EOK) {
-		free(ctx);
-		return ret;
-	}
-
-	ctx->event_rollover = knot_time_min(ctx->event_rollover, knot_get_next_zone_key_event(mod->keyset));
+	ctx->event_rollover = knot_time_min(resch.next_rollover,
+	                                    knot_get_next_zone_key_event(&keys->keyset));
+	ctx->keys = keys;
 
 	pthread_mutex_init(&ctx->event_mutex, NULL);
-	pthread_rwlock_init(&ctx->signing_mutex, NULL);
+	pthread_mutex_init(&ctx->event_reschedule_lock, NULL);
+	pthread_cond_init(&ctx->event_done, NULL);
 
 	*ctx_ptr = ctx;
 
@@ -706,8 +1002,34 @@ int online_sign_load(knotd_mod_t *mod)
 		return ret;
 	}
 
+	size_t cache_size = knotd_conf_mod(mod, MOD_CACHE_SIZE).single.integer;
+	if (cache_size > 0) {
+		ctx->rrsig_cache = rrsig_cache_new(cache_size);
+		if (ctx->rrsig_cache == NULL) {
+			online_sign_ctx_free(ctx);
+			return KNOT_ENOMEM;
+		}
+		ctx->cache_validity = knotd_conf_mod(mod, MOD_CACHE_VALID).single.integer;
+
+		ret = knotd_mod_stats_add(mod, "cache-hit", 1, NULL);
+		if (ret == KNOT_EOK) {
+			ret = knotd_mod_stats_add(mod, "cache-miss", 1, NULL);
+		}
+		if (ret != KNOT_EOK) {
+			online_sign_ctx_free(ctx);
+			return ret;
+		}
+	}
+
 	knotd_mod_ctx_set(mod, ctx);
 
+	ret = events_start(mod, ctx);
+	if (ret != KNOT_EOK) {
+		knotd_mod_ctx_set(mod, NULL);
+		online_sign_ctx_free(ctx);
+		return ret;
+	}
+
 	knotd_mod_in_hook(mod, KNOTD_STAGE_ANSWER, pre_routine);
 
 	knotd_mod_in_hook(mod, KNOTD_STAGE_ANSWER, synth_answer);
@@ -723,7 +1045,9 @@ int online_sign_load(knotd_mod_t *mod)
 
 void online_sign_unload(knotd_mod_t *mod)
 {
-	online_sign_ctx_free(knotd_mod_ctx(mod));
+	online_sign_ctx_t *ctx = knotd_mod_ctx(mod);
+	events_stop(mod, ctx);
+	online_sign_ctx_free(ctx);
 }
 
 KNOTD_MOD_API(onlinesign, KNOTD_MOD_FLAG_SCOPE_ZONE | KNOTD_MOD_FLAG_OPT_CONF,
@@ -0,0 +1,186 @@
+/*  Copyright (C) 2021 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "knot/modules/onlinesign/rrsig_cache.h"
+#include "contrib/openbsd/siphash.h"
+#include "libdnssec/error.h"
+#include "libdnssec/random.h"
+
+#define RRSIG_CACHE_LOCKS 32
+
+typedef struct {
+	uint64_t hash;            /*!< Hash of the covered RRSet. */
+	knot_time_t valid_until;  /*!< Time until the entry can be served. */
+	knot_dname_t *owner;      /*!< Owner of the covered RRSet (NULL if empty). */
+	uint16_t type;            /*!< Type of the covered RRSet. */
+	uint32_t ttl;             /*!< TTL of the covered RRSet. */
+	knot_rdataset_t rrs;      /*!< Covered rdataset. */
+	knot_rdataset_t rrsigs;   /*!< RRSIGs of the covered RRSet. */
+} rrsig_cache_item_t;
+
+struct rrsig_cache {
+	SIPHASH_KEY key;
+	size_t size;
+	pthread_mutex_t locks[RRSIG_CACHE_LOCKS];
+	rrsig_cache_item_t items[];
+};
+
+static uint64_t rrset_hash(const SIPHASH_KEY *key, const knot_rrset_t *rrset)
+{
+	SIPHASH_CTX ctx;
+	SipHash24_Init(&ctx, key);
+	SipHash24_Update(&ctx, rrset->owner, knot_dname_size(rrset->owner));
+	SipHash24_Update(&ctx, &rrset->type, sizeof(rrset->type));
+	SipHash24_Update(&ctx, &rrset->ttl, sizeof(rrset->ttl));
+	SipHash24_Update(&ctx, rrset->rrs.rdata, rrset->rrs.size);
+	return SipHash24_End(&ctx);
+}
+
+static bool item_match(const rrsig_cache_item_t *item, uint64_t hash,
+                       const knot_rrset_t *rrset)
+{
+	return item->owner != NULL &&
+	       item->hash == hash &&
+	       item->type == rrset->type &&
+	       item->ttl == rrset->ttl &&
+	       knot_dname_is_equal(item->owner, rrset->owner) &&
+	       knot_rdataset_eq(&item->rrs, &rrset->rrs);
+}
+
+static void item_clear(rrsig_cache_item_t *item)
+{
+	knot_dname_free(item->owner, NULL);
+	knot_rdataset_clear(&item->rrs, NULL);
+	knot_rdataset_clear(&item->rrsigs, NULL);
+	memset(item, 0, sizeof(*item));
+}
+
+rrsig_cache_t *rrsig_cache_new(size_t size)
+{
+	if (size == 0) {
+		return NULL;
+	}
+
+	rrsig_cache_t *cache = calloc(1, sizeof(*cache) + size * sizeof(rrsig_cache_item_t));
+	if (cache == NULL) {
+		return NULL;
+	}
+	cache->size = size;
+
+	if (dnssec_random_buffer((uint8_t *)&cache->key, sizeof(cache->key)) != DNSSEC_EOK) {
+		free(cache);
+		return NULL;
+	}
+
+	for (size_t i = 0; i < RRSIG_CACHE_LOCKS; ++i) {
+		pthread_mutex_init(&cache->locks[i], NULL);
+	}
+
+	return cache;
+}
+
+bool rrsig_cache_get(rrsig_cache_t *cache, const knot_rrset_t *covered,
+                     knot_time_t now, knot_rdataset_t *rrsigs, knot_mm_t *mm)
+{
+	if (cache == NULL || covered == NULL || rrsigs == NULL) {
+		return false;
+	}
+
+	uint64_t hash = rrset_hash(&cache->key, covered);
+	size_t slot = hash % cache->size;
+	pthread_mutex_t *lock = &cache->locks[slot % RRSIG_CACHE_LOCKS];
+	rrsig_cache_item_t *item = &cache->items[slot];
+
+	bool found = false;
+	pthread_mutex_lock(lock);
+	if (item_match(item, hash, covered)) {
+		if (knot_time_cmp(now, item->valid_until) < 0) {
+			found = (knot_rdataset_copy(rrsigs, &item->rrsigs, mm) == KNOT_EOK);
+		} else {
+			item_clear(item);
+		}
+	}
+	pthread_mutex_unlock(lock);
+
+	return found;
+}
+
+void rrsig_cache_put(rrsig_cache_t *cache, const knot_rrset_t *covered,
+                     const knot_rdataset_t *rrsigs, knot_time_t valid_until)
+{
+	if (cache == NULL || covered == NULL || rrsigs == NULL) {
+		return;
+	}
+
+	// Prepare the entry outside of the lock.
+	rrsig_cache_item_t new = {
+		.hash = rrset_hash(&cache->key, covered),
+		.valid_until = valid_until,
+		.owner = knot_dname_copy(covered->owner, NULL),
+		.type = covered->type,
+		.ttl = covered->ttl,
+	};
+	if (new.owner == NULL ||
+	    knot_rdataset_copy(&new.rrs, &covered->rrs, NULL) != KNOT_EOK ||
+	    knot_rdataset_copy(&new.rrsigs, rrsigs, NULL) != KNOT_EOK) {
+		item_clear(&new);
+		return;
+	}
+
+	size_t slot = new.hash % cache->size;
+	pthread_mutex_t *lock = &cache->locks[slot % RRSIG_CACHE_LOCKS];
+	rrsig_cache_item_t *item = &cache->items[slot];
+
+	pthread_mutex_lock(lock);
+	rrsig_cache_item_t old = *item;
+	*item = new;
+	pthread_mutex_unlock(lock);
+
+	item_clear(&old);
+}
+
+void rrsig_cache_clear(rrsig_cache_t *cache)
+{
+	if (cache == NULL) {
+		return;
+	}
+
+	for (size_t i = 0; i < cache->size; ++i) {
+		pthread_mutex_t *lock = &cache->locks[i % RRSIG_CACHE_LOCKS];
+		pthread_mutex_lock(lock);
+		item_clear(&cache->items[i]);
+		pthread_mutex_unlock(lock);
+	}
+}
+
+void rrsig_cache_free(rrsig_cache_t *cache)
+{
+	if (cache == NULL) {
+		return;
+	}
+
+	rrsig_cache_clear(cache);
+
+	for (size_t i = 0; i < RRSIG_CACHE_LOCKS; ++i) {
+		pthread_mutex_destroy(&cache->locks[i]);
+	}
+
+	free(cache);
+}
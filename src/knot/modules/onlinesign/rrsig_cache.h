@@ -0,0 +1,77 @@
+/*  Copyright (C) 2021 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "contrib/time.h"
+#include "libknot/libknot.h"
+
+/*!
+ * \brief Cache of generated RRSIGs.
+ *
+ * The cache is a fixed size direct-mapped table, the entries are keyed by
+ * the covered RRSet (owner, type, TTL and rdataset). Colliding entries are
+ * replaced. To avoid lock contention, the slots are guarded by N locks,
+ * the lock K for slot I is calculated as K = I % N.
+ */
+typedef struct rrsig_cache rrsig_cache_t;
+
+/*!
+ * \brief Create an RRSIG cache.
+ *
+ * \param size  Number of cache slots.
+ *
+ * \return Created cache or NULL.
+ */
+rrsig_cache_t *rrsig_cache_new(size_t size);
+
+/*!
+ * \brief Look up RRSIGs for the covered RRSet.
+ *
+ * \param cache    RRSIG cache.
+ * \param covered  Covered RRSet (with the owner as put into the answer).
+ * \param now      Current time.
+ * \param rrsigs   Output rdataset with the cached RRSIGs (allocated on \a mm).
+ * \param mm       Memory context.
+ *
+ * \retval true if a valid entry was found and copied.
+ */
+bool rrsig_cache_get(rrsig_cache_t *cache, const knot_rrset_t *covered,
+                     knot_time_t now, knot_rdataset_t *rrsigs, knot_mm_t *mm);
+
+/*!
+ * \brief Store RRSIGs for the covered RRSet.
+ *
+ * \param cache        RRSIG cache.
+ * \param covered      Covered RRSet.
+ * \param rrsigs       RRSIGs of the covered RRSet.
+ * \param valid_until  Time until which the entry can be served.
+ */
+void rrsig_cache_put(rrsig_cache_t *cache, const knot_rrset_t *covered,
+                     const knot_rdataset_t *rrsigs, knot_time_t valid_until);
+
+/*!
+ * \brief Drop all cached RRSIGs.
+ */
+void rrsig_cache_clear(rrsig_cache_t *cache);
+
+/*!
+ * \brief Destroy the RRSIG cache.
+ */
+void rrsig_cache_free(rrsig_cache_t *cache);
@@ -187,5 +187,6 @@ void probe_unload(knotd_mod_t *mod)
 	}
 }
 
-KNOTD_MOD_API(probe, KNOTD_MOD_FLAG_SCOPE_ANY | KNOTD_MOD_FLAG_OPT_CONF,
+KNOTD_MOD_API(probe, KNOTD_MOD_FLAG_SCOPE_ANY | KNOTD_MOD_FLAG_OPT_CONF |
+                     KNOTD_MOD_FLAG_CACHEABLE,
               probe_load, probe_unload, probe_conf, NULL);
@@ -89,5 +89,5 @@ void queryacl_unload(knotd_mod_t *mod)
 	free(ctx);
 }
 
-KNOTD_MOD_API(queryacl, KNOTD_MOD_FLAG_SCOPE_ANY,
+KNOTD_MOD_API(queryacl, KNOTD_MOD_FLAG_SCOPE_ANY | KNOTD_MOD_FLAG_CACHEABLE,
               queryacl_load, queryacl_unload, queryacl_conf, NULL);
@@ -35,7 +35,8 @@
 #define RRL_SSTART 2 /* 1/Nth of the rate for slow start */
 #define RRL_PSIZE_LARGE 1024
 #define RRL_CAPACITY 4 /* Window size in seconds */
-#define RRL_LOCK_GRANULARITY 32 /* Last digit granularity */
+#define RRL_SHARD_COUNT 64 /* Maximum number of table shards */
+#define RRL_SHARD_MINSIZE (4 * HOP_LEN) /* Minimum buckets per shard */
 
 /* Classification */
 enum {
@@ -199,7 +200,7 @@ static int bucket_match(rrl_item_t *bucket, rrl_item_t *match)
 	       bucket->qname  == match->qname;
 }
 
-static int find_free(rrl_table_t *tbl, unsigned id, uint32_t now)
+static int find_free(rrl_shard_t *tbl, unsigned id, uint32_t now)
 {
 	for (int i = id; i < tbl->size; i++) {
 		if (bucket_free(&tbl->arr[i], now)) {
@@ -216,7 +217,7 @@ static int find_free(rrl_table_t *tbl, unsigned id, uint32_t now)
 	return id;
 }
 
-static inline unsigned find_match(rrl_table_t *tbl, uint32_t id, rrl_item_t *m)
+static inline unsigned find_match(rrl_shard_t *tbl, uint32_t id, rrl_item_t *m)
 {
 	unsigned new_id = 0;
 	unsigned hop = 0;
@@ -234,7 +235,7 @@ static inline unsigned find_match(rrl_table_t *tbl, uint32_t id, rrl_item_t *m)
 	return HOP_LEN + 1;
 }
 
-static inline unsigned reduce_dist(rrl_table_t *tbl, unsigned id, unsigned dist, unsigned *free_id)
+static inline unsigned reduce_dist(rrl_shard_t *tbl, unsigned id, unsigned dist, unsigned *free_id)
 {
 	unsigned rd = HOP_LEN - 1;
 	while (rd > 0) {
@@ -307,49 +308,37 @@ static void rrl_log_state(knotd_mod_t *mod, const struct sockaddr_storage *ss,
 	              addr_str, rrl_clsstr(cls), qname_str, what);
 }
 
-static void rrl_lock(rrl_table_t *tbl, int lk_id)
+static int rrl_setshards(rrl_table_t *tbl, unsigned count)
 {
-	assert(lk_id > -1);
-	pthread_mutex_lock(tbl->lk + lk_id);
-}
-
-static void rrl_unlock(rrl_table_t *tbl, int lk_id)
-{
-	assert(lk_id > -1);
-	pthread_mutex_unlock(tbl->lk + lk_id);
-}
-
-static int rrl_setlocks(rrl_table_t *tbl, uint32_t granularity)
-{
-	assert(!tbl->lk); /* Cannot change while locks are used. */
-	assert(granularity <= tbl->size / 10); /* Due to int. division err. */
+	assert(!tbl->shards); /* Cannot change while shards are used. */
+	assert(count > 0);
 
-	if (pthread_mutex_init(&tbl->ll, NULL) < 0) {
+	tbl->shards = calloc(count, sizeof(rrl_shard_t));
+	if (!tbl->shards) {
 		return KNOT_ENOMEM;
 	}
 
-	/* Alloc new locks. */
-	tbl->lk = malloc(granularity * sizeof(pthread_mutex_t));
-	if (!tbl->lk) {
-		return KNOT_ENOMEM;
-	}
-	memset(tbl->lk, 0, granularity * sizeof(pthread_mutex_t));
-
-	/* Initialize. */
-	for (size_t i = 0; i < granularity; ++i) {
-		if (pthread_mutex_init(tbl->lk + i, NULL) < 0) {
+	/* Distribute the buckets, the first shards take the remainder. */
+	rrl_item_t *arr = tbl->arr;
+	for (unsigned i = 0; i < count; ++i) {
+		rrl_shard_t *shard = tbl->shards + i;
+		if (pthread_mutex_init(&shard->lock, NULL) != 0) {
 			break;
 		}
-		++tbl->lk_count;
+		shard->size = tbl->size / count + (i < tbl->size % count ? 1 : 0);
+		shard->arr = arr;
+		arr += shard->size;
+		++tbl->shard_count;
 	}
 
 	/* Incomplete initialization */
-	if (tbl->lk_count != granularity) {
-		for (size_t i = 0; i < tbl->lk_count; ++i) {
-			pthread_mutex_destroy(tbl->lk + i);
+	if (tbl->shard_count != count) {
+		for (unsigned i = 0; i < tbl->shard_count; ++i) {
+			pthread_mutex_destroy(&tbl->shards[i].lock);
 		}
-		free(tbl->lk);
-		tbl->lk_count = 0;
+		free(tbl->shards);
+		tbl->shards = NULL;
+		tbl->shard_count = 0;
 		return KNOT_ERROR;
 	}
 
@@ -375,7 +364,12 @@ rrl_table_t *rrl_create(size_t size, uint32_t rate)
 		return NULL;
 	}
 
-	if (rrl_setlocks(tbl, RRL_LOCK_GRANULARITY) != KNOT_EOK) {
+	unsigned shards = RRL_SHARD_COUNT;
+	while (shards > 1 && size / shards < RRL_SHARD_MINSIZE) {
+		shards /= 2;
+	}
+
+	if (rrl_setshards(tbl, shards) != KNOT_EOK) {
 		free(tbl);
 		return NULL;
 	}
@@ -388,22 +382,25 @@ static knot_dname_t *buf_qname(uint8_t *buf)
 	return buf + sizeof(uint8_t) + sizeof(uint64_t);
 }
 
-/*! \brief Get bucket for current combination of parameters. */
+/*!
+ * \brief Get bucket for current combination of parameters.
+ *
+ * \note On success, the returned bucket's shard is locked and stored into \a shard.
+ */
 static rrl_item_t *rrl_hash(rrl_table_t *tbl, const struct sockaddr_storage *remote,
                             rrl_req_t *req, const knot_dname_t *zone, uint32_t stamp,
-                            int *lock, uint8_t *buf, size_t buf_len)
+                            rrl_shard_t **shard, uint8_t *buf, size_t buf_len)
 {
 	int len = rrl_classify(buf, buf_len, remote, req, zone);
 	if (len < 0) {
 		return NULL;
 	}
 
-	uint32_t id = SipHash24(&tbl->key, buf, len) % tbl->size;
-
-	/* Lock for lookup. */
-	pthread_mutex_lock(&tbl->ll);
+	/* Select the shard and the home bucket within it. */
+	uint64_t hash = SipHash24(&tbl->key, buf, len);
+	rrl_shard_t *shd = tbl->shards + (hash % tbl->shard_count);
+	uint32_t id = (hash / tbl->shard_count) % shd->size;
 
-	/* Find an exact match in <id, id + HOP_LEN). */
 	knot_dname_t *qname = buf_qname(buf);
 	uint64_t netblk;
 	memcpy(&netblk, buf + sizeof(uint8_t), sizeof(netblk));
@@ -417,26 +414,26 @@ static rrl_item_t *rrl_hash(rrl_table_t *tbl, const struct sockaddr_storage *rem
 		.time = stamp
 	};
 
-	unsigned dist = find_match(tbl, id, &match);
+	/* Lock the shard for lookup and bucket update. */
+	pthread_mutex_lock(&shd->lock);
+	*shard = shd;
+
+	/* Find an exact match in <id, id + HOP_LEN). */
+	unsigned dist = find_match(shd, id, &match);
 	if (dist > HOP_LEN) { /* not an exact match, find free element [f] */
-		dist = find_free(tbl, id, stamp);
+		dist = find_free(shd, id, stamp);
 	}
 
 	/* Reduce distance to fit <id, id + HOP_LEN) */
-	unsigned free_id = (id + dist) % tbl->size;
+	unsigned free_id = (id + dist) % shd->size;
 	while (dist >= HOP_LEN) {
-		dist = reduce_dist(tbl, id, dist, &free_id);
+		dist = reduce_dist(shd, id, dist, &free_id);
 	}
 
-	/* Assign granular lock and unlock lookup. */
-	*lock = free_id % tbl->lk_count;
-	rrl_lock(tbl, *lock);
-	pthread_mutex_unlock(&tbl->ll);
-
 	/* found free bucket which is in <id, id + HOP_LEN) */
-	tbl->arr[id].hop |= (1 << dist);
-	rrl_item_t *bucket = &tbl->arr[free_id];
-	assert(free_id == (id + dist) % tbl->size);
+	shd->arr[id].hop |= (1 << dist);
+	rrl_item_t *bucket = &shd->arr[free_id];
+	assert(free_id == (id + dist) % shd->size);
 
 	/* Inspect bucket state. */
 	unsigned hop = bucket->hop;
@@ -468,13 +465,10 @@ int rrl_query(rrl_table_t *rrl, const struct sockaddr_storage *remote,
 
 	/* Calculate hash and fetch */
 	int ret = KNOT_EOK;
-	int lock = -1;
+	rrl_shard_t *shard = NULL;
 	uint32_t now = time_now().tv_sec;
-	rrl_item_t *bucket = rrl_hash(rrl, remote, req, zone, now, &lock, buf, sizeof(buf));
+	rrl_item_t *bucket = rrl_hash(rrl, remote, req, zone, now, &shard, buf, sizeof(buf));
 	if (!bucket) {
-		if (lock > -1) {
-			rrl_unlock(rrl, lock);
-		}
 		return KNOT_ERROR;
 	}
 
@@ -519,9 +513,7 @@ int rrl_query(rrl_table_t *rrl, const struct sockaddr_storage *remote,
 		ret = KNOT_ELIMIT;
 	}
 
-	if (lock > -1) {
-		rrl_unlock(rrl, lock);
-	}
+	pthread_mutex_unlock(&shard->lock);
 	return ret;
 }
 
@@ -540,13 +532,10 @@ bool rrl_slip_roll(int n_slip)
 void rrl_destroy(rrl_table_t *rrl)
 {
 	if (rrl) {
-		if (rrl->lk_count > 0) {
-			pthread_mutex_destroy(&rrl->ll);
-		}
-		for (size_t i = 0; i < rrl->lk_count; ++i) {
-			pthread_mutex_destroy(rrl->lk + i);
+		for (unsigned i = 0; i < rrl->shard_count; ++i) {
+			pthread_mutex_destroy(&rrl->shards[i].lock);
 		}
-		free(rrl->lk);
+		free(rrl->shards);
 	}
 
 	free(rrl);
@@ -37,6 +37,18 @@ typedef struct {
 	uint32_t time;       /* Timestamp. */
 } rrl_item_t;
 
+/*!
+ * \brief RRL hash bucket table shard.
+ *
+ * Each shard is an independent hopscotch table with its own lock, all lookups,
+ * insertions and bucket updates are serialized only within the shard.
+ */
+typedef struct {
+	pthread_mutex_t lock; /* Shard lock. */
+	size_t size;          /* Number of buckets in the shard. */
+	rrl_item_t *arr;      /* Shard buckets. */
+} rrl_shard_t;
+
 /*!
  * \brief RRL hash bucket table.
  *
@@ -45,18 +57,18 @@ typedef struct {
  * When a bucket is in a slow-start mode, it cannot reset again for the time
  * period.
  *
- * To avoid lock contention, N locks are created and distributed amongst buckets.
- * As of now lock K for bucket N is calculated as K = N % (num_buckets).
+ * To avoid lock contention, the table is split into N shards, each guarded
+ * by its own lock. There is no table-wide lock, the shard for a request is
+ * selected by its hash as K = hash % N and the bucket within the shard
+ * is derived from the remaining hash bits.
  */
-
 typedef struct {
-	SIPHASH_KEY key;     /* Siphash key. */
-	uint32_t rate;       /* Configured RRL limit. */
-	pthread_mutex_t ll;
-	pthread_mutex_t *lk; /* Table locks. */
-	unsigned lk_count;   /* Table lock count (granularity). */
-	size_t size;         /* Number of buckets. */
-	rrl_item_t arr[];    /* Buckets. */
+	SIPHASH_KEY key;       /* Siphash key. */
+	uint32_t rate;         /* Configured RRL limit. */
+	size_t size;           /* Number of buckets. */
+	unsigned shard_count;  /* Number of table shards. */
+	rrl_shard_t *shards;   /* Table shards. */
+	rrl_item_t arr[];      /* Buckets. */
 } rrl_table_t;
 
 /*! \brief RRL request flags. */
@@ -204,5 +204,5 @@ void rrl_unload(knotd_mod_t *mod)
 	ctx_free(ctx);
 }
 
-KNOTD_MOD_API(rrl, KNOTD_MOD_FLAG_SCOPE_ANY,
+KNOTD_MOD_API(rrl, KNOTD_MOD_FLAG_SCOPE_ANY | KNOTD_MOD_FLAG_CACHEABLE,
               rrl_load, rrl_unload, rrl_conf, rrl_conf_check);
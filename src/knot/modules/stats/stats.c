@@ -32,6 +32,7 @@
 #define MOD_QTYPE	"\x0A""query-type"
 #define MOD_QSIZE	"\x0A""query-size"
 #define MOD_RSIZE	"\x0A""reply-size"
+#define MOD_LATENCY	"\x0F""request-latency"
 
 #define OTHER		"other"
 
@@ -49,6 +50,7 @@ const yp_item_t stats_conf[] = {
 	{ MOD_QTYPE,      YP_TBOOL, YP_VNONE },
 	{ MOD_QSIZE,      YP_TBOOL, YP_VNONE },
 	{ MOD_RSIZE,      YP_TBOOL, YP_VNONE },
+	{ MOD_LATENCY,    YP_TBOOL, YP_VNONE },
 	{ NULL }
 };
 
@@ -66,6 +68,7 @@ enum {
 	CTR_QTYPE,
 	CTR_QSIZE,
 	CTR_RSIZE,
+	CTR_LATENCY,
 };
 
 typedef struct {
@@ -82,6 +85,7 @@ typedef struct {
 	bool qtype;
 	bool qsize;
 	bool rsize;
+	bool latency;
 } stats_t;
 
 typedef struct {
@@ -338,6 +342,90 @@ static char *rsize_to_str(uint32_t idx, uint32_t count)
 	return size_to_str(idx, count);
 }
 
+/*
+ * Log-linear latency histogram (in microseconds). Values below
+ * LATENCY_SUB_COUNT have their own buckets, each higher power of 2 is split
+ * into LATENCY_SUB_COUNT equal buckets (max. relative error 12.5 %).
+ * Longer latencies are counted in the last bucket.
+ */
+#define LATENCY_SUB_BITS	3
+#define LATENCY_SUB_COUNT	(1 << LATENCY_SUB_BITS)
+#define LATENCY_MAX_EXP		23 // ~16.8 s
+#define LATENCY_BUCKETS		((LATENCY_MAX_EXP - LATENCY_SUB_BITS + 2) * LATENCY_SUB_COUNT)
+
+enum {
+	LATENCY_UDP = 0,
+	LATENCY_TCP,
+	LATENCY_UDP_XDP,
+	LATENCY_TCP_XDP,
+	LATENCY_PROTO__COUNT
+};
+
+#define LATENCY__COUNT	(LATENCY_PROTO__COUNT * OPERATION__COUNT * LATENCY_BUCKETS)
+
+static uint32_t latency_bucket(uint64_t usec)
+{
+	if (usec < LATENCY_SUB_COUNT) {
+		return usec;
+	}
+
+	unsigned exp = 63 - __builtin_clzll(usec);
+	if (exp > LATENCY_MAX_EXP) {
+		return LATENCY_BUCKETS - 1;
+	}
+
+	unsigned shift = exp - LATENCY_SUB_BITS;
+	return (shift + 1) * LATENCY_SUB_COUNT + (usec >> shift) - LATENCY_SUB_COUNT;
+}
+
+static char *latency_to_str(uint32_t idx, uint32_t count)
+{
+	static const char *protocols[] = {
+		[LATENCY_UDP]     = "udp",
+		[LATENCY_TCP]     = "tcp",
+		[LATENCY_UDP_XDP] = "udp-xdp",
+		[LATENCY_TCP_XDP] = "tcp-xdp",
+	};
+
+	uint32_t bucket = idx % LATENCY_BUCKETS;
+	uint32_t operation = (idx / LATENCY_BUCKETS) % OPERATION__COUNT;
+	uint32_t protocol = idx / LATENCY_BUCKETS / OPERATION__COUNT;
+	assert(protocol < LATENCY_PROTO__COUNT);
+
+	char *op_str = operation_to_str(operation, OPERATION__COUNT);
+	if (op_str == NULL) {
+		return NULL;
+	}
+
+	uint32_t lo = bucket, hi = bucket;
+	if (bucket >= LATENCY_SUB_COUNT) {
+		unsigned shift = bucket / LATENCY_SUB_COUNT - 1;
+		uint32_t mant = bucket % LATENCY_SUB_COUNT + LATENCY_SUB_COUNT;
+		lo = mant << shift;
+		hi = ((mant + 1) << shift) - 1;
+	}
+
+	char str[64];
+	int ret;
+	if (bucket == LATENCY_BUCKETS - 1) {
+		ret = snprintf(str, sizeof(str), "%s-%s-%u-inf", protocols[protocol],
+		               op_str, lo);
+	} else if (lo == hi) {
+		ret = snprintf(str, sizeof(str), "%s-%s-%uus", protocols[protocol],
+		               op_str, lo);
+	} else {
+		ret = snprintf(str, sizeof(str), "%s-%s-%u-%uus", protocols[protocol],
+		               op_str, lo, hi);
+	}
+	free(op_str);
+
+	if (ret <= 0 || (size_t)ret >= sizeof(str)) {
+		return NULL;
+	} else {
+		return strdup(str);
+	}
+}
+
 static const ctr_desc_t ctr_descs[] = {
 	#define item(macro, name, count) \
 		[CTR_##macro] = { MOD_##macro, offsetof(stats_t, name), (count), name##_to_str }
@@ -354,6 +442,7 @@ static const ctr_desc_t ctr_descs[] = {
 	item(QTYPE,      qtype,      QTYPE__COUNT),
 	item(QSIZE,      qsize,      QSIZE_MAX_IDX + 1),
 	item(RSIZE,      rsize,      RSIZE_MAX_IDX + 1),
+	item(LATENCY,    latency,    LATENCY__COUNT),
 	{ NULL }
 };
 
@@ -380,6 +469,30 @@ static void incr_edns_option(knotd_mod_t *mod, unsigned thr_id, const knot_pkt_t
 	}
 }
 
+static void incr_latency(knotd_mod_t *mod, unsigned thr_id,
+                         const knotd_qdata_params_t *params, uint16_t operation)
+{
+	const struct timespec *begin = &params->begin;
+	if (begin->tv_sec == 0 && begin->tv_nsec == 0) {
+		return;
+	}
+
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	int64_t usec = (now.tv_sec - begin->tv_sec) * 1000000 +
+	               (now.tv_nsec - begin->tv_nsec) / 1000;
+
+	unsigned protocol = (params->flags & KNOTD_QUERY_FLAG_LIMIT_SIZE) ?
+	                    LATENCY_UDP : LATENCY_TCP;
+	if (params->xdp_msg != NULL) {
+		protocol += LATENCY_UDP_XDP;
+	}
+
+	uint32_t idx = (protocol * OPERATION__COUNT + operation) * LATENCY_BUCKETS +
+	               latency_bucket(MAX(usec, 0));
+	knotd_mod_stats_incr(mod, thr_id, CTR_LATENCY, idx, 1);
+}
+
 static knotd_state_t update_counters(knotd_state_t state, knot_pkt_t *pkt,
                                      knotd_qdata_t *qdata, knotd_mod_t *mod)
 {
@@ -493,6 +606,11 @@ static knotd_state_t update_counters(knotd_state_t state, knot_pkt_t *pkt,
 		knotd_mod_stats_incr(mod, tid, CTR_OPERATION, operation, 1);
 	}
 
+	// Count the request latency (till the first response message).
+	if (stats->latency && state != KNOTD_STATE_NOOP) {
+		incr_latency(mod, tid, qdata->params, operation);
+	}
+
 	// Count the request protocol.
 	if (stats->protocol) {
 		bool xdp = qdata->params->xdp_msg != NULL;
@@ -648,5 +766,6 @@ void stats_unload(knotd_mod_t *mod)
 	free(knotd_mod_ctx(mod));
 }
 
-KNOTD_MOD_API(stats, KNOTD_MOD_FLAG_SCOPE_ANY | KNOTD_MOD_FLAG_OPT_CONF,
+KNOTD_MOD_API(stats, KNOTD_MOD_FLAG_SCOPE_ANY | KNOTD_MOD_FLAG_OPT_CONF |
+                     KNOTD_MOD_FLAG_CACHEABLE,
               stats_load, stats_unload, stats_conf, NULL);
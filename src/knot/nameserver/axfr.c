@@ -18,6 +18,7 @@
 
 #include "contrib/mempattern.h"
 #include "contrib/sockaddr.h"
+#include "knot/conf/conf.h"
 #include "knot/nameserver/axfr.h"
 #include "knot/nameserver/internet.h"
 #include "knot/nameserver/log.h"
@@ -31,14 +32,177 @@
 	ns_log(priority, ZONE_NAME(qdata), LOG_OPERATION_AXFR, \
 	       LOG_DIRECTION_OUT, REMOTE(qdata), fmt)
 
+/*! \brief One cached AXFR message, the answer section only. */
+typedef struct {
+	size_t offset;      /*!< Position in the cache data. */
+	uint16_t size;      /*!< Answer section size. */
+	uint16_t ancount;   /*!< Number of answer records. */
+} axfr_cache_msg_t;
+
+/*!
+ * \brief Encoded AXFR messages of one zone contents version.
+ *
+ * Only the answer sections are stored. Their compression pointers are
+ * relative to the message start, so they are valid for any response with
+ * the same question size. Header, OPT, and TSIG are added per client.
+ */
+struct axfr_cache {
+	axfr_cache_msg_t *msgs;  /*!< Messages. */
+	size_t msg_count;        /*!< Number of messages. */
+	size_t msg_max;          /*!< Allocated number of messages. */
+	uint8_t *data;           /*!< Answer sections of all messages. */
+	size_t size;             /*!< Used data size. */
+	size_t max_size;         /*!< Allocated data size. */
+	size_t limit;            /*!< Data size limit. */
+	uint16_t answer_pos;     /*!< Answer section position (header + question). */
+	uint16_t max_msg_size;   /*!< Largest answer section. */
+};
+
+/*! \brief Placeholders of the contents cache pointer. */
+#define AXFR_CACHE_BUILDING ((struct axfr_cache *)1)
+#define AXFR_CACHE_FAILED   ((struct axfr_cache *)2)
+#define AXFR_CACHE_VALID(cache) ((uintptr_t)(cache) > (uintptr_t)AXFR_CACHE_FAILED)
+
 /* AXFR context. @note aliasing the generic xfr_proc */
 struct axfr_proc {
 	struct xfr_proc proc;
 	trie_it_t *i;
 	zone_tree_it_t it;
 	unsigned cur_rrset;
+	struct axfr_cache *cache;   /*!< Cache to answer from. */
+	size_t cache_msg;           /*!< Next message from the cache. */
+	struct axfr_cache *build;   /*!< Cache being built by this transfer. */
 };
 
+void axfr_cache_free(struct axfr_cache *cache)
+{
+	if (AXFR_CACHE_VALID(cache)) {
+		free(cache->msgs);
+		free(cache->data);
+		free(cache);
+	}
+}
+
+static int axfr_cache_add(struct axfr_cache *cache, const knot_pkt_t *pkt)
+{
+	assert(pkt->size >= cache->answer_pos);
+
+	size_t size = pkt->size - cache->answer_pos;
+	if (cache->size + size > cache->limit) {
+		return KNOT_ESPACE;
+	}
+
+	if (cache->msg_count == cache->msg_max) {
+		size_t msg_max = MAX(2 * cache->msg_max, 64);
+		axfr_cache_msg_t *msgs = realloc(cache->msgs, msg_max * sizeof(*msgs));
+		if (msgs == NULL) {
+			return KNOT_ENOMEM;
+		}
+		cache->msgs = msgs;
+		cache->msg_max = msg_max;
+	}
+	if (cache->size + size > cache->max_size) {
+		size_t max_size = MAX(2 * cache->max_size, cache->size + size);
+		max_size = MIN(max_size, cache->limit);
+		uint8_t *data = realloc(cache->data, max_size);
+		if (data == NULL) {
+			return KNOT_ENOMEM;
+		}
+		cache->data = data;
+		cache->max_size = max_size;
+	}
+
+	cache->msgs[cache->msg_count++] = (axfr_cache_msg_t) {
+		.offset = cache->size,
+		.size = size,
+		.ancount = knot_wire_get_ancount(pkt->wire)
+	};
+	memcpy(cache->data + cache->size, pkt->wire + cache->answer_pos, size);
+	cache->size += size;
+	cache->max_msg_size = MAX(cache->max_msg_size, size);
+
+	return KNOT_EOK;
+}
+
+/*!
+ * \brief Answer from the cache if available, or become the one building it.
+ *
+ * The cache is built by the first transfer of the contents version and
+ * published once it successfully finishes.
+ */
+static void axfr_cache_begin(knot_pkt_t *pkt, knotd_qdata_t *qdata,
+                             struct axfr_proc *axfr)
+{
+	zone_contents_t *contents = (zone_contents_t *)qdata->extra->contents;
+
+	struct axfr_cache *cache = rcu_dereference(contents->axfr_cache);
+	if (AXFR_CACHE_VALID(cache)) {
+		/* Usable only with the same message layout and enough space. */
+		if (cache->answer_pos == pkt->size &&
+		    cache->answer_pos + cache->max_msg_size + pkt->reserved <= pkt->max_size) {
+			axfr->cache = cache;
+		}
+		return;
+	} else if (cache != NULL) {
+		return;
+	}
+
+	conf_val_t val = conf_zone_get(conf(), C_AXFR_CACHE_MAX_SIZE, qdata->extra->zone->name);
+	size_t limit = conf_int(&val);
+	if (limit == 0) {
+		return;
+	}
+
+	cache = calloc(1, sizeof(*cache));
+	if (cache == NULL) {
+		return;
+	}
+	cache->limit = limit;
+	cache->answer_pos = pkt->size;
+
+	if (rcu_cmpxchg_pointer(&contents->axfr_cache, NULL, AXFR_CACHE_BUILDING) != NULL) {
+		free(cache); /* Another transfer is faster. */
+		return;
+	}
+	axfr->build = cache;
+}
+
+/*! \brief Store the finished message to the cache being built. */
+static void axfr_cache_store(knot_pkt_t *pkt, knotd_qdata_t *qdata,
+                             struct axfr_proc *axfr, bool last)
+{
+	zone_contents_t *contents = (zone_contents_t *)qdata->extra->contents;
+
+	int ret = axfr_cache_add(axfr->build, pkt);
+	if (ret != KNOT_EOK) {
+		/* Don't retry with this contents version. */
+		axfr_cache_free(axfr->build);
+		axfr->build = NULL;
+		rcu_set_pointer(&contents->axfr_cache, AXFR_CACHE_FAILED);
+	} else if (last) {
+		rcu_set_pointer(&contents->axfr_cache, axfr->build);
+		axfr->build = NULL;
+	}
+}
+
+/*! \brief Put the next cached message to the packet. */
+static int axfr_cache_put(knot_pkt_t *pkt, knotd_qdata_t *qdata, struct axfr_proc *axfr)
+{
+	const struct axfr_cache *cache = axfr->cache;
+	const axfr_cache_msg_t *msg = &cache->msgs[axfr->cache_msg];
+	if (pkt->size != cache->answer_pos ||
+	    pkt->size + msg->size + pkt->reserved > pkt->max_size) {
+		return KNOT_ESPACE;
+	}
+
+	memcpy(pkt->wire + pkt->size, cache->data + msg->offset, msg->size);
+	pkt->size += msg->size;
+	knot_wire_set_ancount(pkt->wire, msg->ancount);
+	xfr_stats_add(&axfr->proc.stats, pkt->size + knot_rrset_size(&qdata->opt_rr));
+
+	return (++axfr->cache_msg < cache->msg_count) ? KNOT_ESPACE : KNOT_EOK;
+}
+
 static int axfr_put_rrsets(knot_pkt_t *pkt, zone_node_t *node,
                            struct axfr_proc *state)
 {
@@ -101,10 +265,16 @@ static void axfr_query_cleanup(knotd_qdata_t *qdata)
 
 	zone_tree_it_free(&axfr->it);
 	ptrlist_free(&axfr->proc.nodes, qdata->mm);
+	if (axfr->build != NULL) { /* Interrupted, let another transfer build it. */
+		axfr_cache_free(axfr->build);
+		rcu_read_lock();
+		if (xfr_contents_current(qdata)) {
+			zone_contents_t *contents = (zone_contents_t *)qdata->extra->contents;
+			rcu_set_pointer(&contents->axfr_cache, NULL);
+		}
+		rcu_read_unlock();
+	}
 	mm_free(qdata->mm, axfr);
-
-	/* Allow zone changes (finished). */
-	rcu_read_unlock();
 }
 
 static int axfr_query_check(knotd_qdata_t *qdata)
@@ -143,6 +313,7 @@ static int axfr_query_init(knotd_qdata_t *qdata)
 	const zone_contents_t *contents = qdata->extra->contents;
 	/* Must be non-NULL for the first message. */
 	assert(contents);
+	axfr->proc.contents_id = contents->id;
 	ptrlist_add(&axfr->proc.nodes, contents->nodes, mm);
 	/* Put NSEC3 data if exists. */
 	if (!zone_tree_is_empty(contents->nsec3_nodes)) {
@@ -153,9 +324,6 @@ static int axfr_query_init(knotd_qdata_t *qdata)
 	qdata->extra->ext = axfr;
 	qdata->extra->ext_cleanup = &axfr_query_cleanup;
 
-	/* No zone changes during multipacket answer (unlocked in axfr_answer_cleanup) */
-	rcu_read_lock();
-
 	return KNOT_EOK;
 }
 
@@ -194,6 +362,15 @@ int axfr_process_query(knot_pkt_t *pkt, knotd_qdata_t *qdata)
 	} else if (qdata->params->xdp_msg != NULL) {
 		qdata->rcode = KNOT_RCODE_SERVFAIL;
 		return KNOT_STATE_FAIL;
+	} else if (!xfr_contents_current(qdata)) {
+		/* Not locked between messages, the contents are gone. */
+		AXFROUT_LOG(LOG_NOTICE, qdata, "zone changed, transfer interrupted");
+		axfr_cache_free(axfr->build);
+		axfr->build = NULL;
+		axfr->cache = NULL;
+		qdata->extra->contents = NULL;
+		qdata->rcode = KNOT_RCODE_SERVFAIL;
+		return KNOT_STATE_FAIL;
 	}
 
 	/* Reserve space for TSIG. */
@@ -202,8 +379,23 @@ int axfr_process_query(knot_pkt_t *pkt, knotd_qdata_t *qdata)
 		return KNOT_STATE_FAIL;
 	}
 
+	/* Use or build the cache of encoded messages. */
+	if (axfr->proc.stats.messages == 0) {
+		axfr_cache_begin(pkt, qdata, axfr);
+	}
+
 	/* Answer current packet (or continue). */
-	ret = xfr_process_list(pkt, &axfr_process_node_tree, qdata);
+	if (axfr->cache != NULL) {
+		ret = axfr_cache_put(pkt, qdata, axfr);
+		if (ret == KNOT_ESPACE && axfr->cache_msg == 0) {
+			ret = KNOT_ENOXFR;
+		}
+	} else {
+		ret = xfr_process_list(pkt, &axfr_process_node_tree, qdata);
+		if (axfr->build != NULL && (ret == KNOT_ESPACE || ret == KNOT_EOK)) {
+			axfr_cache_store(pkt, qdata, axfr, ret == KNOT_EOK);
+		}
+	}
 	switch (ret) {
 	case KNOT_ESPACE: /* Couldn't write more, send packet and continue. */
 		return KNOT_STATE_PRODUCE; /* Check for more. */
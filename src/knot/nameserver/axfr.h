@@ -1,4 +1,4 @@
-/*  Copyright (C) 2017 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+/*  Copyright (C) 2021 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
 
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU General Public License as published by
@@ -19,6 +19,13 @@
 #include "knot/nameserver/process_query.h"
 #include "libknot/packet/pkt.h"
 
+struct axfr_cache;
+
+/*!
+ * \brief Free the cache of encoded AXFR messages of a zone contents version.
+ */
+void axfr_cache_free(struct axfr_cache *cache);
+
 /*!
  * \brief Process an AXFR query message.
  *
@@ -34,13 +34,47 @@
 	ns_log(priority, ZONE_NAME(qdata), LOG_OPERATION_IXFR, \
 	       LOG_DIRECTION_OUT, REMOTE(qdata), fmt)
 
-/*! \brief Helper macro for putting RRs into packet. */
-#define IXFR_SAFE_PUT(pkt, rr) \
-	int ret = knot_pkt_put((pkt), 0, (rr), KNOT_PF_NOTRUNC | KNOT_PF_ORIGTTL); \
-	if (ret != KNOT_EOK) { \
-		return ret; \
+/*!
+ * \brief Prepares the rdata of the journal RR in the rdata buffer.
+ *
+ * The buffer is reset with each message, so that the rdata stays valid
+ * as long as the message RRs are referenced.
+ */
+static knot_rdata_t *ixfr_rdata(struct ixfr_proc *ixfr, const journal_rr_t *rr)
+{
+	if (ixfr->rdata_used + knot_rdata_size(rr->len) > IXFR_RDATA_BUF_SIZE) {
+		return NULL;
 	}
 
+	knot_rdata_t *rdata = (knot_rdata_t *)(ixfr->rdata_buf + ixfr->rdata_used);
+	knot_rdata_init(rdata, rr->len, rr->data);
+
+	return rdata;
+}
+
+/*! \brief Puts the journal RR into packet, only the owner is compressed. */
+static int ixfr_put_rr(knot_pkt_t *pkt, struct ixfr_proc *ixfr,
+                       const journal_rr_t *rr, knot_rdata_t *rdata)
+{
+	knot_rrset_t rrset;
+	knot_rrset_init(&rrset, (knot_dname_t *)rr->owner, rr->type, rr->rclass, rr->ttl);
+	rrset.rrs.count = 1;
+	rrset.rrs.size = knot_rdata_size(rr->len);
+	rrset.rrs.rdata = rdata;
+
+	int ret = knot_pkt_put(pkt, 0, &rrset, KNOT_PF_NOTRUNC | KNOT_PF_ORIGTTL);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+	ixfr->rdata_used += rrset.rrs.size;
+
+	if (rr->type == KNOT_RRTYPE_SOA) {
+		ixfr->in_remove_section = !ixfr->in_remove_section;
+	}
+
+	return KNOT_EOK;
+}
+
 /*! \brief Puts current RR into packet, stores state for retries. */
 static int ixfr_put_chg_part(knot_pkt_t *pkt, struct ixfr_proc *ixfr,
                              journal_read_t *read)
@@ -49,18 +83,21 @@ static int ixfr_put_chg_part(knot_pkt_t *pkt, struct ixfr_proc *ixfr,
 	assert(ixfr);
 	assert(read);
 
-	if (!knot_rrset_empty(&ixfr->cur_rr)) {
-		IXFR_SAFE_PUT(pkt, &ixfr->cur_rr);
-		if (ixfr->cur_rr.type == KNOT_RRTYPE_SOA) {
-			ixfr->in_remove_section = !ixfr->in_remove_section;
-		}
-		journal_read_clear_rrset(&ixfr->cur_rr);
+	/* The RRs are written directly from the journal data, which stay valid
+	 * until the end of reading, so the pending RR can be simply retried. */
+	if (ixfr->cur_rr.owner == NULL && !journal_read_rr(read, &ixfr->cur_rr, true)) {
+		return journal_read_get_error(read, KNOT_EOK);
 	}
 
-	while (journal_read_rrset(read, &ixfr->cur_rr, true)) {
+	do {
+		knot_rdata_t *rdata = ixfr_rdata(ixfr, &ixfr->cur_rr);
+		if (rdata == NULL) {
+			return KNOT_ESPACE;
+		}
+
 		if (ixfr->cur_rr.type == KNOT_RRTYPE_SOA &&
 		    !ixfr->in_remove_section &&
-		    knot_soa_serial(ixfr->cur_rr.rrs.rdata) == ixfr->soa_to) {
+		    knot_soa_serial(rdata) == ixfr->soa_to) {
 			break;
 		}
 
@@ -70,12 +107,13 @@ static int ixfr_put_chg_part(knot_pkt_t *pkt, struct ixfr_proc *ixfr,
 			return KNOT_ESPACE;
 		}
 
-		IXFR_SAFE_PUT(pkt, &ixfr->cur_rr);
-		if (ixfr->cur_rr.type == KNOT_RRTYPE_SOA) {
-			ixfr->in_remove_section = !ixfr->in_remove_section;
+		int ret = ixfr_put_rr(pkt, ixfr, &ixfr->cur_rr, rdata);
+		if (ret != KNOT_EOK) {
+			return ret;
 		}
-		journal_read_clear_rrset(&ixfr->cur_rr);
-	}
+	} while (journal_read_rr(read, &ixfr->cur_rr, true));
+
+	memset(&ixfr->cur_rr, 0, sizeof(ixfr->cur_rr));
 
 	return journal_read_get_error(read, KNOT_EOK);
 }
@@ -99,8 +137,6 @@ static int ixfr_process_journal(knot_pkt_t *pkt, const void *item,
 	return ret;
 }
 
-#undef IXFR_SAFE_PUT
-
 static int ixfr_load_chsets(journal_read_t **journal_read, zone_t *zone,
                             const zone_contents_t *contents, const knot_rrset_t *their_soa)
 {
@@ -152,13 +188,10 @@ static void ixfr_answer_cleanup(knotd_qdata_t *qdata)
 	struct ixfr_proc *ixfr = (struct ixfr_proc *)qdata->extra->ext;
 	knot_mm_t *mm = qdata->mm;
 
-	knot_rrset_clear(&ixfr->cur_rr, NULL);
 	ptrlist_free(&ixfr->proc.nodes, mm);
+	mm_free(mm, ixfr->rdata_buf);
 	journal_read_end(ixfr->journal_ctx);
 	mm_free(mm, qdata->extra->ext);
-
-	/* Allow zone changes (finished). */
-	rcu_read_unlock();
 }
 
 static int ixfr_answer_init(knotd_qdata_t *qdata, uint32_t *serial_from)
@@ -184,9 +217,16 @@ static int ixfr_answer_init(knotd_qdata_t *qdata, uint32_t *serial_from)
 	}
 	memset(xfer, 0, sizeof(*xfer));
 
+	xfer->rdata_buf = mm_alloc(mm, IXFR_RDATA_BUF_SIZE);
+	if (xfer->rdata_buf == NULL) {
+		mm_free(mm, xfer);
+		return KNOT_ENOMEM;
+	}
+
 	int ret = ixfr_load_chsets(&xfer->journal_ctx, (zone_t *)qdata->extra->zone,
 	                           qdata->extra->contents, their_soa);
 	if (ret != KNOT_EOK) {
+		mm_free(mm, xfer->rdata_buf);
 		mm_free(mm, xfer);
 		return ret;
 	}
@@ -194,20 +234,17 @@ static int ixfr_answer_init(knotd_qdata_t *qdata, uint32_t *serial_from)
 	xfr_stats_begin(&xfer->proc.stats);
 	xfer->state = IXFR_SOA_DEL;
 	init_list(&xfer->proc.nodes);
-	knot_rrset_init_empty(&xfer->cur_rr);
 	xfer->qdata = qdata;
 
 	ptrlist_add(&xfer->proc.nodes, xfer->journal_ctx, mm);
 
 	xfer->soa_from = knot_soa_serial(their_soa->rrs.rdata);
 	xfer->soa_to = zone_contents_serial(qdata->extra->contents);
+	xfer->proc.contents_id = qdata->extra->contents->id;
 
 	qdata->extra->ext = xfer;
 	qdata->extra->ext_cleanup = &ixfr_answer_cleanup;
 
-	/* No zone changes during multipacket answer (unlocked in ixfr_answer_cleanup) */
-	rcu_read_lock();
-
 	return KNOT_EOK;
 }
 
@@ -286,6 +323,12 @@ int ixfr_process_query(knot_pkt_t *pkt, knotd_qdata_t *qdata)
 	} else if (qdata->params->xdp_msg != NULL) {
 		qdata->rcode = KNOT_RCODE_SERVFAIL;
 		return KNOT_STATE_FAIL;
+	} else if (!xfr_contents_current(qdata)) {
+		/* Not locked between messages, the contents are gone. */
+		IXFROUT_LOG(LOG_NOTICE, qdata, "zone changed, transfer interrupted");
+		qdata->extra->contents = NULL;
+		qdata->rcode = KNOT_RCODE_SERVFAIL;
+		return KNOT_STATE_FAIL;
 	}
 
 	/* Reserve space for TSIG. */
@@ -294,6 +337,9 @@ int ixfr_process_query(knot_pkt_t *pkt, knotd_qdata_t *qdata)
 		return KNOT_STATE_FAIL;
 	}
 
+	/* The previous message has been sent, its rdata can be overwritten. */
+	ixfr->rdata_used = 0;
+
 	/* Answer current packet (or continue). */
 	ret = xfr_process_list(pkt, &ixfr_process_journal, qdata);
 	switch (ret) {
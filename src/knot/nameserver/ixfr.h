@@ -21,6 +21,9 @@
 #include "knot/nameserver/xfr.h"
 #include "libknot/packet/pkt.h"
 
+/*! \brief Size of the buffer for rdata of one IXFR-out message. */
+#define IXFR_RDATA_BUF_SIZE KNOT_WIRE_MAX_PKTSIZE
+
 /*! \brief IXFR-in processing states. */
 enum ixfr_state {
 	IXFR_INVALID = 0,
@@ -42,8 +45,12 @@ struct ixfr_proc {
 	/* Changes to be sent. */
 	journal_read_t *journal_ctx;
 
-	/* Currently processed RRSet. */
-	knot_rrset_t cur_rr;
+	/* Currently processed RR, pointing to the journal data. */
+	journal_rr_t cur_rr;
+
+	/* Rdata of the RRs in the current message. */
+	uint8_t *rdata_buf;
+	size_t rdata_used;
 
 	/* Processing context. */
 	knotd_qdata_t *qdata;
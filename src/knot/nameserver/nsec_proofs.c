@@ -15,11 +15,14 @@
  */
 
 #include <assert.h>
+#include <urcu.h>
 
+#include "libdnssec/error.h"
 #include "libknot/libknot.h"
 #include "knot/nameserver/nsec_proofs.h"
 #include "knot/nameserver/internet.h"
 #include "knot/dnssec/zone-nsec.h"
+#include "contrib/base32hex.h"
 
 /*!
  * \brief Check if node is empty non-terminal.
@@ -202,6 +205,310 @@ static int put_covering_nsec(const zone_contents_t *zone,
 	return put_nsec_from_node(proof, qdata, resp);
 }
 
+/*! \brief Maximal NSEC3 hash length usable with the proof cache. */
+#define NSEC3_CACHE_HASH_MAX 32
+
+/*! \brief Limits of the number of proof cache slots of each kind. */
+#define NSEC3_CACHE_MIN_BITS 4
+#define NSEC3_CACHE_MAX_BITS 12
+
+/*! \brief Placeholder of the contents cache pointer if the cache is unusable. */
+#define NSEC3_CACHE_FAILED ((struct nsec3_cache *)1)
+
+enum {
+	SLOT_EMPTY = 0,
+	SLOT_BUSY,
+	SLOT_READY,
+};
+
+/*! \brief NSEC3 covering the wildcard at a closest provable encloser. */
+typedef struct {
+	int state;
+	const zone_node_t *encloser;      /*!< Closest provable encloser (key). */
+	const zone_node_t *wildcard_prev; /*!< NSEC3 covering the wildcard. */
+} nsec3_cache_encloser_t;
+
+/*! \brief NSEC3 covering an interval of hashes in the NSEC3 chain. */
+typedef struct {
+	int state;
+	const zone_node_t *cover;         /*!< Covering NSEC3 node. */
+	uint8_t from[NSEC3_CACHE_HASH_MAX]; /*!< Hash of the covering node. */
+	uint8_t to[NSEC3_CACHE_HASH_MAX];   /*!< Hash of the next NSEC3 node. */
+} nsec3_cache_cover_t;
+
+/*!
+ * \brief Lookup cache of NSEC3 proof components of one zone contents version.
+ *
+ * Denial of random names below one parent (e.g. a random subdomain attack)
+ * repeatedly needs the NSEC3 covering the wildcard at the same encloser, and
+ * for each next closer name an NSEC3 from a limited set of chain intervals.
+ * Both are cached in fixed size tables of fill-once slots, so concurrent
+ * lookups need no locking. The cache is bound to the contents and thus
+ * dropped with the contents replaced by an update.
+ */
+struct nsec3_cache {
+	size_t hash_len;                   /*!< NSEC3 hash length. */
+	unsigned shift;                    /*!< 32 - log2(number of slots). */
+	nsec3_cache_encloser_t *enclosers; /*!< Slots indexed by encloser. */
+	nsec3_cache_cover_t *covers;       /*!< Slots indexed by hash prefix. */
+};
+
+void nsec3_cache_free(struct nsec3_cache *cache)
+{
+	if (cache != NSEC3_CACHE_FAILED) {
+		free(cache);
+	}
+}
+
+static struct nsec3_cache *nsec3_cache_new(const zone_contents_t *zone)
+{
+	size_t hash_len = zone_nsec3_hash_len(zone);
+	if (hash_len < sizeof(uint32_t) || hash_len > NSEC3_CACHE_HASH_MAX) {
+		return NULL;
+	}
+
+	// Roughly two slots per NSEC3 record.
+	unsigned bits = NSEC3_CACHE_MIN_BITS;
+	size_t nodes = zone_tree_count(zone->nsec3_nodes);
+	while (bits < NSEC3_CACHE_MAX_BITS && (1UL << bits) < 2 * nodes) {
+		bits++;
+	}
+	size_t slots = 1UL << bits;
+
+	struct nsec3_cache *cache = calloc(1, sizeof(*cache) +
+	                                   slots * sizeof(nsec3_cache_encloser_t) +
+	                                   slots * sizeof(nsec3_cache_cover_t));
+	if (cache == NULL) {
+		return NULL;
+	}
+	cache->hash_len = hash_len;
+	cache->shift = 32 - bits;
+	cache->enclosers = (nsec3_cache_encloser_t *)(cache + 1);
+	cache->covers = (nsec3_cache_cover_t *)(cache->enclosers + slots);
+
+	return cache;
+}
+
+/*!
+ * \brief Get the proof cache of the contents, create it if missing.
+ *
+ * \return Proof cache, NULL if not usable for the contents.
+ */
+static struct nsec3_cache *nsec3_cache_get(const zone_contents_t *zone)
+{
+	struct nsec3_cache *cache = rcu_dereference(zone->nsec3_cache);
+	if (cache != NULL) {
+		return (cache != NSEC3_CACHE_FAILED) ? cache : NULL;
+	}
+
+	if (zone_tree_is_empty(zone->nsec3_nodes) || !knot_is_nsec3_enabled(zone)) {
+		return NULL;
+	}
+
+	cache = nsec3_cache_new(zone);
+	struct nsec3_cache *new = (cache != NULL) ? cache : NSEC3_CACHE_FAILED;
+	struct nsec3_cache *old = rcu_cmpxchg_pointer(&((zone_contents_t *)zone)->nsec3_cache,
+	                                              NULL, new);
+	if (old != NULL) {
+		nsec3_cache_free(cache); // Another query is faster.
+		return (old != NSEC3_CACHE_FAILED) ? old : NULL;
+	}
+
+	return cache;
+}
+
+/*! \brief Try to claim an empty slot for filling. */
+static bool slot_claim(int *state)
+{
+	int empty = SLOT_EMPTY;
+	return __atomic_load_n(state, __ATOMIC_RELAXED) == SLOT_EMPTY &&
+	       __atomic_compare_exchange_n(state, &empty, SLOT_BUSY, false,
+	                                   __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+static void slot_publish(int *state)
+{
+	__atomic_store_n(state, SLOT_READY, __ATOMIC_RELEASE);
+}
+
+static bool slot_ready(int *state)
+{
+	return __atomic_load_n(state, __ATOMIC_ACQUIRE) == SLOT_READY;
+}
+
+static nsec3_cache_encloser_t *encloser_slot(const struct nsec3_cache *cache,
+                                             const zone_node_t *encloser)
+{
+	uint32_t key = ((uintptr_t)encloser >> 4) * 2654435761U;
+	return &cache->enclosers[key >> cache->shift];
+}
+
+static nsec3_cache_cover_t *cover_slot(const struct nsec3_cache *cache,
+                                       const uint8_t *hash)
+{
+	// Neighboring slots belong to neighboring hash intervals.
+	return &cache->covers[knot_wire_read_u32(hash) >> cache->shift];
+}
+
+/*!
+ * \brief Check if hash lies strictly between two hashes in the NSEC3 chain.
+ *
+ * The interval wraps around the chain end if \a from isn't less than \a to.
+ */
+static bool hash_covered(const uint8_t *hash, const uint8_t *from,
+                         const uint8_t *to, size_t len)
+{
+	bool after_from = memcmp(from, hash, len) < 0;
+	bool before_to = memcmp(hash, to, len) < 0;
+	if (memcmp(from, to, len) < 0) {
+		return after_from && before_to;
+	} else {
+		return after_from || before_to;
+	}
+}
+
+static const zone_node_t *cover_get(const struct nsec3_cache *cache,
+                                    const uint8_t *hash)
+{
+	nsec3_cache_cover_t *slot = cover_slot(cache, hash);
+	if (slot_ready(&slot->state) &&
+	    hash_covered(hash, slot->from, slot->to, cache->hash_len)) {
+		return slot->cover;
+	}
+
+	return NULL;
+}
+
+/*!
+ * \brief Store the chain interval of an NSEC3 covering given hash.
+ *
+ * The interval is taken from the hashed owner and next hashed owner of the
+ * covering NSEC3. It's stored only if the next NSEC3 directly follows the
+ * covering one in the zone, so any hash in between has the same proof.
+ */
+static void cover_put(struct nsec3_cache *cache, const zone_contents_t *zone,
+                      const uint8_t *hash, const zone_node_t *cover)
+{
+	nsec3_cache_cover_t *slot = cover_slot(cache, hash);
+	if (__atomic_load_n(&slot->state, __ATOMIC_RELAXED) != SLOT_EMPTY) {
+		return;
+	}
+
+	uint8_t from[KNOT_DNAME_MAXLABELLEN];
+	int32_t from_len = knot_base32hex_decode(cover->owner + 1, cover->owner[0],
+	                                         from, sizeof(from));
+	const knot_rdataset_t *nsec3 = node_rdataset(cover, KNOT_RRTYPE_NSEC3);
+	if (from_len != (int32_t)cache->hash_len || nsec3 == NULL || nsec3->count == 0 ||
+	    knot_nsec3_next_len(nsec3->rdata) != cache->hash_len) {
+		return;
+	}
+	const uint8_t *to = knot_nsec3_next(nsec3->rdata);
+
+	knot_dname_storage_t next_owner;
+	if (knot_nsec3_hash_to_dname(next_owner, sizeof(next_owner), to,
+	                             cache->hash_len, zone->apex->owner) != KNOT_EOK) {
+		return;
+	}
+	const zone_node_t *next = zone_contents_find_nsec3_node(zone, next_owner);
+	if (next == NULL || node_prev(next) != cover ||
+	    !hash_covered(hash, from, to, cache->hash_len)) {
+		return;
+	}
+
+	if (slot_claim(&slot->state)) {
+		slot->cover = cover;
+		memcpy(slot->from, from, cache->hash_len);
+		memcpy(slot->to, to, cache->hash_len);
+		slot_publish(&slot->state);
+	}
+}
+
+/*!
+ * \brief Find NSEC3 for given name, using the proof cache if possible.
+ *
+ * \see zone_contents_find_nsec3_for_name()
+ */
+static int find_nsec3_for_name(const zone_contents_t *zone,
+                               const knot_dname_t *name,
+                               const zone_node_t **nsec3_node,
+                               const zone_node_t **nsec3_previous)
+{
+	struct nsec3_cache *cache = nsec3_cache_get(zone);
+	if (cache == NULL) {
+		return zone_contents_find_nsec3_for_name(zone, name, nsec3_node,
+		                                         nsec3_previous);
+	}
+
+	dnssec_binary_t data = {
+		.data = (uint8_t *)name,
+		.size = knot_dname_size(name)
+	};
+	uint8_t hash[NSEC3_CACHE_HASH_MAX];
+	int ret = dnssec_nsec3_hash_raw(&data, &zone->nsec3_params, hash, sizeof(hash));
+	if (ret != DNSSEC_EOK) {
+		return knot_error_from_libdnssec(ret);
+	}
+
+	const zone_node_t *cover = cover_get(cache, hash);
+	if (cover != NULL) {
+		*nsec3_node = NULL;
+		*nsec3_previous = cover;
+		return ZONE_NAME_NOT_FOUND;
+	}
+
+	knot_dname_storage_t nsec3_name;
+	ret = knot_nsec3_hash_to_dname(nsec3_name, sizeof(nsec3_name), hash,
+	                               cache->hash_len, zone->apex->owner);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	ret = zone_contents_find_nsec3(zone, nsec3_name, nsec3_node, nsec3_previous);
+	if (ret == ZONE_NAME_NOT_FOUND && *nsec3_previous != NULL) {
+		cover_put(cache, zone, hash, *nsec3_previous);
+	}
+
+	return ret;
+}
+
+/*!
+ * \brief Find NSEC3 covering the wildcard at the closest provable encloser.
+ *
+ * \return KNOT_E*
+ */
+static int find_nsec3_wildcard_prev(const zone_contents_t *zone,
+                                    const zone_node_t *cpe,
+                                    const zone_node_t **wildcard_prev)
+{
+	if (cpe->nsec3_wildcard_name == NULL) {
+		return KNOT_ERROR;
+	}
+
+	struct nsec3_cache *cache = nsec3_cache_get(zone);
+	nsec3_cache_encloser_t *slot = NULL;
+	if (cache != NULL) {
+		slot = encloser_slot(cache, cpe);
+		if (slot_ready(&slot->state) && slot->encloser == cpe) {
+			*wildcard_prev = slot->wildcard_prev;
+			return KNOT_EOK;
+		}
+	}
+
+	const zone_node_t *ignored;
+	if (zone_contents_find_nsec3(zone, cpe->nsec3_wildcard_name, &ignored,
+	                             wildcard_prev) == ZONE_NAME_FOUND) {
+		return KNOT_ERROR;
+	}
+
+	if (slot != NULL && *wildcard_prev != NULL && slot_claim(&slot->state)) {
+		slot->encloser = cpe;
+		slot->wildcard_prev = *wildcard_prev;
+		slot_publish(&slot->state);
+	}
+
+	return KNOT_EOK;
+}
+
 /*!
  * \brief Find NSEC3 covering the given name and put it into the response.
  */
@@ -213,7 +520,7 @@ static int put_covering_nsec3(const zone_contents_t *zone,
 	const zone_node_t *prev = NULL;
 	const zone_node_t *node = NULL;
 
-	int match = zone_contents_find_nsec3_for_name(zone, name, &node, &prev);
+	int match = find_nsec3_for_name(zone, name, &node, &prev);
 	if (match < 0) {
 		// ignore if missing
 		return KNOT_EOK;
@@ -439,10 +746,10 @@ static int put_nsec3_nxdomain(const knot_dname_t *qname,
 
 	// NSEC3 covering the (nonexistent) wildcard at the closest encloser.
 
-	const zone_node_t *nsec3_wildcard_prev, *ignored;
-	if (cpe->nsec3_wildcard_name == NULL ||
-	    zone_contents_find_nsec3(zone, cpe->nsec3_wildcard_name, &ignored, &nsec3_wildcard_prev) == ZONE_NAME_FOUND) {
-		return KNOT_ERROR;
+	const zone_node_t *nsec3_wildcard_prev = NULL;
+	ret = find_nsec3_wildcard_prev(zone, cpe, &nsec3_wildcard_prev);
+	if (ret != KNOT_EOK) {
+		return ret;
 	}
 
 	return put_nsec3_from_node(nsec3_wildcard_prev, qdata, resp);
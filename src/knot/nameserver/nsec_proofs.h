@@ -1,4 +1,4 @@
-/*  Copyright (C) 2017 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+/*  Copyright (C) 2021 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
 
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU General Public License as published by
@@ -19,6 +19,11 @@
 #include "libknot/packet/pkt.h"
 #include "knot/nameserver/process_query.h"
 
+struct nsec3_cache;
+
+/*! \brief Free the NSEC3 proof cache of a zone contents version. */
+void nsec3_cache_free(struct nsec3_cache *cache);
+
 /*! \brief Prove wildcards visited during answer resolution. */
 int nsec_prove_wildcards(knot_pkt_t *pkt, knotd_qdata_t *qdata);
 
@@ -28,6 +28,7 @@
 #include "knot/nameserver/update.h"
 #include "knot/nameserver/nsec_proofs.h"
 #include "knot/nameserver/notify.h"
+#include "knot/nameserver/resp_cache.h"
 #include "knot/server/server.h"
 #include "libknot/libknot.h"
 #include "contrib/macros.h"
@@ -572,6 +573,19 @@ static int process_query_out(knot_layer_t *ctx, knot_pkt_t *pkt)
 	PROCESS_BEGIN(plan, step, next_state, qdata);
 	PROCESS_BEGIN(zone_plan, step, next_state, qdata);
 
+	/* Responses possibly modified by query modules aren't cached. */
+	resp_cache_key_t cache_key;
+	bool cacheable = (next_state == KNOT_STATE_PRODUCE &&
+	                  (plan == NULL || !plan->resp_cache_bypass) &&
+	                  (zone_plan == NULL || !zone_plan->resp_cache_bypass) &&
+	                  resp_cache_key(&cache_key, pkt, qdata));
+
+	/* Try the response cache first. */
+	if (cacheable && resp_cache_answer(pkt, qdata, &cache_key) == KNOT_EOK) {
+		next_state = KNOT_STATE_DONE;
+		cacheable = false;
+	}
+
 	/* Answer based on qclass. */
 	if (next_state == KNOT_STATE_PRODUCE) {
 		switch (knot_pkt_qclass(pkt)) {
@@ -591,6 +605,11 @@ static int process_query_out(knot_layer_t *ctx, knot_pkt_t *pkt)
 
 	/* Postprocessing. */
 	if (next_state == KNOT_STATE_DONE || next_state == KNOT_STATE_PRODUCE) {
+		/* Store the complete answer without OPT. */
+		if (cacheable && next_state == KNOT_STATE_DONE) {
+			resp_cache_store(pkt, qdata, &cache_key);
+		}
+
 		/* Restore original QNAME. */
 		process_query_qname_case_restore(pkt, qdata);
 
@@ -14,7 +14,10 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#define __APPLE_USE_RFC_3542
+
 #include <assert.h>
+#include <netinet/in.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -58,6 +61,7 @@ struct query_plan *query_plan_create(void)
 	for (unsigned i = 0; i < KNOTD_STAGES; ++i) {
 		init_list(&plan->stage[i]);
 	}
+	plan->resp_cache_bypass = false;
 
 	return plan;
 }
@@ -111,6 +115,10 @@ int knotd_mod_hook(knotd_mod_t *mod, knotd_stage_t stage, knotd_mod_hook_f hook)
 		return KNOT_EINVAL;
 	}
 
+	if (!(mod->api->flags & KNOTD_MOD_FLAG_CACHEABLE)) {
+		mod->plan->resp_cache_bypass = true;
+	}
+
 	return query_plan_step(mod->plan, stage, hook, mod);
 }
 
@@ -121,6 +129,10 @@ int knotd_mod_in_hook(knotd_mod_t *mod, knotd_stage_t stage, knotd_mod_in_hook_f
 		return KNOT_EINVAL;
 	}
 
+	if (!(mod->api->flags & KNOTD_MOD_FLAG_CACHEABLE)) {
+		mod->plan->resp_cache_bypass = true;
+	}
+
 	return query_plan_step(mod->plan, stage, hook, mod);
 }
 
@@ -617,6 +629,29 @@ void knotd_conf_free(knotd_conf_t *conf)
 	memset(conf, 0, sizeof(*conf));
 }
 
+/*! \brief Replace the wildcard address with the packet destination address. */
+static void pktinfo_dst_addr(const struct cmsghdr *cmsg, struct sockaddr_storage *addr)
+{
+	if (addr->ss_family == AF_INET6 && cmsg->cmsg_level == IPPROTO_IPV6 &&
+	    cmsg->cmsg_type == IPV6_PKTINFO) {
+		const struct in6_pktinfo *info = (const struct in6_pktinfo *)CMSG_DATA(cmsg);
+		((struct sockaddr_in6 *)addr)->sin6_addr = info->ipi6_addr;
+	}
+#if defined(IP_PKTINFO)
+	if (addr->ss_family == AF_INET && cmsg->cmsg_level == IPPROTO_IP &&
+	    cmsg->cmsg_type == IP_PKTINFO) {
+		const struct in_pktinfo *info = (const struct in_pktinfo *)CMSG_DATA(cmsg);
+		((struct sockaddr_in *)addr)->sin_addr = info->ipi_addr;
+	}
+#elif defined(IP_RECVDSTADDR)
+	if (addr->ss_family == AF_INET && cmsg->cmsg_level == IPPROTO_IP &&
+	    cmsg->cmsg_type == IP_RECVDSTADDR) {
+		const struct in_addr *dst = (const struct in_addr *)CMSG_DATA(cmsg);
+		((struct sockaddr_in *)addr)->sin_addr = *dst;
+	}
+#endif
+}
+
 _public_
 const struct sockaddr_storage *knotd_qdata_local_addr(knotd_qdata_t *qdata,
                                                       struct sockaddr_storage *buff)
@@ -638,6 +673,10 @@ const struct sockaddr_storage *knotd_qdata_local_addr(knotd_qdata_t *qdata,
 		                &buff_len) != 0) {
 			return NULL;
 		}
+		/* A wildcard-bound socket, get the address from the packet info. */
+		if (qdata->params->pktinfo != NULL && sockaddr_is_any(buff)) {
+			pktinfo_dst_addr(qdata->params->pktinfo, buff);
+		}
 		return buff;
 	}
 }
@@ -48,6 +48,7 @@ struct query_step {
  */
 struct query_plan {
 	list_t stage[KNOTD_STAGES];
+	bool resp_cache_bypass; /*!< Some step doesn't allow response caching. */
 };
 
 /*! \brief Create an empty query plan. */
@@ -0,0 +1,325 @@
+/*  Copyright (C) 2021 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <urcu.h>
+
+#include "knot/nameserver/resp_cache.h"
+#include "knot/conf/conf.h"
+#include "contrib/macros.h"
+#include "contrib/mempattern.h"
+#include "contrib/openbsd/siphash.h"
+#include "libdnssec/error.h"
+#include "libdnssec/random.h"
+
+#define RESP_CACHE_LOCKS 32
+#define RESP_CACHE_ITEM_SIZE 512 /* Expected item size for slots count. */
+#define RESP_CACHE_MIN_SLOTS 16
+
+/*! \brief Placeholder of the contents cache pointer if the cache failed. */
+#define RESP_CACHE_FAILED ((struct resp_cache *)1)
+
+#define ATOMIC_ADD(dst, val) __atomic_add_fetch(&(dst), (val), __ATOMIC_RELAXED)
+#define ATOMIC_SUB(dst, val) __atomic_sub_fetch(&(dst), (val), __ATOMIC_RELAXED)
+#define ATOMIC_GET(src)      __atomic_load_n(&(src), __ATOMIC_RELAXED)
+
+enum {
+	KEY_DO   = 1 << 0,
+	KEY_EDNS = 1 << 1,
+	KEY_TCP  = 1 << 2,
+};
+
+typedef struct {
+	uint64_t hash;      /*!< Key hash. */
+	uint8_t *data;      /*!< QNAME followed by the response body (NULL if empty). */
+	uint16_t qname_size;
+	uint16_t qtype;
+	uint16_t space;
+	uint8_t flags;
+	bool aa;            /*!< AA flag of the response. */
+	uint16_t body_size; /*!< Size of the sections following the question. */
+	uint16_t ancount;
+	uint16_t nscount;
+	uint16_t arcount;   /*!< Additional records excluding OPT. */
+	int rcode;          /*!< Response (extended) RCODE. */
+	int rcode_ede;      /*!< Extended DNS error. */
+	const zone_node_t *wildcard;      /*!< First expanded wildcard node. */
+	const zone_node_t *wildcard_prev; /*!< Previous node of the wildcard hit. */
+} resp_cache_item_t;
+
+struct resp_cache {
+	SIPHASH_KEY key;
+	size_t max_size;
+	size_t size;        /*!< Memory used by the cache. */
+	uint64_t hits;
+	uint64_t misses;
+	size_t slots;
+	pthread_mutex_t locks[RESP_CACHE_LOCKS];
+	resp_cache_item_t items[];
+};
+
+static size_t item_size(const resp_cache_item_t *item)
+{
+	return (item->data != NULL) ? item->qname_size + item->body_size : 0;
+}
+
+static bool item_match(const resp_cache_item_t *item, const resp_cache_key_t *key)
+{
+	return item->data != NULL &&
+	       item->hash == key->hash &&
+	       item->qtype == key->qtype &&
+	       item->space == key->space &&
+	       item->flags == key->flags &&
+	       item->qname_size == key->qname_size &&
+	       memcmp(item->data, key->qname, key->qname_size) == 0;
+}
+
+static struct resp_cache *resp_cache_new(size_t max_size)
+{
+	size_t slots = MAX(max_size / RESP_CACHE_ITEM_SIZE, RESP_CACHE_MIN_SLOTS);
+	size_t size = sizeof(struct resp_cache) + slots * sizeof(resp_cache_item_t);
+	if (size > max_size) {
+		return NULL;
+	}
+
+	struct resp_cache *cache = calloc(1, size);
+	if (cache == NULL) {
+		return NULL;
+	}
+	cache->max_size = max_size;
+	cache->size = size;
+	cache->slots = slots;
+
+	if (dnssec_random_buffer((uint8_t *)&cache->key, sizeof(cache->key)) != DNSSEC_EOK) {
+		free(cache);
+		return NULL;
+	}
+
+	for (size_t i = 0; i < RESP_CACHE_LOCKS; ++i) {
+		pthread_mutex_init(&cache->locks[i], NULL);
+	}
+
+	return cache;
+}
+
+void resp_cache_free(struct resp_cache *cache)
+{
+	if (cache == NULL || cache == RESP_CACHE_FAILED) {
+		return;
+	}
+
+	for (size_t i = 0; i < cache->slots; ++i) {
+		free(cache->items[i].data);
+	}
+
+	for (size_t i = 0; i < RESP_CACHE_LOCKS; ++i) {
+		pthread_mutex_destroy(&cache->locks[i]);
+	}
+
+	free(cache);
+}
+
+/*! \brief Get the cache of the answering contents, create it if missing. */
+static struct resp_cache *resp_cache_get(knotd_qdata_t *qdata)
+{
+	zone_contents_t *contents = (zone_contents_t *)qdata->extra->contents;
+
+	struct resp_cache *cache = rcu_dereference(contents->resp_cache);
+	if (cache != NULL) {
+		return (cache != RESP_CACHE_FAILED) ? cache : NULL;
+	}
+
+	cache = resp_cache_new(qdata->extra->zone->resp_cache_max_size);
+	struct resp_cache *new = (cache != NULL) ? cache : RESP_CACHE_FAILED;
+	struct resp_cache *old = rcu_cmpxchg_pointer(&contents->resp_cache, NULL, new);
+	if (old != NULL) {
+		resp_cache_free(cache); // Another query is faster.
+		return (old != RESP_CACHE_FAILED) ? old : NULL;
+	}
+
+	return cache;
+}
+
+bool resp_cache_key(resp_cache_key_t *key, const knot_pkt_t *pkt,
+                    knotd_qdata_t *qdata)
+{
+	const zone_t *zone = qdata->extra->zone;
+	const knot_pkt_t *query = qdata->query;
+
+	if (zone == NULL || zone->resp_cache_max_size == 0 || zone->is_catalog_flag ||
+	    qdata->extra->contents == NULL || qdata->type != KNOTD_QUERY_TYPE_NORMAL ||
+	    knot_pkt_qclass(query) != KNOT_CLASS_IN || knot_pkt_has_tsig(query) ||
+	    qdata->ecs != NULL || conf()->cache.srv_ans_rotate) {
+		return false;
+	}
+
+	struct resp_cache *cache = resp_cache_get(qdata);
+	if (cache == NULL) {
+		return false;
+	}
+
+	key->qname = knot_pkt_qname(query);
+	key->qname_size = query->qname_size;
+	key->qtype = knot_pkt_qtype(query);
+	key->space = pkt->max_size - pkt->reserved;
+	key->flags = (knot_pkt_has_dnssec(query) ? KEY_DO : 0) |
+	             (knot_pkt_has_edns(query) ? KEY_EDNS : 0) |
+	             ((qdata->params->flags & KNOTD_QUERY_FLAG_LIMIT_SIZE) ? 0 : KEY_TCP);
+
+	SIPHASH_CTX ctx;
+	SipHash24_Init(&ctx, &cache->key);
+	SipHash24_Update(&ctx, key->qname, key->qname_size);
+	SipHash24_Update(&ctx, &key->qtype, sizeof(key->qtype));
+	SipHash24_Update(&ctx, &key->space, sizeof(key->space));
+	SipHash24_Update(&ctx, &key->flags, sizeof(key->flags));
+	key->hash = SipHash24_End(&ctx);
+
+	return true;
+}
+
+int resp_cache_answer(knot_pkt_t *pkt, knotd_qdata_t *qdata,
+                      const resp_cache_key_t *key)
+{
+	struct resp_cache *cache = rcu_dereference(qdata->extra->contents->resp_cache);
+	assert(cache != NULL && cache != RESP_CACHE_FAILED);
+
+	size_t slot = key->hash % cache->slots;
+	pthread_mutex_t *lock = &cache->locks[slot % RESP_CACHE_LOCKS];
+	resp_cache_item_t *item = &cache->items[slot];
+
+	bool found = false;
+	const zone_node_t *wildcard = NULL, *wildcard_prev = NULL;
+	pthread_mutex_lock(lock);
+	if (item_match(item, key) &&
+	    pkt->size + item->body_size <= pkt->max_size - pkt->reserved) {
+		memcpy(pkt->wire + pkt->size, item->data + item->qname_size, item->body_size);
+		pkt->size += item->body_size;
+		knot_wire_set_ancount(pkt->wire, item->ancount);
+		knot_wire_set_nscount(pkt->wire, item->nscount);
+		knot_wire_set_arcount(pkt->wire, item->arcount);
+		if (item->aa) {
+			knot_wire_set_aa(pkt->wire);
+		}
+		qdata->rcode = item->rcode;
+		qdata->rcode_ede = item->rcode_ede;
+		wildcard = item->wildcard;
+		wildcard_prev = item->wildcard_prev;
+		found = true;
+	}
+	pthread_mutex_unlock(lock);
+
+	if (!found) {
+		ATOMIC_ADD(cache->misses, 1);
+		return KNOT_ENOENT;
+	}
+
+	// Restore the wildcard hit for the query modules (e.g. RRL classification).
+	if (wildcard != NULL) {
+		struct wildcard_hit *hit = mm_alloc(qdata->mm, sizeof(*hit));
+		if (hit != NULL) {
+			hit->node = wildcard;
+			hit->prev = wildcard_prev;
+			hit->sname = knot_pkt_qname(qdata->query);
+			add_tail(&qdata->extra->wildcards, (node_t *)hit);
+		}
+	}
+
+	ATOMIC_ADD(cache->hits, 1);
+	return KNOT_EOK;
+}
+
+void resp_cache_store(const knot_pkt_t *pkt, knotd_qdata_t *qdata,
+                      const resp_cache_key_t *key)
+{
+	// Don't store truncated or failed responses.
+	if (knot_wire_get_tc(pkt->wire) ||
+	    (qdata->rcode != KNOT_RCODE_NOERROR && qdata->rcode != KNOT_RCODE_NXDOMAIN)) {
+		return;
+	}
+
+	struct resp_cache *cache = rcu_dereference(qdata->extra->contents->resp_cache);
+	assert(cache != NULL && cache != RESP_CACHE_FAILED);
+
+	// Prepare the entry outside of the lock.
+	size_t body_pos = KNOT_WIRE_HEADER_SIZE + knot_pkt_question_size(pkt);
+	assert(pkt->size >= body_pos);
+	resp_cache_item_t new = {
+		.hash = key->hash,
+		.qname_size = key->qname_size,
+		.qtype = key->qtype,
+		.space = key->space,
+		.flags = key->flags,
+		.aa = knot_wire_get_aa(pkt->wire),
+		.body_size = pkt->size - body_pos,
+		.ancount = knot_wire_get_ancount(pkt->wire),
+		.nscount = knot_wire_get_nscount(pkt->wire),
+		.arcount = knot_wire_get_arcount(pkt->wire),
+		.rcode = qdata->rcode,
+		.rcode_ede = qdata->rcode_ede,
+	};
+
+	// The nodes are valid as long as the cache of this contents version.
+	if (!EMPTY_LIST(qdata->extra->wildcards)) {
+		struct wildcard_hit *hit = HEAD(qdata->extra->wildcards);
+		new.wildcard = hit->node;
+		new.wildcard_prev = hit->prev;
+	}
+
+	size_t new_size = key->qname_size + new.body_size;
+	new.data = malloc(new_size);
+	if (new.data == NULL) {
+		return;
+	}
+	memcpy(new.data, key->qname, key->qname_size);
+	memcpy(new.data + key->qname_size, pkt->wire + body_pos, new.body_size);
+
+	size_t slot = new.hash % cache->slots;
+	pthread_mutex_t *lock = &cache->locks[slot % RESP_CACHE_LOCKS];
+	resp_cache_item_t *item = &cache->items[slot];
+
+	// Replace the colliding entry unless the cache would exceed its limit.
+	resp_cache_item_t old = new;
+	pthread_mutex_lock(lock);
+	size_t old_size = item_size(item);
+	if (ATOMIC_GET(cache->size) + new_size - old_size <= cache->max_size) {
+		ATOMIC_ADD(cache->size, new_size);
+		ATOMIC_SUB(cache->size, old_size);
+		old = *item;
+		*item = new;
+	}
+	pthread_mutex_unlock(lock);
+
+	free(old.data);
+}
+
+void resp_cache_stats(const zone_contents_t *contents, resp_cache_stats_t *stats)
+{
+	if (contents == NULL) {
+		return;
+	}
+
+	struct resp_cache *cache = rcu_dereference(contents->resp_cache);
+	if (cache == NULL || cache == RESP_CACHE_FAILED) {
+		return;
+	}
+
+	stats->hits += ATOMIC_GET(cache->hits);
+	stats->misses += ATOMIC_GET(cache->misses);
+	stats->size += ATOMIC_GET(cache->size);
+}
@@ -0,0 +1,104 @@
+/*  Copyright (C) 2021 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "knot/nameserver/process_query.h"
+#include "libknot/packet/pkt.h"
+
+/*!
+ * \brief Cache of encoded responses of one zone contents version.
+ *
+ * The cache is a fixed size direct-mapped table, the entries are keyed by
+ * QNAME, QTYPE, DO bit, EDNS presence, transport, and available response
+ * space. Colliding entries are replaced. The slots are guarded by N locks,
+ * the lock K for slot I is calculated as K = I % N.
+ *
+ * Only the sections following the question are stored, excluding OPT.
+ * The header, the question (with original QNAME case), and OPT come from
+ * the processed query. The first wildcard hit of the stored response is
+ * restored on a cache hit so that the query modules see it.
+ */
+struct resp_cache;
+
+/*! \brief Response cache lookup key. */
+typedef struct {
+	const knot_dname_t *qname; /*!< Lowercased QNAME. */
+	uint64_t hash;             /*!< Key hash. */
+	uint16_t qname_size;       /*!< QNAME size. */
+	uint16_t qtype;            /*!< QTYPE. */
+	uint16_t space;            /*!< Available response space. */
+	uint8_t flags;             /*!< DO bit, EDNS, and transport flags. */
+} resp_cache_key_t;
+
+/*! \brief Response cache usage counters. */
+typedef struct {
+	uint64_t hits;   /*!< Answered from the cache. */
+	uint64_t misses; /*!< Not found in the cache. */
+	uint64_t size;   /*!< Memory used by the cache. */
+} resp_cache_stats_t;
+
+/*!
+ * \brief Initialize lookup key if the response can be served from the cache.
+ *
+ * The query must be normal IN class query to a zone with the cache enabled,
+ * without TSIG and EDNS Client Subnet. The caller must check that no query
+ * module modifying the answer sections is active for the query.
+ *
+ * \param key    Key to be initialized.
+ * \param pkt    Response packet with the question and OPT space reserved.
+ * \param qdata  Query data.
+ *
+ * \retval true if the response is cacheable.
+ */
+bool resp_cache_key(resp_cache_key_t *key, const knot_pkt_t *pkt,
+                    knotd_qdata_t *qdata);
+
+/*!
+ * \brief Answer the query from the cache.
+ *
+ * \param pkt    Response packet to be completed.
+ * \param qdata  Query data.
+ * \param key    Lookup key.
+ *
+ * \retval KNOT_EOK if answered.
+ * \retval KNOT_ENOENT if not cached.
+ */
+int resp_cache_answer(knot_pkt_t *pkt, knotd_qdata_t *qdata,
+                      const resp_cache_key_t *key);
+
+/*!
+ * \brief Store the processed response (before adding OPT) into the cache.
+ *
+ * \param pkt    Processed response.
+ * \param qdata  Query data.
+ * \param key    Lookup key.
+ */
+void resp_cache_store(const knot_pkt_t *pkt, knotd_qdata_t *qdata,
+                      const resp_cache_key_t *key);
+
+/*!
+ * \brief Add the cache counters of the zone contents to the stats.
+ */
+void resp_cache_stats(const zone_contents_t *contents, resp_cache_stats_t *stats);
+
+/*!
+ * \brief Free the response cache of a zone contents version.
+ */
+void resp_cache_free(struct resp_cache *cache);
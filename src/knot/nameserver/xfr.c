@@ -1,4 +1,4 @@
-/*  Copyright (C) 2018 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+/*  Copyright (C) 2021 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
 
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU General Public License as published by
@@ -14,9 +14,25 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <urcu.h>
+
 #include "knot/nameserver/xfr.h"
+#include "knot/server/server.h"
 #include "contrib/mempattern.h"
 
+bool xfr_contents_current(knotd_qdata_t *qdata)
+{
+	const struct xfr_proc *xfer = qdata->extra->ext;
+	server_t *server = qdata->params->server;
+	const zone_t *zone = knot_zonedb_find(server->zone_db, knot_pkt_qname(qdata->query));
+	if (zone == NULL) {
+		return false;
+	}
+
+	const zone_contents_t *contents = rcu_dereference(zone->contents);
+	return contents != NULL && contents->id == xfer->contents_id;
+}
+
 int xfr_process_list(knot_pkt_t *pkt, xfr_put_cb put, knotd_qdata_t *qdata)
 {
 	if (pkt == NULL || qdata == NULL || qdata->extra->ext == NULL) {
@@ -34,6 +50,11 @@ int xfr_process_list(knot_pkt_t *pkt, xfr_put_cb put, knotd_qdata_t *qdata)
 	}
 	knot_rrset_t soa_rr = node_rrset(contents->apex, KNOT_RRTYPE_SOA);
 
+	/* Compress against all names in the message if configured, failure isn't fatal. */
+	if (pkt->compr.dict == NULL && conf()->cache.srv_xfr_full_compr) {
+		(void)knot_pkt_compr_dict(pkt);
+	}
+
 	/* Prepend SOA on first packet. */
 	if (xfer->stats.messages == 0) {
 		ret = knot_pkt_put(pkt, 0, &soa_rr, KNOT_PF_NOTRUNC);
@@ -51,9 +51,21 @@ void xfr_log_finished(const knot_dname_t *zone, log_operation_t op,
 struct xfr_proc {
 	list_t nodes;               //!< Items to process (ptrnode_t).
 	zone_contents_t *contents;  //!< Processed zone.
+	uint64_t contents_id;       //!< Identifier of the zone contents being transferred.
 	struct xfr_stats stats;     //!< Packet transfer statistics.
 };
 
+/*!
+ * \brief Check if the transferred zone contents are still the current ones.
+ *
+ * The read lock is only held while a message is being produced, so the zone
+ * contents may be replaced (and freed) between the messages of a transfer.
+ *
+ * \note Must be called under the RCU read lock.
+ * \note qdata->extra->ext points to struct xfr_proc*.
+ */
+bool xfr_contents_current(knotd_qdata_t *qdata);
+
 /*!
  * \brief Generic transfer processing.
  *
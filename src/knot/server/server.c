@@ -84,6 +84,9 @@ static void server_deinit_iface(iface_t *iface, bool dealloc)
 		assert(0);
 #endif
 	}
+#ifdef ENABLE_XDP
+	knot_xdp_umem_deinit(iface->xdp_umem);
+#endif
 	free(iface->fd_xdp);
 	free(iface->xdp_sockets);
 
@@ -224,8 +227,9 @@ static int disable_pmtudisc(int sock, int family)
 	return KNOT_EOK;
 }
 
-static iface_t *server_init_xdp_iface(struct sockaddr_storage *addr, bool route_check,
-                                      bool tcp, unsigned *thread_id_start)
+static iface_t *server_init_xdp_iface(conf_t *conf, struct sockaddr_storage *addr,
+                                      bool route_check, bool tcp,
+                                      unsigned *thread_id_start)
 {
 #ifndef ENABLE_XDP
 	assert(0);
@@ -261,16 +265,36 @@ static iface_t *server_init_xdp_iface(struct sockaddr_storage *addr, bool route_
 		xdp_flags |= KNOT_XDP_LISTEN_PORT_TCP;
 	}
 
+	conf_val_t val = conf_get(conf, C_XDP, C_RING_SIZE);
+	knot_xdp_config_t config = { .ring_size = conf_int(&val) };
+	val = conf_get(conf, C_XDP, C_FRAME_SIZE);
+	config.frame_size = conf_int(&val);
+	val = conf_get(conf, C_XDP, C_HUGEPAGES);
+	config.hugepages = conf_bool(&val);
+	val = conf_get(conf, C_XDP, C_SHARED_UMEM);
+	bool shared_umem = conf_bool(&val);
+	if (shared_umem) {
+		ret = knot_xdp_umem_init(&new_if->xdp_umem, &config, iface.queues);
+		if (ret != KNOT_EOK) {
+			log_error("failed to initialize shared UMEM for XDP interface %s (%s)",
+			          iface.name, knot_strerror(ret));
+			server_deinit_iface(new_if, true);
+			return NULL;
+		}
+		config.umem = new_if->xdp_umem;
+	}
+
 	for (int i = 0; i < iface.queues; i++) {
 		knot_xdp_load_bpf_t mode =
 			(i == 0 ? KNOT_XDP_LOAD_BPF_ALWAYS : KNOT_XDP_LOAD_BPF_NEVER);
 		ret = knot_xdp_init(new_if->xdp_sockets + i, iface.name, i,
-		                    iface.port | xdp_flags, mode);
+		                    iface.port | xdp_flags, mode, &config);
 		if (ret == -EBUSY && i == 0) {
 			log_notice("XDP interface %s@%u is busy, retrying initialization",
 			           iface.name, iface.port);
 			ret = knot_xdp_init(new_if->xdp_sockets + i, iface.name, i,
-			                    iface.port | xdp_flags, KNOT_XDP_LOAD_BPF_ALWAYS_UNLOAD);
+			                    iface.port | xdp_flags, KNOT_XDP_LOAD_BPF_ALWAYS_UNLOAD,
+			                    &config);
 		}
 		if (ret != KNOT_EOK) {
 			log_warning("failed to initialize XDP interface %s@%u, queue %d (%s)",
@@ -285,10 +309,11 @@ static iface_t *server_init_xdp_iface(struct sockaddr_storage *addr, bool route_
 
 	if (ret == KNOT_EOK) {
 		knot_xdp_mode_t mode = knot_eth_xdp_mode(if_nametoindex(iface.name));
-		log_debug("initialized XDP interface %s@%u UDP%s, queues %d, %s mode%s",
+		log_debug("initialized XDP interface %s@%u UDP%s, queues %d, %s mode%s%s",
 		          iface.name, iface.port, (tcp ? "/TCP" : ""), iface.queues,
 		          (mode == KNOT_XDP_MODE_FULL ? "native" : "emulated"),
-		          route_check ? ", route check" : "");
+		          route_check ? ", route check" : "",
+		          shared_umem ? ", shared UMEM" : "");
 	}
 
 	return new_if;
@@ -575,7 +600,8 @@ static int configure_sockets(conf_t *conf, server_t *s)
 		sockaddr_tostr(addr_str, sizeof(addr_str), &addr);
 		log_info("binding to XDP interface %s", addr_str);
 
-		iface_t *new_if = server_init_xdp_iface(&addr, route_check, xdp_tcp, &thread_id);
+		iface_t *new_if = server_init_xdp_iface(conf, &addr, route_check, xdp_tcp,
+		                                        &thread_id);
 		if (new_if == NULL) {
 			server_deinit_iface_list(newlist, nifs);
 			return KNOT_ERROR;
@@ -644,6 +670,8 @@ int server_init(server_t *server, int bg_workers)
 	conf_val_t journal_mode = conf_db_param(conf(), C_JOURNAL_DB_MODE);
 	knot_lmdb_init(&server->journaldb, journal_dir, conf_int(&journal_size), journal_env_flags(conf_opt(&journal_mode), false), NULL);
 	free(journal_dir);
+	conf_val_t journal_batch = conf_db_param(conf(), C_JOURNAL_DB_BATCH);
+	server->journaldb.batch_window = conf_int(&journal_batch);
 
 	kasp_db_ensure_init(&server->kaspdb, conf());
 
@@ -678,6 +706,7 @@ void server_deinit(server_t *server)
 
 	/* Free threads and event handlers. */
 	worker_pool_destroy(server->workers);
+	server->workers = NULL;
 
 	/* Free zone database. */
 	knot_zonedb_deep_free(&server->zone_db, true);
@@ -758,10 +787,10 @@ static void worker_wait_cb(worker_pool_t *pool)
 	static uint64_t last_ns = 0;
 	struct timespec now = time_now();
 	uint64_t now_ns = 1000000000 * now.tv_sec + now.tv_nsec;
-	/* Too frequent worker_pool_status() call with many zones is expensive. */
+	/* Too frequent status notifications with many zones are expensive. */
 	if (now_ns - last_ns > 1000000000) {
 		int running, queued;
-		worker_pool_status(pool, true, &running, &queued);
+		worker_pool_status(pool, &running, &queued);
 		systemd_tasks_status_notify(running + queued);
 		last_ns = now_ns;
 	}
@@ -1123,6 +1152,9 @@ static int reconfigure_journal_db(conf_t *conf, server_t *server)
 	}
 	free(journal_dir);
 
+	conf_val_t journal_batch = conf_db_param(conf, C_JOURNAL_DB_BATCH);
+	server->journaldb.batch_window = conf_int(&journal_batch);
+
 	return KNOT_EOK; // not "ret"
 }
 
@@ -59,6 +59,7 @@ typedef struct {
 	unsigned fd_xdp_count;
 	unsigned xdp_first_thread_id;
 	struct knot_xdp_socket **xdp_sockets;
+	struct knot_xdp_umem *xdp_umem;
 	struct sockaddr_storage addr;
 } iface_t;
 
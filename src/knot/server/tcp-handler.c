@@ -43,11 +43,22 @@
 #include "contrib/time.h"
 #include "contrib/ucw/mempool.h"
 
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0 /* OS X, SIGPIPE is ignored anyway. */
+#endif
+
+#define TCP_MSG_SIZE (sizeof(uint16_t) + KNOT_WIRE_MAX_PKTSIZE) /*!< Max. DNS message with length. */
+#define TCP_RX_SIZE  (2 * TCP_MSG_SIZE) /*!< RX buffer for pipelined queries. */
+#define TCP_BATCH    4 /*!< Max. number of responses sent at once. */
+
 /*! \brief TCP context data. */
 typedef struct tcp_context {
 	knot_layer_t layer;              /*!< Query processing layer. */
 	server_t *server;                /*!< Name server structure. */
-	struct iovec iov[2];             /*!< TX/RX buffers. */
+	struct iovec rx;                 /*!< RX buffer for pipelined queries. */
+	uint8_t *ans_wire[TCP_BATCH];    /*!< Answer buffers, each prefixed with the length. */
+	struct iovec tx[TCP_BATCH];      /*!< Batched responses in the answer buffers. */
+	unsigned tx_count;               /*!< Number of batched responses. */
 	unsigned client_threshold;       /*!< Index of first TCP client. */
 	struct timespec last_poll_time;  /*!< Time of the last socket poll. */
 	bool is_throttled;               /*!< TCP connections throttling switch. */
@@ -58,6 +69,42 @@ typedef struct tcp_context {
 	int io_timeout;                  /*!< [ms] TCP send/recv timeout configuration. */
 } tcp_context_t;
 
+/*!
+ * \brief Outgoing zone transfer in progress.
+ *
+ * The transfer has its own processing context and answer buffer, so that the
+ * responses can be produced progressively as the client reads them,
+ * interleaved with other connections of the thread. The zone isn't locked
+ * between the responses, see xfr_contents_current().
+ */
+typedef struct {
+	knot_layer_t layer;              /*!< Query processing layer of the transfer. */
+	knot_mm_t mm;                    /*!< Memory context of the transfer. */
+	knotd_qdata_params_t params;     /*!< Query processing parameters. */
+	uint8_t *ans_wire;               /*!< Answer buffer, prefixed with the length. */
+	knot_pkt_t *ans;                 /*!< Response packet over the answer buffer. */
+	size_t ans_len;                  /*!< Length of the response in the buffer. */
+	size_t ans_sent;                 /*!< Already sent part of the response. */
+} tcp_xfr_t;
+
+/*!
+ * \brief Client connection state (fdset context of a client socket).
+ *
+ * Unprocessed input and unsent output are only kept here if they don't fit
+ * into a single event processing, the buffers of the thread are used otherwise.
+ */
+typedef struct {
+	struct sockaddr_storage addr;    /*!< Client address. */
+	uint8_t *rx;                     /*!< Received data not processed yet. */
+	size_t rx_len;                   /*!< Length of the unprocessed data. */
+	uint8_t *tx;                     /*!< Responses waiting for POLLOUT. */
+	size_t tx_len;                   /*!< Length of the waiting responses. */
+	size_t tx_sent;                  /*!< Already sent part of the responses. */
+	tcp_xfr_t *xfr;                  /*!< Suspended outgoing zone transfer. */
+	bool pollout;                    /*!< Watched for POLLOUT instead of POLLIN. */
+	bool eof;                        /*!< Closed by the client, finish the responses. */
+} tcp_conn_t;
+
 #define TCP_SWEEP_INTERVAL 2 /*!< [secs] granularity of connection sweeping. */
 
 static void update_sweep_timer(struct timespec *timer)
@@ -77,6 +124,15 @@ static void update_tcp_conf(tcp_context_t *tcp)
 	rcu_read_unlock();
 }
 
+/*! \brief Watchdog interval [s] for connections with pending I/O. */
+static int tcp_io_interval(const tcp_context_t *tcp)
+{
+	if (tcp->io_timeout <= 0) {
+		return tcp->idle_timeout;
+	}
+	return MAX(1, (tcp->io_timeout + 999) / 1000);
+}
+
 static void client_addr(const struct sockaddr_storage *ss, char *out, size_t out_len)
 {
 	if (ss->ss_family == AF_UNIX) {
@@ -86,18 +142,98 @@ static void client_addr(const struct sockaddr_storage *ss, char *out, size_t out
 	}
 }
 
+static tcp_xfr_t *tcp_xfr_new(const knot_layer_t *layer, uint8_t **msg, size_t msg_len)
+{
+	knot_mm_t mm;
+	mm_ctx_mempool(&mm, MM_DEFAULT_BLKSIZE);
+
+	/* Transfer context, answer buffer, and the query kept for the transfer. */
+	tcp_xfr_t *xfr = mm_alloc(&mm, sizeof(*xfr));
+	uint8_t *ans_wire = mm_alloc(&mm, TCP_MSG_SIZE);
+	uint8_t *msg_copy = mm_alloc(&mm, msg_len);
+	if (xfr == NULL || ans_wire == NULL || msg_copy == NULL) {
+		mp_delete(mm.ctx);
+		return NULL;
+	}
+	memset(xfr, 0, sizeof(*xfr));
+	xfr->mm = mm;
+	xfr->ans_wire = ans_wire;
+	xfr->ans = knot_pkt_new(ans_wire + sizeof(uint16_t), KNOT_WIRE_MAX_PKTSIZE, &xfr->mm);
+	if (xfr->ans == NULL) {
+		mp_delete(mm.ctx);
+		return NULL;
+	}
+	knot_layer_init(&xfr->layer, &xfr->mm, layer->api);
+
+	memcpy(msg_copy, *msg, msg_len);
+	*msg = msg_copy;
+
+	return xfr;
+}
+
+static void tcp_xfr_free(tcp_xfr_t *xfr)
+{
+	if (xfr != NULL) {
+		/* Releases the zone contents. */
+		knot_layer_finish(&xfr->layer);
+		mp_delete(xfr->mm.ctx);
+	}
+}
+
+/*! \brief Check if the message is a zone transfer query (without parsing). */
+static bool tcp_xfr_query(const uint8_t *msg, size_t msg_len)
+{
+	if (msg_len <= KNOT_WIRE_HEADER_SIZE || knot_wire_get_qdcount(msg) != 1) {
+		return false;
+	}
+
+	const uint8_t *qname = msg + KNOT_WIRE_HEADER_SIZE;
+	int qname_len = knot_dname_wire_check(qname, msg + msg_len, NULL);
+	if (qname_len <= 0 || qname + qname_len + sizeof(uint16_t) > msg + msg_len) {
+		return false;
+	}
+
+	uint16_t qtype = knot_wire_read_u16(qname + qname_len);
+	return qtype == KNOT_RRTYPE_AXFR || qtype == KNOT_RRTYPE_IXFR;
+}
+
+static void tcp_conn_free(tcp_conn_t *conn)
+{
+	if (conn != NULL) {
+		tcp_xfr_free(conn->xfr);
+		free(conn->rx);
+		free(conn->tx);
+		free(conn);
+	}
+}
+
+/*! \brief Keep a copy of data which couldn't be processed now (append). */
+static int tcp_conn_keep(uint8_t **dst, size_t *dst_len, const uint8_t *src, size_t len)
+{
+	size_t cur_len = (*dst != NULL) ? *dst_len : 0;
+	uint8_t *buf = realloc(*dst, cur_len + len);
+	if (buf == NULL) {
+		return KNOT_ENOMEM;
+	}
+	memcpy(buf + cur_len, src, len);
+	*dst = buf;
+	*dst_len = cur_len + len;
+
+	return KNOT_EOK;
+}
+
 /*! \brief Sweep TCP connection. */
-static fdset_sweep_state_t tcp_sweep(fdset_t *set, int fd, _unused_ void *data)
+static fdset_sweep_state_t tcp_sweep(fdset_t *set, int idx, _unused_ void *data)
 {
-	assert(set && fd >= 0);
+	assert(set && idx >= 0);
 
 	/* Best-effort, name and shame. */
-	struct sockaddr_storage ss = { 0 };
-	socklen_t len = sizeof(struct sockaddr_storage);
-	if (getpeername(fd, (struct sockaddr *)&ss, &len) == 0) {
+	tcp_conn_t *conn = fdset_get_ctx(set, idx);
+	if (conn != NULL) {
 		char addr_str[SOCKADDR_STRLEN];
-		client_addr(&ss, addr_str, sizeof(addr_str));
+		client_addr(&conn->addr, addr_str, sizeof(addr_str));
 		log_notice("TCP, terminated inactive client, address %s", addr_str);
+		tcp_conn_free(conn);
 	}
 
 	return FDSET_SWEEP;
@@ -113,17 +249,6 @@ static bool tcp_send_state(int state)
 	return (state != KNOT_STATE_FAIL && state != KNOT_STATE_NOOP);
 }
 
-static void tcp_log_error(struct sockaddr_storage *ss, const char *operation, int ret)
-{
-	/* Don't log ECONN as it usually means client closed the connection. */
-	if (ret == KNOT_ETIMEOUT) {
-		char addr_str[SOCKADDR_STRLEN];
-		client_addr(ss, addr_str, sizeof(addr_str));
-		log_debug("TCP, failed to %s due to IO timeout, closing connection, address %s",
-		          operation, addr_str);
-	}
-}
-
 static unsigned tcp_set_ifaces(const iface_t *ifaces, size_t n_ifaces,
                                fdset_t *fds, int thread_id)
 {
@@ -156,62 +281,190 @@ static unsigned tcp_set_ifaces(const iface_t *ifaces, size_t n_ifaces,
 	return fdset_get_length(fds);
 }
 
-static int tcp_handle(tcp_context_t *tcp, int fd, struct iovec *rx, struct iovec *tx)
+/*!
+ * \brief Send without blocking.
+ *
+ * \return Number of bytes sent (possibly 0) or an error code.
+ */
+static ssize_t tcp_send_nowait(int fd, struct iovec *iov, unsigned iovcnt)
+{
+	struct msghdr msg = {
+		.msg_iov = iov,
+		.msg_iovlen = iovcnt
+	};
+
+	ssize_t sent;
+	do {
+		sent = sendmsg(fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+	} while (sent < 0 && errno == EINTR);
+
+	if (sent < 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) {
+			return 0;
+		}
+		return knot_map_errno();
+	}
+
+	return sent;
+}
+
+/*!
+ * \brief Send the batched responses, keep a copy of the unsent rest for POLLOUT.
+ *
+ * The responses are sent directly from the answer buffers, they are only
+ * appended to the waiting ones if there are some.
+ */
+static int tcp_flush(tcp_context_t *tcp, int fd, tcp_conn_t *conn)
+{
+	struct iovec *iov = tcp->tx;
+	unsigned count = tcp->tx_count;
+	tcp->tx_count = 0;
+
+	size_t sent = 0;
+	if (conn->tx == NULL && count > 0) {
+		ssize_t ret = tcp_send_nowait(fd, iov, count);
+		if (ret < 0) {
+			return KNOT_EOF;
+		}
+		sent = ret;
+	}
+
+	for (; count > 0; iov++, count--) {
+		if (sent >= iov->iov_len) {
+			sent -= iov->iov_len;
+			continue;
+		}
+		int ret = tcp_conn_keep(&conn->tx, &conn->tx_len,
+		                        (uint8_t *)iov->iov_base + sent, iov->iov_len - sent);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+		sent = 0;
+	}
+
+	return KNOT_EOK;
+}
+
+/*!
+ * \brief Continue sending of the responses waiting for POLLOUT.
+ */
+static int tcp_send_pending(int fd, tcp_conn_t *conn)
 {
-	/* Get peer name. */
-	struct sockaddr_storage ss;
-	socklen_t addrlen = sizeof(struct sockaddr_storage);
-	if (getpeername(fd, (struct sockaddr *)&ss, &addrlen) != 0) {
-		return KNOT_EADDRNOTAVAIL;
+	assert(conn->tx != NULL && conn->tx_sent < conn->tx_len);
+
+	struct iovec iov = {
+		.iov_base = conn->tx + conn->tx_sent,
+		.iov_len = conn->tx_len - conn->tx_sent
+	};
+	ssize_t sent = tcp_send_nowait(fd, &iov, 1);
+	if (sent < 0) {
+		return KNOT_EOF;
+	}
+
+	conn->tx_sent += sent;
+	if (conn->tx_sent == conn->tx_len) {
+		free(conn->tx);
+		conn->tx = NULL;
+		conn->tx_len = 0;
+		conn->tx_sent = 0;
 	}
 
+	return KNOT_EOK;
+}
+
+/*!
+ * \brief Produce responses into the free answer buffers.
+ *
+ * \param ans  Response packets of the query, created over the buffers on demand.
+ *
+ * \retval KNOT_ESPACE  if all the buffers are used and there are more responses.
+ */
+static int tcp_produce(tcp_context_t *tcp, knot_layer_t *layer, knot_pkt_t **ans)
+{
+	while (tcp_active_state(layer->state)) {
+		unsigned idx = tcp->tx_count;
+		if (idx == TCP_BATCH) {
+			return KNOT_ESPACE;
+		}
+
+		uint8_t *out = tcp->ans_wire[idx];
+		if (ans[idx] == NULL) {
+			ans[idx] = knot_pkt_new(out + sizeof(uint16_t),
+			                        KNOT_WIRE_MAX_PKTSIZE, layer->mm);
+			if (ans[idx] == NULL) {
+				return KNOT_ENOMEM;
+			}
+		}
+
+		knot_layer_produce(layer, ans[idx]);
+		/* Batch, if response generation passed and wasn't ignored. */
+		if (ans[idx]->size > 0 && tcp_send_state(layer->state)) {
+			knot_wire_write_u16(out, ans[idx]->size);
+			tcp->tx[idx].iov_base = out;
+			tcp->tx[idx].iov_len = sizeof(uint16_t) + ans[idx]->size;
+			tcp->tx_count++;
+		}
+	}
+
+	return KNOT_EOK;
+}
+
+static int tcp_handle(tcp_context_t *tcp, int fd, tcp_conn_t *conn,
+                      uint8_t *msg, size_t msg_len)
+{
 	/* Create query processing parameter. */
 	knotd_qdata_params_t params = {
-		.remote = &ss,
+		.remote = &conn->addr,
 		.socket = fd,
 		.server = tcp->server,
 		.thread_id = tcp->thread_id
 	};
-
-	rx->iov_len = KNOT_WIRE_MAX_PKTSIZE;
-	tx->iov_len = KNOT_WIRE_MAX_PKTSIZE;
-
-	/* Receive data. */
-	int recv = net_dns_tcp_recv(fd, rx->iov_base, rx->iov_len, tcp->io_timeout);
-	if (recv > 0) {
-		rx->iov_len = recv;
-	} else {
-		tcp_log_error(&ss, "receive", recv);
-		return KNOT_EOF;
+	clock_gettime(CLOCK_MONOTONIC, &params.begin);
+
+	/* Zone transfer is produced when the client reads the responses. */
+	knot_layer_t *layer = &tcp->layer;
+	tcp_xfr_t *xfr = NULL;
+	if (tcp_xfr_query(msg, msg_len)) {
+		xfr = tcp_xfr_new(layer, &msg, msg_len);
+		if (xfr == NULL) {
+			return KNOT_ENOMEM;
+		}
+		xfr->params = params;
+		layer = &xfr->layer;
 	}
 
 	/* Initialize processing layer. */
-	knot_layer_begin(&tcp->layer, &params);
+	knot_layer_begin(layer, (xfr != NULL) ? &xfr->params : &params);
 
-	/* Create packets. */
-	knot_pkt_t *ans = knot_pkt_new(tx->iov_base, tx->iov_len, tcp->layer.mm);
-	knot_pkt_t *query = knot_pkt_new(rx->iov_base, rx->iov_len, tcp->layer.mm);
+	/* Create query packet, response packets are created when needed. */
+	knot_pkt_t *ans[TCP_BATCH] = { NULL };
+	knot_pkt_t *query = knot_pkt_new(msg, msg_len, layer->mm);
 
 	/* Input packet. */
 	int ret = knot_pkt_parse(query, 0);
 	if (ret != KNOT_EOK && query->parsed > 0) { // parsing failed (e.g. 2x OPT)
 		query->parsed--; // artificially decreasing "parsed" leads to FORMERR
 	}
-	knot_layer_consume(&tcp->layer, query);
-
-	/* Resolve until NOOP or finished. */
-	while (tcp_active_state(tcp->layer.state)) {
-		knot_layer_produce(&tcp->layer, ans);
-		/* Send, if response generation passed and wasn't ignored. */
-		if (ans->size > 0 && tcp_send_state(tcp->layer.state)) {
-			int sent = net_dns_tcp_send(fd, ans->wire, ans->size,
-			                            tcp->io_timeout, NULL);
-			if (sent != ans->size) {
-				tcp_log_error(&ss, "send", sent);
-				ret = KNOT_EOF;
-				break;
-			}
+	knot_layer_consume(layer, query);
+
+	if (xfr != NULL) {
+		if (tcp_active_state(layer->state)) {
+			conn->xfr = xfr;
+		} else {
+			tcp_xfr_free(xfr);
 		}
+		return ret;
+	}
+
+	/* Resolve until NOOP or finished, responses not sent now wait for POLLOUT. */
+	int prod_ret;
+	while ((prod_ret = tcp_produce(tcp, layer, ans)) == KNOT_ESPACE) {
+		if ((prod_ret = tcp_flush(tcp, fd, conn)) != KNOT_EOK) {
+			break;
+		}
+	}
+	if (prod_ret != KNOT_EOK) {
+		ret = prod_ret;
 	}
 
 	/* Reset after processing. */
@@ -223,15 +476,74 @@ static int tcp_handle(tcp_context_t *tcp, int fd, struct iovec *rx, struct iovec
 	return ret;
 }
 
+/*!
+ * \brief Produce and send the responses of the zone transfer.
+ *
+ * A response is produced only when the previous one has been sent, the
+ * unsent part is kept in the answer buffer of the transfer. At most TCP_BATCH
+ * responses are produced in one event.
+ */
+static int tcp_xfr_continue(int fd, tcp_conn_t *conn)
+{
+	tcp_xfr_t *xfr = conn->xfr;
+	assert(xfr != NULL && conn->tx == NULL);
+
+	for (unsigned i = 0; i <= TCP_BATCH; i++) {
+		if (xfr->ans_sent == xfr->ans_len) {
+			if (i == TCP_BATCH || !tcp_active_state(xfr->layer.state)) {
+				break;
+			}
+
+			knot_layer_produce(&xfr->layer, xfr->ans);
+			if (xfr->ans->size == 0 || !tcp_send_state(xfr->layer.state)) {
+				continue;
+			}
+			knot_wire_write_u16(xfr->ans_wire, xfr->ans->size);
+			xfr->ans_len = sizeof(uint16_t) + xfr->ans->size;
+			xfr->ans_sent = 0;
+		}
+
+		struct iovec iov = {
+			.iov_base = xfr->ans_wire + xfr->ans_sent,
+			.iov_len = xfr->ans_len - xfr->ans_sent
+		};
+		ssize_t sent = tcp_send_nowait(fd, &iov, 1);
+		if (sent < 0) {
+			return KNOT_EOF;
+		}
+		xfr->ans_sent += sent;
+		if (xfr->ans_sent < xfr->ans_len) {
+			break;
+		}
+	}
+
+	/* Finished with all the responses sent. */
+	if (xfr->ans_sent == xfr->ans_len && !tcp_active_state(xfr->layer.state)) {
+		tcp_xfr_free(xfr);
+		conn->xfr = NULL;
+	}
+
+	return KNOT_EOK;
+}
+
 static void tcp_event_accept(tcp_context_t *tcp, unsigned i)
 {
 	/* Accept client. */
 	int fd = fdset_get_fd(&tcp->set, i);
-	int client = net_accept(fd, NULL);
+	struct sockaddr_storage addr;
+	int client = net_accept(fd, &addr);
 	if (client >= 0) {
+		tcp_conn_t *conn = calloc(1, sizeof(*conn));
+		if (conn == NULL) {
+			close(client);
+			return;
+		}
+		conn->addr = addr;
+
 		/* Assign to fdset. */
-		int idx = fdset_add(&tcp->set, client, FDSET_POLLIN, NULL);
+		int idx = fdset_add(&tcp->set, client, FDSET_POLLIN, conn);
 		if (idx < 0) {
+			free(conn);
 			close(client);
 			return;
 		}
@@ -241,16 +553,124 @@ static void tcp_event_accept(tcp_context_t *tcp, unsigned i)
 	}
 }
 
-static int tcp_event_serve(tcp_context_t *tcp, unsigned i)
+/*!
+ * \brief Process all complete queries received on the connection.
+ *
+ * The socket is watched for POLLOUT instead of POLLIN while some responses
+ * are waiting to be sent or a zone transfer is in progress. Queries received
+ * meanwhile are kept for later. If closed by the client, the connection is
+ * kept until the responses to the already received queries are sent.
+ */
+static int tcp_event_serve(tcp_context_t *tcp, unsigned i, bool readable)
 {
-	int ret = tcp_handle(tcp, fdset_get_fd(&tcp->set, i),
-	                     &tcp->iov[0], &tcp->iov[1]);
+	int fd = fdset_get_fd(&tcp->set, i);
+	tcp_conn_t *conn = fdset_get_ctx(&tcp->set, i);
+	assert(conn);
+
+	/* Continue sending of waiting responses and zone transfer. */
+	int ret = KNOT_EOK;
+	if (conn->tx != NULL) {
+		ret = tcp_send_pending(fd, conn);
+	}
+	if (ret == KNOT_EOK && conn->tx == NULL && conn->xfr != NULL) {
+		ret = tcp_xfr_continue(fd, conn);
+	}
+	if (ret != KNOT_EOK) {
+		return ret;
+	} else if (conn->tx != NULL || conn->xfr != NULL) {
+		(void)fdset_set_watchdog(&tcp->set, i, tcp_io_interval(tcp));
+		return KNOT_EOK;
+	}
+
+	/* Join previously kept and newly received data. */
+	uint8_t *rx = tcp->rx.iov_base;
+	size_t rx_len = 0;
+	bool was_idle = (conn->rx == NULL && !conn->pollout);
+	if (conn->rx != NULL) {
+		memcpy(rx, conn->rx, conn->rx_len);
+		rx_len = conn->rx_len;
+		free(conn->rx);
+		conn->rx = NULL;
+		conn->rx_len = 0;
+	}
+
+	if (readable && !conn->eof && rx_len < tcp->rx.iov_len) {
+		ssize_t recv_len;
+		do {
+			recv_len = recv(fd, rx + rx_len, tcp->rx.iov_len - rx_len,
+			                MSG_DONTWAIT);
+		} while (recv_len < 0 && errno == EINTR);
+
+		if (recv_len > 0) {
+			rx_len += recv_len;
+		} else if (recv_len == 0) {
+			conn->eof = true;
+		} else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+			return KNOT_EOF;
+		}
+	}
+
+	/* Answer all complete queries, batch the responses. */
+	size_t pos = 0;
+	while (rx_len - pos >= sizeof(uint16_t)) {
+		size_t msg_len = knot_wire_read_u16(rx + pos);
+		if (msg_len == 0) {
+			ret = KNOT_EMALF;
+			break;
+		} else if (rx_len - pos < sizeof(uint16_t) + msg_len) {
+			break;
+		}
+
+		ret = tcp_handle(tcp, fd, conn, rx + pos + sizeof(uint16_t), msg_len);
+		pos += sizeof(uint16_t) + msg_len;
+		if (ret == KNOT_EOK && conn->xfr != NULL) {
+			/* Send the preceding responses and start the transfer. */
+			ret = tcp_flush(tcp, fd, conn);
+			if (ret == KNOT_EOK && conn->tx == NULL) {
+				ret = tcp_xfr_continue(fd, conn);
+			}
+		}
+		if (ret != KNOT_EOK || conn->tx != NULL || conn->xfr != NULL) {
+			break;
+		}
+	}
 	if (ret == KNOT_EOK) {
-		/* Update socket activity timer. */
+		ret = tcp_flush(tcp, fd, conn);
+	}
+	tcp->tx_count = 0;
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	/* Closed by the client and all the responses sent. */
+	if (conn->eof && conn->tx == NULL && conn->xfr == NULL) {
+		return KNOT_EOF;
+	}
+
+	/* Keep the rest for the next event. */
+	if (pos < rx_len) {
+		ret = tcp_conn_keep(&conn->rx, &conn->rx_len, rx + pos, rx_len - pos);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+	bool pollout = (conn->tx != NULL || conn->xfr != NULL);
+	if (pollout != conn->pollout) {
+		ret = fdset_set_events(&tcp->set, i, pollout ? FDSET_POLLOUT : FDSET_POLLIN);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+		conn->pollout = pollout;
+	}
+
+	/* Update socket activity timer, pending I/O is limited by io_timeout. */
+	if (conn->rx == NULL && !conn->pollout) {
 		(void)fdset_set_watchdog(&tcp->set, i, tcp->idle_timeout);
+	} else if (was_idle || pos > 0) {
+		(void)fdset_set_watchdog(&tcp->set, i, tcp_io_interval(tcp));
 	}
 
-	return ret;
+	return KNOT_EOK;
 }
 
 static void tcp_wait_for_events(tcp_context_t *tcp)
@@ -277,7 +697,7 @@ static void tcp_wait_for_events(tcp_context_t *tcp)
 		unsigned int idx = fdset_it_get_idx(&it);
 		if (fdset_it_is_error(&it)) {
 			should_close = (idx >= tcp->client_threshold);
-		} else if (fdset_it_is_pollin(&it)) {
+		} else if (fdset_it_is_pollin(&it) || fdset_it_is_pollout(&it)) {
 			/* Master sockets - new connection to accept. */
 			if (idx < tcp->client_threshold) {
 				/* Don't accept more clients than configured. */
@@ -286,13 +706,14 @@ static void tcp_wait_for_events(tcp_context_t *tcp)
 				}
 			/* Client sockets - already accepted connection or
 			   closed connection :-( */
-			} else if (tcp_event_serve(tcp, idx) != KNOT_EOK) {
+			} else if (tcp_event_serve(tcp, idx, fdset_it_is_pollin(&it)) != KNOT_EOK) {
 				should_close = true;
 			}
 		}
 
 		/* Evaluate. */
 		if (should_close) {
+			tcp_conn_free(fdset_get_ctx(set, idx));
 			fdset_it_remove(&it);
 		}
 	}
@@ -333,11 +754,16 @@ int tcp_master(dthread_t *thread)
 	};
 	knot_layer_init(&tcp.layer, &mm, process_query_layer());
 
-	/* Create iovec abstraction. */
-	for (unsigned i = 0; i < 2; ++i) {
-		tcp.iov[i].iov_len = KNOT_WIRE_MAX_PKTSIZE;
-		tcp.iov[i].iov_base = malloc(tcp.iov[i].iov_len);
-		if (tcp.iov[i].iov_base == NULL) {
+	/* Create RX buffer and answer buffers. */
+	tcp.rx.iov_len = TCP_RX_SIZE;
+	tcp.rx.iov_base = malloc(tcp.rx.iov_len);
+	if (tcp.rx.iov_base == NULL) {
+		ret = KNOT_ENOMEM;
+		goto finish;
+	}
+	for (unsigned i = 0; i < TCP_BATCH; ++i) {
+		tcp.ans_wire[i] = malloc(TCP_MSG_SIZE);
+		if (tcp.ans_wire[i] == NULL) {
 			ret = KNOT_ENOMEM;
 			goto finish;
 		}
@@ -379,8 +805,13 @@ int tcp_master(dthread_t *thread)
 	}
 
 finish:
-	free(tcp.iov[0].iov_base);
-	free(tcp.iov[1].iov_base);
+	for (unsigned i = tcp.client_threshold; i < fdset_get_length(&tcp.set); ++i) {
+		tcp_conn_free(fdset_get_ctx(&tcp.set, i));
+	}
+	free(tcp.rx.iov_base);
+	for (unsigned i = 0; i < TCP_BATCH; ++i) {
+		free(tcp.ans_wire[i]);
+	}
 	mp_delete(mm.ctx);
 	fdset_clear(&tcp.set);
 
@@ -20,6 +20,7 @@
 #include <dlfcn.h>
 #include <errno.h>
 #include <string.h>
+#include <time.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
@@ -50,9 +51,10 @@ enum {
 
 /*! \brief UDP context data. */
 typedef struct {
-	knot_layer_t layer; /*!< Query processing layer. */
-	server_t *server;   /*!< Name server structure. */
-	unsigned thread_id; /*!< Thread identifier. */
+	knot_layer_t layer;    /*!< Query processing layer. */
+	server_t *server;      /*!< Name server structure. */
+	unsigned thread_id;    /*!< Thread identifier. */
+	struct timespec begin; /*!< Reception time of the current batch. */
 } udp_context_t;
 
 static bool udp_state_active(int state)
@@ -61,7 +63,8 @@ static bool udp_state_active(int state)
 }
 
 static void udp_handle(udp_context_t *udp, int fd, struct sockaddr_storage *ss,
-                       struct iovec *rx, struct iovec *tx, struct knot_xdp_msg *xdp_msg)
+                       const struct cmsghdr *pktinfo, struct iovec *rx, struct iovec *tx,
+                       struct knot_xdp_msg *xdp_msg)
 {
 	/* Create query processing parameter. */
 	knotd_qdata_params_t params = {
@@ -71,7 +74,9 @@ static void udp_handle(udp_context_t *udp, int fd, struct sockaddr_storage *ss,
 		.socket = fd,
 		.server = udp->server,
 		.xdp_msg = xdp_msg,
-		.thread_id = udp->thread_id
+		.pktinfo = pktinfo,
+		.thread_id = udp->thread_id,
+		.begin = udp->begin
 	};
 
 	/* Start query processing. */
@@ -216,7 +221,8 @@ static void udp_recvfrom_handle(udp_context_t *ctx, void *d)
 	udp_pktinfo_handle(&rq->msg[RX], &rq->msg[TX]);
 
 	/* Process received pkt. */
-	udp_handle(ctx, rq->fd, &rq->addr, &rq->iov[RX], &rq->iov[TX], NULL);
+	udp_handle(ctx, rq->fd, &rq->addr, CMSG_FIRSTHDR(&rq->msg[RX]),
+	           &rq->iov[RX], &rq->iov[TX], NULL);
 }
 
 static void udp_recvfrom_send(void *d)
@@ -311,7 +317,8 @@ static void udp_recvmmsg_handle(udp_context_t *ctx, void *d)
 
 		udp_pktinfo_handle(&rq->msgs[RX][i].msg_hdr, &rq->msgs[TX][i].msg_hdr);
 
-		udp_handle(ctx, rq->fd, rq->addrs + i, rx, tx, NULL);
+		udp_handle(ctx, rq->fd, rq->addrs + i, CMSG_FIRSTHDR(&rq->msgs[RX][i].msg_hdr),
+		           rx, tx, NULL);
 		rq->msgs[TX][i].msg_len = tx->iov_len;
 		rq->msgs[TX][i].msg_hdr.msg_namelen = 0;
 		if (tx->iov_len > 0) {
@@ -367,7 +374,7 @@ static int xdp_recvmmsg_recv(_unused_ int fd, void *d)
 
 static void xdp_recvmmsg_handle(udp_context_t *ctx, void *d)
 {
-	xdp_handle_msgs(d, &ctx->layer, ctx->server, ctx->thread_id);
+	xdp_handle_msgs(d, &ctx->layer, ctx->server, ctx->thread_id, &ctx->begin);
 }
 
 static void xdp_recvmmsg_send(void *d)
@@ -537,6 +544,7 @@ int udp_master(dthread_t *thread)
 				continue;
 			}
 			if (api->udp_recv(fdset_it_get_fd(&it), api_ctx) > 0) {
+				clock_gettime(CLOCK_MONOTONIC, &udp.begin);
 				api->udp_handle(&udp, api_ctx);
 				api->udp_send(api_ctx);
 			}
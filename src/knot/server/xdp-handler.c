@@ -42,6 +42,7 @@ typedef struct xdp_handle_ctx {
 	size_t tcp_max_inbufs;
 	uint32_t tcp_idle_close; // In microseconds.
 	uint32_t tcp_idle_reset; // In microseconds.
+	uint32_t tcp_resend;     // In microseconds.
 } xdp_handle_ctx_t;
 
 static bool udp_state_active(int state)
@@ -68,6 +69,7 @@ void xdp_handle_reconfigure(xdp_handle_ctx_t *ctx)
 	ctx->tcp_max_inbufs = pconf->cache.xdp_tcp_inbuf_max_size / pconf->cache.srv_xdp_threads;
 	ctx->tcp_idle_close = pconf->cache.xdp_tcp_idle_close * 1000000;
 	ctx->tcp_idle_reset = pconf->cache.xdp_tcp_idle_reset * 1000000;
+	ctx->tcp_resend     = pconf->cache.xdp_tcp_resend * 1000;
 	rcu_read_unlock();
 }
 
@@ -178,6 +180,13 @@ static void handle_udp(xdp_handle_ctx_t *ctx, knot_layer_t *layer,
 	}
 }
 
+static void log_reply_failed(knotd_qdata_params_t *params, int ret)
+{
+	char addr[SOCKADDR_STRLEN];
+	sockaddr_tostr(addr, sizeof(addr), params->remote);
+	log_notice("TCP, failed to reply, address %s (%s)", addr, knot_strerror(ret));
+}
+
 static void handle_tcp(xdp_handle_ctx_t *ctx, knot_layer_t *layer,
                        knotd_qdata_params_t *params)
 {
@@ -193,8 +202,6 @@ static void handle_tcp(xdp_handle_ctx_t *ctx, knot_layer_t *layer,
 		log_notice("TCP, failed to send some ACK packets");
 	}
 
-	uint8_t ans_buf[KNOT_WIRE_MAX_PKTSIZE];
-
 	// Note dynaray_foreach can't be used as we insert into the dynarray inside the loop.
 	for (int n_tcp_relays = ctx->tcp_relays.size, rli = 0; rli < n_tcp_relays; rli++) {
 		knot_tcp_relay_t *rl = knot_tcp_relay_dynarray_arr(&ctx->tcp_relays) + rli;
@@ -205,31 +212,42 @@ static void handle_tcp(xdp_handle_ctx_t *ctx, knot_layer_t *layer,
 		// Consume the query.
 		handle_init(params, layer, rl->msg, &rl->data);
 
-		// Process the reply.
-		knot_pkt_t *ans = knot_pkt_new(ans_buf, sizeof(ans_buf), layer->mm);
+		// Process the reply, each message is built in its own output buffer.
+		knot_tcp_outbuf_t *outbuf = NULL;
+		knot_pkt_t *ans = NULL;
 		while (tcp_active_state(layer->state)) {
+			if (outbuf == NULL) {
+				outbuf = knot_tcp_outbuf_alloc(KNOT_WIRE_MAX_PKTSIZE);
+				if (outbuf == NULL) {
+					log_reply_failed(params, KNOT_ENOMEM);
+					break;
+				}
+				ans = knot_pkt_new(knot_tcp_outbuf_data(outbuf),
+				                   KNOT_WIRE_MAX_PKTSIZE, layer->mm);
+			}
+
 			knot_layer_produce(layer, ans);
 			if (!tcp_send_state(layer->state)) {
 				continue;
 			}
 
-			ret = knot_tcp_relay_answer(&ctx->tcp_relays, rl,
-			                            ans->wire, ans->size);
+			ret = knot_tcp_relay_answer_outbuf(&ctx->tcp_relays, rl,
+			                                   ctx->tcp_table, outbuf, ans->size);
+			outbuf = NULL;
 			if (ret != KNOT_EOK) {
-				char addr[SOCKADDR_STRLEN];
-				sockaddr_tostr(addr, sizeof(addr), params->remote);
-				log_notice("TCP, failed to reply, address %s (%s)",
-				           addr, knot_strerror(ret));
+				log_reply_failed(params, ret);
 				layer->state = KNOT_STATE_FAIL;
 			}
 		}
+		knot_tcp_outbuf_free(outbuf);
 
 		handle_finish(layer);
 	}
 }
 
 void xdp_handle_msgs(xdp_handle_ctx_t *ctx, knot_layer_t *layer,
-                     server_t *server, unsigned thread_id)
+                     server_t *server, unsigned thread_id,
+                     const struct timespec *begin)
 {
 	assert(ctx->msg_recv_count > 0);
 
@@ -237,6 +255,7 @@ void xdp_handle_msgs(xdp_handle_ctx_t *ctx, knot_layer_t *layer,
 		.socket = knot_xdp_socket_fd(ctx->sock),
 		.server = server,
 		.thread_id = thread_id,
+		.begin = *begin,
 	};
 
 	knot_xdp_send_prepare(ctx->sock);
@@ -287,7 +306,7 @@ void xdp_handle_sweep(xdp_handle_ctx_t *ctx)
 	do {
 		prev_reset = total_reset;
 		ret = knot_tcp_sweep(ctx->tcp_table, ctx->sock, 20,
-		                     ctx->tcp_idle_close, ctx->tcp_idle_reset,
+		                     ctx->tcp_idle_close, ctx->tcp_idle_reset, ctx->tcp_resend,
 		                     overweight(ctx->tcp_table->usage, ctx->tcp_max_conns),
 		                     overweight(ctx->tcp_table->inbufs_total, ctx->tcp_max_inbufs),
 		                     &total_close, &total_reset);
@@ -44,10 +44,13 @@ int xdp_handle_recv(struct xdp_handle_ctx *ctx);
 /*!
  * \brief Answer packets including DNS layers.
  *
+ * \param begin  Reception time of the packets (CLOCK_MONOTONIC).
+ *
  * \warning In case of TCP, this also sends some packets, e.g. ACK.
  */
 void xdp_handle_msgs(struct xdp_handle_ctx *ctx, knot_layer_t *layer,
-                     struct server *server, unsigned thread_id);
+                     struct server *server, unsigned thread_id,
+                     const struct timespec *begin);
 
 /*!
  * \brief Send packets thru XDP socket.
@@ -17,6 +17,9 @@
 #include <assert.h>
 
 #include "knot/common/log.h"
+#include "knot/nameserver/axfr.h"
+#include "knot/nameserver/nsec_proofs.h"
+#include "knot/nameserver/resp_cache.h"
 #include "knot/updates/apply.h"
 #include "libknot/libknot.h"
 #include "contrib/macros.h"
@@ -374,6 +377,9 @@ void update_free_zone(zone_contents_t *contents)
 	free(contents->nsec3_nodes);
 
 	dnssec_nsec3_params_free(&contents->nsec3_params);
+	axfr_cache_free(contents->axfr_cache);
+	nsec3_cache_free(contents->nsec3_cache);
+	resp_cache_free(contents->resp_cache);
 
 	free(contents);
 }
@@ -24,26 +24,259 @@
 #include "knot/server/dthreads.h"
 #include "knot/worker/pool.h"
 
+#ifdef HAVE_ATOMIC
+ #define ATOMIC_GET(src)      __atomic_load_n(&(src), __ATOMIC_SEQ_CST)
+ #define ATOMIC_SET(dst, val) __atomic_store_n(&(dst), (val), __ATOMIC_SEQ_CST)
+ #define ATOMIC_ADD(dst, val) __atomic_add_fetch(&(dst), (val), __ATOMIC_SEQ_CST)
+ #define ATOMIC_SUB(dst, val) __atomic_sub_fetch(&(dst), (val), __ATOMIC_SEQ_CST)
+#else
+ #define ATOMIC_GET(src)      (src)
+ #define ATOMIC_SET(dst, val) ((dst) = (val))
+ #define ATOMIC_ADD(dst, val) ((dst) += (val))
+ #define ATOMIC_SUB(dst, val) ((dst) -= (val))
+#endif
+
+static const struct {
+	const char *name;
+	int weight;
+} CLASSES[WORKER_CLASS_COUNT] = {
+	[WORKER_CLASS_NORMAL] = { "normal", 2 },
+	[WORKER_CLASS_URGENT] = { "urgent", 4 },
+	[WORKER_CLASS_HEAVY]  = { "heavy",  1 },
+};
+
+/*!
+ * \brief Task queues of one worker thread.
+ */
+typedef struct {
+	pthread_mutex_t lock;
+	worker_queue_t queues[WORKER_CLASS_COUNT];
+	size_t counts[WORKER_CLASS_COUNT]; /*!< Queue lengths. */
+} worker_local_t;
+
 /*!
  * \brief Worker pool state.
  */
 struct worker_pool {
 	dt_unit_t *threads;
+	worker_local_t *locals;	/*!< Per-thread task queues. */
+	unsigned next_local;	/*!< Target queue of tasks assigned from outside. */
+	uint64_t heavy_max;	/*!< Limit of concurrently running heavy tasks. */
 
-	pthread_mutex_t lock;
+	pthread_mutex_t lock;	/*!< Sleeping and waiting for the pool. */
 	pthread_cond_t wake;
 
 	bool terminating;	/*!< Is the pool terminating? .*/
 	bool suspended;		/*!< Is execution temporarily suspended? .*/
-	int running;		/*!< Number of running threads. */
-	worker_queue_t tasks;
+	int idle;		/*!< Number of sleeping threads. */
+	int waiting;		/*!< Number of threads waiting for the pool. */
+	worker_class_stats_t stats[WORKER_CLASS_COUNT];
 };
 
+/*! \brief Pool and queue index of the current worker thread. */
+static __thread struct {
+	worker_pool_t *pool;
+	unsigned idx;
+} self = { NULL };
+
+static void atomic_max(uint64_t *dst, uint64_t val)
+{
+#ifdef HAVE_ATOMIC
+	uint64_t cur = __atomic_load_n(dst, __ATOMIC_RELAXED);
+	while (val > cur && !__atomic_compare_exchange_n(dst, &cur, val, false,
+	                                                 __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+	}
+#else
+	if (val > *dst) {
+		*dst = val;
+	}
+#endif
+}
+
+/*! \brief Reserve a run slot of the class if under the limit. */
+static bool class_reserve(worker_pool_t *pool, worker_class_t cls)
+{
+	uint64_t *running = &pool->stats[cls].running;
+	if (cls != WORKER_CLASS_HEAVY) {
+		ATOMIC_ADD(*running, 1);
+		return true;
+	}
+
+#ifdef HAVE_ATOMIC
+	uint64_t cur = __atomic_load_n(running, __ATOMIC_SEQ_CST);
+	do {
+		if (cur >= pool->heavy_max) {
+			return false;
+		}
+	} while (!__atomic_compare_exchange_n(running, &cur, cur + 1, false,
+	                                      __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST));
+	return true;
+#else
+	if (*running >= pool->heavy_max) {
+		return false;
+	}
+	*running += 1;
+	return true;
+#endif
+}
+
+static bool class_runnable(worker_pool_t *pool, worker_class_t cls)
+{
+	return ATOMIC_GET(pool->stats[cls].queued) > 0 &&
+	       (cls != WORKER_CLASS_HEAVY ||
+	        ATOMIC_GET(pool->stats[cls].running) < pool->heavy_max);
+}
+
+static bool pool_runnable(worker_pool_t *pool)
+{
+	for (worker_class_t cls = 0; cls < WORKER_CLASS_COUNT; cls++) {
+		if (class_runnable(pool, cls)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static bool pool_busy(worker_pool_t *pool)
+{
+	for (worker_class_t cls = 0; cls < WORKER_CLASS_COUNT; cls++) {
+		if (ATOMIC_GET(pool->stats[cls].queued) > 0 ||
+		    ATOMIC_GET(pool->stats[cls].running) > 0) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*! \brief Take a task of the class from own queue or steal it from others. */
+static worker_task_t *class_dequeue(worker_pool_t *pool, unsigned idx,
+                                    worker_class_t cls)
+{
+	unsigned size = pool->threads->size;
+	for (unsigned i = 0; i < size; i++) {
+		worker_local_t *local = &pool->locals[(idx + i) % size];
+		if (ATOMIC_GET(local->counts[cls]) == 0) {
+			continue;
+		}
+
+		uint64_t wait_usec = 0;
+		pthread_mutex_lock(&local->lock);
+		worker_task_t *task = worker_queue_dequeue_wait(&local->queues[cls], &wait_usec);
+		if (task != NULL) {
+			ATOMIC_SUB(local->counts[cls], 1);
+		}
+		pthread_mutex_unlock(&local->lock);
+
+		if (task != NULL) {
+			worker_class_stats_t *stats = &pool->stats[cls];
+			ATOMIC_SUB(stats->queued, 1);
+			ATOMIC_ADD(stats->executed, 1);
+			ATOMIC_ADD(stats->wait_usec, wait_usec);
+			atomic_max(&stats->wait_max_usec, wait_usec);
+			return task;
+		}
+	}
+
+	return NULL;
+}
+
+/*!
+ * \brief Take the next task to be run.
+ *
+ * The class is selected by a smooth weighted round-robin among the classes
+ * with runnable tasks, the credits are kept per thread.
+ */
+static worker_task_t *task_take(worker_pool_t *pool, unsigned idx, int *credits,
+                                worker_class_t *cls)
+{
+	bool tried[WORKER_CLASS_COUNT] = { false };
+
+	for (int attempt = 0; attempt < WORKER_CLASS_COUNT; attempt++) {
+		int best = -1, total = 0;
+		for (worker_class_t c = 0; c < WORKER_CLASS_COUNT; c++) {
+			if (tried[c] || !class_runnable(pool, c)) {
+				continue;
+			}
+			credits[c] += CLASSES[c].weight;
+			total += CLASSES[c].weight;
+			if (best < 0 || credits[c] > credits[best]) {
+				best = c;
+			}
+		}
+		if (best < 0) {
+			return NULL;
+		}
+		credits[best] -= total;
+		tried[best] = true;
+
+		if (!class_reserve(pool, best)) {
+			continue;
+		}
+		worker_task_t *task = class_dequeue(pool, idx, best);
+		if (task != NULL) {
+			*cls = best;
+			return task;
+		}
+		ATOMIC_SUB(pool->stats[best].running, 1);
+	}
+
+	return NULL;
+}
+
+static void task_done(worker_pool_t *pool, worker_class_t cls)
+{
+	ATOMIC_SUB(pool->stats[cls].running, 1);
+
+	/* Wake up the waiters or the threads blocked by the heavy task limit. */
+	if (ATOMIC_GET(pool->waiting) > 0 ||
+	    (cls == WORKER_CLASS_HEAVY && ATOMIC_GET(pool->idle) > 0)) {
+		pthread_mutex_lock(&pool->lock);
+		pthread_cond_broadcast(&pool->wake);
+		pthread_mutex_unlock(&pool->lock);
+	}
+}
+
+/*!
+ * \brief Sleep until there is a runnable task, or the pool is resumed
+ *        or terminated.
+ *
+ * \return True if terminating.
+ */
+static bool worker_sleep(worker_pool_t *pool, bool any_task)
+{
+	pthread_mutex_lock(&pool->lock);
+	ATOMIC_ADD(pool->idle, 1);
+	while (!pool->terminating &&
+	       (pool->suspended || (any_task && !pool_runnable(pool)))) {
+		pthread_cond_wait(&pool->wake, &pool->lock);
+	}
+	ATOMIC_SUB(pool->idle, 1);
+	bool terminating = pool->terminating;
+	pthread_mutex_unlock(&pool->lock);
+
+	return terminating;
+}
+
+static unsigned thread_index(dthread_t *thread)
+{
+	for (int i = 0; i < thread->unit->size; i++) {
+		if (thread->unit->threads[i] == thread) {
+			return i;
+		}
+	}
+
+	assert(0);
+	return 0;
+}
+
 /*!
  * \brief Worker thread.
  *
- * The thread takes a task from the tasks queue and runs it, while checking
- * if the dispatching of new tasks is allowed by the thread pool.
+ * The thread takes a task from its own queues or steals it from the queues
+ * of the other threads and runs it, while checking if the dispatching of new
+ * tasks is allowed by the thread pool.
  *
  * An execution of a running thread cannot be enforced.
  *
@@ -53,36 +286,38 @@ static int worker_main(dthread_t *thread)
 	assert(thread);
 
 	worker_pool_t *pool = thread->data;
+	self.pool = pool;
+	self.idx = thread_index(thread);
 
-	pthread_mutex_lock(&pool->lock);
+	int credits[WORKER_CLASS_COUNT] = { 0 };
 
 	for (;;) {
-		if (pool->terminating) {
-			break;
-		}
-
+		worker_class_t cls = WORKER_CLASS_NORMAL;
 		worker_task_t *task = NULL;
-		if (!pool->suspended) {
-			task = worker_queue_dequeue(&pool->tasks);
+		if (!ATOMIC_GET(pool->terminating) && !ATOMIC_GET(pool->suspended)) {
+			task = task_take(pool, self.idx, credits, &cls);
 		}
 
 		if (task == NULL) {
-			pthread_cond_wait(&pool->wake, &pool->lock);
+			if (worker_sleep(pool, true)) {
+				break;
+			}
 			continue;
 		}
 
-		assert(task->run);
-		pool->running += 1;
+		/* Suspended meanwhile, hold the task until resumed. */
+		if (ATOMIC_GET(pool->suspended) && worker_sleep(pool, false)) {
+			task_done(pool, cls);
+			break;
+		}
 
-		pthread_mutex_unlock(&pool->lock);
+		assert(task->run);
 		task->run(task);
-		pthread_mutex_lock(&pool->lock);
 
-		pool->running -= 1;
-		pthread_cond_broadcast(&pool->wake);
+		task_done(pool, cls);
 	}
 
-	pthread_mutex_unlock(&pool->lock);
+	self.pool = NULL;
 
 	return KNOT_EOK;
 }
@@ -102,6 +337,20 @@ worker_pool_t *worker_pool_create(unsigned threads)
 		goto fail;
 	}
 
+	pool->locals = calloc(threads, sizeof(worker_local_t));
+	if (pool->locals == NULL) {
+		goto fail;
+	}
+	for (unsigned i = 0; i < threads; i++) {
+		pthread_mutex_init(&pool->locals[i].lock, NULL);
+		for (worker_class_t cls = 0; cls < WORKER_CLASS_COUNT; cls++) {
+			worker_queue_init(&pool->locals[i].queues[cls]);
+		}
+	}
+
+	/* Keep a thread for the other classes. */
+	pool->heavy_max = (threads > 1) ? threads - 1 : 1;
+
 	if (pthread_mutex_init(&pool->lock, NULL) != 0) {
 		goto fail;
 	}
@@ -110,12 +359,11 @@ worker_pool_t *worker_pool_create(unsigned threads)
 		goto fail;
 	}
 
-	worker_queue_init(&pool->tasks);
-
 	return pool;
 
 fail:
 	dt_delete(&pool->threads);
+	free(pool->locals);
 	free(pool);
 	return NULL;
 }
@@ -126,12 +374,19 @@ void worker_pool_destroy(worker_pool_t *pool)
 		return;
 	}
 
+	int threads = pool->threads->size;
 	dt_delete(&pool->threads);
 
 	pthread_mutex_destroy(&pool->lock);
 	pthread_cond_destroy(&pool->wake);
 
-	worker_queue_deinit(&pool->tasks);
+	for (int i = 0; i < threads; i++) {
+		pthread_mutex_destroy(&pool->locals[i].lock);
+		for (worker_class_t cls = 0; cls < WORKER_CLASS_COUNT; cls++) {
+			worker_queue_deinit(&pool->locals[i].queues[cls]);
+		}
+	}
+	free(pool->locals);
 
 	free(pool);
 }
@@ -152,7 +407,7 @@ void worker_pool_stop(worker_pool_t *pool)
 	}
 
 	pthread_mutex_lock(&pool->lock);
-	pool->terminating = true;
+	ATOMIC_SET(pool->terminating, true);
 	pthread_cond_broadcast(&pool->wake);
 	pthread_mutex_unlock(&pool->lock);
 
@@ -166,7 +421,7 @@ void worker_pool_suspend(worker_pool_t *pool)
 	}
 
 	pthread_mutex_lock(&pool->lock);
-	pool->suspended = true;
+	ATOMIC_SET(pool->suspended, true);
 	pthread_mutex_unlock(&pool->lock);
 }
 
@@ -177,7 +432,7 @@ void worker_pool_resume(worker_pool_t *pool)
 	}
 
 	pthread_mutex_lock(&pool->lock);
-	pool->suspended = false;
+	ATOMIC_SET(pool->suspended, false);
 	pthread_cond_broadcast(&pool->wake);
 	pthread_mutex_unlock(&pool->lock);
 }
@@ -198,12 +453,14 @@ void worker_pool_wait_cb(worker_pool_t *pool, wait_callback_t cb)
 	}
 
 	pthread_mutex_lock(&pool->lock);
-	while (!EMPTY_LIST(pool->tasks.list) || pool->running > 0) {
+	ATOMIC_ADD(pool->waiting, 1);
+	while (pool_busy(pool)) {
 		if (cb != NULL) {
 			cb(pool);
 		}
 		pthread_cond_wait(&pool->wake, &pool->lock);
 	}
+	ATOMIC_SUB(pool->waiting, 1);
 	pthread_mutex_unlock(&pool->lock);
 }
 
@@ -212,16 +469,73 @@ void worker_pool_wait(worker_pool_t *pool)
 	worker_pool_wait_cb(pool, NULL);
 }
 
-void worker_pool_assign(worker_pool_t *pool, struct task *task)
+int worker_pool_assign(worker_pool_t *pool, struct task *task)
 {
 	if (!pool || !task) {
-		return;
+		return KNOT_EINVAL;
 	}
 
-	pthread_mutex_lock(&pool->lock);
-	worker_queue_enqueue(&pool->tasks, task);
-	pthread_cond_signal(&pool->wake);
-	pthread_mutex_unlock(&pool->lock);
+	/* Workers enqueue to their own queues, others round-robin. */
+	unsigned idx;
+	if (self.pool == pool) {
+		idx = self.idx;
+	} else {
+		idx = ATOMIC_ADD(pool->next_local, 1) % pool->threads->size;
+	}
+	worker_local_t *local = &pool->locals[idx];
+	worker_class_t cls = (task->cls < WORKER_CLASS_COUNT) ? task->cls : WORKER_CLASS_NORMAL;
+
+	/* Counted in advance so that no thread goes to sleep with a task queued. */
+	ATOMIC_ADD(pool->stats[cls].queued, 1);
+
+	pthread_mutex_lock(&local->lock);
+	int ret = worker_queue_enqueue(&local->queues[cls], task);
+	if (ret == KNOT_EOK) {
+		ATOMIC_ADD(local->counts[cls], 1);
+	} else {
+		ATOMIC_SUB(pool->stats[cls].queued, 1);
+	}
+	pthread_mutex_unlock(&local->lock);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	if (ATOMIC_GET(pool->idle) > 0) {
+		pthread_mutex_lock(&pool->lock);
+		pthread_cond_signal(&pool->wake);
+		pthread_mutex_unlock(&pool->lock);
+	}
+
+	return KNOT_EOK;
+}
+
+bool worker_pool_cancel(worker_pool_t *pool, const struct task *task)
+{
+	if (!pool || !task) {
+		return false;
+	}
+
+	worker_class_t cls = (task->cls < WORKER_CLASS_COUNT) ? task->cls : WORKER_CLASS_NORMAL;
+	for (int i = 0; i < pool->threads->size; i++) {
+		worker_local_t *local = &pool->locals[i];
+		if (ATOMIC_GET(local->counts[cls]) == 0) {
+			continue;
+		}
+
+		pthread_mutex_lock(&local->lock);
+		bool found = worker_queue_remove(&local->queues[cls], task);
+		if (found) {
+			ATOMIC_SUB(local->counts[cls], 1);
+			ATOMIC_SUB(pool->stats[cls].queued, 1);
+		}
+		pthread_mutex_unlock(&local->lock);
+
+		if (found) {
+			return true;
+		}
+	}
+
+	return false;
 }
 
 void worker_pool_clear(worker_pool_t *pool)
@@ -230,25 +544,53 @@ void worker_pool_clear(worker_pool_t *pool)
 		return;
 	}
 
+	for (int i = 0; i < pool->threads->size; i++) {
+		worker_local_t *local = &pool->locals[i];
+		pthread_mutex_lock(&local->lock);
+		for (worker_class_t cls = 0; cls < WORKER_CLASS_COUNT; cls++) {
+			worker_queue_deinit(&local->queues[cls]);
+			worker_queue_init(&local->queues[cls]);
+			ATOMIC_SUB(pool->stats[cls].queued, local->counts[cls]);
+			ATOMIC_SET(local->counts[cls], 0);
+		}
+		pthread_mutex_unlock(&local->lock);
+	}
+
 	pthread_mutex_lock(&pool->lock);
-	worker_queue_deinit(&pool->tasks);
-	worker_queue_init(&pool->tasks);
+	pthread_cond_broadcast(&pool->wake);
 	pthread_mutex_unlock(&pool->lock);
 }
 
-void worker_pool_status(worker_pool_t *pool, bool locked, int *running, int *queued)
+void worker_pool_status(worker_pool_t *pool, int *running, int *queued)
 {
+	*running = *queued = 0;
 	if (!pool) {
-		*running = *queued = 0;
 		return;
 	}
 
-	if (!locked) {
-		pthread_mutex_lock(&pool->lock);
+	for (worker_class_t cls = 0; cls < WORKER_CLASS_COUNT; cls++) {
+		*running += ATOMIC_GET(pool->stats[cls].running);
+		*queued += ATOMIC_GET(pool->stats[cls].queued);
 	}
-	*running = pool->running;
-	*queued = worker_queue_length(&pool->tasks);
-	if (!locked) {
-		pthread_mutex_unlock(&pool->lock);
+}
+
+void worker_pool_stats(worker_pool_t *pool, worker_class_t cls,
+                       worker_class_stats_t *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+	if (!pool || cls >= WORKER_CLASS_COUNT) {
+		return;
 	}
+
+	const worker_class_stats_t *src = &pool->stats[cls];
+	stats->queued = ATOMIC_GET(src->queued);
+	stats->running = ATOMIC_GET(src->running);
+	stats->executed = ATOMIC_GET(src->executed);
+	stats->wait_usec = ATOMIC_GET(src->wait_usec);
+	stats->wait_max_usec = ATOMIC_GET(src->wait_max_usec);
+}
+
+const char *worker_class_name(worker_class_t cls)
+{
+	return (cls < WORKER_CLASS_COUNT) ? CLASSES[cls].name : NULL;
 }
@@ -17,17 +17,34 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "knot/worker/queue.h"
 
 struct worker_pool;
 typedef struct worker_pool worker_pool_t;
 
+/*!
+ * \brief Statistics of one task class.
+ */
+typedef struct {
+	uint64_t queued;        /*!< Number of queued tasks. */
+	uint64_t running;       /*!< Number of running tasks. */
+	uint64_t executed;      /*!< Total number of started tasks. */
+	uint64_t wait_usec;     /*!< Total queue wait time of the started tasks. */
+	uint64_t wait_max_usec; /*!< Maximal queue wait time. */
+} worker_class_stats_t;
+
 typedef void(*wait_callback_t)(worker_pool_t *);
 
 /*!
  * \brief Initialize worker pool.
  *
+ * Each thread has its own task queues, one per task class, and steals
+ * tasks from the other threads if its queues are empty. The classes are
+ * served in the ratio of their weights (urgent 4, normal 2, heavy 1) and
+ * heavy tasks never occupy all the threads if there are more of them.
+ *
  * \param threads  Number of threads to be created.
  *
  * \return Thread pool or NULL in case of error.
@@ -77,8 +94,20 @@ void worker_pool_wait_cb(worker_pool_t *pool, wait_callback_t cb);
 
 /*!
  * \brief Assign a task to be performed by a worker in the pool.
+ *
+ * \note The task is scheduled according to its class (task->cls).
+ *
+ * \return KNOT_EOK, KNOT_EINVAL, or KNOT_ENOMEM if the task couldn't be queued.
  */
-void worker_pool_assign(worker_pool_t *pool, struct task *task);
+int worker_pool_assign(worker_pool_t *pool, struct task *task);
+
+/*!
+ * \brief Remove a task from the pool if it hasn't been started yet.
+ *
+ * \return True if the task was removed, false if it isn't queued
+ *         (not assigned or already taken by a worker).
+ */
+bool worker_pool_cancel(worker_pool_t *pool, const struct task *task);
 
 /*!
  * \brief Clear all tasks enqueued in pool processing queue.
@@ -87,7 +116,16 @@ void worker_pool_clear(worker_pool_t *pool);
 
 /*!
  * \brief Obtain info regarding how the pool is busy.
- *
- * \note Locked means if the mutex `pool->lock` is locked.
  */
-void worker_pool_status(worker_pool_t *pool, bool locked, int *running, int *queued);
+void worker_pool_status(worker_pool_t *pool, int *running, int *queued);
+
+/*!
+ * \brief Obtain statistics of the given task class.
+ */
+void worker_pool_stats(worker_pool_t *pool, worker_class_t cls,
+                       worker_class_stats_t *stats);
+
+/*!
+ * \brief Returns the name of the task class.
+ */
+const char *worker_class_name(worker_class_t cls);
@@ -14,8 +14,24 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <time.h>
+
 #include "knot/worker/queue.h"
 #include "contrib/mempattern.h"
+#include "libknot/errcode.h"
+
+typedef struct {
+	node_t n;
+	worker_task_t *task;
+	uint64_t enqueued; /*!< Enqueue time (monotonic usec). */
+} queue_node_t;
+
+static uint64_t now_usec(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
 
 void worker_queue_init(worker_queue_t *queue)
 {
@@ -31,19 +47,37 @@ void worker_queue_init(worker_queue_t *queue)
 
 void worker_queue_deinit(worker_queue_t *queue)
 {
-	ptrlist_free(&queue->list, &queue->mm_ctx);
+	node_t *n, *nxt;
+	WALK_LIST_DELSAFE(n, nxt, queue->list) {
+		mm_free(&queue->mm_ctx, n);
+	}
+	init_list(&queue->list);
 }
 
-void worker_queue_enqueue(worker_queue_t *queue, worker_task_t *task)
+int worker_queue_enqueue(worker_queue_t *queue, worker_task_t *task)
 {
 	if (!queue || !task) {
-		return;
+		return KNOT_EINVAL;
 	}
 
-	ptrlist_add(&queue->list, task, &queue->mm_ctx);
+	queue_node_t *node = mm_alloc(&queue->mm_ctx, sizeof(*node));
+	if (node == NULL) {
+		return KNOT_ENOMEM;
+	}
+	node->task = task;
+	node->enqueued = now_usec();
+	add_tail(&queue->list, &node->n);
+
+	return KNOT_EOK;
 }
 
 worker_task_t *worker_queue_dequeue(worker_queue_t *queue)
+{
+	uint64_t unused;
+	return worker_queue_dequeue_wait(queue, &unused);
+}
+
+worker_task_t *worker_queue_dequeue_wait(worker_queue_t *queue, uint64_t *wait_usec)
 {
 	if (!queue) {
 		return NULL;
@@ -52,15 +86,35 @@ worker_task_t *worker_queue_dequeue(worker_queue_t *queue)
 	worker_task_t *task = NULL;
 
 	if (!EMPTY_LIST(queue->list)) {
-		ptrnode_t *node = HEAD(queue->list);
-		task = (void *)node->d;
+		queue_node_t *node = HEAD(queue->list);
+		task = node->task;
+		uint64_t now = now_usec();
+		*wait_usec = (now > node->enqueued) ? now - node->enqueued : 0;
 		rem_node(&node->n);
-		queue->mm_ctx.free(&node->n);
+		mm_free(&queue->mm_ctx, node);
 	}
 
 	return task;
 }
 
+bool worker_queue_remove(worker_queue_t *queue, const worker_task_t *task)
+{
+	if (!queue || !task) {
+		return false;
+	}
+
+	queue_node_t *node;
+	WALK_LIST(node, queue->list) {
+		if (node->task == task) {
+			rem_node(&node->n);
+			mm_free(&queue->mm_ctx, node);
+			return true;
+		}
+	}
+
+	return false;
+}
+
 size_t worker_queue_length(worker_queue_t *queue)
 {
 	return queue ? list_size(&queue->list) : 0;
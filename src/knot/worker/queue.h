@@ -16,17 +16,31 @@
 
 #pragma once
 
+#include <stdbool.h>
+#include <stdint.h>
+
 #include "contrib/ucw/lists.h"
 
 struct task;
 typedef void (*task_cb)(struct task *);
 
+/*!
+ * \brief Task classes with different scheduling priorities.
+ */
+typedef enum {
+	WORKER_CLASS_NORMAL = 0, /*!< Default class. */
+	WORKER_CLASS_URGENT,     /*!< Short tasks which mustn't be delayed. */
+	WORKER_CLASS_HEAVY,      /*!< Long-running tasks, e.g. zone signing. */
+	WORKER_CLASS_COUNT
+} worker_class_t;
+
 /*!
  * \brief Task executable by a worker.
  */
 typedef struct task {
 	void *ctx;
 	task_cb run;
+	worker_class_t cls;
 } worker_task_t;
 
 /*!
@@ -49,8 +63,10 @@ void worker_queue_deinit(worker_queue_t *queue);
 
 /*!
  * \brief Insert new item into the queue.
+ *
+ * \return KNOT_EOK, KNOT_EINVAL, or KNOT_ENOMEM.
  */
-void worker_queue_enqueue(worker_queue_t *queue, worker_task_t *task);
+int worker_queue_enqueue(worker_queue_t *queue, worker_task_t *task);
 
 /*!
  * \brief Remove item from the queue.
@@ -59,6 +75,23 @@ void worker_queue_enqueue(worker_queue_t *queue, worker_task_t *task);
  */
 worker_task_t *worker_queue_dequeue(worker_queue_t *queue);
 
+/*!
+ * \brief Remove item from the queue and get the time it spent in the queue.
+ *
+ * \param queue      Worker queue.
+ * \param wait_usec  Output time since the task was enqueued (microseconds).
+ *
+ * \return Task or NULL if the queue is empty.
+ */
+worker_task_t *worker_queue_dequeue_wait(worker_queue_t *queue, uint64_t *wait_usec);
+
+/*!
+ * \brief Remove given task from the queue.
+ *
+ * \return True if the task was found in the queue.
+ */
+bool worker_queue_remove(worker_queue_t *queue, const worker_task_t *task);
+
 /*!
  * \brief Return number of tasks in worker queue.
  */
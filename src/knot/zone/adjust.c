@@ -334,12 +334,9 @@ typedef struct {
 	measure_t *m;
 
 	// just for parallel
-	unsigned threads;
-	unsigned thr_id;
-	size_t i;
+	zone_tree_split_t *split;
 	pthread_t thread;
 	int ret;
-	zone_tree_t *tree;
 } zone_adjust_arg_t;
 
 static int adjust_single(zone_node_t *node, void *data)
@@ -349,13 +346,6 @@ static int adjust_single(zone_node_t *node, void *data)
 
 	zone_adjust_arg_t *args = (zone_adjust_arg_t *)data;
 
-	// parallel adjust support
-	if (args->threads > 1) {
-		if (args->i++ % args->threads != args->thr_id) {
-			return KNOT_EOK;
-		}
-	}
-
 	if (args->m != NULL) {
 		knot_measure_node(node, args->m);
 	}
@@ -415,7 +405,7 @@ static void *adjust_tree_thread(void *ctx)
 {
 	zone_adjust_arg_t *arg = ctx;
 
-	arg->ret = zone_tree_apply(arg->tree, adjust_single, ctx);
+	arg->ret = zone_tree_split_apply(arg->split, adjust_single, ctx);
 
 	return NULL;
 }
@@ -429,7 +419,13 @@ static int zone_adjust_tree_parallel(zone_tree_t *tree, adjust_ctx_t *ctx,
 
 	zone_adjust_arg_t args[threads];
 	memset(args, 0, sizeof(args));
-	int ret = KNOT_EOK;
+
+	// split the tree so that each node is adjusted by one thread only
+	zone_tree_split_t split;
+	int ret = zone_tree_split_init(tree, threads, &split);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
 
 	for (unsigned i = 0; i < threads; i++) {
 		args[i].first_node = NULL;
@@ -437,10 +433,7 @@ static int zone_adjust_tree_parallel(zone_tree_t *tree, adjust_ctx_t *ctx,
 		args[i].adjust_cb = adjust_cb;
 		args[i].adjust_prevs = false;
 		args[i].m = NULL;
-		args[i].tree = tree;
-		args[i].threads = threads;
-		args[i].i = 0;
-		args[i].thr_id = i;
+		args[i].split = &split;
 		args[i].ret = -1;
 		if (ctx->changed_nodes != NULL) {
 			args[i].ctx.changed_nodes = zone_tree_create(true);
@@ -455,6 +448,7 @@ static int zone_adjust_tree_parallel(zone_tree_t *tree, adjust_ctx_t *ctx,
 		for (unsigned i = 0; i < threads; i++) {
 			zone_tree_free(&args[i].ctx.changed_nodes);
 		}
+		zone_tree_split_deinit(&split);
 		return ret;
 	}
 
@@ -474,6 +468,7 @@ static int zone_adjust_tree_parallel(zone_tree_t *tree, adjust_ctx_t *ctx,
 		}
 		zone_tree_free(&args[i].ctx.changed_nodes);
 	}
+	zone_tree_split_deinit(&split);
 
 	return ret;
 }
@@ -22,6 +22,9 @@
 #include "knot/zone/contents.h"
 #include "knot/common/log.h"
 #include "knot/dnssec/zone-nsec.h"
+#include "knot/nameserver/axfr.h"
+#include "knot/nameserver/nsec_proofs.h"
+#include "knot/nameserver/resp_cache.h"
 #include "libknot/libknot.h"
 #include "contrib/qp-trie/trie.h"
 
@@ -158,6 +161,13 @@ static int remove_rr(zone_contents_t *z, const knot_rrset_t *rr,
 	return KNOT_EOK;
 }
 
+/*! \brief Get a unique identifier for a new contents instance. */
+static uint64_t contents_new_id(void)
+{
+	static uint64_t last_id = 0;
+	return __atomic_add_fetch(&last_id, 1, __ATOMIC_RELAXED);
+}
+
 // Public API
 
 zone_contents_t *zone_contents_new(const knot_dname_t *apex_name, bool use_binodes)
@@ -170,6 +180,7 @@ zone_contents_t *zone_contents_new(const knot_dname_t *apex_name, bool use_binod
 	if (contents == NULL) {
 		return NULL;
 	}
+	contents->id = contents_new_id();
 
 	contents->nodes = zone_tree_create(use_binodes);
 	if (contents->nodes == NULL) {
@@ -475,6 +486,7 @@ int zone_contents_cow(zone_contents_t *from, zone_contents_t **to)
 	if (contents == NULL) {
 		return KNOT_ENOMEM;
 	}
+	contents->id = contents_new_id();
 
 	contents->nodes = zone_tree_cow(from->nodes);
 	if (contents->nodes == NULL) {
@@ -513,6 +525,9 @@ void zone_contents_free(zone_contents_t *contents)
 
 	dnssec_nsec3_params_free(&contents->nsec3_params);
 	additionals_tree_free(contents->adds_tree);
+	axfr_cache_free(contents->axfr_cache);
+	nsec3_cache_free(contents->nsec3_cache);
+	resp_cache_free(contents->resp_cache);
 
 	free(contents);
 }
@@ -38,6 +38,11 @@ typedef struct zone_contents {
 	size_t size;
 	uint32_t max_ttl;
 	bool dnssec;
+	uint64_t id;             /*!< Unique identifier of this contents instance. */
+
+	struct axfr_cache *axfr_cache; // encoded AXFR messages of this version, see axfr.c
+	struct nsec3_cache *nsec3_cache; // NSEC3 proofs lookup cache, see nsec_proofs.c
+	struct resp_cache *resp_cache; // encoded responses of this version, see resp_cache.c
 } zone_contents_t;
 
 /*!
@@ -0,0 +1,332 @@
+/*  Copyright (C) 2021 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "knot/zone/zone-image.h"
+#include "contrib/files.h"
+#include "contrib/string.h"
+#include "libknot/libknot.h"
+
+/*
+ * # Zone image
+ *
+ * Zone image is a binary cache of one version of the parsed zone file. It's
+ * loaded by mapping the file into memory and inserting the stored rdatasets
+ * into the zone trees as they are, so the zone file parsing and the rdata
+ * canonicalization are skipped. The zone adjustment isn't, the adjusted
+ * state consists of pointers into the zone trees.
+ *
+ * # Format
+ *
+ * The image is a cache of the local zone file, so the values are stored in
+ * the host byte order. The file starts with a fixed header followed by the
+ * records, each aligned to 8 bytes:
+ *
+ *     type (2 B), RR count (2 B), TTL (4 B), rdata size (4 B),
+ *     owner (uncompressed wire format), padding,
+ *     rdataset (knot_rdata_t array of the given size), padding
+ *
+ * The image is valid only if the modification time and size of the zone
+ * file match the values in the header.
+ */
+
+#define IMAGE_MAGIC	"KNOTZIM1"
+#define IMAGE_ORDER	0x01020304
+#define IMAGE_ALIGN	8
+
+/*! \brief Zone image header. */
+typedef struct {
+	char magic[8];          /*!< Format identifier. */
+	uint32_t order;         /*!< Byte order mark. */
+	uint32_t serial;        /*!< SOA serial of the stored contents. */
+	uint64_t mtime_sec;     /*!< Zone file modification time (seconds). */
+	uint64_t mtime_nsec;    /*!< Zone file modification time (nanoseconds). */
+	uint64_t file_size;     /*!< Zone file size. */
+	uint64_t records;       /*!< Number of the stored records. */
+} image_hdr_t;
+
+/*! \brief Fixed part of a zone image record. */
+typedef struct {
+	uint16_t type;
+	uint16_t count;
+	uint32_t ttl;
+	uint32_t size;
+} image_rec_t;
+
+static size_t padding(size_t len)
+{
+	return (IMAGE_ALIGN - (len % IMAGE_ALIGN)) % IMAGE_ALIGN;
+}
+
+char *zone_image_path(const char *zonefile)
+{
+	if (zonefile == NULL) {
+		return NULL;
+	}
+
+	return sprintf_alloc("%s.image", zonefile);
+}
+
+static int write_pad(FILE *file, size_t len)
+{
+	static const uint8_t zeroes[IMAGE_ALIGN] = { 0 };
+
+	size_t pad = padding(len);
+	return (fwrite(zeroes, 1, pad, file) == pad) ? KNOT_EOK : KNOT_EFILE;
+}
+
+static int write_node(FILE *file, const zone_node_t *node, uint64_t *records)
+{
+	size_t owner_size = knot_dname_size(node->owner);
+
+	for (uint16_t i = 0; i < node->rrset_count; i++) {
+		const struct rr_data *data = &node->rrs[i];
+		image_rec_t rec = {
+			.type = data->type,
+			.count = data->rrs.count,
+			.ttl = data->ttl,
+			.size = data->rrs.size
+		};
+
+		if (fwrite(&rec, sizeof(rec), 1, file) != 1 ||
+		    fwrite(node->owner, owner_size, 1, file) != 1 ||
+		    write_pad(file, sizeof(rec) + owner_size) != KNOT_EOK ||
+		    fwrite(data->rrs.rdata, 1, rec.size, file) != rec.size ||
+		    write_pad(file, rec.size) != KNOT_EOK) {
+			return KNOT_EFILE;
+		}
+		(*records)++;
+	}
+
+	return KNOT_EOK;
+}
+
+static int write_contents(FILE *file, const zone_contents_t *contents,
+                          image_hdr_t *hdr)
+{
+	if (fwrite(hdr, sizeof(*hdr), 1, file) != 1) {
+		return KNOT_EFILE;
+	}
+
+	zone_tree_it_t it = { 0 };
+	int ret = zone_tree_it_double_begin(contents->nodes, contents->nsec3_nodes, &it);
+	while (ret == KNOT_EOK && !zone_tree_it_finished(&it)) {
+		ret = write_node(file, zone_tree_it_val(&it), &hdr->records);
+		zone_tree_it_next(&it);
+	}
+	zone_tree_it_free(&it);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	// Rewrite the header with the final number of records.
+	if (fseek(file, 0, SEEK_SET) != 0 ||
+	    fwrite(hdr, sizeof(*hdr), 1, file) != 1 ||
+	    fflush(file) != 0 || fsync(fileno(file)) != 0) {
+		return KNOT_EFILE;
+	}
+
+	return KNOT_EOK;
+}
+
+int zone_image_write(const char *path, const char *zonefile,
+                     const struct timespec *mtime,
+                     const zone_contents_t *contents)
+{
+	if (path == NULL || zonefile == NULL || mtime == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	if (zone_contents_is_empty(contents)) {
+		return KNOT_EEMPTYZONE;
+	}
+
+	struct stat st;
+	if (stat(zonefile, &st) < 0) {
+		return knot_map_errno();
+	}
+	if (st.st_mtim.tv_sec != mtime->tv_sec || st.st_mtim.tv_nsec != mtime->tv_nsec) {
+		return KNOT_EAGAIN;
+	}
+
+	image_hdr_t hdr = {
+		.magic = IMAGE_MAGIC,
+		.order = IMAGE_ORDER,
+		.serial = zone_contents_serial(contents),
+		.mtime_sec = st.st_mtim.tv_sec,
+		.mtime_nsec = st.st_mtim.tv_nsec,
+		.file_size = st.st_size
+	};
+
+	FILE *file = NULL;
+	char *tmp_name = NULL;
+	int ret = open_tmp_file(path, &tmp_name, &file, S_IRUSR|S_IWUSR|S_IRGRP|S_IWGRP);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	ret = write_contents(file, contents, &hdr);
+	fclose(file);
+	if (ret == KNOT_EOK && rename(tmp_name, path) != 0) {
+		ret = knot_map_errno();
+	}
+	if (ret != KNOT_EOK) {
+		unlink(tmp_name);
+	}
+	free(tmp_name);
+
+	return ret;
+}
+
+static bool check_rdataset(const knot_rdataset_t *rrs)
+{
+	const uint8_t *end = (const uint8_t *)rrs->rdata + rrs->size;
+
+	knot_rdata_t *rr = rrs->rdata;
+	for (uint16_t i = 0; i < rrs->count; i++) {
+		if ((uint8_t *)rr + sizeof(uint16_t) > end ||
+		    (uint8_t *)rr + knot_rdata_size(rr->len) > end) {
+			return false;
+		}
+		rr = knot_rdataset_next(rr);
+	}
+
+	return (uint8_t *)rr == end;
+}
+
+static int load_records(const uint8_t *pos, const uint8_t *end, uint64_t records,
+                        zone_contents_t *contents)
+{
+	for (uint64_t i = 0; i < records; i++) {
+		image_rec_t rec;
+		if (end - pos < sizeof(rec)) {
+			return KNOT_EMALF;
+		}
+		memcpy(&rec, pos, sizeof(rec));
+		pos += sizeof(rec);
+
+		int owner_size = knot_dname_wire_check(pos, end, NULL);
+		if (owner_size <= 0) {
+			return KNOT_EMALF;
+		}
+		const knot_dname_t *owner = pos;
+		pos += owner_size + padding(sizeof(rec) + owner_size);
+
+		if (pos > end || end - pos < rec.size) {
+			return KNOT_EMALF;
+		}
+
+		knot_rrset_t rrset;
+		knot_rrset_init(&rrset, (knot_dname_t *)owner, rec.type,
+		                KNOT_CLASS_IN, rec.ttl);
+		rrset.rrs.count = rec.count;
+		rrset.rrs.size = rec.size;
+		rrset.rrs.rdata = (knot_rdata_t *)pos;
+		if (rec.count == 0 || !check_rdataset(&rrset.rrs)) {
+			return KNOT_EMALF;
+		}
+		pos += rec.size + padding(rec.size);
+
+		zone_node_t *unused = NULL;
+		int ret = zone_contents_add_rr(contents, &rrset, &unused);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
+	return (pos == end) ? KNOT_EOK : KNOT_EMALF;
+}
+
+int zone_image_load(const char *path, const char *zonefile,
+                    const knot_dname_t *origin, zone_contents_t **contents)
+{
+	if (path == NULL || zonefile == NULL || origin == NULL || contents == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	struct stat zf_st;
+	if (stat(zonefile, &zf_st) < 0) {
+		return knot_map_errno();
+	}
+
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return knot_map_errno();
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) < 0) {
+		int ret = knot_map_errno();
+		close(fd);
+		return ret;
+	}
+	if (st.st_size < sizeof(image_hdr_t)) {
+		close(fd);
+		return KNOT_EMALF;
+	}
+
+	void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		return knot_map_errno();
+	}
+	(void)madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+	const uint8_t *pos = map, *end = pos + st.st_size;
+	image_hdr_t hdr;
+	memcpy(&hdr, pos, sizeof(hdr));
+
+	int ret = KNOT_EOK;
+	if (memcmp(hdr.magic, IMAGE_MAGIC, sizeof(hdr.magic)) != 0 ||
+	    hdr.order != IMAGE_ORDER) {
+		ret = KNOT_EMALF;
+	} else if (hdr.mtime_sec != zf_st.st_mtim.tv_sec ||
+	           hdr.mtime_nsec != zf_st.st_mtim.tv_nsec ||
+	           hdr.file_size != zf_st.st_size) {
+		ret = KNOT_ENOENT;
+	}
+	if (ret != KNOT_EOK) {
+		munmap(map, st.st_size);
+		return ret;
+	}
+
+	zone_contents_t *z = zone_contents_new(origin, true);
+	if (z == NULL) {
+		munmap(map, st.st_size);
+		return KNOT_ENOMEM;
+	}
+
+	ret = load_records(pos + sizeof(hdr), end, hdr.records, z);
+	munmap(map, st.st_size);
+	if (ret == KNOT_EOK &&
+	    (!node_rrtype_exists(z->apex, KNOT_RRTYPE_SOA) ||
+	     zone_contents_serial(z) != hdr.serial)) {
+		ret = KNOT_EMALF;
+	}
+	if (ret != KNOT_EOK) {
+		zone_contents_deep_free(z);
+		return ret;
+	}
+
+	*contents = z;
+
+	return KNOT_EOK;
+}
@@ -0,0 +1,61 @@
+/*  Copyright (C) 2021 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "knot/zone/contents.h"
+
+/*!
+ * \brief Returns the zone image file name for the zone file.
+ *
+ * \note The result must be explicitly deallocated.
+ */
+char *zone_image_path(const char *zonefile);
+
+/*!
+ * \brief Writes the zone contents into a binary zone image.
+ *
+ * The image is bound to the current modification time and size of the zone
+ * file, which the contents must correspond to.
+ *
+ * \param path      Zone image file name.
+ * \param zonefile  Corresponding zone file name.
+ * \param mtime     Zone file modification time the contents correspond to.
+ * \param contents  Zone contents to be stored.
+ *
+ * \retval KNOT_EOK     if success.
+ * \retval KNOT_EAGAIN  if the zone file was modified meanwhile.
+ * \retval KNOT_E*      if other error.
+ */
+int zone_image_write(const char *path, const char *zonefile,
+                     const struct timespec *mtime,
+                     const zone_contents_t *contents);
+
+/*!
+ * \brief Loads the zone contents from a binary zone image.
+ *
+ * \param path      Zone image file name.
+ * \param zonefile  Corresponding zone file name.
+ * \param origin    Zone name.
+ * \param contents  Output zone contents.
+ *
+ * \retval KNOT_EOK     if success.
+ * \retval KNOT_ENOENT  if no image or the image doesn't match the zone file.
+ * \retval KNOT_EMALF   if malformed image.
+ * \retval KNOT_E*      if other error.
+ */
+int zone_image_load(const char *path, const char *zonefile,
+                    const knot_dname_t *origin, zone_contents_t **contents);
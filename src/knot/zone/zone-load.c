@@ -18,6 +18,7 @@
 #include "knot/journal/journal_metadata.h"
 #include "knot/journal/journal_read.h"
 #include "knot/zone/zone-diff.h"
+#include "knot/zone/zone-image.h"
 #include "knot/zone/zone-load.h"
 #include "knot/zone/zonefile.h"
 #include "knot/dnssec/key-events.h"
@@ -49,6 +50,9 @@ int zone_load_contents(conf_t *conf, const knot_dname_t *zone_name,
 	zl.err_handler = &handler;
 	zl.creator->master = !zone_load_can_bootstrap(conf, zone_name);
 
+	val = conf_zone_get(conf, C_ADJUST_THR, zone_name);
+	zl.threads = conf_int(&val);
+
 	*contents = zonefile_load(&zl);
 	zonefile_close(&zl);
 	if (*contents == NULL) {
@@ -61,6 +65,76 @@ int zone_load_contents(conf_t *conf, const knot_dname_t *zone_name,
 	return KNOT_EOK;
 }
 
+int zone_load_image(conf_t *conf, const knot_dname_t *zone_name,
+                    zone_contents_t **contents)
+{
+	if (conf == NULL || zone_name == NULL || contents == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	conf_val_t val = conf_zone_get(conf, C_ZONEFILE_IMAGE, zone_name);
+	if (!conf_bool(&val)) {
+		return KNOT_ENOENT;
+	}
+
+	char *zonefile = conf_zonefile(conf, zone_name);
+	char *image = zone_image_path(zonefile);
+	if (image == NULL) {
+		free(zonefile);
+		return KNOT_ENOMEM;
+	}
+
+	int ret = zone_image_load(image, zonefile, zone_name, contents);
+	switch (ret) {
+	case KNOT_EOK:
+		log_zone_info(zone_name, "zone image '%s' loaded", image);
+		break;
+	case KNOT_ENOENT:
+		break;
+	default:
+		log_zone_warning(zone_name, "failed to load zone image '%s' (%s)",
+		                 image, knot_strerror(ret));
+		ret = KNOT_ENOENT;
+		break;
+	}
+
+	free(image);
+	free(zonefile);
+
+	return ret;
+}
+
+int zone_store_image(conf_t *conf, const knot_dname_t *zone_name,
+                     const struct timespec *mtime, const zone_contents_t *contents)
+{
+	if (conf == NULL || zone_name == NULL || mtime == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	conf_val_t val = conf_zone_get(conf, C_ZONEFILE_IMAGE, zone_name);
+	if (!conf_bool(&val)) {
+		return KNOT_EOK;
+	}
+
+	char *zonefile = conf_zonefile(conf, zone_name);
+	char *image = zone_image_path(zonefile);
+	if (image == NULL) {
+		free(zonefile);
+		return KNOT_ENOMEM;
+	}
+
+	int ret = zone_image_write(image, zonefile, mtime, contents);
+	if (ret != KNOT_EOK) {
+		log_zone_warning(zone_name, "failed to write zone image '%s' (%s)",
+		                 image, knot_strerror(ret));
+	}
+
+	free(image);
+	free(zonefile);
+
+	return ret;
+}
+
 static int apply_one_cb(bool remove, const knot_rrset_t *rr, void *ctx)
 {
 	zone_node_t *unused = NULL;
@@ -34,6 +34,33 @@
 int zone_load_contents(conf_t *conf, const knot_dname_t *zone_name,
                        zone_contents_t **contents, bool fail_on_warning);
 
+/*!
+ * \brief Load zone contents from the zone image if configured and up-to-date.
+ *
+ * \param conf
+ * \param zone_name
+ * \param contents
+ *
+ * \retval KNOT_EOK     if success.
+ * \retval KNOT_ENOENT  if no usable zone image, the zone file is to be parsed.
+ * \retval KNOT_E*      if error.
+ */
+int zone_load_image(conf_t *conf, const knot_dname_t *zone_name,
+                    zone_contents_t **contents);
+
+/*!
+ * \brief Store zone contents into the zone image if configured.
+ *
+ * \param conf
+ * \param zone_name
+ * \param mtime      Modification time of the zone file the contents correspond to.
+ * \param contents
+ *
+ * \return KNOT_EOK or an error
+ */
+int zone_store_image(conf_t *conf, const knot_dname_t *zone_name,
+                     const struct timespec *mtime, const zone_contents_t *contents);
+
 /*!
  * \brief Update zone contents from the journal.
  *
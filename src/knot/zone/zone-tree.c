@@ -16,12 +16,16 @@
 
 #include <assert.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "knot/zone/zone-tree.h"
 #include "libknot/consts.h"
 #include "libknot/errcode.h"
 #include "libknot/packet/wire.h"
 
+/*! \brief Number of subtrees per thread for dynamic load balancing. */
+#define SPLIT_PARTS_PER_THREAD 16
+
 typedef struct {
 	zone_tree_apply_cb_t func;
 	void *data;
@@ -318,6 +322,83 @@ int zone_tree_sub_apply(zone_tree_t *tree, const knot_dname_t *sub_root,
 	return ret;
 }
 
+int zone_tree_split_init(zone_tree_t *tree, unsigned threads, zone_tree_split_t *split)
+{
+	if (split == NULL || threads == 0) {
+		return KNOT_EINVAL;
+	}
+
+	memset(split, 0, sizeof(*split));
+	split->tree = tree;
+	knot_spin_init(&split->lock);
+
+	if (zone_tree_is_empty(tree)) {
+		return KNOT_EOK;
+	}
+
+	size_t parts = (size_t)threads * SPLIT_PARTS_PER_THREAD;
+	split->subs = malloc(parts * sizeof(*split->subs));
+	if (split->subs == NULL) {
+		knot_spin_destroy(&split->lock);
+		return KNOT_ENOMEM;
+	}
+	split->count = trie_split(tree->trie, split->subs, parts);
+
+	return KNOT_EOK;
+}
+
+int zone_tree_split_apply(zone_tree_split_t *split, zone_tree_apply_cb_t function, void *data)
+{
+	if (split == NULL || function == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	if (zone_tree_is_empty(split->tree)) {
+		return KNOT_EOK;
+	}
+
+	zone_tree_func_t f = {
+		.func = function,
+		.data = data,
+		.binode_second = ((split->tree->flags & ZONE_TREE_BINO_SECOND) ? 1 : 0),
+	};
+
+	int ret = KNOT_EOK;
+	while (ret == KNOT_EOK) {
+		knot_spin_lock(&split->lock);
+		size_t i = split->next;
+		if (i < split->count) {
+			split->next++;
+		}
+		knot_spin_unlock(&split->lock);
+
+		if (i >= split->count) {
+			break;
+		}
+		ret = trie_sub_apply(split->subs[i], tree_apply_cb, &f);
+	}
+
+	// Don't let the other threads continue after a failure.
+	if (ret != KNOT_EOK) {
+		knot_spin_lock(&split->lock);
+		split->next = split->count;
+		knot_spin_unlock(&split->lock);
+	}
+
+	return ret;
+}
+
+void zone_tree_split_deinit(zone_tree_split_t *split)
+{
+	if (split == NULL) {
+		return;
+	}
+
+	free(split->subs);
+	knot_spin_destroy(&split->lock);
+	memset(split, 0, sizeof(*split));
+}
+
 int zone_tree_it_begin(zone_tree_t *tree, zone_tree_it_t *it)
 {
 	return zone_tree_it_double_begin(tree, NULL, it);
@@ -17,6 +17,7 @@
 #pragma once
 
 #include "contrib/qp-trie/trie.h"
+#include "contrib/spinlock.h"
 #include "contrib/ucw/lists.h"
 #include "knot/zone/node.h"
 
@@ -52,6 +53,20 @@ typedef struct {
 	knot_dname_t *sub_root;
 } zone_tree_it_t;
 
+/*!
+ * \brief Zone tree split into disjoint subtrees for parallel processing.
+ *
+ * The subtrees are handed out to the processing threads one by one on demand,
+ * so each node is visited exactly once and the load is balanced dynamically.
+ */
+typedef struct {
+	zone_tree_t *tree;
+	trie_sub_t **subs;
+	size_t count;
+	size_t next;
+	knot_spin_t lock;
+} zone_tree_split_t;
+
 typedef struct {
 	zone_node_t **nodes;
 	size_t total;
@@ -235,6 +250,38 @@ int zone_tree_apply(zone_tree_t *tree, zone_tree_apply_cb_t function, void *data
 int zone_tree_sub_apply(zone_tree_t *tree, const knot_dname_t *sub_root,
                         bool excl_root, zone_tree_apply_cb_t function, void *data);
 
+/*!
+ * \brief Split the zone tree into subtrees for parallel processing.
+ *
+ * \note The tree must not be modified until the split is deinitialized.
+ *
+ * \param tree      Zone tree to be split.
+ * \param threads   Number of threads that will process the subtrees.
+ * \param split     Out: split context.
+ *
+ * \return KNOT_EOK, KNOT_EINVAL, KNOT_ENOMEM
+ */
+int zone_tree_split_init(zone_tree_t *tree, unsigned threads, zone_tree_split_t *split);
+
+/*!
+ * \brief Applies given function to each node of the subtrees not yet processed.
+ *
+ * Intended to be called from each of the processing threads. It takes
+ * the remaining subtrees one by one until all of them are processed.
+ *
+ * \param split       Split context.
+ * \param function    Callback to be applied.
+ * \param data        Callback context.
+ *
+ * \return KNOT_E*
+ */
+int zone_tree_split_apply(zone_tree_split_t *split, zone_tree_apply_cb_t function, void *data);
+
+/*!
+ * \brief Deinitialize the split context.
+ */
+void zone_tree_split_deinit(zone_tree_split_t *split);
+
 /*!
  * \brief Start zone tree iteration.
  *
@@ -32,6 +32,7 @@
 #include "knot/zone/contents.h"
 #include "knot/zone/serial.h"
 #include "knot/zone/zone.h"
+#include "knot/zone/zone-load.h"
 #include "knot/zone/zonefile.h"
 #include "libknot/libknot.h"
 #include "contrib/sockaddr.h"
@@ -129,6 +130,8 @@ static int flush_journal(conf_t *conf, zone_t *zone, bool allow_empty_zone, bool
 
 	free(zonefile);
 
+	(void)zone_store_image(conf, zone->name, &st.st_mtim, contents);
+
 	/* Update zone file attributes. */
 	zone->zonefile.exists = true;
 	zone->zonefile.mtime = st.st_mtim;
@@ -100,6 +100,9 @@ typedef struct zone
 	/*! \brief Query modules. */
 	list_t query_modules;
 	struct query_plan *query_plan;
+
+	/*! \brief Response cache size limit (0 if disabled). */
+	size_t resp_cache_max_size;
 } zone_t;
 
 /*!
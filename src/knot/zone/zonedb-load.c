@@ -64,6 +64,12 @@ static void zone_get_catalog_group(conf_t *conf, zone_t *zone)
 	}
 }
 
+static void zone_get_resp_cache(conf_t *conf, zone_t *zone)
+{
+	conf_val_t val = conf_zone_get(conf, C_RESP_CACHE_MAX_SIZE, zone->name);
+	zone->resp_cache_max_size = conf_int(&val);
+}
+
 static zone_t *create_zone_from(const knot_dname_t *name, server_t *server)
 {
 	zone_t *zone = zone_new(name);
@@ -210,6 +216,7 @@ static zone_t *create_zone(conf_t *conf, const knot_dname_t *name, server_t *ser
 
 	if (z != NULL) {
 		zone_get_catalog_group(conf, z);
+		zone_get_resp_cache(conf, z);
 	}
 
 	return z;
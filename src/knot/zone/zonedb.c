@@ -135,12 +135,21 @@ zone_t **knot_zonedb_find_ptr(knot_zonedb_t *db, const knot_dname_t *zone_name)
 	return (zone_t **)val;
 }
 
-zone_t *knot_zonedb_find_suffix(knot_zonedb_t *db, const knot_dname_t *zone_name)
+/*! \brief Check if the lookup format prefix ends at a label boundary of the name. */
+static bool lf_label_boundary(const knot_dname_t *name, uint8_t lf_len, uint32_t prefix_len)
 {
-	if (db == NULL || zone_name == NULL) {
-		return NULL;
+	uint32_t suffix_len = lf_len;
+	while (suffix_len > prefix_len) {
+		suffix_len -= *name + 1;
+		name = knot_wire_next_label(name, NULL);
 	}
 
+	return suffix_len == prefix_len;
+}
+
+/*! \brief Find the zone by looking up the name suffixes one by one. */
+static zone_t *find_suffix_labels(knot_zonedb_t *db, const knot_dname_t *zone_name)
+{
 	while (true) {
 		knot_dname_storage_t lf_storage;
 		uint8_t *lf = knot_dname_lf(zone_name, lf_storage);
@@ -157,6 +166,31 @@ zone_t *knot_zonedb_find_suffix(knot_zonedb_t *db, const knot_dname_t *zone_name
 	}
 }
 
+zone_t *knot_zonedb_find_suffix(knot_zonedb_t *db, const knot_dname_t *zone_name)
+{
+	if (db == NULL || zone_name == NULL) {
+		return NULL;
+	}
+
+	knot_dname_storage_t lf_storage;
+	uint8_t *lf = knot_dname_lf(zone_name, lf_storage);
+	assert(lf);
+
+	/* Zone names in the lookup format are prefixes of their subdomains. */
+	uint32_t prefix_len = 0;
+	trie_val_t *val = trie_get_lpm(db->trie, lf + 1, *lf, &prefix_len);
+	if (val == NULL) {
+		return NULL;
+	}
+
+	/* A zero byte inside a label can imitate a label separator. */
+	if (!lf_label_boundary(zone_name, *lf, prefix_len)) {
+		return find_suffix_labels(db, zone_name);
+	}
+
+	return *val;
+}
+
 size_t knot_zonedb_size(const knot_zonedb_t *db)
 {
 	if (db == NULL) {
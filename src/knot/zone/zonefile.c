@@ -24,9 +24,14 @@
 #include <time.h>
 #include <unistd.h>
 #include <inttypes.h>
+#include <pthread.h>
+#include <strings.h>
 
 #include "libknot/libknot.h"
 #include "contrib/files.h"
+#include "contrib/macros.h"
+#include "contrib/mempattern.h"
+#include "contrib/ucw/mempool.h"
 #include "knot/common/log.h"
 #include "knot/dnssec/zone-nsec.h"
 #include "knot/zone/semantic-check.h"
@@ -39,15 +44,29 @@
 #define WARNING(zone, fmt, ...) log_zone_warning(zone, "zone loader, " fmt, ##__VA_ARGS__)
 #define NOTICE(zone, fmt, ...) log_zone_notice(zone, "zone loader, " fmt, ##__VA_ARGS__)
 
+/*! \brief Minimal size of a zone file part parsed by one thread. */
+#define PART_SIZE_MIN		(1 << 20)
+/*! \brief Number of zone file parts per parsing thread. */
+#define PARTS_PER_THREAD	8
+
+static void log_parse_error(const knot_dname_t *zname, const char *file,
+                            uint64_t line, bool fatal, int code)
+{
+	ERROR(zname, "%s in zone, file '%s', line %"PRIu64" (%s)",
+	      fatal ? "fatal error" : "error", file, line, zs_strerror(code));
+}
+
+static void log_scanner_error(const knot_dname_t *zname, zs_scanner_t *s)
+{
+	log_parse_error(zname, s->file.name, s->line_counter, s->error.fatal,
+	                s->error.code);
+}
+
 static void process_error(zs_scanner_t *s)
 {
 	zcreator_t *zc = s->process.data;
-	const knot_dname_t *zname = zc->z->apex->owner;
 
-	ERROR(zname, "%s in zone, file '%s', line %"PRIu64" (%s)",
-	      s->error.fatal ? "fatal error" : "error",
-	      s->file.name, s->line_counter,
-	      zs_strerror(s->error.code));
+	log_scanner_error(zc->z->apex->owner, s);
 }
 
 static bool handle_err(zcreator_t *zc, const knot_rrset_t *rr, int ret, bool master)
@@ -75,6 +94,19 @@ static bool handle_err(zcreator_t *zc, const knot_rrset_t *rr, int ret, bool mas
 	}
 }
 
+static int zcreator_add(zcreator_t *zc, const knot_rrset_t *rr, zone_node_t **node)
+{
+	int ret = zone_contents_add_rr(zc->z, rr, node);
+	if (ret != KNOT_EOK) {
+		if (!handle_err(zc, rr, ret, zc->master)) {
+			// Fatal error
+			return ret;
+		}
+	}
+
+	return KNOT_EOK;
+}
+
 int zcreator_step(zcreator_t *zc, const knot_rrset_t *rr)
 {
 	if (zc == NULL || rr == NULL || rr->rrs.count != 1) {
@@ -88,15 +120,71 @@ int zcreator_step(zcreator_t *zc, const knot_rrset_t *rr)
 	}
 
 	zone_node_t *node = NULL;
-	int ret = zone_contents_add_rr(zc->z, rr, &node);
-	if (ret != KNOT_EOK) {
-		if (!handle_err(zc, rr, ret, zc->master)) {
-			// Fatal error
+	return zcreator_add(zc, rr, &node);
+}
+
+int zcreator_batch(zcreator_t *zc, const knot_rrset_t *rr)
+{
+	if (zc == NULL || rr == NULL || rr->rrs.count != 1) {
+		return KNOT_EINVAL;
+	}
+
+	knot_rrset_t *batch = &zc->batch;
+	if (batch->owner != NULL &&
+	    (batch->type != rr->type || batch->ttl != rr->ttl ||
+	     !knot_dname_is_equal(batch->owner, rr->owner))) {
+		int ret = zcreator_flush(zc);
+		if (ret != KNOT_EOK) {
 			return ret;
 		}
 	}
 
-	return KNOT_EOK;
+	// SOA presence is checked by the callers, so no batching.
+	if (rr->type == KNOT_RRTYPE_SOA) {
+		return zcreator_step(zc, rr);
+	}
+
+	if (batch->owner == NULL) {
+		knot_dname_t *owner = knot_dname_copy(rr->owner, NULL);
+		if (owner == NULL) {
+			return KNOT_ENOMEM;
+		}
+		knot_rrset_init(batch, owner, rr->type, rr->rclass, rr->ttl);
+		zc->batch_capacity = 0;
+	}
+
+	return knot_rdataset_append(&batch->rrs, &zc->batch_capacity,
+	                            rr->rrs.rdata, NULL);
+}
+
+int zcreator_flush(zcreator_t *zc)
+{
+	if (zc == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	if (zc->batch.owner == NULL) {
+		return KNOT_EOK;
+	}
+
+	zone_node_t *node = NULL;
+	int ret = knot_rdataset_sort(&zc->batch.rrs, NULL);
+	if (ret == KNOT_EOK) {
+		ret = zcreator_add(zc, &zc->batch, &node);
+	}
+	zcreator_clear(zc);
+
+	return ret;
+}
+
+void zcreator_clear(zcreator_t *zc)
+{
+	if (zc == NULL) {
+		return;
+	}
+
+	knot_rrset_clear(&zc->batch, NULL);
+	zc->batch_capacity = 0;
 }
 
 /*! \brief Creates RR from parser input, passes it to handling function. */
@@ -132,10 +220,503 @@ static void process_data(zs_scanner_t *scanner)
 		return;
 	}
 
-	zc->ret = zcreator_step(zc, &rr);
+	zc->ret = zcreator_batch(zc, &rr);
 	knot_rrset_clear(&rr, NULL);
 }
 
+/*! \brief Parsed records of the same owner, type, and TTL in a row, waiting for insertion. */
+typedef struct zrecord {
+	struct zrecord *next;
+	knot_rdataset_t rrs;    /*!< Records in the canonical order once the part is parsed. */
+	size_t capacity;        /*!< Allocated size of the rdata array. */
+	uint32_t ttl;
+	uint16_t type;
+	uint16_t rclass;
+	knot_dname_t owner[];
+} zrecord_t;
+
+/*! \brief Parsing error waiting for logging. */
+typedef struct zerror {
+	struct zerror *next;
+	uint64_t line;
+	int code;
+	bool fatal;
+} zerror_t;
+
+/*! \brief Zone file part parsed by one thread. */
+typedef struct {
+	const char *start;      /*!< Part beginning, always an owner at a line start. */
+	const char *end;        /*!< Part end. */
+	const char *origin;     /*!< Last $ORIGIN directive before the part (or NULL). */
+	size_t origin_len;      /*!< Length of the $ORIGIN directive. */
+	const char *ttl;        /*!< Last $TTL directive before the part (or NULL). */
+	size_t ttl_len;         /*!< Length of the $TTL directive. */
+	uint64_t line;          /*!< Line number of the part beginning. */
+	knot_mm_t mm;           /*!< Memory context for the parsed records. */
+	knot_rdata_t *rdata;    /*!< Buffer for the record being processed. */
+	zrecord_t *first;       /*!< First parsed record. */
+	zrecord_t *last;        /*!< Last parsed record. */
+	zerror_t *first_error;  /*!< First parsing error. */
+	zerror_t *last_error;   /*!< Last parsing error. */
+	uint64_t errors;        /*!< Number of parsing errors. */
+	int ret;                /*!< Processing return value. */
+	bool done;              /*!< Indication of the finished parsing. */
+} zpart_t;
+
+/*! \brief Context of the parallel zone file parsing. */
+typedef struct {
+	const char *source;     /*!< Zone file name. */
+	const char *origin;     /*!< Zone origin in the textual form. */
+	zpart_t *parts;         /*!< Zone file parts. */
+	size_t count;           /*!< Number of the parts. */
+	size_t next;            /*!< Next part to be parsed. */
+	size_t inserted;        /*!< Number of parts inserted into the zone. */
+	size_t window;          /*!< Maximum number of parsed parts not inserted yet. */
+	bool stop;              /*!< Indication of a fatal error. */
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+} zparallel_t;
+
+static bool is_directive(const char *pos, const char *end, const char *name)
+{
+	size_t len = strlen(name);
+	return (end - pos > len && strncasecmp(pos, name, len) == 0 &&
+	        (pos[len] == ' ' || pos[len] == '\t'));
+}
+
+/*! \brief Checks if the $ORIGIN directive contains an absolute domain name. */
+static bool is_absolute_origin(const char *pos, const char *end)
+{
+	pos += strlen("$ORIGIN");
+	while (pos < end && (*pos == ' ' || *pos == '\t')) {
+		pos++;
+	}
+
+	const char *last = NULL;
+	while (pos < end && strchr(" \t\r\n;", *pos) == NULL) {
+		if (*pos == '\\' && pos + 1 < end) {
+			pos++;
+			last = NULL;
+		} else {
+			last = pos;
+		}
+		pos++;
+	}
+
+	return (last != NULL && *last == '.');
+}
+
+/*!
+ * \brief Splits the zone file into parts which can be parsed independently.
+ *
+ * A part always begins at a line with an explicit owner outside of any
+ * multi-line record. The last $ORIGIN and $TTL directives preceding the part
+ * are stored so that the part scanner can start in the same state. Relative
+ * $ORIGIN directives depend on the preceding ones, so they aren't supported.
+ *
+ * \return Number of the parts or 0 if the file cannot be split.
+ */
+static size_t split_parts(const char *start, const char *end, zpart_t *parts,
+                          size_t max_parts)
+{
+	const size_t part_size = (end - start) / max_parts;
+
+	const char *origin = NULL, *ttl = NULL, *directive = NULL;
+	size_t origin_len = 0, ttl_len = 0;
+	const char **directive_pos = NULL;
+	size_t *directive_len = NULL;
+
+	size_t count = 1;
+	parts[0] = (zpart_t) { .start = start, .line = 1 };
+	const char *next_split = start + part_size;
+
+	uint64_t line = 1;
+	unsigned depth = 0;
+	bool line_start = true;
+	bool quoted = false;
+	for (const char *pos = start; pos < end; pos++) {
+		if (line_start) {
+			line_start = false;
+			if (*pos == '$') {
+				if (is_directive(pos, end, "$ORIGIN")) {
+					if (!is_absolute_origin(pos, end)) {
+						return 0;
+					}
+					directive_pos = &origin;
+					directive_len = &origin_len;
+				} else if (is_directive(pos, end, "$TTL")) {
+					directive_pos = &ttl;
+					directive_len = &ttl_len;
+				} else {
+					// $INCLUDE or unknown directive.
+					return 0;
+				}
+				directive = pos;
+			} else if (pos >= next_split && count < max_parts &&
+			           strchr(" \t\r\n;()\"", *pos) == NULL) {
+				parts[count - 1].end = pos;
+				parts[count++] = (zpart_t) {
+					.start = pos,
+					.origin = origin,
+					.origin_len = origin_len,
+					.ttl = ttl,
+					.ttl_len = ttl_len,
+					.line = line
+				};
+				next_split = pos + part_size;
+			}
+		}
+
+		switch (*pos) {
+		case '\\':
+			if (pos + 1 < end && pos[1] != '\n') {
+				pos++;
+			}
+			break;
+		case '"':
+			quoted = !quoted;
+			break;
+		case ';':
+			if (!quoted) {
+				while (pos + 1 < end && pos[1] != '\n') {
+					pos++;
+				}
+			}
+			break;
+		case '(':
+			depth += quoted ? 0 : 1;
+			break;
+		case ')':
+			if (!quoted && depth > 0) {
+				depth--;
+			}
+			break;
+		case '\n':
+			line++;
+			if (depth == 0 && !quoted) {
+				line_start = true;
+				if (directive != NULL) {
+					*directive_pos = directive;
+					*directive_len = pos + 1 - directive;
+					directive = NULL;
+				}
+			}
+			break;
+		default:
+			break;
+		}
+	}
+	parts[count - 1].end = end;
+
+	return count;
+}
+
+/*!
+ * \brief Stores the parsing error, the errors are logged in the file order
+ *        by the loading thread.
+ */
+static void process_part_error(zs_scanner_t *s)
+{
+	zpart_t *part = s->process.data;
+
+	zerror_t *err = mm_alloc(&part->mm, sizeof(*err));
+	if (err == NULL) {
+		part->ret = KNOT_ENOMEM;
+		s->state = ZS_STATE_STOP;
+		return;
+	}
+	*err = (zerror_t) {
+		.line = s->line_counter,
+		.code = s->error.code,
+		.fatal = s->error.fatal
+	};
+
+	if (part->last_error == NULL) {
+		part->first_error = err;
+	} else {
+		part->last_error->next = err;
+	}
+	part->last_error = err;
+}
+
+static bool same_rrset(const zrecord_t *rec, const zs_scanner_t *scanner)
+{
+	// SOA presence is checked on insertion, so no batching.
+	return rec != NULL && rec->type == scanner->r_type &&
+	       rec->type != KNOT_RRTYPE_SOA && rec->ttl == scanner->r_ttl &&
+	       rec->rclass == scanner->r_class &&
+	       knot_dname_is_case_equal(rec->owner, scanner->r_owner);
+}
+
+static void process_part_data(zs_scanner_t *scanner)
+{
+	zpart_t *part = scanner->process.data;
+	if (part->ret != KNOT_EOK) {
+		scanner->state = ZS_STATE_STOP;
+		return;
+	}
+
+	zrecord_t *rec = part->last;
+	if (!same_rrset(rec, scanner)) {
+		rec = mm_alloc(&part->mm, sizeof(*rec) + scanner->r_owner_length);
+		if (rec == NULL) {
+			part->ret = KNOT_ENOMEM;
+			return;
+		}
+
+		memcpy(rec->owner, scanner->r_owner, scanner->r_owner_length);
+		rec->next = NULL;
+		knot_rdataset_init(&rec->rrs);
+		rec->capacity = 0;
+		rec->ttl = scanner->r_ttl;
+		rec->type = scanner->r_type;
+		rec->rclass = scanner->r_class;
+
+		if (part->last == NULL) {
+			part->first = rec;
+		} else {
+			part->last->next = rec;
+		}
+		part->last = rec;
+	}
+
+	/* Convert RDATA dnames to lowercase before adding to zone. */
+	knot_rdata_t *rdata = part->rdata;
+	knot_rdata_init(rdata, scanner->r_data_length, scanner->r_data);
+	knot_rrset_t rr;
+	knot_rrset_init(&rr, rec->owner, rec->type, rec->rclass, rec->ttl);
+	rr.rrs.count = 1;
+	rr.rrs.size = knot_rdata_size(rdata->len);
+	rr.rrs.rdata = rdata;
+	part->ret = knot_rrset_rr_to_canonical(&rr);
+	if (part->ret == KNOT_EOK) {
+		part->ret = knot_rdataset_append(&rec->rrs, &rec->capacity, rdata, &part->mm);
+	}
+}
+
+/*! \brief Sorts the parsed rdatasets, so they are inserted into the zone as they are. */
+static int sort_part(zpart_t *part)
+{
+	for (zrecord_t *rec = part->first; rec != NULL; rec = rec->next) {
+		int ret = knot_rdataset_sort(&rec->rrs, &part->mm);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
+	return KNOT_EOK;
+}
+
+static void parse_part(zparallel_t *ctx, zpart_t *part, zs_scanner_t *s)
+{
+	mm_ctx_mempool(&part->mm, 16 * MM_DEFAULT_BLKSIZE);
+	if (part->mm.ctx == NULL) {
+		part->ret = KNOT_ENOMEM;
+		return;
+	}
+	part->rdata = mm_alloc(&part->mm, knot_rdata_size(UINT16_MAX));
+	if (part->rdata == NULL) {
+		part->ret = KNOT_ENOMEM;
+		return;
+	}
+
+	if (zs_init(s, ctx->origin, KNOT_CLASS_IN, 3600) != 0 ||
+	    (part->ttl != NULL &&
+	     (zs_set_input_string(s, part->ttl, part->ttl_len) != 0 ||
+	      zs_parse_all(s) != 0)) ||
+	    (part->origin != NULL &&
+	     (zs_set_input_string(s, part->origin, part->origin_len) != 0 ||
+	      zs_parse_all(s) != 0))) {
+		// The directive error is reported by the part containing it.
+		part->errors = 1;
+		zs_deinit(s);
+		return;
+	}
+
+	if (zs_set_input_string(s, part->start, part->end - part->start) != 0 ||
+	    zs_set_processing(s, process_part_data, process_part_error, part) != 0) {
+		part->ret = KNOT_ENOMEM;
+		zs_deinit(s);
+		return;
+	}
+	s->line_counter = part->line;
+
+	(void)zs_parse_all(s);
+	part->errors = s->error.counter;
+	if (part->ret == KNOT_EOK && part->errors == 0) {
+		part->ret = sort_part(part);
+	}
+
+	zs_deinit(s);
+}
+
+static void *parse_parts_thread(void *data)
+{
+	zparallel_t *ctx = data;
+
+	zs_scanner_t *s = malloc(sizeof(*s));
+
+	while (true) {
+		pthread_mutex_lock(&ctx->lock);
+		while (!ctx->stop && ctx->next < ctx->count &&
+		       ctx->next >= ctx->inserted + ctx->window) {
+			pthread_cond_wait(&ctx->cond, &ctx->lock);
+		}
+		if (ctx->stop || ctx->next == ctx->count) {
+			pthread_mutex_unlock(&ctx->lock);
+			break;
+		}
+		zpart_t *part = &ctx->parts[ctx->next++];
+		pthread_mutex_unlock(&ctx->lock);
+
+		if (s != NULL) {
+			parse_part(ctx, part, s);
+		} else {
+			part->ret = KNOT_ENOMEM;
+		}
+
+		pthread_mutex_lock(&ctx->lock);
+		part->done = true;
+		pthread_cond_broadcast(&ctx->cond);
+		pthread_mutex_unlock(&ctx->lock);
+	}
+
+	free(s);
+
+	return NULL;
+}
+
+static int insert_part(zcreator_t *zc, zpart_t *part)
+{
+	const zrecord_t *prev = NULL;
+	bool prev_nsec3 = false;
+	zone_node_t *node = NULL;
+	for (zrecord_t *rec = part->first; rec != NULL; rec = rec->next) {
+		knot_rrset_t rr;
+		knot_rrset_init(&rr, rec->owner, rec->type, rec->rclass, rec->ttl);
+		rr.rrs = rec->rrs;
+
+		// Consecutive rdatasets of the same owner go into the same node.
+		bool nsec3 = knot_rrset_is_nsec3rel(&rr);
+		if (prev == NULL || prev->type == KNOT_RRTYPE_SOA || prev_nsec3 != nsec3 ||
+		    !knot_dname_is_equal(prev->owner, rec->owner)) {
+			node = NULL;
+		}
+		prev = rec;
+		prev_nsec3 = nsec3;
+
+		int ret = (rec->type == KNOT_RRTYPE_SOA) ? zcreator_step(zc, &rr) :
+		                                          zcreator_add(zc, &rr, &node);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
+	return KNOT_EOK;
+}
+
+/*!
+ * \brief Parses the zone file in parallel, records are inserted in the file order.
+ *
+ * The parts are parsed by the threads into lists of sorted rdatasets which
+ * are inserted into the zone by the calling thread, the number of parsed parts
+ * waiting for insertion is limited.
+ *
+ * \return Same as zs_parse_all() or 1 if the zone file isn't worth splitting.
+ */
+static int parse_parallel(zloader_t *loader, const char *origin)
+{
+	zs_scanner_t *s = &loader->scanner;
+	zcreator_t *zc = loader->creator;
+
+	size_t max_parts = (s->input.end - s->input.start) / PART_SIZE_MIN;
+	max_parts = MIN(max_parts, loader->threads * PARTS_PER_THREAD);
+	if (loader->threads <= 1 || max_parts <= 1) {
+		return 1;
+	}
+
+	zparallel_t ctx = {
+		.source = loader->source,
+		.origin = origin,
+		.parts = calloc(max_parts, sizeof(zpart_t))
+	};
+	if (ctx.parts == NULL) {
+		return 1;
+	}
+
+	ctx.count = split_parts(s->input.start, s->input.end, ctx.parts, max_parts);
+	if (ctx.count <= 1) {
+		free(ctx.parts);
+		return 1;
+	}
+
+	unsigned threads = MIN(loader->threads, ctx.count);
+	ctx.window = 2 * threads;
+	pthread_mutex_init(&ctx.lock, NULL);
+	pthread_cond_init(&ctx.cond, NULL);
+
+	pthread_t thread[threads];
+	unsigned started = 0;
+	for (; started < threads; started++) {
+		if (pthread_create(&thread[started], NULL, parse_parts_thread, &ctx) != 0) {
+			break;
+		}
+	}
+
+	uint64_t errors = 0;
+	for (size_t i = 0; i < ctx.count && started > 0; i++) {
+		zpart_t *part = &ctx.parts[i];
+
+		pthread_mutex_lock(&ctx.lock);
+		while (!part->done) {
+			pthread_cond_wait(&ctx.cond, &ctx.lock);
+		}
+		pthread_mutex_unlock(&ctx.lock);
+
+		for (zerror_t *err = part->first_error; err != NULL; err = err->next) {
+			log_parse_error(zc->z->apex->owner, ctx.source, err->line,
+			                err->fatal, err->code);
+		}
+		errors += part->errors;
+		if (part->ret != KNOT_EOK) {
+			zc->ret = part->ret;
+		} else if (errors == 0) {
+			zc->ret = insert_part(zc, part);
+		}
+		mp_delete(part->mm.ctx);
+		part->mm.ctx = NULL;
+
+		pthread_mutex_lock(&ctx.lock);
+		ctx.inserted++;
+		ctx.stop = (zc->ret != KNOT_EOK);
+		pthread_cond_broadcast(&ctx.cond);
+		pthread_mutex_unlock(&ctx.lock);
+
+		if (ctx.stop) {
+			break;
+		}
+	}
+
+	for (unsigned i = 0; i < started; i++) {
+		pthread_join(thread[i], NULL);
+	}
+	for (size_t i = 0; i < ctx.count; i++) {
+		mp_delete(ctx.parts[i].mm.ctx);
+	}
+
+	pthread_cond_destroy(&ctx.cond);
+	pthread_mutex_destroy(&ctx.lock);
+	free(ctx.parts);
+
+	if (started == 0) {
+		s->error.code = ZS_ENOMEM;
+		return -1;
+	}
+
+	s->error.counter += errors;
+	return (errors > 0) ? -1 : 0;
+}
+
 int zonefile_open(zloader_t *loader, const char *source,
                   const knot_dname_t *origin, semcheck_optional_t semantic_checks, time_t time)
 {
@@ -200,7 +781,20 @@ zone_contents_t *zonefile_load(zloader_t *loader)
 	const knot_dname_t *zname = zc->z->apex->owner;
 
 	assert(zc);
-	int ret = zs_parse_all(&loader->scanner);
+	int ret = 1;
+	if (loader->threads > 1) {
+		char *origin = knot_dname_to_str_alloc(zname);
+		if (origin != NULL) {
+			ret = parse_parallel(loader, origin);
+			free(origin);
+		}
+	}
+	if (ret > 0) {
+		ret = zs_parse_all(&loader->scanner);
+	}
+	if (zc->ret == KNOT_EOK) {
+		zc->ret = zcreator_flush(zc);
+	}
 	if (ret != 0 && loader->scanner.error.counter == 0) {
 		ERROR(zname, "failed to load zone, file '%s' (%s)",
 		      loader->source, zs_strerror(loader->scanner.error.code));
@@ -330,6 +924,7 @@ void zonefile_close(zloader_t *loader)
 
 	zs_deinit(&loader->scanner);
 	free(loader->source);
+	zcreator_clear(loader->creator);
 	free(loader->creator);
 }
 
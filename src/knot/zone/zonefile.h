@@ -1,4 +1,4 @@
-/*  Copyright (C) 2020 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+/*  Copyright (C) 2021 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
 
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU General Public License as published by
@@ -29,6 +29,8 @@ typedef struct zcreator {
 	zone_contents_t *z;  /*!< Created zone. */
 	bool master;         /*!< True if server is a primary master for the zone. */
 	int ret;             /*!< Return value. */
+	knot_rrset_t batch;  /*!< Consecutive RRs of one RRSet not inserted yet. */
+	size_t batch_capacity; /*!< Allocated size of the batch rdata. */
 } zcreator_t;
 
 /*!
@@ -41,6 +43,7 @@ typedef struct {
 	zcreator_t *creator;         /*!< Loader context. */
 	zs_scanner_t scanner;        /*!< Zone scanner. */
 	time_t time;                 /*!< time for zone check. */
+	unsigned threads;            /*!< Number of zone file parsing threads. */
 } zloader_t;
 
 void err_handler_logger(sem_handler_t *handler, const zone_contents_t *zone,
@@ -102,3 +105,32 @@ void zonefile_close(zloader_t *loader);
  * \return KNOT_E*
  */
 int zcreator_step(zcreator_t *zl, const knot_rrset_t *rr);
+
+/*!
+ * \brief Adds one RR into zone, consecutive RRs of one RRSet are inserted at once.
+ *
+ * The RR is inserted when the next RR belongs to another RRSet (or has
+ * another TTL), zcreator_flush() must be called after the last RR.
+ *
+ * \param zl  Zone loader.
+ * \param rr  RR to add.
+ *
+ * \return KNOT_E*
+ */
+int zcreator_batch(zcreator_t *zl, const knot_rrset_t *rr);
+
+/*!
+ * \brief Inserts the collected RRs into zone.
+ *
+ * \param zl  Zone loader.
+ *
+ * \return KNOT_E*
+ */
+int zcreator_flush(zcreator_t *zl);
+
+/*!
+ * \brief Drops the collected RRs without inserting them into zone.
+ *
+ * \param zl  Zone loader.
+ */
+void zcreator_clear(zcreator_t *zl);
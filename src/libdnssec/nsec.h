@@ -1,4 +1,4 @@
-/*  Copyright (C) 2020 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+/*  Copyright (C) 2021 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
 
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU General Public License as published by
@@ -106,6 +106,26 @@ int dnssec_nsec3_hash(const dnssec_binary_t *data,
 		      const dnssec_nsec3_params_t *params,
 		      dnssec_binary_t *hash);
 
+/*!
+ * Compute NSEC3 hash for given data into a caller provided buffer.
+ *
+ * Unlike \ref dnssec_nsec3_hash, no memory is allocated, which makes this
+ * variant suitable for hashing on the query processing path.
+ *
+ * \todo Input data must be converted to lowercase!
+ *
+ * \param[in]  data       Data to be hashed (usually domain name).
+ * \param[in]  params     NSEC3 parameters.
+ * \param[out] hash       Output buffer for the raw hash.
+ * \param[in]  hash_size  Size of the output buffer, at least
+ *                        \ref dnssec_nsec3_hash_length of the algorithm.
+ *
+ * \return Error code, DNSSEC_EOK if successful.
+ */
+int dnssec_nsec3_hash_raw(const dnssec_binary_t *data,
+			  const dnssec_nsec3_params_t *params,
+			  uint8_t *hash, size_t hash_size);
+
 /*!
  * Get length of raw NSEC3 hash for a given algorithm.
  *
@@ -1,4 +1,4 @@
-/*  Copyright (C) 2018 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+/*  Copyright (C) 2021 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
 
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU General Public License as published by
@@ -21,35 +21,27 @@
 
 #include "libdnssec/error.h"
 #include "libdnssec/nsec.h"
+#include "libdnssec/shared/dname.h"
+#include "libdnssec/shared/sha1.h"
 #include "libdnssec/shared/shared.h"
 
 /*!
- * Compute NSEC3 hash for given data and algorithm.
- *
- * \see RFC 5155
+ * Maximal size of the hashed input assembled on stack, enough for a domain
+ * name or a digest followed by the longest possible salt.
+ */
+#define NSEC3_INPUT_MAX (DNAME_MAX_LENGTH + UINT8_MAX)
+
+/*!
+ * Compute NSEC3 hash using an incremental digest context.
  *
- * \todo Input data should be converted to lowercase.
+ * Used only for inputs not fitting into the stack buffer.
  */
-static int nsec3_hash(gnutls_digest_algorithm_t algorithm, int iterations,
-		      const dnssec_binary_t *salt, const dnssec_binary_t *data,
-		      dnssec_binary_t *hash)
+static int nsec3_hash_ctx(gnutls_digest_algorithm_t algorithm, int iterations,
+			  const dnssec_binary_t *salt, const dnssec_binary_t *data,
+			  uint8_t *hash, size_t hash_size)
 {
-	assert(salt);
-	assert(data);
-	assert(hash);
-
-	int hash_size = gnutls_hash_get_len(algorithm);
-	if (hash_size <= 0) {
-		return DNSSEC_NSEC3_HASHING_ERROR;
-	}
-
-	int result = dnssec_binary_resize(hash, hash_size);
-	if (result != DNSSEC_EOK) {
-		return result;
-	}
-
 	_cleanup_hash_ gnutls_hash_hd_t digest = NULL;
-	result = gnutls_hash_init(&digest, algorithm);
+	int result = gnutls_hash_init(&digest, algorithm);
 	if (result < 0) {
 		return DNSSEC_NSEC3_HASHING_ERROR;
 	}
@@ -68,10 +60,76 @@ static int nsec3_hash(gnutls_digest_algorithm_t algorithm, int iterations,
 			return DNSSEC_NSEC3_HASHING_ERROR;
 		}
 
-		gnutls_hash_output(digest, hash->data);
+		gnutls_hash_output(digest, hash);
+
+		in = hash;
+		in_size = hash_size;
+	}
+
+	return DNSSEC_EOK;
+}
+
+/*!
+ * Compute digest in one shot, using the SHA extensions for SHA-1 if available.
+ */
+static int digest_fast(gnutls_digest_algorithm_t algorithm,
+		       const uint8_t *data, size_t size, uint8_t *hash)
+{
+	if (algorithm == GNUTLS_DIG_SHA1 && sha1_ni_available()) {
+		sha1_ni(data, size, hash);
+		return DNSSEC_EOK;
+	}
+
+	if (gnutls_hash_fast(algorithm, data, size, hash) < 0) {
+		return DNSSEC_NSEC3_HASHING_ERROR;
+	}
+
+	return DNSSEC_EOK;
+}
+
+/*!
+ * Compute NSEC3 hash for given data and algorithm into a raw buffer.
+ *
+ * The input and the salt are concatenated on stack and hashed in one shot,
+ * which avoids allocation of a digest context for each hash. With the SHA
+ * extensions, there is no digest context at all.
+ *
+ * \see RFC 5155
+ *
+ * \todo Input data should be converted to lowercase.
+ */
+static int nsec3_hash(gnutls_digest_algorithm_t algorithm, int iterations,
+		      const dnssec_binary_t *salt, const dnssec_binary_t *data,
+		      uint8_t *hash, size_t hash_size)
+{
+	assert(salt);
+	assert(data);
+	assert(hash);
+
+	uint8_t input[NSEC3_INPUT_MAX];
+	if (data->size + salt->size > sizeof(input) ||
+	    hash_size + salt->size > sizeof(input)) {
+		return nsec3_hash_ctx(algorithm, iterations, salt, data,
+				      hash, hash_size);
+	}
 
-		in = hash->data;
-		in_size = hash->size;
+	memcpy(input, data->data, data->size);
+	memcpy(input + data->size, salt->data, salt->size);
+	int result = digest_fast(algorithm, input, data->size + salt->size, hash);
+	if (result != DNSSEC_EOK) {
+		return result;
+	}
+
+	if (iterations > 0) {
+		memcpy(input + hash_size, salt->data, salt->size);
+	}
+
+	for (int i = 0; i < iterations; i++) {
+		memcpy(input, hash, hash_size);
+		result = digest_fast(algorithm, input, hash_size + salt->size, hash);
+		if (result != DNSSEC_EOK) {
+			return result;
+		}
 	}
 
 	return DNSSEC_EOK;
@@ -107,7 +165,47 @@ int dnssec_nsec3_hash(const dnssec_binary_t *data,
 		return DNSSEC_INVALID_NSEC3_ALGORITHM;
 	}
 
-	return nsec3_hash(algorithm, params->iterations, &params->salt, data, hash);
+	int hash_size = gnutls_hash_get_len(algorithm);
+	if (hash_size <= 0) {
+		return DNSSEC_NSEC3_HASHING_ERROR;
+	}
+
+	int result = dnssec_binary_resize(hash, hash_size);
+	if (result != DNSSEC_EOK) {
+		return result;
+	}
+
+	return nsec3_hash(algorithm, params->iterations, &params->salt, data,
+			  hash->data, hash->size);
+}
+
+/*!
+ * Compute NSEC3 hash for given data into a caller provided buffer.
+ */
+_public_
+int dnssec_nsec3_hash_raw(const dnssec_binary_t *data,
+			  const dnssec_nsec3_params_t *params,
+			  uint8_t *hash, size_t hash_size)
+{
+	if (!data || !params || !hash) {
+		return DNSSEC_EINVAL;
+	}
+
+	gnutls_digest_algorithm_t algorithm = algorithm_d2g(params->algorithm);
+	if (algorithm == GNUTLS_DIG_UNKNOWN) {
+		return DNSSEC_INVALID_NSEC3_ALGORITHM;
+	}
+
+	int digest_size = gnutls_hash_get_len(algorithm);
+	if (digest_size <= 0) {
+		return DNSSEC_NSEC3_HASHING_ERROR;
+	}
+	if (hash_size < (size_t)digest_size) {
+		return DNSSEC_EINVAL;
+	}
+
+	return nsec3_hash(algorithm, params->iterations, &params->salt, data,
+			  hash, digest_size);
 }
 
 /*!
@@ -0,0 +1,157 @@
+/*  Copyright (C) 2021 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "libdnssec/shared/sha1.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define ENABLE_SHA1_NI
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+#define SHA1_BLOCK_SIZE 64
+
+#ifdef ENABLE_SHA1_NI
+
+#define CPUID1_ECX_SSSE3  (1 << 9)
+#define CPUID1_ECX_SSE41  (1 << 19)
+#define CPUID7_EBX_SHA    (1 << 29)
+
+bool sha1_ni_available(void)
+{
+	static int available = -1;
+
+	int cached = __atomic_load_n(&available, __ATOMIC_RELAXED);
+	if (cached >= 0) {
+		return cached;
+	}
+
+	unsigned eax, ebx, ecx, edx;
+	bool result = __get_cpuid(1, &eax, &ebx, &ecx, &edx) &&
+	              (ecx & CPUID1_ECX_SSSE3) && (ecx & CPUID1_ECX_SSE41) &&
+	              __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) &&
+	              (ebx & CPUID7_EBX_SHA);
+
+	__atomic_store_n(&available, result, __ATOMIC_RELAXED);
+	return result;
+}
+
+/*!
+ * Four SHA-1 rounds (of eighty) on the message words 4g to 4g+3.
+ *
+ * The message schedule for the following rounds is computed meanwhile, the
+ * E values of the odd and even groups alternate.
+ */
+#define SHA1_NI_ROUNDS4(g) do { \
+	if ((g) < 4) { \
+		msg[g] = _mm_shuffle_epi8(_mm_loadu_si128( \
+		         (const __m128i *)(block + 16 * (g))), mask); \
+	} \
+	__m128i cur = msg[(g) % 4]; \
+	if ((g) == 0) { \
+		e[0] = _mm_add_epi32(e[0], cur); \
+	} else { \
+		e[(g) % 2] = _mm_sha1nexte_epu32(e[(g) % 2], cur); \
+	} \
+	e[((g) + 1) % 2] = abcd; \
+	if ((g) >= 3 && (g) <= 18) { \
+		msg[((g) + 1) % 4] = _mm_sha1msg2_epu32(msg[((g) + 1) % 4], cur); \
+	} \
+	abcd = _mm_sha1rnds4_epu32(abcd, e[(g) % 2], (g) / 5); \
+	if ((g) >= 1 && (g) <= 16) { \
+		msg[((g) + 3) % 4] = _mm_sha1msg1_epu32(msg[((g) + 3) % 4], cur); \
+	} \
+	if ((g) >= 2 && (g) <= 17) { \
+		msg[((g) + 2) % 4] = _mm_xor_si128(msg[((g) + 2) % 4], cur); \
+	} \
+} while (0)
+
+__attribute__((target("sha,sse4.1,ssse3")))
+static void sha1_ni_blocks(uint32_t state[5], const uint8_t *data, size_t blocks)
+{
+	const __m128i mask = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+
+	__m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)state), 0x1b);
+	__m128i e0 = _mm_set_epi32(state[4], 0, 0, 0);
+
+	for (const uint8_t *block = data; block < data + blocks * SHA1_BLOCK_SIZE;
+	     block += SHA1_BLOCK_SIZE) {
+		__m128i abcd_save = abcd;
+		__m128i msg[4];
+		__m128i e[2] = { e0 };
+
+		SHA1_NI_ROUNDS4(0);  SHA1_NI_ROUNDS4(1);  SHA1_NI_ROUNDS4(2);
+		SHA1_NI_ROUNDS4(3);  SHA1_NI_ROUNDS4(4);  SHA1_NI_ROUNDS4(5);
+		SHA1_NI_ROUNDS4(6);  SHA1_NI_ROUNDS4(7);  SHA1_NI_ROUNDS4(8);
+		SHA1_NI_ROUNDS4(9);  SHA1_NI_ROUNDS4(10); SHA1_NI_ROUNDS4(11);
+		SHA1_NI_ROUNDS4(12); SHA1_NI_ROUNDS4(13); SHA1_NI_ROUNDS4(14);
+		SHA1_NI_ROUNDS4(15); SHA1_NI_ROUNDS4(16); SHA1_NI_ROUNDS4(17);
+		SHA1_NI_ROUNDS4(18); SHA1_NI_ROUNDS4(19);
+
+		e0 = _mm_sha1nexte_epu32(e[0], e0);
+		abcd = _mm_add_epi32(abcd, abcd_save);
+	}
+
+	_mm_storeu_si128((__m128i *)state, _mm_shuffle_epi32(abcd, 0x1b));
+	state[4] = _mm_extract_epi32(e0, 3);
+}
+
+void sha1_ni(const uint8_t *data, size_t size, uint8_t digest[SHA1_DIGEST_SIZE])
+{
+	uint32_t state[5] = {
+		0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0
+	};
+
+	size_t blocks = size / SHA1_BLOCK_SIZE;
+	sha1_ni_blocks(state, data, blocks);
+
+	/* Padding and message length in bits (big endian). */
+	uint8_t last[2 * SHA1_BLOCK_SIZE] = { 0 };
+	size_t rest = size % SHA1_BLOCK_SIZE;
+	memcpy(last, data + blocks * SHA1_BLOCK_SIZE, rest);
+	last[rest] = 0x80;
+
+	size_t last_blocks = (rest + 1 + sizeof(uint64_t) <= SHA1_BLOCK_SIZE) ? 1 : 2;
+	uint64_t bits = (uint64_t)size * 8;
+	for (size_t i = 0; i < sizeof(uint64_t); i++) {
+		last[last_blocks * SHA1_BLOCK_SIZE - 1 - i] = bits >> (8 * i);
+	}
+	sha1_ni_blocks(state, last, last_blocks);
+
+	for (int i = 0; i < 5; i++) {
+		digest[4 * i]     = state[i] >> 24;
+		digest[4 * i + 1] = state[i] >> 16;
+		digest[4 * i + 2] = state[i] >> 8;
+		digest[4 * i + 3] = state[i];
+	}
+}
+
+#else
+
+bool sha1_ni_available(void)
+{
+	return false;
+}
+
+void sha1_ni(const uint8_t *data, size_t size, uint8_t digest[SHA1_DIGEST_SIZE])
+{
+	assert(0);
+}
+
+#endif
@@ -0,0 +1,42 @@
+/*  Copyright (C) 2021 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/*!
+ * Size of SHA-1 digest.
+ */
+#define SHA1_DIGEST_SIZE 20
+
+/*!
+ * Check if SHA-1 can be computed using the x86 SHA extensions (SHA-NI).
+ *
+ * The check is done once, the result is cached.
+ */
+bool sha1_ni_available(void);
+
+/*!
+ * Compute SHA-1 digest using the x86 SHA extensions.
+ *
+ * The whole computation state is kept on stack, there is no context.
+ *
+ * \note Must be called only if \ref sha1_ni_available.
+ */
+void sha1_ni(const uint8_t *data, size_t size, uint8_t digest[SHA1_DIGEST_SIZE]);
@@ -63,6 +63,30 @@ typedef struct {
 	uint16_t compress_ptr[KNOT_COMPR_HINT_COUNT]; /* Array of compr. ptr hints. */
 } knot_rrinfo_t;
 
+/*! \brief Name suffix dictionary dimensions. */
+enum knot_compr_dict_size {
+	KNOT_COMPR_DICT_ENTRIES = 4096, /* Maximum number of stored suffixes. */
+	KNOT_COMPR_DICT_SLOTS   = 8192  /* Hash table size (power of two). */
+};
+
+/*!
+ * \brief Dictionary of name suffixes written to the packet.
+ *
+ * Each written label is stored as a suffix identified by the label position
+ * and by the position of the following (already stored) suffix. A name is
+ * then matched from the root label towards the leftmost label, one lookup per
+ * label, finding the longest earlier occurrence of any of its suffixes.
+ */
+typedef struct {
+	uint16_t count;                          /* Number of entries. */
+	uint16_t order[KNOT_COMPR_DICT_ENTRIES]; /* Used slots in insertion order. */
+	struct {
+		uint16_t pos;    /* Label position in the packet (0 if empty). */
+		uint16_t parent; /* Position of the following suffix (0 if root). */
+		uint16_t tag;    /* Hash bits not used for the slot index. */
+	} slots[KNOT_COMPR_DICT_SLOTS];
+} knot_compr_dict_t;
+
 /*!
  * \brief Name compression context.
  */
@@ -73,6 +97,7 @@ typedef struct knot_compr {
 		uint16_t pos;   /* Position of current suffix. */
 		uint8_t labels; /* Label count of the suffix. */
 	} suffix;
+	knot_compr_dict_t *dict; /* Suffix dictionary (optional). */
 } knot_compr_t;
 
 /*!
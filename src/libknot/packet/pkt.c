@@ -176,6 +176,11 @@ static void compr_clear(knot_compr_t *compr)
 	compr->rrinfo = NULL;
 	compr->suffix.pos = 0;
 	compr->suffix.labels = 0;
+	if (compr->dict != NULL) {
+		while (compr->dict->count > 0) {
+			compr->dict->slots[compr->dict->order[--compr->dict->count]].pos = 0;
+		}
+	}
 }
 
 /*! \brief Clear the packet and switch wireformat pointers (possibly allocate new). */
@@ -392,6 +397,9 @@ void knot_pkt_free(knot_pkt_t *pkt)
 	mm_free(&pkt->mm, pkt->rr);
 	mm_free(&pkt->mm, pkt->rr_info);
 
+	/* Free compression dictionary. */
+	mm_free(&pkt->mm, pkt->compr.dict);
+
 	/* Free the space for wireformat. */
 	if (pkt->flags & KNOT_PF_FREE) {
 		mm_free(&pkt->mm, pkt->wire);
@@ -400,6 +408,26 @@ void knot_pkt_free(knot_pkt_t *pkt)
 	mm_free(&pkt->mm, pkt);
 }
 
+_public_
+int knot_pkt_compr_dict(knot_pkt_t *pkt)
+{
+	if (pkt == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	if (pkt->compr.dict == NULL) {
+		pkt->compr.dict = mm_alloc(&pkt->mm, sizeof(*pkt->compr.dict));
+		if (pkt->compr.dict == NULL) {
+			return KNOT_ENOMEM;
+		}
+		memset(pkt->compr.dict, 0, sizeof(*pkt->compr.dict));
+	}
+
+	compr_clear(&pkt->compr);
+
+	return KNOT_EOK;
+}
+
 _public_
 int knot_pkt_reserve(knot_pkt_t *pkt, uint16_t size)
 {
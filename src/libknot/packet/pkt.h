@@ -148,6 +148,20 @@ void knot_pkt_clear(knot_pkt_t *pkt);
 /*! \brief Begone you foul creature of the underworld. */
 void knot_pkt_free(knot_pkt_t *pkt);
 
+/*!
+ * \brief Enable name compression using a dictionary of all written name suffixes.
+ *
+ * Each name is compressed against its longest earlier occurrence in the packet,
+ * which saves space in large responses (e.g. zone transfers). The dictionary
+ * is allocated from the packet memory context and it's kept until the packet
+ * is freed.
+ *
+ * \note Names written to the packet before this call aren't used for compression.
+ *
+ * \return KNOT_EOK, KNOT_EINVAL, KNOT_ENOMEM
+ */
+int knot_pkt_compr_dict(knot_pkt_t *pkt);
+
 /*!
  * \brief Reserve an arbitrary amount of space in the packet.
  *
@@ -166,6 +166,216 @@ static int write_rdata_naptr_header(const uint8_t **src, size_t *src_avail,
 		written += (len); \
 	}
 
+/*!
+ * \brief Hash a label followed by the given suffix.
+ *
+ * Only the label length and its first and last four bytes are hashed,
+ * which is enough to tell apart the labels usually seen in a zone.
+ */
+static uint32_t dict_hash(const uint8_t *label, uint16_t parent)
+{
+	uint8_t len = *label;
+	uint32_t head = 0, tail = 0;
+	if (len >= sizeof(uint32_t)) {
+		memcpy(&head, label + 1, sizeof(head));
+		memcpy(&tail, label + 1 + len - sizeof(tail), sizeof(tail));
+	} else {
+		for (uint8_t i = 1; i <= len; i++) {
+			head = (head << 8) | label[i];
+		}
+	}
+
+	// Letters differ from their upper case in the 0x20 bit only.
+	uint64_t hash = ((uint64_t)(head | 0x20202020) << 32) | (tail | 0x20202020);
+	hash ^= (((uint64_t)parent << 8) | len) * 0x9e3779b97f4a7c15ULL;
+	hash *= 0xc2b2ae3d27d4eb4fULL;
+
+	return hash >> 32;
+}
+
+/*!
+ * \brief Find the position of a label followed by the given suffix.
+ *
+ * \param slot  Output for the free slot where the suffix belongs if not found.
+ *
+ * \return Position of the suffix in the packet or 0 if not found.
+ */
+static uint16_t dict_find(const knot_compr_t *compr, const uint8_t *label,
+                          uint16_t parent, uint32_t hash, uint16_t *slot)
+{
+	const knot_compr_dict_t *dict = compr->dict;
+	const uint16_t mask = KNOT_COMPR_DICT_SLOTS - 1;
+	const uint16_t tag = hash >> 16;
+
+	uint16_t i = hash & mask;
+	for (; dict->slots[i].pos != 0; i = (i + 1) & mask) {
+		uint16_t pos = dict->slots[i].pos;
+		if (dict->slots[i].tag == tag && dict->slots[i].parent == parent &&
+		    (memcmp(label, compr->wire + pos, *label + 1) == 0 ||
+		     label_is_equal(label, compr->wire + pos))) {
+			return pos;
+		}
+	}
+
+	*slot = i;
+	return 0;
+}
+
+/*! \brief Find a free slot for a suffix known not to be stored yet. */
+static uint16_t dict_free_slot(const knot_compr_t *compr, uint32_t hash)
+{
+	const knot_compr_dict_t *dict = compr->dict;
+	const uint16_t mask = KNOT_COMPR_DICT_SLOTS - 1;
+
+	uint16_t i = hash & mask;
+	while (dict->slots[i].pos != 0) {
+		i = (i + 1) & mask;
+	}
+
+	return i;
+}
+
+static bool dict_insert(knot_compr_t *compr, uint16_t pos, uint16_t parent,
+                        uint32_t hash, uint16_t slot)
+{
+	knot_compr_dict_t *dict = compr->dict;
+
+	if (dict->count == KNOT_COMPR_DICT_ENTRIES || pos >= KNOT_WIRE_PTR_MAX) {
+		return false;
+	}
+
+	dict->slots[slot].pos = pos;
+	dict->slots[slot].parent = parent;
+	dict->slots[slot].tag = hash >> 16;
+	dict->order[dict->count++] = slot;
+
+	return true;
+}
+
+/*!
+ * \brief Remove the entries added after the dictionary had given size.
+ *
+ * \note The latest entries can be removed without breaking the probe sequences.
+ */
+static void dict_rollback(knot_compr_t *compr, uint16_t count)
+{
+	knot_compr_dict_t *dict = compr->dict;
+
+	while (dict->count > count) {
+		dict->slots[dict->order[--dict->count]].pos = 0;
+	}
+}
+
+/*! \brief Store all suffixes of an uncompressed name written in the packet. */
+static void dict_add_name(knot_compr_t *compr, const knot_dname_t *name)
+{
+	uint8_t offsets[KNOT_DNAME_MAXLABELS];
+	size_t labels = 0;
+	for (const uint8_t *label = name; *label != '\0'; label += *label + 1) {
+		offsets[labels++] = label - name;
+	}
+
+	uint16_t parent = 0;
+	while (labels > 0) {
+		const uint8_t *label = name + offsets[--labels];
+		uint32_t hash = dict_hash(label, parent);
+		uint16_t slot = 0;
+		uint16_t pos = dict_find(compr, label, parent, hash, &slot);
+		if (pos == 0) {
+			pos = label - compr->wire;
+			if (!dict_insert(compr, pos, parent, hash, slot)) {
+				return;
+			}
+		}
+		parent = pos;
+	}
+}
+
+/*!
+ * \brief Write domain name compressed using the suffix dictionary.
+ *
+ * The name is matched against the current suffix (the last owner) first,
+ * the dictionary is probed only for the labels in front of the matched part.
+ *
+ * \see compr_put_dname
+ */
+static int dict_put_dname(const knot_dname_t *dname, uint8_t *dst, uint16_t max,
+                          knot_compr_t *compr)
+{
+	uint8_t offsets[KNOT_DNAME_MAXLABELS];
+	size_t labels = 0;
+	const uint8_t *label = dname;
+	for (; *label != '\0'; label += *label + 1) {
+		offsets[labels++] = label - dname;
+	}
+	const uint8_t *root = label;
+
+	// Start with the common suffix of the last owner, it's cheaper.
+	const uint8_t *suffix = compr->wire + compr->suffix.pos;
+	size_t suffix_labels = compr->suffix.labels;
+	while (suffix_labels > labels) {
+		suffix = knot_wire_next_label(suffix, compr->wire);
+		suffix_labels--;
+	}
+	uint16_t parent = 0;
+	size_t matched = labels;
+	for (size_t i = labels - suffix_labels; i < labels; i++) {
+		if (!label_is_equal(dname + offsets[i], suffix)) {
+			parent = 0;
+			matched = labels;
+		} else if (parent == 0) {
+			parent = suffix - compr->wire;
+			matched = i;
+		}
+		suffix = knot_wire_next_label(suffix, compr->wire);
+	}
+
+	// Extend the match with the stored suffixes.
+	uint32_t hash = 0;
+	uint16_t slot = 0;
+	while (matched > 0) {
+		label = dname + offsets[matched - 1];
+		hash = dict_hash(label, parent);
+		uint16_t pos = dict_find(compr, label, parent, hash, &slot);
+		if (pos == 0) {
+			break;
+		}
+		parent = pos;
+		matched--;
+	}
+
+	// Write the unmatched labels, terminated by a pointer or the root label.
+	uint16_t written = 0;
+	size_t prefix_len = (matched < labels) ? offsets[matched] : root - dname;
+	WRITE_LABEL(dst, written, dname, max, prefix_len);
+	if (parent != 0) {
+		if (written + sizeof(uint16_t) > max) {
+			return KNOT_ESPACE;
+		}
+		knot_wire_put_pointer(dst + written, parent);
+		written += sizeof(uint16_t);
+	} else {
+		WRITE_LABEL(dst, written, root, max, 1);
+	}
+
+	// Store the new suffixes, the first one has the slot found already.
+	// The following ones can't be stored as their parents are new.
+	uint16_t wire_pos = dst - compr->wire;
+	for (size_t i = matched; i > 0; i--) {
+		uint16_t pos = wire_pos + offsets[i - 1];
+		if (i < matched) {
+			hash = dict_hash(dname + offsets[i - 1], parent);
+			slot = dict_free_slot(compr, hash);
+		}
+		if (!dict_insert(compr, pos, parent, hash, slot)) {
+			break;
+		}
+		parent = pos;
+	}
+
+	return written;
+}
+
 /*!
  * \brief Write compressed domain name to the destination wire.
  *
@@ -185,6 +395,10 @@ static int compr_put_dname(const knot_dname_t *dname, uint8_t *dst, uint16_t max
 		return knot_dname_to_wire(dst, dname, max);
 	}
 
+	if (compr->dict != NULL) {
+		return dict_put_dname(dname, dst, max, compr);
+	}
+
 	// Get number of labels (should not be a zero label dname).
 	size_t name_labels = knot_dname_labels(dname, NULL);
 	assert(name_labels > 0);
@@ -293,7 +507,8 @@ static int write_owner(const knot_rrset_t *rrset, uint8_t **dst, size_t *dst_ava
 		              knot_dname_size(rrset->owner));
 		WRITE_OWNER_INCR(dst, dst_avail, sizeof(uint16_t));
 	} else {
-		if (compr != NULL) {
+		// The dictionary matches against the previous owner instead.
+		if (compr != NULL && compr->dict == NULL) {
 			compr->suffix.pos = KNOT_WIRE_HEADER_SIZE;
 			compr->suffix.labels =
 				knot_dname_labels(compr->wire + compr->suffix.pos,
@@ -306,6 +521,13 @@ static int write_owner(const knot_rrset_t *rrset, uint8_t **dst, size_t *dst_ava
 			return written;
 		}
 
+		// Keep the last owner for the coincidence checks and RDATA names.
+		if (compr != NULL && compr->dict != NULL && written > sizeof(uint16_t) &&
+		    *dst - compr->wire + written < KNOT_WIRE_PTR_MAX) {
+			compr->suffix.pos = *dst - compr->wire;
+			compr->suffix.labels = knot_dname_labels(rrset->owner, NULL);
+		}
+
 		compr_set_ptr(compr, KNOT_COMPR_HINT_OWNER, *dst, written);
 		WRITE_OWNER_INCR(dst, dst_avail, written);
 	}
@@ -369,6 +591,11 @@ static int compress_rdata_dname(const uint8_t **src, size_t *src_avail,
 		return written;
 	}
 
+	// Uncompressed names may still be compression targets.
+	if (put_compr == NULL && compr != NULL && compr->dict != NULL) {
+		dict_add_name(compr, *dst);
+	}
+
 	// Update compression hints.
 	if (compr_get_ptr(compr, hint) == 0) {
 		compr_set_ptr(compr, hint, *dst, written);
@@ -498,6 +725,21 @@ int knot_rrset_to_wire_extra(const knot_rrset_t *rrset, uint8_t *wire,
 		rotate %= rrset->rrs.count;
 	}
 
+	// Remember the compression state for a rollback.
+	uint16_t suffix_pos = 0, dict_count = 0;
+	uint8_t suffix_labels = 0;
+	if (compr != NULL) {
+		suffix_pos = compr->suffix.pos;
+		suffix_labels = compr->suffix.labels;
+		if (compr->dict != NULL) {
+			// Store the QNAME suffixes first.
+			if (compr->dict->count == 0 && knot_wire_get_qdcount(compr->wire) > 0) {
+				dict_add_name(compr, compr->wire + KNOT_WIRE_HEADER_SIZE);
+			}
+			dict_count = compr->dict->count;
+		}
+	}
+
 	uint8_t *write = wire;
 	size_t capacity = max_size;
 
@@ -506,6 +748,14 @@ int knot_rrset_to_wire_extra(const knot_rrset_t *rrset, uint8_t *wire,
 		uint16_t pos = (i < count) ? i : (i - count);
 		int ret = write_rr(rrset, pos, &write, &capacity, compr, flags);
 		if (ret != KNOT_EOK) {
+			// Forget the names of the unfinished RRSet.
+			if (compr != NULL) {
+				compr->suffix.pos = suffix_pos;
+				compr->suffix.labels = suffix_labels;
+				if (compr->dict != NULL) {
+					dict_rollback(compr, dict_count);
+				}
+			}
 			return ret;
 		}
 	}
@@ -20,6 +20,7 @@
 
 #include "libknot/attribute.h"
 #include "libknot/rdataset.h"
+#include "contrib/macros.h"
 #include "contrib/mempattern.h"
 
 static knot_rdata_t *rr_seek(const knot_rdataset_t *rrs, uint16_t pos)
@@ -86,6 +87,73 @@ static int add_rr_at(knot_rdataset_t *rrs, const knot_rdata_t *rr, knot_rdata_t
 	return KNOT_EOK;
 }
 
+static bool is_sorted(const knot_rdataset_t *rrs)
+{
+	knot_rdata_t *rr = rrs->rdata;
+	for (uint16_t i = 1; i < rrs->count; ++i) {
+		knot_rdata_t *next = knot_rdataset_next(rr);
+		if (knot_rdata_cmp(rr, next) >= 0) {
+			return false;
+		}
+		rr = next;
+	}
+
+	return true;
+}
+
+static int rdata_ptr_cmp(const void *a, const void *b)
+{
+	return knot_rdata_cmp(*(const knot_rdata_t **)a, *(const knot_rdata_t **)b);
+}
+
+/*! \brief Merges two canonically sorted rdatasets into a new rdata array. */
+static int merge_sorted(knot_rdataset_t *rrs1, const knot_rdataset_t *rrs2,
+                        knot_mm_t *mm)
+{
+	if (rrs1->size > UINT32_MAX - rrs2->size) {
+		return KNOT_ESPACE;
+	}
+
+	knot_rdata_t *out = mm_alloc(mm, rrs1->size + rrs2->size);
+	if (out == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	knot_rdata_t *rr1 = rrs1->rdata, *rr2 = rrs2->rdata, *pos = out;
+	uint16_t i1 = 0, i2 = 0;
+	size_t count = 0;
+	while (i1 < rrs1->count || i2 < rrs2->count) {
+		int cmp = (i1 == rrs1->count) ? 1 :
+		          (i2 == rrs2->count) ? -1 : knot_rdata_cmp(rr1, rr2);
+		knot_rdata_t *next = (cmp <= 0) ? rr1 : rr2;
+		size_t size = knot_rdata_size(next->len);
+		memcpy(pos, next, size);
+		pos = (knot_rdata_t *)((uint8_t *)pos + size);
+		count++;
+
+		if (cmp <= 0) {
+			rr1 = knot_rdataset_next(rr1);
+			i1++;
+		}
+		if (cmp >= 0) {
+			rr2 = knot_rdataset_next(rr2);
+			i2++;
+		}
+	}
+
+	if (count > UINT16_MAX) {
+		mm_free(mm, out);
+		return KNOT_ESPACE;
+	}
+
+	mm_free(mm, rrs1->rdata);
+	rrs1->rdata = out;
+	rrs1->count = count;
+	rrs1->size = (uint8_t *)pos - (uint8_t *)out;
+
+	return KNOT_EOK;
+}
+
 static int remove_rr_at(knot_rdataset_t *rrs, uint16_t pos, knot_mm_t *mm)
 {
 	assert(rrs);
@@ -203,6 +271,100 @@ int knot_rdataset_add(knot_rdataset_t *rrs, const knot_rdata_t *rr, knot_mm_t *m
 	return add_rr_at(rrs, rr, ins_pos, mm);
 }
 
+_public_
+int knot_rdataset_append(knot_rdataset_t *rrs, size_t *capacity,
+                         const knot_rdata_t *rr, knot_mm_t *mm)
+{
+	if (rrs == NULL || capacity == NULL || rr == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	if (rrs->count == UINT16_MAX) {
+		return KNOT_ESPACE;
+	} else if (rrs->size > UINT32_MAX - knot_rdata_size(UINT16_MAX)) {
+		return KNOT_ESPACE;
+	}
+
+	const size_t rr_size = knot_rdata_size(rr->len);
+
+	if (rrs->size + rr_size > *capacity) {
+		size_t new_capacity = MAX(2 * *capacity, rrs->size + rr_size);
+		new_capacity = MIN(new_capacity, UINT32_MAX);
+		knot_rdata_t *tmp = mm_realloc(mm, rrs->rdata, new_capacity, rrs->size);
+		if (tmp == NULL) {
+			return KNOT_ENOMEM;
+		}
+		rrs->rdata = tmp;
+		*capacity = new_capacity;
+	}
+
+	knot_rdata_t *pos = (knot_rdata_t *)((uint8_t *)rrs->rdata + rrs->size);
+	knot_rdata_init(pos, rr->len, rr->data);
+	rrs->count++;
+	rrs->size += rr_size;
+
+	return KNOT_EOK;
+}
+
+_public_
+int knot_rdataset_sort(knot_rdataset_t *rrs, knot_mm_t *mm)
+{
+	if (rrs == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	if (rrs->count == 0) {
+		return KNOT_EOK;
+	}
+
+	if (is_sorted(rrs)) {
+		// Release the unused capacity, a memory context would need a copy.
+		if (mm == NULL) {
+			knot_rdata_t *tmp = realloc(rrs->rdata, rrs->size);
+			if (tmp != NULL) {
+				rrs->rdata = tmp;
+			}
+		}
+		return KNOT_EOK;
+	}
+
+	knot_rdata_t **index = malloc(rrs->count * sizeof(*index));
+	knot_rdata_t *out = mm_alloc(mm, rrs->size);
+	if (index == NULL || out == NULL) {
+		free(index);
+		mm_free(mm, out);
+		return KNOT_ENOMEM;
+	}
+
+	knot_rdata_t *rr = rrs->rdata;
+	for (uint16_t i = 0; i < rrs->count; ++i) {
+		index[i] = rr;
+		rr = knot_rdataset_next(rr);
+	}
+	qsort(index, rrs->count, sizeof(*index), rdata_ptr_cmp);
+
+	// Copy in the canonical order, skip duplicates.
+	knot_rdata_t *pos = out;
+	uint16_t count = 0;
+	for (uint16_t i = 0; i < rrs->count; ++i) {
+		if (i > 0 && knot_rdata_cmp(index[i - 1], index[i]) == 0) {
+			continue;
+		}
+		size_t size = knot_rdata_size(index[i]->len);
+		memcpy(pos, index[i], size);
+		pos = (knot_rdata_t *)((uint8_t *)pos + size);
+		count++;
+	}
+	free(index);
+
+	mm_free(mm, rrs->rdata);
+	rrs->rdata = out;
+	rrs->count = count;
+	rrs->size = (uint8_t *)pos - (uint8_t *)out;
+
+	return KNOT_EOK;
+}
+
 _public_
 bool knot_rdataset_eq(const knot_rdataset_t *rrs1, const knot_rdataset_t *rrs2)
 {
@@ -254,6 +416,12 @@ int knot_rdataset_merge(knot_rdataset_t *rrs1, const knot_rdataset_t *rrs2,
 		return KNOT_EINVAL;
 	}
 
+	// Merge larger sets at once, the insertion one by one is quadratic.
+	if (rrs2->count > 1 && rrs1->count > 0 && rrs1->rdata != rrs2->rdata &&
+	    is_sorted(rrs2)) {
+		return merge_sorted(rrs1, rrs2, mm);
+	}
+
 	knot_rdata_t *rr2 = rrs2->rdata;
 	for (uint16_t i = 0; i < rrs2->count; ++i) {
 		int ret = knot_rdataset_add(rrs1, rr2, mm);
@@ -112,6 +112,36 @@ knot_rdata_t *knot_rdataset_at(const knot_rdataset_t *rrs, uint16_t pos);
  */
 int knot_rdataset_add(knot_rdataset_t *rrs, const knot_rdata_t *rr, knot_mm_t *mm);
 
+/*!
+ * \brief Appends single RR at the end of RRS structure. All data are copied.
+ *
+ * Unlike knot_rdataset_add(), the canonical order isn't kept and duplicates
+ * aren't detected. The rdata array grows geometrically, so a large RRS can be
+ * built in linear time. Once all RRs are appended, knot_rdataset_sort() must
+ * be called before the RRS is used otherwise.
+ *
+ * \param rrs       RRS structure to add RR into.
+ * \param capacity  Allocated size of the rdata array (initialize to 0 with empty RRS).
+ * \param rr        RR to add.
+ * \param mm        Memory context.
+ *
+ * \return KNOT_E*
+ */
+int knot_rdataset_append(knot_rdataset_t *rrs, size_t *capacity,
+                         const knot_rdata_t *rr, knot_mm_t *mm);
+
+/*!
+ * \brief Sorts RRS canonically and removes duplicate RRs.
+ *
+ * Also releases the unused capacity left by knot_rdataset_append().
+ *
+ * \param rrs  RRS structure to sort.
+ * \param mm   Memory context.
+ *
+ * \return KNOT_E*
+ */
+int knot_rdataset_sort(knot_rdataset_t *rrs, knot_mm_t *mm);
+
 /*!
  * \brief RRS equality check.
  *
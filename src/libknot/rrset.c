@@ -105,6 +105,21 @@ int knot_rrset_add_rdata(knot_rrset_t *rrset, const uint8_t *data, uint16_t len,
 	return knot_rdataset_add(&rrset->rrs, rdata, mm);
 }
 
+_public_
+int knot_rrset_append_rdata(knot_rrset_t *rrset, const uint8_t *data, uint16_t len,
+                            size_t *capacity, knot_mm_t *mm)
+{
+	if (rrset == NULL || (data == NULL && len > 0)) {
+		return KNOT_EINVAL;
+	}
+
+	uint8_t buf[knot_rdata_size(len)];
+	knot_rdata_t *rdata = (knot_rdata_t *)buf;
+	knot_rdata_init(rdata, len, data);
+
+	return knot_rdataset_append(&rrset->rrs, capacity, rdata, mm);
+}
+
 _public_
 bool knot_rrset_equal(const knot_rrset_t *r1,
                       const knot_rrset_t *r2,
@@ -136,6 +136,24 @@ void knot_rrset_clear(knot_rrset_t *rrset, knot_mm_t *mm);
 int knot_rrset_add_rdata(knot_rrset_t *rrset, const uint8_t *data, uint16_t len,
                          knot_mm_t *mm);
 
+/*!
+ * \brief Appends the given RDATA to the RRSet without sorting.
+ *
+ * \see knot_rdataset_append()
+ *
+ * \note knot_rdataset_sort() must be called on the RRSet data afterwards.
+ *
+ * \param rrset     RRSet to add the RDATA to.
+ * \param data      RDATA to add to the RRSet.
+ * \param len       Length of RDATA.
+ * \param capacity  Allocated size of the RRSet data.
+ * \param mm        Memory context.
+ *
+ * \return KNOT_E*
+ */
+int knot_rrset_append_rdata(knot_rrset_t *rrset, const uint8_t *data, uint16_t len,
+                            size_t *capacity, knot_mm_t *mm);
+
 /*!
  * \brief Compares two RRSets for equality.
  *
@@ -28,6 +28,7 @@
 #include <bpf/xsk.h>
 
 #include "libknot/xdp/xdp.h"
+#include "contrib/spinlock.h"
 
 struct kxsk_iface {
 	/*! Interface name. */
@@ -46,20 +47,63 @@ struct kxsk_iface {
 	struct bpf_object *prog_obj;
 };
 
+struct knot_xdp_umem {
+	/*! Handle internal to libbpf. */
+	struct xsk_umem *umem;
+	/*! Fill queue created together with the UMEM (taken by the first socket). */
+	struct xsk_ring_prod fq;
+	/*! Completion queue created together with the UMEM (taken by the first socket). */
+	struct xsk_ring_cons cq;
+
+	/*! The memory frames. */
+	uint8_t *frames;
+	/*! Size of the memory block. */
+	size_t size;
+	/*! The memory block is allocated from huge pages. */
+	bool hugepages;
+	/*! Size of one frame. */
+	uint32_t frame_size;
+	/*! Number of RX (and TX) frames per socket. */
+	uint32_t ring_size;
+	/*! Maximum number of sockets. */
+	unsigned sockets;
+	/*! Number of sockets created so far. */
+	unsigned used;
+	/*! Number of references (the creator and the sockets). */
+	unsigned refcount;
+
+	/*! Lock of the shared pool of free TX frames. */
+	knot_spin_t tx_lock;
+	/*! The number of free frames in the shared pool (for TX). */
+	uint32_t tx_free_count;
+	/*! Stack of indices of the free frames in the shared pool (for TX). */
+	uint32_t tx_free_indices[];
+};
+
 struct kxsk_umem {
 	/*! Fill queue: passing memory frames to kernel - ready to receive. */
 	struct xsk_ring_prod fq;
 	/*! Completion queue: passing memory frames from kernel - after send finishes. */
 	struct xsk_ring_cons cq;
-	/*! Handle internal to libbpf. */
-	struct xsk_umem *umem;
-
-	/*! The memory frames. */
-	struct umem_frame *frames;
+	/*! The (possibly shared) UMEM. */
+	struct knot_xdp_umem *shared;
+
+	/*! The memory frames (of the whole UMEM). */
+	uint8_t *frames;
+	/*! Size of one frame. */
+	uint32_t frame_size;
+	/*! Number of RX frames of this socket. */
+	uint32_t ring_size;
+	/*! Number of failed TX frame allocations. */
+	uint64_t tx_alloc_fail;
+	/*! Number of TX frames taken by this socket (free, queued, or in flight). */
+	uint32_t tx_owned;
+	/*! Maximum number of TX frames this socket can take. */
+	uint32_t tx_max;
 	/*! The number of free frames (for TX). */
 	uint32_t tx_free_count;
 	/*! Stack of indices of the free frames (for TX). */
-	uint16_t tx_free_indices[];
+	uint32_t tx_free_indices[];
 };
 
 struct knot_xdp_socket {
@@ -64,15 +64,52 @@ static list_t *tcp_table_timeout(knot_tcp_table_t *table)
 	return (list_t *)&table->conns[table->size];
 }
 
+static list_t *tcp_table_resend(knot_tcp_table_t *table)
+{
+	return tcp_table_timeout(table) + 1;
+}
+
 static node_t *tcp_conn_node(knot_tcp_conn_t *conn)
 {
 	return (node_t *)&conn->list_node_placeholder;
 }
 
+static node_t *tcp_conn_resend_node(knot_tcp_conn_t *conn)
+{
+	return (node_t *)&conn->resend_node_placeholder;
+}
+
+static knot_tcp_conn_t *tcp_resend_node_conn(node_t *node)
+{
+	return (knot_tcp_conn_t *)((uint8_t *)node -
+	                           offsetof(knot_tcp_conn_t, resend_node_placeholder));
+}
+
+/*!
+ * \brief (Re)start the resend timer, the timers are ordered by the start time.
+ */
+static void resend_timer_start(knot_tcp_table_t *table, knot_tcp_conn_t *conn, uint32_t now)
+{
+	node_t *node = tcp_conn_resend_node(conn);
+	if (node->next != NULL) {
+		rem_node(node);
+	}
+	conn->resend_start = now;
+	add_tail(tcp_table_resend(table), node);
+}
+
+static void resend_timer_stop(knot_tcp_conn_t *conn)
+{
+	node_t *node = tcp_conn_resend_node(conn);
+	if (node->next != NULL) {
+		rem_node(node);
+	}
+}
+
 _public_
 knot_tcp_table_t *knot_tcp_table_new(size_t size)
 {
-	knot_tcp_table_t *table = calloc(1, sizeof(*table) + sizeof(list_t) +
+	knot_tcp_table_t *table = calloc(1, sizeof(*table) + 2 * sizeof(list_t) +
 	                                    size * sizeof(table->conns[0]));
 	if (table == NULL) {
 		return table;
@@ -80,6 +117,7 @@ knot_tcp_table_t *knot_tcp_table_new(size_t size)
 
 	table->size = size;
 	init_list(tcp_table_timeout(table));
+	init_list(tcp_table_resend(table));
 
 	assert(sizeof(table->hash_secret) == sizeof(SIPHASH_KEY));
 	table->hash_secret[0] = dnssec_random_uint64_t();
@@ -94,6 +132,8 @@ void knot_tcp_table_free(knot_tcp_table_t *table)
 	if (table != NULL) {
 		knot_tcp_conn_t *conn, *next;
 		WALK_LIST_DELSAFE(conn, next, *tcp_table_timeout(table)) {
+			tcp_outbufs_free(&conn->outbufs, &table->inbufs_total);
+			free(conn->inbuf.iov_base);
 			free(conn);
 		}
 		free(table);
@@ -125,6 +165,7 @@ static void tcp_table_del_conn(knot_tcp_conn_t **todel)
 	if (conn != NULL) {
 		*todel = conn->next; // remove from conn-table linked list
 		rem_node(tcp_conn_node(conn)); // remove from timeout double-linked list
+		resend_timer_stop(conn);
 		free(conn->inbuf.iov_base);
 		free(conn);
 	}
@@ -134,6 +175,7 @@ static void tcp_table_del(knot_tcp_conn_t **todel, knot_tcp_table_t *table)
 {
 	assert(table->usage > 0);
 	table->inbufs_total -= (*todel)->inbuf.iov_len;
+	tcp_outbufs_free(&(*todel)->outbufs, &table->inbufs_total);
 	tcp_table_del_conn(todel);
 	table->usage--;
 }
@@ -167,12 +209,16 @@ static int tcp_table_add(knot_xdp_msg_t *msg, uint64_t hash, knot_tcp_table_t *t
 	c->seqno = msg->seqno;
 	c->ackno = msg->ackno;
 	c->acked = msg->ackno;
+	c->window_size = msg->win;
+	c->window_scale = 0;
 
 	c->last_active = get_timestamp();
 	add_tail(tcp_table_timeout(table), tcp_conn_node(c));
+	memset(tcp_conn_resend_node(c), 0, sizeof(node_t));
 
 	c->state = XDP_TCP_NORMAL;
 	memset(&c->inbuf, 0, sizeof(c->inbuf));
+	c->outbufs = NULL;
 
 	c->next = *addto;
 	*addto = c;
@@ -184,6 +230,26 @@ static int tcp_table_add(knot_xdp_msg_t *msg, uint64_t hash, knot_tcp_table_t *t
 
 knot_dynarray_define(knot_tcp_relay, knot_tcp_relay_t, DYNARRAY_VISIBILITY_PUBLIC)
 
+static uint32_t tcp_conn_sent(const knot_tcp_conn_t *conn)
+{
+	// Sequence number following the sent data, FIN is excluded.
+	return conn->ackno - (conn->state == XDP_TCP_CLOSING ? 1 : 0);
+}
+
+static bool tcp_conn_unsent(const knot_tcp_conn_t *conn)
+{
+	if (conn->state == XDP_TCP_CLOSING) {
+		return false;
+	}
+
+	uint32_t end = tcp_outbufs_end(conn->outbufs, conn->ackno);
+	if (!tcp_seq_lt(conn->ackno, end)) {
+		// Only the pending FIN, if any.
+		return conn->state == XDP_TCP_FIN_PENDING;
+	}
+	return tcp_seq_lt(conn->ackno, conn->acked + conn->window_size);
+}
+
 static bool check_seq_ack(const knot_xdp_msg_t *msg, const knot_tcp_conn_t *conn)
 {
 	if (conn == NULL || conn->seqno != msg->seqno) {
@@ -245,7 +311,15 @@ int knot_tcp_relay(knot_xdp_socket_t *socket, knot_xdp_msg_t msgs[], uint32_t ms
 			memcpy((*conn)->last_eth_loc, msg->eth_to, sizeof((*conn)->last_eth_loc));
 			(*conn)->last_active = get_timestamp();
 			if (msg->flags & KNOT_XDP_MSG_ACK) {
+				bool acked_new = tcp_seq_lt((*conn)->acked, msg->ackno);
 				(*conn)->acked = msg->ackno;
+				(*conn)->window_size = (uint32_t)msg->win << (*conn)->window_scale;
+				tcp_outbufs_ack(&(*conn)->outbufs, msg->ackno, &tcp_table->inbufs_total);
+				if ((*conn)->outbufs == NULL) {
+					resend_timer_stop(*conn);
+				} else if (acked_new) {
+					resend_timer_start(tcp_table, *conn, (*conn)->last_active);
+				}
 			}
 		}
 
@@ -283,6 +357,14 @@ int knot_tcp_relay(knot_xdp_socket_t *socket, knot_xdp_msg_t msgs[], uint32_t ms
 			}
 		}
 
+		// continue sending of queued data if acknowledged or allowed by window
+		if (seq_ack_match && ret == KNOT_EOK && tcp_conn_unsent(*conn)) {
+			knot_tcp_relay_t send = { .msg = msg, .answer = XDP_TCP_DATA, .conn = *conn };
+			if (knot_tcp_relay_dynarray_add(relays, &send) == NULL) {
+				ret = KNOT_ENOMEM;
+			}
+		}
+
 		// process TCP connection state
 		switch (msg->flags & (KNOT_XDP_MSG_SYN | KNOT_XDP_MSG_ACK |
 		                      KNOT_XDP_MSG_FIN | KNOT_XDP_MSG_RST)) {
@@ -303,6 +385,9 @@ int knot_tcp_relay(knot_xdp_socket_t *socket, knot_xdp_msg_t msgs[], uint32_t ms
 					relay.conn->state = XDP_TCP_ESTABLISHING;
 					relay.conn->seqno++;
 					relay.conn->mss = MAX(msg->mss, 536); // minimal MSS, most importantly not zero!
+					if (msg->flags & KNOT_XDP_MSG_WSC) {
+						relay.conn->window_scale = MIN(msg->win_scale, 14);
+					}
 					relay.conn->acked = acks[n_acks - 1].seqno;
 					relay.conn->ackno = relay.conn->acked + (synack ? 0 : 1);
 				}
@@ -316,10 +401,17 @@ int knot_tcp_relay(knot_xdp_socket_t *socket, knot_xdp_msg_t msgs[], uint32_t ms
 				if (syn_table != NULL && msg->payload.iov_len == 0 &&
 				    *(conn = tcp_table_lookup(&msg->ip_from, &msg->ip_to, &syn_hash, syn_table)) != NULL &&
 				     check_seq_ack(msg, *conn)) {
+					uint16_t mss = (*conn)->mss;
+					uint8_t window_scale = (*conn)->window_scale;
 					tcp_table_del(conn, syn_table);
 					*conn = NULL;
 					relay.action = XDP_TCP_ESTABLISH;
 					ret = tcp_table_add(msg, conn_hash, tcp_table, &relay.conn);
+					if (ret == KNOT_EOK) {
+						relay.conn->mss = mss;
+						relay.conn->window_scale = window_scale;
+						relay.conn->window_size = (uint32_t)msg->win << window_scale;
+					}
 					if (ret == KNOT_EOK && knot_tcp_relay_dynarray_add(relays, &relay) == NULL) {
 						ret = KNOT_ENOMEM;
 					}
@@ -330,12 +422,16 @@ int knot_tcp_relay(knot_xdp_socket_t *socket, knot_xdp_msg_t msgs[], uint32_t ms
 			} else {
 				switch ((*conn)->state) {
 				case XDP_TCP_NORMAL:
+				case XDP_TCP_FIN_PENDING:
 					break;
 				case XDP_TCP_ESTABLISHING:
 					(*conn)->state = XDP_TCP_NORMAL;
 					break;
 				case XDP_TCP_CLOSING:
-					tcp_table_del(conn, tcp_table);
+					// The data sent before FIN can be acknowledged separately.
+					if (msg->ackno == (*conn)->ackno) {
+						tcp_table_del(conn, tcp_table);
+					}
 					break;
 				}
 			}
@@ -352,13 +448,21 @@ int knot_tcp_relay(knot_xdp_socket_t *socket, knot_xdp_msg_t msgs[], uint32_t ms
 					}
 					tcp_table_del(conn, tcp_table);
 				} else if (msg->payload.iov_len == 0) { // otherwise ignore FIN
-					resp_ack(msg, KNOT_XDP_MSG_FIN | KNOT_XDP_MSG_ACK);
 					relay.action = XDP_TCP_CLOSE;
 					if (knot_tcp_relay_dynarray_add(relays, &relay) == NULL) {
 						ret = KNOT_ENOMEM;
 					}
-					(*conn)->state = XDP_TCP_CLOSING;
-					(*conn)->ackno++;
+					if (tcp_seq_lt((*conn)->ackno,
+					               tcp_outbufs_end((*conn)->outbufs, (*conn)->ackno))) {
+						// Our FIN follows the queued data.
+						resp_ack(msg, KNOT_XDP_MSG_ACK);
+						(*conn)->state = XDP_TCP_FIN_PENDING;
+					} else {
+						resp_ack(msg, KNOT_XDP_MSG_FIN | KNOT_XDP_MSG_ACK);
+						acks[n_acks - 1].seqno = (*conn)->ackno;
+						(*conn)->state = XDP_TCP_CLOSING;
+						(*conn)->ackno++;
+					}
 				}
 			}
 			break;
@@ -388,44 +492,66 @@ int knot_tcp_relay(knot_xdp_socket_t *socket, knot_xdp_msg_t msgs[], uint32_t ms
 }
 
 _public_
-int knot_tcp_relay_answer(knot_tcp_relay_dynarray_t *relays, const knot_tcp_relay_t *relay,
-                          void *data, size_t data_len)
+knot_tcp_outbuf_t *knot_tcp_outbuf_alloc(size_t max_len)
 {
-	if (relays == NULL || relay == NULL || data == NULL) {
-		return KNOT_EINVAL;
+	if (max_len > UINT16_MAX) {
+		return NULL;
 	}
 
-	assert(data_len <= UINT16_MAX);
-	uint16_t prefix = htobe16(data_len);
-#define PREFIX_LEN (prefix == 0 ? 0 : sizeof(prefix))
+	return malloc(sizeof(knot_tcp_outbuf_t) + sizeof(uint16_t) + max_len);
+}
 
-	while (data_len > 0) {
-		knot_tcp_relay_t *clone = knot_tcp_relay_dynarray_add(relays, relay);
-		if (clone == NULL) {
-			return KNOT_ENOMEM;
-		}
+_public_
+void knot_tcp_outbuf_free(knot_tcp_outbuf_t *outbuf)
+{
+	free(outbuf);
+}
 
-		size_t chunk = MIN(data_len + PREFIX_LEN, relay->conn->mss);
-		assert(chunk >= PREFIX_LEN);
+_public_
+int knot_tcp_relay_answer_outbuf(knot_tcp_relay_dynarray_t *relays,
+                                 const knot_tcp_relay_t *relay,
+                                 knot_tcp_table_t *tcp_table,
+                                 knot_tcp_outbuf_t *outbuf, size_t data_len)
+{
+	if (relays == NULL || relay == NULL || relay->conn == NULL || tcp_table == NULL ||
+	    outbuf == NULL) {
+		free(outbuf);
+		return KNOT_EINVAL;
+	}
 
-		clone->data.iov_base = malloc(chunk);
-		if (clone->data.iov_base == NULL) {
-			return KNOT_ENOMEM;
-		}
-		clone->data.iov_len = chunk;
+	knot_tcp_relay_t *clone = knot_tcp_relay_dynarray_add(relays, relay);
+	if (clone == NULL) {
+		free(outbuf);
+		return KNOT_ENOMEM;
+	}
+	memset(&clone->data, 0, sizeof(clone->data));
+	clone->answer = XDP_TCP_ANSWER | XDP_TCP_DATA;
+	clone->free_data = XDP_TCP_FREE_NONE;
+
+	knot_tcp_conn_t *conn = relay->conn;
+	tcp_outbufs_add(&conn->outbufs, outbuf, data_len, conn->ackno, &tcp_table->inbufs_total);
+	if (tcp_conn_resend_node(conn)->next == NULL) {
+		resend_timer_start(tcp_table, conn, get_timestamp());
+	}
 
-		memcpy(clone->data.iov_base, &prefix, PREFIX_LEN);
-		chunk -= PREFIX_LEN;
+	return KNOT_EOK;
+}
 
-		memcpy(clone->data.iov_base + PREFIX_LEN, data, chunk);
-		clone->answer = XDP_TCP_ANSWER | XDP_TCP_DATA;
-		clone->free_data = XDP_TCP_FREE_DATA;
+_public_
+int knot_tcp_relay_answer(knot_tcp_relay_dynarray_t *relays, const knot_tcp_relay_t *relay,
+                          knot_tcp_table_t *tcp_table, void *data, size_t data_len)
+{
+	if (relays == NULL || relay == NULL || data == NULL) {
+		return KNOT_EINVAL;
+	}
 
-		data += chunk;
-		data_len -= chunk;
-		prefix = 0;
+	knot_tcp_outbuf_t *outbuf = knot_tcp_outbuf_alloc(data_len);
+	if (outbuf == NULL) {
+		return KNOT_ENOMEM;
 	}
-	return KNOT_EOK;
+	memcpy(knot_tcp_outbuf_data(outbuf), data, data_len);
+
+	return knot_tcp_relay_answer_outbuf(relays, relay, tcp_table, outbuf, data_len);
 }
 
 _public_
@@ -444,6 +570,132 @@ void knot_tcp_relay_free(knot_tcp_relay_dynarray_t *relays)
 	knot_tcp_relay_dynarray_free(relays);
 }
 
+#define TCP_SEND_BATCH 20
+
+typedef struct {
+	knot_xdp_socket_t *socket;
+	knot_xdp_msg_t msgs[TCP_SEND_BATCH];
+	uint32_t count;
+} send_batch_t;
+
+static void send_flush(send_batch_t *batch)
+{
+	uint32_t sent_unused;
+	(void)knot_xdp_send(batch->socket, batch->msgs, batch->count, &sent_unused);
+	batch->count = 0;
+}
+
+static int send_alloc(send_batch_t *batch, const knot_tcp_conn_t *conn,
+                      knot_xdp_msg_t **out)
+{
+	if (batch->count == TCP_SEND_BATCH) {
+		send_flush(batch);
+	}
+
+	knot_xdp_msg_flag_t fl = KNOT_XDP_MSG_TCP;
+	if (conn->ip_loc.sin6_family == AF_INET6) {
+		fl |= KNOT_XDP_MSG_IPV6;
+	}
+
+	knot_xdp_msg_t *msg = &batch->msgs[batch->count];
+	int ret = knot_xdp_send_alloc(batch->socket, fl, msg);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+	batch->count++;
+
+	memcpy( msg->eth_from, conn->last_eth_loc, sizeof(msg->eth_from));
+	memcpy( msg->eth_to,   conn->last_eth_rem, sizeof(msg->eth_to));
+	memcpy(&msg->ip_from, &conn->ip_loc,  sizeof(msg->ip_from));
+	memcpy(&msg->ip_to,   &conn->ip_rem,  sizeof(msg->ip_to));
+
+	msg->ackno = conn->seqno;
+	msg->seqno = conn->ackno;
+
+	*out = msg;
+	return KNOT_EOK;
+}
+
+/*!
+ * \brief Send the queued data between the sequence numbers, split into segments.
+ *
+ * \param from  In/out: sequence number of the first byte, moved after the sent data.
+ * \param to    Sequence number following the last byte.
+ */
+static int send_data(send_batch_t *batch, knot_tcp_conn_t *conn,
+                     uint32_t *from, uint32_t to)
+{
+	knot_tcp_outbuf_t *ob = conn->outbufs;
+	while (ob != NULL && *from - ob->seqno >= ob->len) {
+		ob = ob->next;
+	}
+
+	while (ob != NULL && tcp_seq_lt(*from, to)) {
+		knot_xdp_msg_t *msg;
+		int ret = send_alloc(batch, conn, &msg);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+		msg->flags |= KNOT_XDP_MSG_ACK;
+		msg->seqno = *from;
+
+		size_t seg = MIN(conn->mss, msg->payload.iov_len), len = 0;
+		seg = MIN(seg, to - *from);
+		while (ob != NULL && len < seg) {
+			size_t offset = *from - ob->seqno;
+			size_t chunk = MIN(ob->len - offset, seg - len);
+			memcpy(msg->payload.iov_base + len, ob->bytes + offset, chunk);
+			len += chunk;
+			*from += chunk;
+			if (offset + chunk == ob->len) {
+				ob = ob->next;
+			}
+		}
+		msg->payload.iov_len = len;
+	}
+
+	return KNOT_EOK;
+}
+
+static int send_fin(send_batch_t *batch, knot_tcp_conn_t *conn)
+{
+	knot_xdp_msg_t *msg;
+	int ret = send_alloc(batch, conn, &msg);
+	if (ret == KNOT_EOK) {
+		msg->flags |= (KNOT_XDP_MSG_FIN | KNOT_XDP_MSG_ACK);
+		msg->payload.iov_len = 0;
+		conn->ackno++;
+		conn->state = XDP_TCP_CLOSING;
+	}
+	return ret;
+}
+
+static int send_outbufs(send_batch_t *batch, knot_tcp_conn_t *conn, bool resend)
+{
+	uint32_t end = tcp_outbufs_end(conn->outbufs, conn->ackno);
+	uint32_t window_end = conn->acked + conn->window_size;
+
+	if (resend) {
+		// Resend the unacknowledged data, at least one segment as a window probe.
+		uint32_t from = conn->acked, to = tcp_conn_sent(conn);
+		uint32_t limit = tcp_seq_lt(window_end, from + conn->mss) ? from + conn->mss : window_end;
+		if (tcp_seq_lt(limit, to)) {
+			to = limit;
+		}
+		return send_data(batch, conn, &from, to);
+	}
+
+	if (conn->state == XDP_TCP_CLOSING) {
+		return KNOT_EOK;
+	}
+	uint32_t to = tcp_seq_lt(window_end, end) ? window_end : end;
+	int ret = send_data(batch, conn, &conn->ackno, to);
+	if (ret == KNOT_EOK && conn->state == XDP_TCP_FIN_PENDING && conn->ackno == end) {
+		ret = send_fin(batch, conn);
+	}
+	return ret;
+}
+
 _public_
 int knot_tcp_send(knot_xdp_socket_t *socket, knot_tcp_relay_t relays[], uint32_t relay_count)
 {
@@ -454,74 +706,48 @@ int knot_tcp_send(knot_xdp_socket_t *socket, knot_tcp_relay_t relays[], uint32_t
 		return KNOT_EINVAL;
 	}
 
-	knot_xdp_msg_t msgs[relay_count], *msg = &msgs[0];
-	int ret = KNOT_EOK, n_msgs = 0;
+	send_batch_t batch = { .socket = socket };
+	int ret = KNOT_EOK;
 
-	for (size_t irl = 0; irl < relay_count; irl++) {
+	for (size_t irl = 0; irl < relay_count && ret == KNOT_EOK; irl++) {
 		knot_tcp_relay_t *rl = &relays[irl];
-		if ((rl->answer & 0x0f) == XDP_TCP_NOOP) {
-			continue;
-		}
-
-		knot_xdp_msg_flag_t fl = KNOT_XDP_MSG_TCP;
-		if (rl->conn->ip_loc.sin6_family == AF_INET6) {
-			fl |= KNOT_XDP_MSG_IPV6;
-		}
-
-		ret = knot_xdp_send_alloc(socket, fl, msg);
-		if (ret != KNOT_EOK) {
-			break;
-		}
-
-		memcpy( msg->eth_from, rl->conn->last_eth_loc, sizeof(msg->eth_from));
-		memcpy( msg->eth_to,   rl->conn->last_eth_rem, sizeof(msg->eth_to));
-		memcpy(&msg->ip_from, &rl->conn->ip_loc,  sizeof(msg->ip_from));
-		memcpy(&msg->ip_to,   &rl->conn->ip_rem,  sizeof(msg->ip_to));
-
-		msg->ackno = rl->conn->seqno;
-		msg->seqno = rl->conn->ackno;
+		knot_xdp_msg_t *msg;
 
 		switch (rl->answer & 0x0f) {
+		case XDP_TCP_NOOP:
+			break;
 		case XDP_TCP_ESTABLISH:
-			msg->flags |= KNOT_XDP_MSG_SYN;
-			msg->payload.iov_len = 0;
+			ret = send_alloc(&batch, rl->conn, &msg);
+			if (ret == KNOT_EOK) {
+				msg->flags |= KNOT_XDP_MSG_SYN;
+				msg->payload.iov_len = 0;
+			}
 			break;
 		case XDP_TCP_DATA:
-			msg->flags |= KNOT_XDP_MSG_ACK;
-			if (rl->data.iov_len > UINT16_MAX ||
-			    rl->data.iov_len > msg->payload.iov_len) {
-				ret = KNOT_ESPACE;
-			} else {
-				memcpy(msg->payload.iov_base, rl->data.iov_base,
-				       rl->data.iov_len);
-				msg->payload.iov_len = rl->data.iov_len;
-			}
+		case XDP_TCP_RESEND:
 			assert(rl->conn != NULL);
-			rl->conn->ackno += msg->payload.iov_len;
+			ret = send_outbufs(&batch, rl->conn, (rl->answer & 0x0f) == XDP_TCP_RESEND);
 			break;
 		case XDP_TCP_CLOSE:
-			msg->flags |= (KNOT_XDP_MSG_FIN | KNOT_XDP_MSG_ACK);
-			msg->payload.iov_len = 0;
 			assert(rl->conn != NULL);
-			rl->conn->ackno++;
-			rl->conn->state = XDP_TCP_CLOSING;
+			if (rl->conn->state != XDP_TCP_CLOSING) {
+				// FIN is sent after the queued data.
+				rl->conn->state = XDP_TCP_FIN_PENDING;
+				ret = send_outbufs(&batch, rl->conn, false);
+			}
 			break;
 		case XDP_TCP_RESET:
 		default:
-			msg->flags |= KNOT_XDP_MSG_RST;
-			msg->payload.iov_len = 0;
-			break;
-		}
-
-		msg++;
-		n_msgs++;
-		if (ret != KNOT_EOK) {
+			ret = send_alloc(&batch, rl->conn, &msg);
+			if (ret == KNOT_EOK) {
+				msg->flags |= KNOT_XDP_MSG_RST;
+				msg->payload.iov_len = 0;
+			}
 			break;
 		}
 	}
 
-	uint32_t sent_unused;
-	(void)knot_xdp_send(socket, msgs, n_msgs, &sent_unused);
+	send_flush(&batch);
 
 	return ret;
 }
@@ -529,7 +755,7 @@ int knot_tcp_send(knot_xdp_socket_t *socket, knot_tcp_relay_t relays[], uint32_t
 _public_
 int knot_tcp_sweep(knot_tcp_table_t *tcp_table, knot_xdp_socket_t *socket,
                    uint32_t max_at_once, uint32_t close_timeout, uint32_t reset_timeout,
-                   uint32_t reset_at_least, size_t reset_buf_size,
+                   uint32_t resend_timeout, uint32_t reset_at_least, size_t reset_buf_size,
                    uint32_t *close_count, uint32_t *reset_count)
 {
 	if (tcp_table == NULL) {
@@ -540,22 +766,52 @@ int knot_tcp_sweep(knot_tcp_table_t *tcp_table, knot_xdp_socket_t *socket,
 	knot_tcp_relay_dynarray_t relays = { 0 };
 	uint32_t now = get_timestamp(), i = 0;
 	knot_tcp_conn_t *conn, *next;
-	list_t to_remove;
+	list_t to_remove, restarted;
 	init_list(&to_remove);
+	init_list(&restarted);
+
+	// Resend the unacknowledged data of the connections with expired resend timer.
+	node_t *node, *next_node;
+	WALK_LIST_DELSAFE(node, next_node, *tcp_table_resend(tcp_table)) {
+		conn = tcp_resend_node_conn(node);
+		if (now - conn->resend_start < resend_timeout || relays.size >= max_at_once) {
+			break;
+		}
+		// The restarted timers are appended after the walk.
+		rem_node(node);
+		conn->resend_start = now;
+		add_tail(&restarted, node);
+
+		if (tcp_seq_lt(conn->acked, tcp_conn_sent(conn))) {
+			rl.answer = XDP_TCP_RESEND;
+			rl.conn = conn;
+			(void)knot_tcp_relay_dynarray_add(&relays, &rl);
+		}
+	}
+	WALK_LIST_DELSAFE(node, next_node, restarted) {
+		rem_node(node);
+		add_tail(tcp_table_resend(tcp_table), node);
+	}
 
 	WALK_LIST_DELSAFE(conn, next, *tcp_table_timeout(tcp_table)) {
+		if (relays.size >= max_at_once) {
+			break;
+		}
+
+		rl.answer = XDP_TCP_NOOP;
+		size_t buf_size = conn->inbuf.iov_len + tcp_outbufs_size(conn->outbufs);
 		if (i++ < reset_at_least ||
 		    now - conn->last_active >= reset_timeout ||
-		    (reset_buf_size > 0 && conn->inbuf.iov_len > 0)) {
+		    (reset_buf_size > 0 && buf_size > 0)) {
 			rl.answer = XDP_TCP_RESET;
 
 			// move this conn into to-remove list
 			rem_node((node_t *)conn);
 			add_tail(&to_remove, (node_t *)conn);
 
-			reset_buf_size -= MIN(reset_buf_size, conn->inbuf.iov_len);
+			reset_buf_size -= MIN(reset_buf_size, buf_size);
 		} else if (now - conn->last_active >= close_timeout) {
-			if (conn->state != XDP_TCP_CLOSING) {
+			if (conn->state != XDP_TCP_CLOSING && conn->state != XDP_TCP_FIN_PENDING) {
 				rl.answer = XDP_TCP_CLOSE;
 				if (close_count != NULL) {
 					(*close_count)++;
@@ -565,11 +821,11 @@ int knot_tcp_sweep(knot_tcp_table_t *tcp_table, knot_xdp_socket_t *socket,
 			break;
 		}
 
+		if (rl.answer == XDP_TCP_NOOP) {
+			continue;
+		}
 		rl.conn = conn;
 		(void)knot_tcp_relay_dynarray_add(&relays, &rl);
-		if (relays.size >= max_at_once) {
-			break;
-		}
 	}
 
 	knot_xdp_send_prepare(socket);
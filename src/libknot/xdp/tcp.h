@@ -35,6 +35,7 @@ typedef enum {
 	XDP_TCP_ESTABLISH = 2,
 	XDP_TCP_CLOSE     = 3,
 	XDP_TCP_RESET     = 4,
+	XDP_TCP_RESEND    = 5,
 	XDP_TCP_DATA      = (1 << 3),
 	XDP_TCP_ANSWER    = (1 << 4),
 } knot_tcp_action_t;
@@ -43,6 +44,7 @@ typedef enum {
 	XDP_TCP_NORMAL,
 	XDP_TCP_ESTABLISHING,
 	XDP_TCP_CLOSING,
+	XDP_TCP_FIN_PENDING, /*!< FIN to be sent after the queued data. */
 } knot_tcp_state_t;
 
 typedef enum {
@@ -51,6 +53,14 @@ typedef enum {
 	XDP_TCP_FREE_PREFIX,
 } knot_tcp_relay_free_t;
 
+/*! \brief Outgoing DNS message kept until acknowledged by the peer. */
+typedef struct knot_tcp_outbuf {
+	struct knot_tcp_outbuf *next;
+	uint32_t len;     /*!< Length including the two-byte DNS message length prefix. */
+	uint32_t seqno;   /*!< TCP sequence number of the first byte. */
+	uint8_t bytes[];
+} knot_tcp_outbuf_t;
+
 typedef struct knot_tcp_conn {
 	struct {
 		void *list_node_placeholder1;
@@ -64,16 +74,24 @@ typedef struct knot_tcp_conn {
 	uint32_t seqno;
 	uint32_t ackno;
 	uint32_t acked;
+	uint32_t window_size;
+	uint8_t window_scale;
 	uint32_t last_active;
+	uint32_t resend_start; /*!< Resend deadline is this plus the resend timeout. */
+	struct {
+		void *list_node_placeholder1;
+		void *list_node_placeholder2;
+	} resend_node_placeholder;
 	knot_tcp_state_t state;
 	struct iovec inbuf;
+	knot_tcp_outbuf_t *outbufs;
 	struct knot_tcp_conn *next;
 } knot_tcp_conn_t;
 
 typedef struct {
 	size_t size;
 	size_t usage;
-	size_t inbufs_total;
+	size_t inbufs_total; /*!< Input and queued output buffers size. */
 	uint64_t hash_secret[2];
 	knot_tcp_conn_t *conns[];
 } knot_tcp_table_t;
@@ -142,15 +160,59 @@ int knot_tcp_relay(knot_xdp_socket_t *socket, knot_xdp_msg_t msgs[], uint32_t ms
 /*!
  * \brief Fetch answer to one relay with one or more relays with data payload.
  *
- * \param relays    Relays.
- * \param relay     The relay to answer to.
- * \param data      Data payload, possibly > MSS.
- * \param data_len  Payload length.
+ * The data is copied into the connection output queue and kept there until
+ * acknowledged by the peer.
+ *
+ * \param relays     Relays.
+ * \param relay      The relay to answer to.
+ * \param tcp_table  Table of TCP connections, the queued data is counted in its buffers.
+ * \param data       Data payload, possibly > MSS.
+ * \param data_len   Payload length.
  *
  * \return KNOT_EOK, KNOT_ENOMEM
  */
 int knot_tcp_relay_answer(knot_tcp_relay_dynarray_t *relays, const knot_tcp_relay_t *relay,
-                          void *data, size_t data_len);
+                          knot_tcp_table_t *tcp_table, void *data, size_t data_len);
+
+/*!
+ * \brief Allocate an output buffer for building an answer in place.
+ *
+ * \param max_len  Maximal length of the DNS message.
+ *
+ * \return The buffer, or NULL.
+ */
+knot_tcp_outbuf_t *knot_tcp_outbuf_alloc(size_t max_len);
+
+/*!
+ * \brief Return the space for the DNS message in the output buffer.
+ */
+inline static uint8_t *knot_tcp_outbuf_data(knot_tcp_outbuf_t *outbuf)
+{
+	return outbuf->bytes + sizeof(uint16_t);
+}
+
+/*!
+ * \brief Free an output buffer not passed to knot_tcp_relay_answer_outbuf().
+ */
+void knot_tcp_outbuf_free(knot_tcp_outbuf_t *outbuf);
+
+/*!
+ * \brief Fetch answer built in an output buffer to one relay.
+ *
+ * \note The output buffer is consumed (queued or freed) in any case.
+ *
+ * \param relays     Relays.
+ * \param relay      The relay to answer to.
+ * \param tcp_table  Table of TCP connections, the queued data is counted in its buffers.
+ * \param outbuf     Output buffer allocated by knot_tcp_outbuf_alloc().
+ * \param data_len   Length of the DNS message in the output buffer.
+ *
+ * \return KNOT_EOK, KNOT_ENOMEM
+ */
+int knot_tcp_relay_answer_outbuf(knot_tcp_relay_dynarray_t *relays,
+                                 const knot_tcp_relay_t *relay,
+                                 knot_tcp_table_t *tcp_table,
+                                 knot_tcp_outbuf_t *outbuf, size_t data_len);
 
 /*!
  * \brief Free resources in 'relays'.
@@ -160,6 +222,11 @@ void knot_tcp_relay_free(knot_tcp_relay_dynarray_t *relays);
 /*!
  * \brief Send TCP packets.
  *
+ * The data answers send the queued data of the connection, split into segments
+ * and limited by the peer's receive window. The data is kept until acknowledged.
+ * The close answer sends FIN after the last queued byte, possibly later when
+ * the window opens.
+ *
  * \param socket       XDP socket to send through.
  * \param relays       Connection changes and data.
  * \param relay_count  Number of connection changes and data.
@@ -176,10 +243,11 @@ int knot_tcp_send(knot_xdp_socket_t *socket, knot_tcp_relay_t relays[], uint32_t
  * \param max_at_once      Don't close more connections at once.
  * \param close_timeout    Gracefully close connections older than this (usecs).
  * \param reset_timeout    Reset connections older than this (usecs).
+ * \param resend_timeout   Resend data not acknowledged this long after sending (usecs).
  * \param reset_at_least   Reset at least this number of oldest connections, even
  *                         when not yet timed out.
  * \param reset_buf_size   Reset oldest connection with buffered partial DNS messages
- *                         to free up this amount of space.
+ *                         or queued output data to free up this amount of space.
  * \param close_count      Optional: Out: incremented with number of closed connections.
  * \param reset_count      Optional: Out: incremented with number of reset connections.
  *
@@ -187,7 +255,7 @@ int knot_tcp_send(knot_xdp_socket_t *socket, knot_tcp_relay_t relays[], uint32_t
  */
 int knot_tcp_sweep(knot_tcp_table_t *tcp_table, knot_xdp_socket_t *socket,
                    uint32_t max_at_once, uint32_t close_timeout, uint32_t reset_timeout,
-                   uint32_t reset_at_least, size_t reset_buf_size,
+                   uint32_t resend_timeout, uint32_t reset_at_least, size_t reset_buf_size,
                    uint32_t *close_count, uint32_t *reset_count);
 
 /*! @} */
@@ -91,3 +91,61 @@ int tcp_inbuf_update(struct iovec *buffer, struct iovec *data,
 	}
 	return KNOT_EOK;
 }
+
+void tcp_outbufs_add(knot_tcp_outbuf_t **bufs, knot_tcp_outbuf_t *buf, size_t data_len,
+                     uint32_t snd_nxt, size_t *buffers_total)
+{
+	assert(data_len <= UINT16_MAX);
+	uint16_t prefix = htobe16(data_len);
+	memcpy(buf->bytes, &prefix, sizeof(prefix));
+	buf->len = data_len + sizeof(prefix);
+	buf->next = NULL;
+
+	// The buffer was allocated for the largest possible message.
+	knot_tcp_outbuf_t *shrunk = realloc(buf, sizeof(*buf) + buf->len);
+	if (shrunk != NULL) {
+		buf = shrunk;
+	}
+
+	while (*bufs != NULL) {
+		snd_nxt = (*bufs)->seqno + (*bufs)->len;
+		bufs = &(*bufs)->next;
+	}
+	buf->seqno = snd_nxt;
+	*bufs = buf;
+	*buffers_total += buf->len;
+}
+
+void tcp_outbufs_ack(knot_tcp_outbuf_t **bufs, uint32_t ackno, size_t *buffers_total)
+{
+	while (*bufs != NULL && !tcp_seq_lt(ackno, (*bufs)->seqno + (*bufs)->len)) {
+		knot_tcp_outbuf_t *acked = *bufs;
+		*bufs = acked->next;
+		assert(*buffers_total >= acked->len);
+		*buffers_total -= acked->len;
+		free(acked);
+	}
+}
+
+uint32_t tcp_outbufs_end(const knot_tcp_outbuf_t *bufs, uint32_t snd_nxt)
+{
+	while (bufs != NULL) {
+		snd_nxt = bufs->seqno + bufs->len;
+		bufs = bufs->next;
+	}
+	return snd_nxt;
+}
+
+size_t tcp_outbufs_size(const knot_tcp_outbuf_t *bufs)
+{
+	size_t size = 0;
+	for (; bufs != NULL; bufs = bufs->next) {
+		size += bufs->len;
+	}
+	return size;
+}
+
+void tcp_outbufs_free(knot_tcp_outbuf_t **bufs, size_t *buffers_total)
+{
+	tcp_outbufs_ack(bufs, tcp_outbufs_end(*bufs, 0), buffers_total);
+}
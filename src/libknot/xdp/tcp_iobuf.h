@@ -26,10 +26,20 @@
 #pragma once
 
 #include <assert.h>
+#include <stdbool.h>
 #include <string.h>
 #include <sys/uio.h>
 
 #include "libknot/endian.h"
+#include "libknot/xdp/tcp.h"
+
+/*!
+ * \brief Compare TCP sequence numbers with respect to the wrap-around.
+ */
+inline static bool tcp_seq_lt(uint32_t a, uint32_t b)
+{
+	return (int32_t)(a - b) < 0;
+}
 
 /*!
  * \brief Return the required length for payload buffer.
@@ -55,4 +65,46 @@ inline static size_t tcp_payload_len(const struct iovec *payload)
 int tcp_inbuf_update(struct iovec *buffer, struct iovec *data,
                      struct iovec *data_tofree, size_t *buffers_total);
 
+/*!
+ * \brief Append a DNS message to the connection output queue.
+ *
+ * \param bufs           In/out: output queue of the connection.
+ * \param buf            Output buffer with the DNS message after the length prefix.
+ * \param data_len       Length of the DNS message.
+ * \param snd_nxt        Sequence number of the next byte to be sent if the queue is empty.
+ * \param buffers_total  In/Out: total size of buffers (will be increased).
+ */
+void tcp_outbufs_add(knot_tcp_outbuf_t **bufs, knot_tcp_outbuf_t *buf, size_t data_len,
+                     uint32_t snd_nxt, size_t *buffers_total);
+
+/*!
+ * \brief Free the queued DNS messages acknowledged by the peer.
+ *
+ * \param bufs           In/out: output queue of the connection.
+ * \param ackno          Acknowledged sequence number.
+ * \param buffers_total  In/Out: total size of buffers (will be decreased).
+ */
+void tcp_outbufs_ack(knot_tcp_outbuf_t **bufs, uint32_t ackno, size_t *buffers_total);
+
+/*!
+ * \brief Return the sequence number following the last queued byte.
+ *
+ * \param bufs     Output queue of the connection.
+ * \param snd_nxt  Returned if the queue is empty.
+ */
+uint32_t tcp_outbufs_end(const knot_tcp_outbuf_t *bufs, uint32_t snd_nxt);
+
+/*!
+ * \brief Return the total length of the queued DNS messages.
+ */
+size_t tcp_outbufs_size(const knot_tcp_outbuf_t *bufs);
+
+/*!
+ * \brief Free the whole connection output queue.
+ *
+ * \param bufs           In/out: output queue of the connection.
+ * \param buffers_total  In/Out: total size of buffers (will be decreased).
+ */
+void tcp_outbufs_free(knot_tcp_outbuf_t **bufs, size_t *buffers_total);
+
 /*! @} */
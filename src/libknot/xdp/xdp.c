@@ -16,6 +16,7 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <inttypes.h>
 #include <linux/if_ether.h>
 #include <linux/ip.h>
 #include <linux/ipv6.h>
@@ -23,6 +24,8 @@
 #include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
 #include <time.h>
 #include <unistd.h>
 
@@ -37,94 +40,272 @@
 #include "contrib/macros.h"
 #include "contrib/net.h"
 
-#define FRAME_SIZE 2048
-#define UMEM_FRAME_COUNT_RX 4096
-#define UMEM_FRAME_COUNT_TX UMEM_FRAME_COUNT_RX // No reason to differ so far.
-#define UMEM_RING_LEN_RX (UMEM_FRAME_COUNT_RX * 2)
-#define UMEM_RING_LEN_TX (UMEM_FRAME_COUNT_TX * 2)
-#define UMEM_FRAME_COUNT (UMEM_FRAME_COUNT_RX + UMEM_FRAME_COUNT_TX)
+#define RING_SIZE_MIN     64
+#define RING_SIZE_MAX     (1 << 20)
+#define HUGEPAGE_SIZE     (2 * 1024 * 1024)
 
 #define ALLOC_RETRY_NUM   15
 #define ALLOC_RETRY_DELAY 20 // In nanoseconds.
 
-/* With recent compilers we statically check #defines for settings that
- * get refused by AF_XDP drivers (in current versions, at least). */
-#if (__STDC_VERSION__ >= 201112L)
+#define TX_POOL_BATCH     32 // Frames moved between a socket and the shared pool at once.
+
 #define IS_POWER_OF_2(n) (((n) & (n - 1)) == 0)
-_Static_assert((FRAME_SIZE == 4096 || FRAME_SIZE == 2048)
-	&& IS_POWER_OF_2(UMEM_FRAME_COUNT)
-	/* The following two inequalities aren't required by drivers, but they allow
-	 * our implementation assume that the rings can never get filled. */
-	&& IS_POWER_OF_2(UMEM_RING_LEN_RX) && UMEM_RING_LEN_RX > UMEM_FRAME_COUNT_RX
-	&& IS_POWER_OF_2(UMEM_RING_LEN_TX) && UMEM_RING_LEN_TX > UMEM_FRAME_COUNT_TX
-	&& UMEM_FRAME_COUNT_TX <= (1 << 16) /* see tx_free_indices */
-	, "Incorrect #define combination for AF_XDP.");
+
+#ifndef SOL_XDP
+#define SOL_XDP 283
 #endif
 
-struct umem_frame {
-	uint8_t bytes[FRAME_SIZE];
+/* XDP_STATISTICS layout (older kernels fill in just the first three fields). */
+struct xdp_statistics_v2 {
+	uint64_t rx_dropped;
+	uint64_t rx_invalid_descs;
+	uint64_t tx_invalid_descs;
+	uint64_t rx_ring_full;
+	uint64_t rx_fill_ring_empty_descs;
+	uint64_t tx_ring_empty_descs;
 };
 
-static int configure_xsk_umem(struct kxsk_umem **out_umem)
+/*
+ * The UMEM for N sockets consists of N * ring_size TX frames followed by
+ * ring_size RX frames for each socket. A private UMEM (N = 1) gives all
+ * the TX frames to its socket. The TX frames of a shared UMEM form a pool,
+ * the sockets take them in batches and return the surplus, so a socket
+ * can hold up to 2 * ring_size TX frames. The fill, completion, RX, and
+ * TX rings are 2 * ring_size long, so our implementation can assume that
+ * the rings never get filled.
+ */
+
+static int check_config(uint32_t ring_size, uint32_t frame_size)
 {
-	/* Allocate memory and call driver to create the UMEM. */
-	struct kxsk_umem *umem = calloc(1,
-		offsetof(struct kxsk_umem, tx_free_indices)
-		+ sizeof(umem->tx_free_indices[0]) * UMEM_FRAME_COUNT_TX);
+	/* Settings that get refused by AF_XDP drivers (in current versions, at least). */
+	if ((frame_size != 4096 && frame_size != 2048) ||
+	    !IS_POWER_OF_2(ring_size) || ring_size < RING_SIZE_MIN ||
+	    ring_size > RING_SIZE_MAX) {
+		return KNOT_EINVAL;
+	}
+
+	return KNOT_EOK;
+}
+
+static void umem_free(struct knot_xdp_umem *umem)
+{
+	if (umem->umem != NULL) {
+		(void)xsk_umem__delete(umem->umem);
+	}
+	if (umem->frames != NULL) {
+		(void)munmap(umem->frames, umem->size);
+	}
+	knot_spin_destroy(&umem->tx_lock);
+	free(umem);
+}
+
+static void umem_unref(struct knot_xdp_umem *umem)
+{
+	if (umem != NULL && --umem->refcount == 0) {
+		umem_free(umem);
+	}
+}
+
+static int umem_new(const knot_xdp_config_t *config, unsigned sockets,
+                    struct knot_xdp_umem **out_umem)
+{
+	uint32_t ring_size = KNOT_XDP_RING_SIZE_DEFAULT;
+	uint32_t frame_size = KNOT_XDP_FRAME_SIZE_DEFAULT;
+	bool hugepages = false;
+	if (config != NULL) {
+		ring_size = (config->ring_size > 0) ? config->ring_size : ring_size;
+		frame_size = (config->frame_size > 0) ? config->frame_size : frame_size;
+		hugepages = config->hugepages;
+	}
+	if (check_config(ring_size, frame_size) != KNOT_EOK ||
+	    sockets > UINT32_MAX / (2 * ring_size)) {
+		return KNOT_EINVAL;
+	}
+
+	/* A private UMEM doesn't need the shared pool of TX frames. */
+	const uint32_t pool_size = (sockets > 1) ? sockets * ring_size : 0;
+	struct knot_xdp_umem *umem = calloc(1,
+		offsetof(struct knot_xdp_umem, tx_free_indices)
+		+ sizeof(umem->tx_free_indices[0]) * pool_size);
 	if (umem == NULL) {
 		return KNOT_ENOMEM;
 	}
+	umem->frame_size = frame_size;
+	umem->ring_size = ring_size;
+	umem->sockets = sockets;
+	umem->refcount = 1;
+	umem->hugepages = hugepages;
 
-	int ret = posix_memalign((void **)&umem->frames, getpagesize(),
-	                         FRAME_SIZE * UMEM_FRAME_COUNT);
-	if (ret != 0) {
-		free(umem);
-		return KNOT_ENOMEM;
+	umem->size = (size_t)frame_size * 2 * ring_size * sockets;
+	if (hugepages) {
+		umem->size = (umem->size + HUGEPAGE_SIZE - 1) & ~((size_t)HUGEPAGE_SIZE - 1);
+	}
+
+	knot_spin_init(&umem->tx_lock);
+	umem->tx_free_count = pool_size;
+	for (uint32_t i = 0; i < pool_size; ++i) {
+		umem->tx_free_indices[i] = i;
+	}
+
+	*out_umem = umem;
+	return KNOT_EOK;
+}
+
+_public_
+int knot_xdp_umem_init(knot_xdp_umem_t **out_umem, const knot_xdp_config_t *config,
+                       unsigned sockets)
+{
+	if (out_umem == NULL || sockets == 0) {
+		return KNOT_EINVAL;
+	}
+#ifndef HAVE_XSK_SOCKET__CREATE_SHARED
+	if (sockets > 1) {
+		return KNOT_ENOTSUP;
+	}
+#endif
+
+	struct knot_xdp_umem *umem = NULL;
+	int ret = umem_new(config, sockets, &umem);
+	if (ret != KNOT_EOK) {
+		return ret;
 	}
 
-	const struct xsk_umem_config config = {
-		.fill_size = UMEM_RING_LEN_RX,
-		.comp_size = UMEM_RING_LEN_TX,
-		.frame_size = FRAME_SIZE,
+	/* Allocate memory and call driver to create the UMEM. */
+	int flags = MAP_PRIVATE | MAP_ANONYMOUS | (umem->hugepages ? MAP_HUGETLB : 0);
+	void *frames = mmap(NULL, umem->size, PROT_READ | PROT_WRITE, flags, -1, 0);
+	if (frames == MAP_FAILED) {
+		ret = knot_map_errno();
+		umem_free(umem);
+		return ret;
+	}
+	umem->frames = frames;
+
+	const struct xsk_umem_config umem_conf = {
+		.fill_size = 2 * umem->ring_size,
+		.comp_size = 2 * umem->ring_size,
+		.frame_size = umem->frame_size,
 		.frame_headroom = 0,
 	};
 
-	ret = xsk_umem__create(&umem->umem, umem->frames, FRAME_SIZE * UMEM_FRAME_COUNT,
-	                       &umem->fq, &umem->cq, &config);
+	ret = xsk_umem__create(&umem->umem, umem->frames, umem->size,
+	                       &umem->fq, &umem->cq, &umem_conf);
 	if (ret != KNOT_EOK) {
-		free(umem->frames);
-		free(umem);
+		umem->umem = NULL;
+		umem_free(umem);
 		return ret;
 	}
+
 	*out_umem = umem;
+	return KNOT_EOK;
+}
 
-	/* Designate the starting chunk of buffers for TX, and put them onto the stack. */
-	umem->tx_free_count = UMEM_FRAME_COUNT_TX;
-	for (uint32_t i = 0; i < UMEM_FRAME_COUNT_TX; ++i) {
-		umem->tx_free_indices[i] = i;
+_public_
+void knot_xdp_umem_deinit(knot_xdp_umem_t *umem)
+{
+	umem_unref(umem);
+}
+
+static void tx_free_relative(struct kxsk_umem *umem, uint64_t addr_relative)
+{
+	/* The address may not point to *start* of buffer, but `/` solves that. */
+	uint64_t index = addr_relative / umem->frame_size;
+	assert(index < umem->shared->sockets * umem->ring_size);
+	assert(umem->tx_free_count < umem->tx_owned);
+	umem->tx_free_indices[umem->tx_free_count++] = index;
+}
+
+static uint32_t tx_pool_take(struct kxsk_umem *umem)
+{
+	struct knot_xdp_umem *shared = umem->shared;
+	if (shared->sockets == 1) {
+		return 0;
 	}
 
-	/* Designate the rest of buffers for RX, and pass them to the driver. */
-	uint32_t idx = 0;
-	ret = xsk_ring_prod__reserve(&umem->fq, UMEM_FRAME_COUNT_RX, &idx);
-	if (ret != UMEM_FRAME_COUNT - UMEM_FRAME_COUNT_TX) {
-		assert(0);
-		return KNOT_ERROR;
+	knot_spin_lock(&shared->tx_lock);
+	uint32_t count = MIN(shared->tx_free_count, umem->tx_max - umem->tx_owned);
+	count = MIN(count, TX_POOL_BATCH);
+	shared->tx_free_count -= count;
+	memcpy(umem->tx_free_indices + umem->tx_free_count,
+	       shared->tx_free_indices + shared->tx_free_count,
+	       count * sizeof(umem->tx_free_indices[0]));
+	knot_spin_unlock(&shared->tx_lock);
+
+	umem->tx_owned += count;
+	umem->tx_free_count += count;
+	return count;
+}
+
+static void tx_pool_return(struct kxsk_umem *umem, uint32_t keep)
+{
+	struct knot_xdp_umem *shared = umem->shared;
+	if (shared->sockets == 1 || umem->tx_free_count <= keep) {
+		return;
 	}
-	assert(idx == 0);
-	for (uint32_t i = UMEM_FRAME_COUNT_TX; i < UMEM_FRAME_COUNT; ++i) {
-		*xsk_ring_prod__fill_addr(&umem->fq, idx++) = i * FRAME_SIZE;
+
+	const uint32_t count = umem->tx_free_count - keep;
+	umem->tx_free_count = keep;
+	umem->tx_owned -= count;
+
+	knot_spin_lock(&shared->tx_lock);
+	memcpy(shared->tx_free_indices + shared->tx_free_count,
+	       umem->tx_free_indices + keep,
+	       count * sizeof(umem->tx_free_indices[0]));
+	shared->tx_free_count += count;
+	knot_spin_unlock(&shared->tx_lock);
+}
+
+static int configure_xsk_umem(struct knot_xdp_umem *shared, struct kxsk_umem **out_umem)
+{
+	if (shared->used == shared->sockets) {
+		return KNOT_ESPACE;
 	}
-	xsk_ring_prod__submit(&umem->fq, UMEM_FRAME_COUNT_RX);
 
+	const uint32_t ring_size = shared->ring_size;
+	const uint32_t tx_max = (shared->sockets > 1) ? 2 * ring_size : ring_size;
+	struct kxsk_umem *umem = calloc(1,
+		offsetof(struct kxsk_umem, tx_free_indices)
+		+ sizeof(umem->tx_free_indices[0]) * tx_max);
+	if (umem == NULL) {
+		return KNOT_ENOMEM;
+	}
+	umem->shared = shared;
+	umem->frames = shared->frames;
+	umem->frame_size = shared->frame_size;
+	umem->ring_size = ring_size;
+	umem->tx_max = tx_max;
+
+	/* A private UMEM puts all the TX buffers onto the stack, a shared one
+	 * leaves them in the pool. */
+	if (shared->sockets == 1) {
+		umem->tx_owned = ring_size;
+		umem->tx_free_count = ring_size;
+		for (uint32_t i = 0; i < ring_size; ++i) {
+			umem->tx_free_indices[i] = i;
+		}
+	}
+
+	*out_umem = umem;
 	return KNOT_EOK;
 }
 
-static void deconfigure_xsk_umem(struct kxsk_umem *umem)
+static int fill_xsk_umem(struct kxsk_umem *umem, unsigned slot)
 {
-	(void)xsk_umem__delete(umem->umem);
-	free(umem->frames);
-	free(umem);
+	/* Designate the socket's buffers for RX, and pass them to the driver. */
+	const uint32_t ring_size = umem->ring_size;
+	const uint32_t first = (umem->shared->sockets + slot) * ring_size;
+
+	uint32_t idx = 0;
+	int ret = xsk_ring_prod__reserve(&umem->fq, ring_size, &idx);
+	if (ret != ring_size) {
+		assert(0);
+		return KNOT_ERROR;
+	}
+	for (uint32_t i = first; i < first + ring_size; ++i) {
+		*xsk_ring_prod__fill_addr(&umem->fq, idx++) = (uint64_t)i * umem->frame_size;
+	}
+	xsk_ring_prod__submit(&umem->fq, ring_size);
+
+	return KNOT_EOK;
 }
 
 static int configure_xsk_socket(struct kxsk_umem *umem,
@@ -139,53 +320,87 @@ static int configure_xsk_socket(struct kxsk_umem *umem,
 	xsk_info->umem = umem;
 
 	const struct xsk_socket_config sock_conf = {
-		.tx_size = UMEM_RING_LEN_TX,
-		.rx_size = UMEM_RING_LEN_RX,
+		.tx_size = 2 * umem->ring_size,
+		.rx_size = 2 * umem->ring_size,
 		.libbpf_flags = XSK_LIBBPF_FLAGS__INHIBIT_PROG_LOAD,
 	};
 
+	struct knot_xdp_umem *shared = umem->shared;
+#ifdef HAVE_XSK_SOCKET__CREATE_SHARED
+	/* The first socket takes over the rings created with the UMEM. */
+	int ret = xsk_socket__create_shared(&xsk_info->xsk, iface->if_name,
+	                                    iface->if_queue, shared->umem,
+	                                    &xsk_info->rx, &xsk_info->tx,
+	                                    &umem->fq, &umem->cq, &sock_conf);
+#else
+	assert(shared->used == 0);
+	umem->fq = shared->fq;
+	umem->cq = shared->cq;
 	int ret = xsk_socket__create(&xsk_info->xsk, iface->if_name,
-	                             iface->if_queue, umem->umem,
+	                             iface->if_queue, shared->umem,
 	                             &xsk_info->rx, &xsk_info->tx, &sock_conf);
+#endif
 	if (ret != 0) {
 		free(xsk_info);
 		return ret;
 	}
 
+	ret = fill_xsk_umem(umem, shared->used);
+	if (ret != KNOT_EOK) {
+		xsk_socket__delete(xsk_info->xsk);
+		free(xsk_info);
+		return ret;
+	}
+	shared->used++;
+
 	*out_sock = xsk_info;
 	return KNOT_EOK;
 }
 
 _public_
 int knot_xdp_init(knot_xdp_socket_t **socket, const char *if_name, int if_queue,
-                  uint32_t listen_port, knot_xdp_load_bpf_t load_bpf)
+                  uint32_t listen_port, knot_xdp_load_bpf_t load_bpf,
+                  const knot_xdp_config_t *config)
 {
 	if (socket == NULL || if_name == NULL) {
 		return KNOT_EINVAL;
 	}
 
+	/* Initialize packet_buffer for umem usage, or take a reference to the shared one. */
+	struct knot_xdp_umem *shared = (config != NULL) ? config->umem : NULL;
+	if (shared == NULL) {
+		int ret = knot_xdp_umem_init(&shared, config, 1);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	} else {
+		shared->refcount++;
+	}
+
 	struct kxsk_iface *iface;
 	int ret = kxsk_iface_new(if_name, if_queue, load_bpf, &iface);
 	if (ret != KNOT_EOK) {
+		umem_unref(shared);
 		return ret;
 	}
 
-	/* Initialize shared packet_buffer for umem usage. */
 	struct kxsk_umem *umem = NULL;
-	ret = configure_xsk_umem(&umem);
+	ret = configure_xsk_umem(shared, &umem);
 	if (ret != KNOT_EOK) {
 		kxsk_iface_free(iface);
+		umem_unref(shared);
 		return ret;
 	}
 
 	ret = configure_xsk_socket(umem, iface, socket);
 	if (ret != KNOT_EOK) {
-		deconfigure_xsk_umem(umem);
+		free(umem);
 		kxsk_iface_free(iface);
+		umem_unref(shared);
 		return ret;
 	}
 
-	(*socket)->frame_limit = FRAME_SIZE;
+	(*socket)->frame_limit = umem->frame_size;
 	ret = knot_eth_mtu(if_name);
 	if (ret > 0) {
 		(*socket)->frame_limit = MIN((unsigned)ret, (*socket)->frame_limit);
@@ -194,8 +409,9 @@ int knot_xdp_init(knot_xdp_socket_t **socket, const char *if_name, int if_queue,
 	ret = kxsk_socket_start(iface, listen_port, (*socket)->xsk);
 	if (ret != KNOT_EOK) {
 		xsk_socket__delete((*socket)->xsk);
-		deconfigure_xsk_umem(umem);
+		free(umem);
 		kxsk_iface_free(iface);
+		umem_unref(shared);
 		free(*socket);
 		*socket = NULL;
 		return ret;
@@ -217,7 +433,9 @@ void knot_xdp_deinit(knot_xdp_socket_t *socket)
 
 	kxsk_socket_stop(socket->iface);
 	xsk_socket__delete(socket->xsk);
-	deconfigure_xsk_umem(socket->umem);
+	tx_pool_return(socket->umem, 0);
+	umem_unref(socket->umem->shared);
+	free(socket->umem);
 
 	kxsk_iface_free((struct kxsk_iface *)/*const-cast*/socket->iface);
 	free(socket);
@@ -233,14 +451,6 @@ int knot_xdp_socket_fd(knot_xdp_socket_t *socket)
 	return xsk_socket__fd(socket->xsk);
 }
 
-static void tx_free_relative(struct kxsk_umem *umem, uint64_t addr_relative)
-{
-	/* The address may not point to *start* of buffer, but `/` solves that. */
-	uint64_t index = addr_relative / FRAME_SIZE;
-	assert(index < UMEM_FRAME_COUNT);
-	umem->tx_free_indices[umem->tx_free_count++] = index;
-}
-
 _public_
 void knot_xdp_send_prepare(knot_xdp_socket_t *socket)
 {
@@ -256,7 +466,7 @@ void knot_xdp_send_prepare(knot_xdp_socket_t *socket)
 	if (completed == 0) {
 		return;
 	}
-	assert(umem->tx_free_count + completed <= UMEM_FRAME_COUNT_TX);
+	assert(umem->tx_free_count + completed <= umem->tx_owned);
 
 	for (uint32_t i = 0; i < completed; ++i) {
 		uint64_t addr_relative = *xsk_ring_cons__comp_addr(cq, idx++);
@@ -264,19 +474,28 @@ void knot_xdp_send_prepare(knot_xdp_socket_t *socket)
 	}
 
 	xsk_ring_cons__release(cq, completed);
+
+	/* Let other sockets sharing the UMEM use the surplus of free frames. */
+	if (umem->tx_free_count > 2 * TX_POOL_BATCH) {
+		tx_pool_return(umem, TX_POOL_BATCH);
+	}
 }
 
-static struct umem_frame *alloc_tx_frame(knot_xdp_socket_t *socket)
+static uint8_t *alloc_tx_frame(knot_xdp_socket_t *socket)
 {
 	if (unlikely(socket->send_mock != NULL)) {
-		return malloc(sizeof(struct umem_frame));
+		return malloc(KNOT_XDP_FRAME_SIZE_DEFAULT);
 	}
 
 	const struct timespec delay = { .tv_nsec = ALLOC_RETRY_DELAY };
 	struct kxsk_umem *umem = socket->umem;
 
 	for (int i = 0; unlikely(umem->tx_free_count == 0); i++) {
+		if (tx_pool_take(umem) > 0) {
+			break;
+		}
 		if (i == ALLOC_RETRY_NUM) {
+			__atomic_add_fetch(&umem->tx_alloc_fail, 1, __ATOMIC_RELAXED);
 			return NULL;
 		}
 		nanosleep(&delay, NULL);
@@ -284,14 +503,17 @@ static struct umem_frame *alloc_tx_frame(knot_xdp_socket_t *socket)
 	}
 
 	uint32_t index = umem->tx_free_indices[--umem->tx_free_count];
-	return umem->frames + index;
+	return umem->frames + (size_t)index * umem->frame_size;
 }
 
-static void prepare_payload(knot_xdp_msg_t *msg, void *uframe)
+static void prepare_payload(knot_xdp_socket_t *socket, knot_xdp_msg_t *msg,
+                            uint8_t *uframe)
 {
+	size_t frame_size = unlikely(socket->send_mock != NULL) ?
+	                    KNOT_XDP_FRAME_SIZE_DEFAULT : socket->umem->frame_size;
 	size_t hdr_len = prot_write_hdrs_len(msg);
 	msg->payload.iov_base = uframe + hdr_len;
-	msg->payload.iov_len = FRAME_SIZE - hdr_len;
+	msg->payload.iov_len = frame_size - hdr_len;
 }
 
 _public_
@@ -302,13 +524,13 @@ int knot_xdp_send_alloc(knot_xdp_socket_t *socket, knot_xdp_msg_flag_t flags,
 		return KNOT_EINVAL;
 	}
 
-	struct umem_frame *uframe = alloc_tx_frame(socket);
+	uint8_t *uframe = alloc_tx_frame(socket);
 	if (uframe == NULL) {
 		return KNOT_ENOMEM;
 	}
 
 	msg_init(out, flags);
-	prepare_payload(out, uframe);
+	prepare_payload(socket, out, uframe);
 
 	return KNOT_EOK;
 }
@@ -321,13 +543,13 @@ int knot_xdp_reply_alloc(knot_xdp_socket_t *socket, const knot_xdp_msg_t *query,
 		return KNOT_EINVAL;
 	}
 
-	struct umem_frame *uframe = alloc_tx_frame(socket);
+	uint8_t *uframe = alloc_tx_frame(socket);
 	if (uframe == NULL) {
 		return KNOT_ENOMEM;
 	}
 
 	msg_init_reply(out, query);
-	prepare_payload(out, uframe);
+	prepare_payload(socket, out, uframe);
 
 	return KNOT_EOK;
 }
@@ -339,7 +561,7 @@ static void free_unsent(knot_xdp_socket_t *socket, const knot_xdp_msg_t *msg)
 		return;
 	}
 	uint64_t addr_relative = (uint8_t *)msg->payload.iov_base
-	                         - socket->umem->frames->bytes;
+	                         - socket->umem->frames;
 	tx_free_relative(socket->umem, addr_relative);
 }
 
@@ -365,7 +587,7 @@ int knot_xdp_send(knot_xdp_socket_t *socket, const knot_xdp_msg_t msgs[],
 	 * Therefore we handle `socket->tx.cached_prod` by hand;
 	 * that's simplified by the fact that there is always free space.
 	 */
-	assert(UMEM_RING_LEN_TX > UMEM_FRAME_COUNT_TX);
+	assert(socket->tx.size >= socket->umem->tx_max);
 	uint32_t idx = socket->tx.cached_prod;
 
 	for (uint32_t i = 0; i < count; ++i) {
@@ -381,7 +603,7 @@ int knot_xdp_send(knot_xdp_socket_t *socket, const knot_xdp_msg_t msgs[],
 			prot_write_eth(msg_beg, msg, msg_beg + tot_len, mss);
 
 			*xsk_ring_prod__tx_desc(&socket->tx, idx++) = (struct xdp_desc) {
-				.addr = msg_beg - socket->umem->frames->bytes,
+				.addr = msg_beg - socket->umem->frames,
 				.len = tot_len,
 			};
 		}
@@ -458,16 +680,17 @@ int knot_xdp_recv(knot_xdp_socket_t *socket, knot_xdp_msg_t msgs[],
 	}
 	assert(available <= max_count);
 
+	const uint32_t frame_size = socket->umem->frame_size;
 	for (uint32_t i = 0; i < available; ++i) {
 		knot_xdp_msg_t *msg = &msgs[i];
 		const struct xdp_desc *desc = xsk_ring_cons__rx_desc(&socket->rx, idx++);
-		uint8_t *uframe_p = socket->umem->frames->bytes + desc->addr;
+		uint8_t *uframe_p = socket->umem->frames + desc->addr;
 
 		void *payl_end, *payl_start = prot_read_eth(uframe_p, msg, &payl_end);
 
 		msg->payload.iov_base = payl_start;
 		msg->payload.iov_len = payl_end - payl_start;
-		msg->mss = MIN(msg->mss, FRAME_SIZE - (payl_start - (void *)uframe_p));
+		msg->mss = MIN(msg->mss, frame_size - (payl_start - (void *)uframe_p));
 
 		if (wire_size != NULL) {
 			(*wire_size) += desc->len;
@@ -480,9 +703,10 @@ int knot_xdp_recv(knot_xdp_socket_t *socket, knot_xdp_msg_t msgs[],
 	return KNOT_EOK;
 }
 
-static uint8_t *msg_uframe_ptr(const knot_xdp_msg_t *msg)
+static uint8_t *msg_uframe_ptr(const knot_xdp_msg_t *msg, uint32_t frame_size)
 {
-	return NULL + ((msg->payload.iov_base - NULL) & ~(FRAME_SIZE - 1));
+	/* The UMEM is page-aligned and the frame size is a power of 2. */
+	return NULL + ((msg->payload.iov_base - NULL) & ~((uintptr_t)frame_size - 1));
 }
 
 _public_
@@ -501,8 +725,8 @@ void knot_xdp_recv_finish(knot_xdp_socket_t *socket, const knot_xdp_msg_t msgs[]
 	assert(reserved == count);
 
 	for (uint32_t i = 0; i < reserved; ++i) {
-		uint8_t *uframe_p = msg_uframe_ptr(&msgs[i]);
-		uint64_t offset = uframe_p - umem->frames->bytes;
+		uint8_t *uframe_p = msg_uframe_ptr(&msgs[i], umem->frame_size);
+		uint64_t offset = uframe_p - umem->frames;
 		*xsk_ring_prod__fill_addr(fq, idx++) = offset;
 	}
 
@@ -526,16 +750,62 @@ void knot_xdp_info(const knot_xdp_socket_t *socket, FILE *file)
 		        (unsigned)RING_BUSY((ring)), \
 		        (unsigned)*(ring)->producer, (unsigned)*(ring)->consumer)
 
+	const int rx_frames = socket->umem->ring_size;
+	const int tx_frames = socket->umem->tx_owned;
+
 	const int rx_busyf = RING_BUSY(&socket->umem->fq) + RING_BUSY(&socket->rx);
-	fprintf(file, "\nLOST RX frames: %4d", (int)(UMEM_FRAME_COUNT_RX - rx_busyf));
+	fprintf(file, "\nLOST RX frames: %4d", (int)(rx_frames - rx_busyf));
 
 	const int tx_busyf = RING_BUSY(&socket->umem->cq) + RING_BUSY(&socket->tx);
 	const int tx_freef = socket->umem->tx_free_count;
-	fprintf(file, "\nLOST TX frames: %4d\n", (int)(UMEM_FRAME_COUNT_TX - tx_busyf - tx_freef));
+	fprintf(file, "\nLOST TX frames: %4d\n", (int)(tx_frames - tx_busyf - tx_freef));
 
 	RING_PRINFO("FQ", &socket->umem->fq);
 	RING_PRINFO("RX", &socket->rx);
 	RING_PRINFO("TX", &socket->tx);
 	RING_PRINFO("CQ", &socket->umem->cq);
 	fprintf(file, "TX free frames: %4d\n", tx_freef);
+
+	knot_xdp_stats_t stats;
+	if (knot_xdp_stats(socket, &stats) == KNOT_EOK) {
+		fprintf(file, "RX ring full: %"PRIu64", fill ring empty: %"PRIu64
+		              ", RX dropped: %"PRIu64", RX invalid: %"PRIu64"\n",
+		        stats.rx_ring_full, stats.fill_ring_empty,
+		        stats.rx_dropped, stats.rx_invalid);
+		fprintf(file, "TX ring empty: %"PRIu64", TX alloc failed: %"PRIu64
+		              ", TX invalid: %"PRIu64"\n",
+		        stats.tx_ring_empty, stats.tx_alloc_fail, stats.tx_invalid);
+	}
+}
+
+_public_
+int knot_xdp_stats(const knot_xdp_socket_t *socket, knot_xdp_stats_t *stats)
+{
+	if (socket == NULL || stats == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	memset(stats, 0, sizeof(*stats));
+	if (unlikely(socket->send_mock != NULL)) {
+		return KNOT_EOK;
+	}
+
+	stats->tx_alloc_fail = __atomic_load_n(&socket->umem->tx_alloc_fail,
+	                                       __ATOMIC_RELAXED);
+
+	struct xdp_statistics_v2 xstats = { 0 };
+	socklen_t len = sizeof(xstats);
+	if (getsockopt(xsk_socket__fd(socket->xsk), SOL_XDP, XDP_STATISTICS,
+	               &xstats, &len) != 0) {
+		return knot_map_errno();
+	}
+
+	stats->rx_dropped = xstats.rx_dropped;
+	stats->rx_invalid = xstats.rx_invalid_descs;
+	stats->tx_invalid = xstats.tx_invalid_descs;
+	stats->rx_ring_full = xstats.rx_ring_full;
+	stats->fill_ring_empty = xstats.rx_fill_ring_empty_descs;
+	stats->tx_ring_empty = xstats.tx_ring_empty_descs;
+
+	return KNOT_EOK;
 }
@@ -51,6 +51,64 @@ typedef enum {
 /*! \brief Context structure for one XDP socket. */
 typedef struct knot_xdp_socket knot_xdp_socket_t;
 
+/*! \brief UMEM (packet buffer memory) possibly shared by more XDP sockets. */
+typedef struct knot_xdp_umem knot_xdp_umem_t;
+
+/*! \brief Default number of RX (and TX) frames per socket. */
+#define KNOT_XDP_RING_SIZE_DEFAULT  4096
+/*! \brief Default size of one UMEM frame. */
+#define KNOT_XDP_FRAME_SIZE_DEFAULT 2048
+
+/*! \brief XDP socket and UMEM configuration. */
+typedef struct {
+	/*! Number of RX (and TX) frames per socket, a power of 2 (0 = default). */
+	uint32_t ring_size;
+	/*! Size of one UMEM frame, 2048 or 4096 (0 = default). */
+	uint32_t frame_size;
+	/*! Allocate the UMEM from huge pages. */
+	bool hugepages;
+	/*! UMEM shared with other sockets (NULL = private UMEM for the socket). */
+	knot_xdp_umem_t *umem;
+} knot_xdp_config_t;
+
+/*! \brief XDP socket statistics. */
+typedef struct {
+	uint64_t rx_dropped;      /*!< Packets dropped by the kernel for other reasons. */
+	uint64_t rx_invalid;      /*!< Invalid RX descriptors. */
+	uint64_t tx_invalid;      /*!< Invalid TX descriptors. */
+	uint64_t rx_ring_full;    /*!< Packets dropped due to full RX ring. */
+	uint64_t fill_ring_empty; /*!< Receptions when the fill ring was empty. */
+	uint64_t tx_ring_empty;   /*!< Send attempts with empty TX ring. */
+	uint64_t tx_alloc_fail;   /*!< Failed TX frame allocations. */
+} knot_xdp_stats_t;
+
+/*!
+ * \brief Create UMEM to be shared by more XDP sockets on one interface.
+ *
+ * The memory block is registered once. Each socket has its own RX frames,
+ * the TX frames form one pool, which the sockets take frames from in batches.
+ * A busy socket can thus use up to twice the ring size of TX frames.
+ *
+ * \note The UMEM is freed when the last socket using it and the creator
+ *       by knot_xdp_umem_deinit() release it. The function is not thread-safe.
+ *
+ * \param umem     Out: created UMEM.
+ * \param config   Ring, frame size, and huge pages configuration (NULL = defaults).
+ * \param sockets  Maximum number of the sockets sharing the UMEM.
+ *
+ * \retval KNOT_ENOTSUP  if more sockets requested and libbpf can't share UMEM.
+ * \return KNOT_E* or -errno
+ */
+int knot_xdp_umem_init(knot_xdp_umem_t **umem, const knot_xdp_config_t *config,
+                       unsigned sockets);
+
+/*!
+ * \brief Release the UMEM reference held by its creator.
+ *
+ * \param umem  UMEM to be released.
+ */
+void knot_xdp_umem_deinit(knot_xdp_umem_t *umem);
+
 /*!
  * \brief Initialize XDP socket.
  *
@@ -59,11 +117,16 @@ typedef struct knot_xdp_socket knot_xdp_socket_t;
  * \param if_queue     Network card queue to be used (normally 1 socket per each queue).
  * \param listen_port  Port to listen on, or KNOT_XDP_LISTEN_PORT_* flag.
  * \param load_bpf     Insert BPF program into packet processing.
+ * \param config       Socket configuration (NULL = defaults).
+ *
+ * \note If the configuration contains a shared UMEM, the ring and frame
+ *       sizes of the UMEM apply.
  *
  * \return KNOT_E* or -errno
  */
 int knot_xdp_init(knot_xdp_socket_t **socket, const char *if_name, int if_queue,
-                  uint32_t listen_port, knot_xdp_load_bpf_t load_bpf);
+                  uint32_t listen_port, knot_xdp_load_bpf_t load_bpf,
+                  const knot_xdp_config_t *config);
 
 /*!
  * \brief De-init XDP socket.
@@ -182,4 +245,16 @@ void knot_xdp_recv_finish(knot_xdp_socket_t *socket, const knot_xdp_msg_t msgs[]
  */
 void knot_xdp_info(const knot_xdp_socket_t *socket, FILE *file);
 
+/*!
+ * \brief Get the XDP socket statistics.
+ *
+ * \note Counters not provided by the running kernel are zero.
+ *
+ * \param socket  XDP socket.
+ * \param stats   Out: the statistics.
+ *
+ * \return KNOT_E* or -errno
+ */
+int knot_xdp_stats(const knot_xdp_socket_t *socket, knot_xdp_stats_t *stats);
+
 /*! @} */
@@ -345,7 +345,8 @@ void *xdp_gun_thread(void *_ctx)
 
 	knot_xdp_load_bpf_t mode = (ctx->thread_id == 0 ?
 	                            KNOT_XDP_LOAD_BPF_ALWAYS : KNOT_XDP_LOAD_BPF_NEVER);
-	int ret = knot_xdp_init(&xsk, ctx->dev, ctx->thread_id, ctx->listen_port, mode);
+	int ret = knot_xdp_init(&xsk, ctx->dev, ctx->thread_id, ctx->listen_port, mode,
+	                        NULL);
 	if (ret != KNOT_EOK) {
 		printf("failed to initialize XDP socket#%u: %s\n",
 		       ctx->thread_id, knot_strerror(ret));
@@ -438,8 +439,8 @@ void *xdp_gun_thread(void *_ctx)
 							local_stats.synack_recv++;
 							rl->answer = XDP_TCP_ANSWER | XDP_TCP_DATA;
 							put_dns_payload(&payl, true, ctx, &payload_ptr);
-							ret = knot_tcp_relay_answer(&relays, rl, payl.iov_base,
-							                            payl.iov_len);
+							ret = knot_tcp_relay_answer(&relays, rl, tcp_table,
+							                            payl.iov_base, payl.iov_len);
 							if (ret != KNOT_EOK) {
 								errors++;
 							}
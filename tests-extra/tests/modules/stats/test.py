@@ -157,6 +157,29 @@ check_item(knot, "mod-stats", "response-code", 4, idx="NOERROR")
 check_item(knot, "mod-stats", "response-code", 3, idx="NOERROR", zone=zones[0])
 check_item(knot, "mod-stats", "response-code", 1, idx="NOERROR", zone=zones[1])
 
+# Check request latency metrics (UDP and TCP queries and AXFR, no DDNS).
+def latency_count(server, zone=None):
+    ctl = libknot.control.KnotCtl()
+    ctl.connect(os.path.join(server.dir, "knot.sock"))
+    try:
+        if zone:
+            ctl.send_block(cmd="zone-stats", section="mod-stats", item="request-latency",
+                           zone=zone.name)
+        else:
+            ctl.send_block(cmd="stats", section="mod-stats", item="request-latency")
+        stats = ctl.receive_stats()
+    finally:
+        ctl.send(libknot.control.KnotCtlType.END)
+        ctl.close()
+
+    if zone:
+        stats = stats.get("zone").get(zone.name.lower())
+    return sum(int(v) for v in stats.get("mod-stats").get("request-latency").values())
+
+compare(latency_count(knot), 4, "mod-stats.request-latency")
+compare(latency_count(knot, zones[0]), 3, "mod-stats.request-latency")
+compare(latency_count(knot, zones[1]), 1, "mod-stats.request-latency")
+
 # Check nodata metrics.
 check_item(knot, "mod-stats", "reply-nodata",  1, idx="other")
 check_item(knot, "mod-stats", "reply-nodata", -1, idx="other", zone=zones[0])
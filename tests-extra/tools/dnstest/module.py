@@ -270,6 +270,7 @@ class ModStats(KnotModule):
         self._bool(conf, "query-type", True)
         self._bool(conf, "query-size", True)
         self._bool(conf, "reply-size", True)
+        self._bool(conf, "request-latency", True)
         conf.end()
 
         return conf
@@ -1,4 +1,4 @@
-/*  Copyright (C) 2019 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+/*  Copyright (C) 2021 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
 
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU General Public License as published by
@@ -103,6 +103,39 @@ static bool str_key_get_leq(trie_t *trie, char **keys, size_t i, size_t size)
 
 }
 
+/* Check the order of keys applied across subtries. */
+typedef struct {
+	const char *prev;
+	size_t count;
+	bool sorted;
+} split_ctx_t;
+
+static int split_apply_cb(trie_val_t *val, void *d)
+{
+	split_ctx_t *ctx = d;
+	if (ctx->prev != NULL && strcmp(ctx->prev, *val) > 0) {
+		ctx->sorted = false;
+	}
+	ctx->prev = *val;
+	ctx->count++;
+	return KNOT_EOK;
+}
+
+static void test_split(trie_t *trie, size_t max)
+{
+	trie_sub_t *subs[max];
+	size_t count = trie_split(trie, subs, max);
+	ok(count > 1 && count <= max, "trie: split into %zu/%zu subtries", count, max);
+
+	split_ctx_t ctx = { .sorted = true };
+	int ret = KNOT_EOK;
+	for (size_t i = 0; i < count && ret == KNOT_EOK; ++i) {
+		ret = trie_sub_apply(subs[i], split_apply_cb, &ctx);
+	}
+	ok(ret == KNOT_EOK && ctx.sorted && ctx.count == trie_weight(trie),
+	   "trie: subtries cover all keys in order");
+}
+
 static void test_wildcards(void)
 {
 	/* Test zone. */
@@ -178,6 +211,52 @@ static void test_wildcards(void)
 	ok(true, "trie: wildcard searches");
 }
 
+static void test_lpm(void)
+{
+	/* Short keys from a small alphabet, so that many are prefixes of others. */
+	const unsigned key_count = 2000;
+	trie_t *trie = trie_create(NULL);
+	if (!trie) ok(false, "trie: create");
+
+	char *keys[key_count];
+	for (unsigned i = 0; i < key_count; ++i) {
+		size_t len = rand() % 12;
+		keys[i] = malloc(len + 1);
+		for (size_t j = 0; j < len; ++j) {
+			keys[i][j] = "ab"[rand() % 2];
+		}
+		keys[i][len] = '\0';
+		if (i % 2 == 0) {
+			*trie_get_ins(trie, (uint8_t *)keys[i], len) = keys[i];
+		}
+	}
+
+	/* Compare with lookups of all prefixes from the longest one. */
+	bool passed = true;
+	for (unsigned i = 0; i < key_count && passed; ++i) {
+		uint32_t len = strlen(keys[i]), prefix_len = UINT32_MAX;
+		trie_val_t *val = trie_get_lpm(trie, (uint8_t *)keys[i], len, &prefix_len);
+
+		trie_val_t *expected = NULL;
+		uint32_t expected_len = len + 1;
+		while (expected == NULL && expected_len-- > 0) {
+			expected = trie_get_try(trie, (uint8_t *)keys[i], expected_len);
+		}
+
+		if (val != expected || (val != NULL && prefix_len != expected_len)) {
+			diag("trie: longest prefix of '%s' is '%s'", keys[i],
+			     val != NULL ? (char *)*val : "<null>");
+			passed = false;
+		}
+	}
+	ok(passed, "trie: longest prefix match");
+
+	for (unsigned i = 0; i < key_count; ++i) {
+		free(keys[i]);
+	}
+	trie_free(trie);
+}
+
 int main(int argc, char *argv[])
 {
 	plan_lazy();
@@ -270,6 +349,12 @@ int main(int argc, char *argv[])
 	is_int(inserted, iterated, "trie: sorted iteration");
 	trie_it_free(it);
 
+	/* Split for parallel processing. */
+	test_split(trie, 16);
+	test_split(trie, 1000);
+	trie_sub_t *sub = NULL;
+	is_int(1, trie_split(trie, &sub, 1), "trie: split into one subtrie");
+
 	/* Cleanup */
 	for (unsigned i = 0; i < key_count; ++i) {
 		free(keys[i]);
@@ -280,5 +365,8 @@ int main(int argc, char *argv[])
 	/* Test trie_get_try_wildcard(). */
 	test_wildcards();
 
+	/* Test trie_get_lpm(). */
+	test_lpm();
+
 	return 0;
 }
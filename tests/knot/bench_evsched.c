@@ -0,0 +1,268 @@
+/*  Copyright (C) 2021 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <getopt.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "knot/common/evsched.h"
+#include "libknot/errcode.h"
+
+/*
+ * Benchmark of the event scheduler. A pool of events, e.g. one per zone,
+ * is repeatedly (re)scheduled far in the future, canceled, and scheduled
+ * and canceled in turns by the given number of threads, while the scheduler
+ * thread merges the insertion buffers into the timer wheel. Finally, all
+ * the events are scheduled to expire within one second and the dispatch
+ * lateness is measured.
+ *
+ * Run via 'make bench', parameters can be passed via the BENCH_FLAGS
+ * variable, e.g. make bench BENCH_FLAGS="-e 1000000 -o 10000000 -t 4".
+ */
+
+#define BENCH_EVENTS		1000000
+#define BENCH_OPERATIONS	10000000	/* Total per phase. */
+#define BENCH_THREADS		1
+#define BENCH_FAR		3600000		/* Minimal far event time (ms). */
+#define BENCH_SPREAD		1000		/* Expiration spread (ms). */
+
+typedef struct {
+	uint64_t deadline;
+} ev_data_t;
+
+typedef struct {
+	event_t **events;
+	ev_data_t *data;
+	unsigned count;
+	unsigned threads;
+	unsigned long operations;
+} bench_t;
+
+typedef enum {
+	PHASE_SCHEDULE,
+	PHASE_CANCEL,
+	PHASE_CHURN,
+	PHASE_EXPIRE,
+} phase_t;
+
+typedef struct {
+	const bench_t *bench;
+	phase_t phase;
+	unsigned id;
+	pthread_t thread;
+} worker_t;
+
+static unsigned long expired = 0;
+static uint64_t max_late = 0;
+
+static uint64_t now_ms(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000ULL + ts.tv_nsec / 1000000;
+}
+
+static double elapsed_ms(const struct timespec *begin, const struct timespec *end)
+{
+	return (end->tv_sec - begin->tv_sec) * 1000.0 +
+	       (end->tv_nsec - begin->tv_nsec) / 1000000.0;
+}
+
+static unsigned next_rand(unsigned *state)
+{
+	*state = *state * 1103515245 + 12345;
+	return *state >> 1;
+}
+
+static void ev_callback(event_t *ev)
+{
+	// Run only by the scheduler thread.
+	ev_data_t *data = ev->data;
+	uint64_t now = now_ms();
+	if (now > data->deadline && now - data->deadline > max_late) {
+		max_late = now - data->deadline;
+	}
+	__atomic_add_fetch(&expired, 1, __ATOMIC_RELAXED);
+}
+
+static void *worker_run(void *arg)
+{
+	worker_t *w = arg;
+	const bench_t *b = w->bench;
+
+	// Each thread works with its own part of the events.
+	unsigned from = (unsigned long)b->count * w->id / b->threads;
+	unsigned to = (unsigned long)b->count * (w->id + 1) / b->threads;
+	unsigned long ops = b->operations / b->threads;
+	unsigned state = w->id + 1;
+
+	switch (w->phase) {
+	case PHASE_SCHEDULE:
+		for (unsigned long i = 0; i < ops; i++) {
+			event_t *ev = b->events[from + i % (to - from)];
+			evsched_schedule(ev, BENCH_FAR + next_rand(&state) % BENCH_FAR);
+		}
+		break;
+	case PHASE_CANCEL:
+		for (unsigned i = from; i < to; i++) {
+			evsched_cancel(b->events[i]);
+		}
+		break;
+	case PHASE_CHURN:
+		for (unsigned long i = 0; i < ops; i++) {
+			event_t *ev = b->events[from + next_rand(&state) % (to - from)];
+			evsched_schedule(ev, BENCH_FAR + next_rand(&state) % BENCH_FAR);
+			evsched_cancel(ev);
+		}
+		break;
+	case PHASE_EXPIRE:
+		for (unsigned i = from; i < to; i++) {
+			uint32_t dt = next_rand(&state) % BENCH_SPREAD;
+			b->data[i].deadline = now_ms() + dt;
+			evsched_schedule(b->events[i], dt);
+		}
+		break;
+	}
+
+	return NULL;
+}
+
+static double run_phase(const bench_t *bench, phase_t phase)
+{
+	worker_t workers[bench->threads];
+
+	struct timespec begin, end;
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	for (unsigned i = 0; i < bench->threads; i++) {
+		workers[i] = (worker_t) { .bench = bench, .phase = phase, .id = i };
+		pthread_create(&workers[i].thread, NULL, worker_run, &workers[i]);
+	}
+	for (unsigned i = 0; i < bench->threads; i++) {
+		pthread_join(workers[i].thread, NULL);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	return elapsed_ms(&begin, &end);
+}
+
+static void print_phase(const char *name, unsigned long ops, double ms)
+{
+	printf("%-16s %10lu ops %10.2f ms %8.2f Mops/s\n",
+	       name, ops, ms, ops / ms / 1000.0);
+}
+
+static bool parse_num(const char *arg, unsigned long *num, unsigned long min)
+{
+	char *end = NULL;
+	unsigned long val = strtoul(arg, &end, 10);
+	if (*arg == '\0' || *end != '\0' || val < min || val > UINT32_MAX) {
+		fprintf(stderr, "invalid parameter value '%s'\n", arg);
+		return false;
+	}
+	*num = val;
+	return true;
+}
+
+static void interrupt_handle(int s)
+{
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned long events = BENCH_EVENTS, operations = BENCH_OPERATIONS;
+	unsigned long threads = BENCH_THREADS;
+
+	opterr = 0;
+	int opt;
+	while ((opt = getopt(argc, argv, "e:o:t:")) != -1) {
+		bool valid = true;
+		switch (opt) {
+		case 'e': valid = parse_num(optarg, &events, 1); break;
+		case 'o': valid = parse_num(optarg, &operations, 1); break;
+		case 't': valid = parse_num(optarg, &threads, 1); break;
+		default: break;
+		}
+		if (!valid) {
+			return EXIT_FAILURE;
+		}
+	}
+	if (threads > events) {
+		threads = events;
+	}
+
+	struct sigaction sa;
+	sa.sa_handler = interrupt_handle;
+	sigemptyset(&sa.sa_mask);
+	sa.sa_flags = 0;
+	sigaction(SIGALRM, &sa, NULL);
+
+	evsched_t sched;
+	if (evsched_init(&sched, NULL) != KNOT_EOK) {
+		return EXIT_FAILURE;
+	}
+
+	bench_t bench = {
+		.events = calloc(events, sizeof(event_t *)),
+		.data = calloc(events, sizeof(ev_data_t)),
+		.count = events,
+		.threads = threads,
+		.operations = operations
+	};
+	if (bench.events == NULL || bench.data == NULL) {
+		return EXIT_FAILURE;
+	}
+	for (unsigned i = 0; i < events; i++) {
+		bench.events[i] = evsched_event_create(&sched, ev_callback, &bench.data[i]);
+		if (bench.events[i] == NULL) {
+			return EXIT_FAILURE;
+		}
+	}
+
+	evsched_start(&sched);
+
+	printf("%lu events, %lu threads\n", events, threads);
+	print_phase("schedule", operations, run_phase(&bench, PHASE_SCHEDULE));
+	print_phase("cancel", events, run_phase(&bench, PHASE_CANCEL));
+	print_phase("schedule+cancel", operations, run_phase(&bench, PHASE_CHURN));
+	print_phase("schedule expire", events, run_phase(&bench, PHASE_EXPIRE));
+
+	uint64_t limit = now_ms() + BENCH_SPREAD + 60000;
+	while (__atomic_load_n(&expired, __ATOMIC_RELAXED) < events && now_ms() < limit) {
+		usleep(10000);
+	}
+	evsched_stop(&sched);
+	evsched_join(&sched);
+
+	unsigned long done = __atomic_load_n(&expired, __ATOMIC_RELAXED);
+	printf("%-16s %10lu events, max lateness %" PRIu64 " ms\n",
+	       "expired", done, max_late);
+
+	for (unsigned i = 0; i < events; i++) {
+		evsched_cancel(bench.events[i]);
+		evsched_event_free(bench.events[i]);
+	}
+	evsched_deinit(&sched);
+	free(bench.events);
+	free(bench.data);
+
+	return (done == events) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,1079 @@
+/*  Copyright (C) 2021 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <assert.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <urcu.h>
+#include <tap/files.h>
+
+#include "libdnssec/error.h"
+#include "libdnssec/key.h"
+#include "libdnssec/nsec.h"
+#include "libdnssec/random.h"
+#include "libknot/libknot.h"
+#include "knot/dnssec/nsec-chain.h"
+#include "knot/dnssec/zone-nsec.h"
+#include "knot/nameserver/process_query.h"
+#include "knot/nameserver/resp_cache.h"
+#include "test_server.h"
+#include "contrib/macros.h"
+#include "contrib/mempattern.h"
+#include "contrib/sockaddr.h"
+#include "contrib/ucw/mempool.h"
+
+/*
+ * Benchmark of the authoritative query path. A synthetic zone is generated
+ * in memory and a corpus of wire queries is processed by the query layer
+ * in-process, in the same way as the UDP handler does it, but without the
+ * UDP size limit. The allocations are counted in the per-query memory pool.
+ * Finally, the zone is encoded into zone transfer messages with the default
+ * name compression and with the compression dictionary.
+ *
+ * Run via 'make bench', parameters can be passed via the BENCH_FLAGS
+ * variable, e.g. make bench BENCH_FLAGS="-n 1000000 -t 4".
+ */
+
+#define BENCH_NAMES		100000
+#define BENCH_THREADS		1
+#define BENCH_QUERIES		1000000	/* Per thread. */
+#define BENCH_RATIO		10	/* Every Nth name has delegation, wildcard, CNAME chain. */
+#define BENCH_CHAIN		3	/* Length of the CNAME chains. */
+#define BENCH_LARGE		64	/* Number of records in the large RRset. */
+#define BENCH_CORPUS		1024	/* Number of distinct queries per answer kind. */
+#define BENCH_TTL		3600
+#define BENCH_QUERY_MAX		512
+#define BENCH_XFR_ROUNDS	3	/* Zone transfer encodings, the fastest one counts. */
+
+typedef enum {
+	BENCH_POSITIVE,
+	BENCH_NXDOMAIN,
+	BENCH_REFERRAL,
+	BENCH_CNAME,
+	BENCH_WILDCARD,
+	BENCH_LARGE_RRSET,
+	BENCH_KINDS
+} bench_kind_t;
+
+static const char *kind_names[BENCH_KINDS] = {
+	[BENCH_POSITIVE]    = "positive",
+	[BENCH_NXDOMAIN]    = "nxdomain",
+	[BENCH_REFERRAL]    = "referral",
+	[BENCH_CNAME]       = "cname",
+	[BENCH_WILDCARD]    = "wildcard",
+	[BENCH_LARGE_RRSET] = "large",
+};
+
+typedef struct {
+	unsigned names;      /*!< Number of host names. */
+	unsigned threads;    /*!< Number of processing threads. */
+	unsigned queries;    /*!< Number of queries per thread. */
+	unsigned large;      /*!< Number of records in the large RRset. */
+	unsigned iterations; /*!< NSEC3 iterations. */
+	unsigned cache_size; /*!< Response cache size limit. */
+	bool dnssec;         /*!< Signed zone with NSEC3 (fake signatures). */
+} bench_params_t;
+
+typedef struct {
+	bench_kind_t kind;
+	uint16_t nscount;    /*!< Expected authority records of a signed NXDOMAIN. */
+	uint16_t size;
+	uint8_t wire[BENCH_QUERY_MAX];
+} bench_query_t;
+
+/*! \brief Memory context counting allocations from the per-query pool. */
+typedef struct {
+	knot_mm_t pool;
+	size_t allocs;
+	size_t bytes;
+} bench_mm_t;
+
+typedef struct {
+	pthread_t thread;
+	unsigned id;
+	server_t *server;
+	const bench_params_t *params;
+	const bench_query_t *corpus;
+	size_t corpus_size;
+	uint32_t *latency;               /*!< Query latencies in nanoseconds. */
+	size_t allocs[BENCH_KINDS];
+	size_t bytes[BENCH_KINDS];
+	double elapsed_ms;
+	int ret;
+} bench_worker_t;
+
+static const uint8_t *bench_dname(const char *fmt, ...)
+{
+	static knot_dname_storage_t dname;
+	char str[KNOT_DNAME_TXT_MAXLEN];
+
+	va_list args;
+	va_start(args, fmt);
+	(void)vsnprintf(str, sizeof(str), fmt, args);
+	va_end(args);
+
+	return knot_dname_from_str(dname, str, sizeof(dname));
+}
+
+static int add_rr(zone_contents_t *zone, const knot_dname_t *owner, uint16_t type,
+                  const uint8_t *rdata, uint16_t rdlen)
+{
+	knot_rrset_t rr;
+	knot_rrset_init(&rr, (knot_dname_t *)owner, type, KNOT_CLASS_IN, BENCH_TTL);
+	int ret = knot_rrset_add_rdata(&rr, rdata, rdlen, NULL);
+	if (ret == KNOT_EOK) {
+		zone_node_t *unused = NULL;
+		ret = zone_contents_add_rr(zone, &rr, &unused);
+	}
+	knot_rdataset_clear(&rr.rrs, NULL);
+
+	return ret;
+}
+
+static int add_a(zone_contents_t *zone, const knot_dname_t *owner, uint32_t addr)
+{
+	uint8_t rdata[4];
+	knot_wire_write_u32(rdata, addr);
+
+	return add_rr(zone, owner, KNOT_RRTYPE_A, rdata, sizeof(rdata));
+}
+
+static int add_name(zone_contents_t *zone, const knot_dname_t *owner, uint16_t type,
+                    const char *target)
+{
+	knot_dname_storage_t owner_copy;
+	knot_dname_to_wire(owner_copy, owner, sizeof(owner_copy));
+	const uint8_t *rdata = bench_dname("%s", target);
+
+	return add_rr(zone, owner_copy, type, rdata, knot_dname_size(rdata));
+}
+
+/*! \brief Add RRSIGs with fake signatures to all authoritative RRsets. */
+static int sign_node_cb(zone_node_t *node, void *data)
+{
+	if (node->flags & NODE_FLAGS_NONAUTH) {
+		return KNOT_EOK;
+	}
+
+	static const uint8_t signer[] = "\x07""example";
+	uint8_t rdata[18 + sizeof(signer) + 64] = { 0 };
+	rdata[2] = DNSSEC_KEY_ALGORITHM_ECDSA_P256_SHA256;
+	rdata[3] = knot_dname_labels(node->owner, NULL) -
+	           (knot_dname_is_wildcard(node->owner) ? 1 : 0);
+	knot_wire_write_u32(rdata + 4, BENCH_TTL);
+	knot_wire_write_u32(rdata + 8, UINT32_MAX);
+	knot_wire_write_u16(rdata + 16, 12345);
+	memcpy(rdata + 18, signer, sizeof(signer));
+
+	knot_rrset_t rrsig;
+	knot_rrset_init(&rrsig, node->owner, KNOT_RRTYPE_RRSIG, KNOT_CLASS_IN, BENCH_TTL);
+	for (uint16_t i = 0; i < node->rrset_count; i++) {
+		uint16_t type = node->rrs[i].type;
+		if (type == KNOT_RRTYPE_RRSIG ||
+		    (type == KNOT_RRTYPE_NS && (node->flags & NODE_FLAGS_DELEG))) {
+			continue;
+		}
+		knot_wire_write_u16(rdata, type);
+		int ret = knot_rrset_add_rdata(&rrsig, rdata, sizeof(rdata), NULL);
+		if (ret != KNOT_EOK) {
+			knot_rdataset_clear(&rrsig.rrs, NULL);
+			return ret;
+		}
+	}
+
+	int ret = KNOT_EOK;
+	if (!knot_rrset_empty(&rrsig)) {
+		ret = node_add_rrset(node, &rrsig, NULL);
+	}
+	knot_rdataset_clear(&rrsig.rrs, NULL);
+
+	return ret;
+}
+
+typedef struct {
+	uint8_t hash[32];
+	uint8_t *bitmap;
+	uint16_t bitmap_size;
+} nsec3_item_t;
+
+typedef struct {
+	const dnssec_nsec3_params_t *params;
+	nsec3_item_t *items;
+	size_t count;
+} nsec3_ctx_t;
+
+static int nsec3_item_cb(zone_node_t *node, void *data)
+{
+	if (node->flags & NODE_FLAGS_NONAUTH) {
+		return KNOT_EOK;
+	}
+
+	nsec3_ctx_t *ctx = data;
+	nsec3_item_t *item = &ctx->items[ctx->count];
+
+	dnssec_binary_t owner = { .data = node->owner, .size = knot_dname_size(node->owner) };
+	dnssec_binary_t hash = { 0 };
+	int ret = dnssec_nsec3_hash(&owner, ctx->params, &hash);
+	if (ret != DNSSEC_EOK || hash.size != 20) {
+		dnssec_binary_free(&hash);
+		return KNOT_ERROR;
+	}
+	memcpy(item->hash, hash.data, hash.size);
+	dnssec_binary_free(&hash);
+
+	dnssec_nsec_bitmap_t *bitmap = dnssec_nsec_bitmap_new();
+	if (bitmap == NULL) {
+		return KNOT_ENOMEM;
+	}
+	bitmap_add_node_rrsets(bitmap, node, true);
+	if (node->flags & NODE_FLAGS_APEX) {
+		dnssec_nsec_bitmap_add(bitmap, KNOT_RRTYPE_NSEC3PARAM);
+	}
+	item->bitmap_size = dnssec_nsec_bitmap_size(bitmap);
+	item->bitmap = malloc(item->bitmap_size);
+	if (item->bitmap == NULL) {
+		dnssec_nsec_bitmap_free(bitmap);
+		return KNOT_ENOMEM;
+	}
+	dnssec_nsec_bitmap_write(bitmap, item->bitmap);
+	dnssec_nsec_bitmap_free(bitmap);
+
+	ctx->count++;
+
+	return KNOT_EOK;
+}
+
+static int nsec3_item_cmp(const void *a, const void *b)
+{
+	return memcmp(((const nsec3_item_t *)a)->hash, ((const nsec3_item_t *)b)->hash, 20);
+}
+
+/*! \brief Add NSEC3 chain (with fake signatures) for all authoritative names. */
+static int add_nsec3_chain(zone_contents_t *zone, unsigned iterations)
+{
+	uint8_t nsec3param[5] = { DNSSEC_NSEC3_ALGORITHM_SHA1, 0 };
+	knot_wire_write_u16(nsec3param + 2, iterations);
+
+	dnssec_nsec3_params_t params = {
+		.algorithm = DNSSEC_NSEC3_ALGORITHM_SHA1,
+		.iterations = iterations,
+	};
+
+	nsec3_ctx_t ctx = {
+		.params = &params,
+		.items = calloc(zone_tree_count(zone->nodes), sizeof(nsec3_item_t)),
+	};
+	if (ctx.items == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	int ret = zone_tree_apply(zone->nodes, nsec3_item_cb, &ctx);
+	if (ret == KNOT_EOK) {
+		ret = add_rr(zone, zone->apex->owner, KNOT_RRTYPE_NSEC3PARAM,
+		             nsec3param, sizeof(nsec3param));
+	}
+
+	qsort(ctx.items, ctx.count, sizeof(nsec3_item_t), nsec3_item_cmp);
+
+	for (size_t i = 0; i < ctx.count && ret == KNOT_EOK; i++) {
+		const nsec3_item_t *item = &ctx.items[i];
+		const nsec3_item_t *next = &ctx.items[(i + 1) % ctx.count];
+
+		uint8_t rdata[6 + 20 + 1024];
+		if (item->bitmap_size > sizeof(rdata) - 26) {
+			ret = KNOT_ESPACE;
+			break;
+		}
+		memcpy(rdata, nsec3param, 4);
+		rdata[4] = 0;  /* Salt length. */
+		rdata[5] = 20; /* Hash length. */
+		memcpy(rdata + 6, next->hash, 20);
+		memcpy(rdata + 26, item->bitmap, item->bitmap_size);
+
+		knot_dname_storage_t owner;
+		ret = knot_nsec3_hash_to_dname(owner, sizeof(owner), item->hash, 20,
+		                               zone->apex->owner);
+		if (ret == KNOT_EOK) {
+			ret = add_rr(zone, owner, KNOT_RRTYPE_NSEC3, rdata,
+			             26 + item->bitmap_size);
+		}
+	}
+
+	for (size_t i = 0; i < ctx.count; i++) {
+		free(ctx.items[i].bitmap);
+	}
+	free(ctx.items);
+
+	if (ret == KNOT_EOK) {
+		ret = zone_tree_apply(zone->nsec3_nodes, sign_node_cb, NULL);
+	}
+
+	return ret;
+}
+
+static zone_contents_t *synth_zone(const bench_params_t *params)
+{
+	zone_contents_t *zone = zone_contents_new(bench_dname("example."), true);
+	if (zone == NULL) {
+		return NULL;
+	}
+
+	const uint8_t soa[] = "\x02ns\x07""example\x00\x05""admin\x07""example\x00"
+	                      "\x00\x00\x00\x01\x00\x00\x0e\x10\x00\x00\x0e\x10"
+	                      "\x00\x00\x0e\x10\x00\x00\x0e\x10";
+	int ret = add_rr(zone, zone->apex->owner, KNOT_RRTYPE_SOA, soa, sizeof(soa) - 1);
+	if (ret == KNOT_EOK) {
+		ret = add_name(zone, zone->apex->owner, KNOT_RRTYPE_NS, "ns.example.");
+	}
+	if (ret == KNOT_EOK) {
+		ret = add_a(zone, bench_dname("ns.example."), 0xc0000201);
+	}
+
+	for (unsigned i = 0; i < params->names && ret == KNOT_EOK; i++) {
+		uint32_t addr = 0x0a000000 + i;
+		ret = add_a(zone, bench_dname("h%u.example.", i), addr);
+		if (i % BENCH_RATIO != 0 || ret != KNOT_EOK) {
+			continue;
+		}
+
+		/* Delegation with glue. */
+		char target[KNOT_DNAME_TXT_MAXLEN];
+		(void)snprintf(target, sizeof(target), "ns.d%u.example.", i);
+		ret = add_name(zone, bench_dname("d%u.example.", i), KNOT_RRTYPE_NS, target);
+		if (ret == KNOT_EOK) {
+			ret = add_a(zone, bench_dname("%s", target), addr);
+		}
+
+		/* Wildcard below an empty non-terminal. */
+		if (ret == KNOT_EOK) {
+			ret = add_a(zone, bench_dname("*.w%u.example.", i), addr);
+		}
+
+		/* CNAME chain ending at the host name. */
+		for (unsigned j = 0; j < BENCH_CHAIN && ret == KNOT_EOK; j++) {
+			if (j + 1 < BENCH_CHAIN) {
+				(void)snprintf(target, sizeof(target), "c%u-%u.example.", i, j + 1);
+			} else {
+				(void)snprintf(target, sizeof(target), "h%u.example.", i);
+			}
+			ret = add_name(zone, j == 0 ? bench_dname("c%u.example.", i) :
+			               bench_dname("c%u-%u.example.", i, j),
+			               KNOT_RRTYPE_CNAME, target);
+		}
+	}
+
+	for (unsigned i = 0; i < params->large && ret == KNOT_EOK; i++) {
+		ret = add_a(zone, bench_dname("large.example."), 0xc6336400 + i);
+	}
+
+	/* Flags of the nodes are needed for signing. */
+	if (ret == KNOT_EOK) {
+		ret = zone_adjust_full(zone, 1);
+	}
+	if (ret == KNOT_EOK && params->dnssec) {
+		ret = zone_tree_apply(zone->nodes, sign_node_cb, NULL);
+		if (ret == KNOT_EOK) {
+			ret = add_nsec3_chain(zone, params->iterations);
+		}
+		if (ret == KNOT_EOK) {
+			ret = zone_adjust_full(zone, 1);
+		}
+	}
+
+	if (ret != KNOT_EOK) {
+		zone_contents_deep_free(zone);
+		return NULL;
+	}
+
+	return zone;
+}
+
+static int make_query(bench_query_t *query, bench_kind_t kind, const knot_dname_t *qname,
+                      uint16_t qtype, bool dnssec)
+{
+	knot_pkt_t *pkt = knot_pkt_new(NULL, sizeof(query->wire), NULL);
+	if (pkt == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	knot_wire_set_id(pkt->wire, dnssec_random_uint16_t());
+	int ret = knot_pkt_put_question(pkt, qname, KNOT_CLASS_IN, qtype);
+	if (ret == KNOT_EOK) {
+		ret = knot_pkt_begin(pkt, KNOT_ADDITIONAL);
+	}
+
+	knot_rrset_t opt;
+	if (ret == KNOT_EOK) {
+		ret = knot_edns_init(&opt, KNOT_EDNS_MAX_UDP_PAYLOAD, 0,
+		                     KNOT_EDNS_VERSION, NULL);
+	}
+	if (ret == KNOT_EOK) {
+		if (dnssec) {
+			knot_edns_set_do(&opt);
+		}
+		ret = knot_pkt_put(pkt, KNOT_COMPR_HINT_NONE, &opt, 0);
+		knot_rrset_clear(&opt, NULL);
+	}
+
+	query->kind = kind;
+	query->size = pkt->size;
+	memcpy(query->wire, pkt->wire, pkt->size);
+	knot_pkt_free(pkt);
+
+	return ret;
+}
+
+/*!
+ * \brief Number of authority records of a signed NXDOMAIN answer.
+ *
+ * The proof consists of the NSEC3 matching the apex (closest encloser), the NSEC3
+ * covering the next closer name and the one covering the wildcard, which may
+ * coincide in small zones. Computed by the plain NSEC3 tree search.
+ */
+static uint16_t nxdomain_nscount(const zone_contents_t *zone, const knot_dname_t *qname,
+                                 const zone_node_t *proof[2])
+{
+	const zone_node_t *match = NULL, *cover = NULL;
+	(void)zone_contents_find_nsec3_for_name(zone, qname, &match, &cover);
+
+	unsigned nsec3s = (proof[0] == proof[1]) ? 1 : 2;
+	if (cover != proof[0] && cover != proof[1]) {
+		nsec3s++;
+	}
+
+	// SOA and the NSEC3s, all with signatures.
+	return 2 * (1 + nsec3s);
+}
+
+static bench_query_t *make_corpus(server_t *server, const bench_params_t *params,
+                                  size_t *count)
+{
+	*count = BENCH_KINDS * BENCH_CORPUS;
+	bench_query_t *corpus = calloc(*count, sizeof(*corpus));
+	if (corpus == NULL) {
+		return NULL;
+	}
+
+	// NSEC3 matching the apex and NSEC3 covering the wildcard at the apex.
+	const zone_contents_t *zone = NULL;
+	const zone_node_t *proof[2] = { NULL }, *unused = NULL;
+	if (params->dnssec) {
+		zone = knot_zonedb_find(server->zone_db, bench_dname("example."))->contents;
+		(void)zone_contents_find_nsec3_for_name(zone, zone->apex->owner,
+		                                        &proof[0], &unused);
+		(void)zone_contents_find_nsec3_for_name(zone, bench_dname("*.example."),
+		                                        &unused, &proof[1]);
+	}
+
+	unsigned ratio_names = (params->names + BENCH_RATIO - 1) / BENCH_RATIO;
+
+	int ret = KNOT_EOK;
+	for (size_t i = 0; i < *count && ret == KNOT_EOK; i++) {
+		bench_kind_t kind = i % BENCH_KINDS;
+		unsigned rnd = dnssec_random_uint32_t();
+		unsigned host = rnd % params->names;
+		unsigned special = BENCH_RATIO * (rnd % ratio_names);
+
+		const knot_dname_t *qname = NULL;
+		switch (kind) {
+		case BENCH_POSITIVE:
+			qname = bench_dname("h%u.example.", host);
+			break;
+		case BENCH_NXDOMAIN:
+			qname = bench_dname("nx%u.example.", host);
+			break;
+		case BENCH_REFERRAL:
+			qname = bench_dname("www.d%u.example.", special);
+			break;
+		case BENCH_CNAME:
+			qname = bench_dname("c%u.example.", special);
+			break;
+		case BENCH_WILDCARD:
+			qname = bench_dname("q%u.w%u.example.", host, special);
+			break;
+		case BENCH_LARGE_RRSET:
+			qname = bench_dname("large.example.");
+			break;
+		default:
+			assert(0);
+		}
+
+		ret = make_query(&corpus[i], kind, qname, KNOT_RRTYPE_A, params->dnssec);
+		if (kind == BENCH_NXDOMAIN && params->dnssec) {
+			corpus[i].nscount = nxdomain_nscount(zone, qname, proof);
+		}
+	}
+
+	if (ret != KNOT_EOK) {
+		free(corpus);
+		return NULL;
+	}
+
+	return corpus;
+}
+
+/*! \brief Check that the answer is of the expected kind. */
+static bool answer_ok(const bench_params_t *params, const bench_query_t *query,
+                      const knot_pkt_t *answer)
+{
+	uint8_t rcode = knot_wire_get_rcode(answer->wire);
+	uint16_t an = knot_wire_get_ancount(answer->wire);
+	uint16_t ns = knot_wire_get_nscount(answer->wire);
+	unsigned sigs = params->dnssec ? 2 : 1;
+
+	switch (query->kind) {
+	case BENCH_POSITIVE:
+	case BENCH_WILDCARD:
+		return rcode == KNOT_RCODE_NOERROR && an == sigs;
+	case BENCH_NXDOMAIN:
+		return rcode == KNOT_RCODE_NXDOMAIN && an == 0 &&
+		       (params->dnssec ? ns == query->nscount : ns >= 1);
+	case BENCH_REFERRAL:
+		return rcode == KNOT_RCODE_NOERROR && an == 0 && ns > 0 &&
+		       !knot_wire_get_aa(answer->wire);
+	case BENCH_CNAME:
+		return rcode == KNOT_RCODE_NOERROR && an == (BENCH_CHAIN + 1) * sigs;
+	case BENCH_LARGE_RRSET:
+		return rcode == KNOT_RCODE_NOERROR && an == params->large + sigs - 1;
+	default:
+		return false;
+	}
+}
+
+static void *bench_mm_alloc(void *ctx, size_t size)
+{
+	bench_mm_t *mm = ctx;
+	mm->allocs++;
+	mm->bytes += size;
+
+	return mm_alloc(&mm->pool, size);
+}
+
+static uint64_t elapsed_ns(const struct timespec *begin, const struct timespec *end)
+{
+	return (end->tv_sec - begin->tv_sec) * 1000000000ULL + end->tv_nsec - begin->tv_nsec;
+}
+
+/*! \brief Process one query in the same way as the UDP handler does. */
+static int process(knot_layer_t *layer, knotd_qdata_params_t *params,
+                   uint8_t *rx, const bench_query_t *query, uint8_t *tx,
+                   knot_pkt_t **answer)
+{
+	knot_layer_begin(layer, params);
+
+	memcpy(rx, query->wire, query->size);
+	knot_pkt_t *q = knot_pkt_new(rx, query->size, layer->mm);
+	knot_pkt_t *ans = knot_pkt_new(tx, KNOT_WIRE_MAX_PKTSIZE, layer->mm);
+
+	(void)knot_pkt_parse(q, 0);
+	knot_layer_consume(layer, q);
+	while (layer->state == KNOT_STATE_PRODUCE || layer->state == KNOT_STATE_FAIL) {
+		knot_layer_produce(layer, ans);
+	}
+	int state = layer->state;
+	if (answer != NULL) {
+		*answer = ans;
+	}
+
+	knot_layer_finish(layer);
+
+	return state == KNOT_STATE_DONE ? KNOT_EOK : KNOT_ERROR;
+}
+
+static void *bench_worker(void *data)
+{
+	bench_worker_t *worker = data;
+	const bench_params_t *params = worker->params;
+
+	rcu_register_thread();
+
+	bench_mm_t mm = { 0 };
+	mm_ctx_mempool(&mm.pool, MM_DEFAULT_BLKSIZE);
+	knot_mm_t layer_mm = {
+		.ctx = &mm,
+		.alloc = bench_mm_alloc,
+		.free = mm.pool.free
+	};
+
+	knot_layer_t layer = { 0 };
+	knot_layer_init(&layer, &layer_mm, process_query_layer());
+
+	struct sockaddr_storage remote;
+	sockaddr_set(&remote, AF_INET, "127.0.0.1", 53);
+	knotd_qdata_params_t qparams = {
+		.remote = &remote,
+		.socket = -1,
+		.thread_id = worker->id,
+		.server = worker->server
+	};
+
+	uint8_t rx[KNOT_WIRE_MAX_PKTSIZE], tx[KNOT_WIRE_MAX_PKTSIZE];
+	size_t offset = worker->id * BENCH_CORPUS / 2;
+
+	struct timespec begin, end, qbegin, qend;
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	for (unsigned i = 0; i < params->queries; i++) {
+		const bench_query_t *query = &worker->corpus[(offset + i) % worker->corpus_size];
+		size_t allocs = mm.allocs, bytes = mm.bytes;
+
+		clock_gettime(CLOCK_MONOTONIC, &qbegin);
+		int ret = process(&layer, &qparams, rx, query, tx, NULL);
+		mp_flush(mm.pool.ctx);
+		clock_gettime(CLOCK_MONOTONIC, &qend);
+
+		if (ret != KNOT_EOK) {
+			worker->ret = ret;
+			break;
+		}
+		worker->latency[i] = elapsed_ns(&qbegin, &qend);
+		worker->allocs[query->kind] += mm.allocs - allocs;
+		worker->bytes[query->kind] += mm.bytes - bytes;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	worker->elapsed_ms = elapsed_ns(&begin, &end) / 1e6;
+
+	mp_delete(mm.pool.ctx);
+	rcu_unregister_thread();
+
+	return NULL;
+}
+
+/*! \brief Check the answers of the whole corpus. */
+static int verify_corpus(server_t *server, const bench_params_t *params,
+                         const bench_query_t *corpus, size_t count)
+{
+	knot_mm_t mm;
+	mm_ctx_mempool(&mm, MM_DEFAULT_BLKSIZE);
+
+	knot_layer_t layer = { 0 };
+	knot_layer_init(&layer, &mm, process_query_layer());
+
+	struct sockaddr_storage remote;
+	sockaddr_set(&remote, AF_INET, "127.0.0.1", 53);
+	knotd_qdata_params_t qparams = {
+		.remote = &remote,
+		.socket = -1,
+		.server = server
+	};
+
+	uint8_t rx[KNOT_WIRE_MAX_PKTSIZE], tx[KNOT_WIRE_MAX_PKTSIZE];
+
+	int ret = KNOT_EOK;
+	for (size_t i = 0; i < count && ret == KNOT_EOK; i++) {
+		knot_pkt_t *answer = NULL;
+		ret = process(&layer, &qparams, rx, &corpus[i], tx, &answer);
+		if (ret == KNOT_EOK && !answer_ok(params, &corpus[i], answer)) {
+			fprintf(stderr, "unexpected %s answer, rcode %u, ancount %u, nscount %u\n",
+			        kind_names[corpus[i].kind], knot_wire_get_rcode(answer->wire),
+			        knot_wire_get_ancount(answer->wire),
+			        knot_wire_get_nscount(answer->wire));
+			ret = KNOT_EMALF;
+		}
+		mp_flush(mm.ctx);
+	}
+
+	mp_delete(mm.ctx);
+
+	return ret;
+}
+
+static int latency_cmp(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+	return (x > y) - (x < y);
+}
+
+static double percentile_us(uint32_t *values, size_t count, unsigned pct)
+{
+	if (count == 0) {
+		return 0;
+	}
+	qsort(values, count, sizeof(*values), latency_cmp);
+	return values[(count - 1) * pct / 100] / 1e3;
+}
+
+static void cache_stats_cb(zone_t *zone, resp_cache_stats_t *stats)
+{
+	resp_cache_stats(zone->contents, stats);
+}
+
+static void report(const bench_params_t *params, bench_worker_t *workers,
+                   const bench_query_t *corpus, size_t corpus_size)
+{
+	size_t total = (size_t)params->threads * params->queries;
+	uint32_t *values = malloc(total * sizeof(*values));
+	if (values == NULL) {
+		return;
+	}
+
+	printf("%-10s %10s %10s %10s %10s %10s\n", "kind", "queries",
+	       "p50 [us]", "p99 [us]", "allocs/q", "bytes/q");
+
+	for (unsigned kind = 0; kind <= BENCH_KINDS; kind++) {
+		size_t count = 0, allocs = 0, bytes = 0;
+		for (unsigned t = 0; t < params->threads; t++) {
+			bench_worker_t *worker = &workers[t];
+			size_t offset = worker->id * BENCH_CORPUS / 2;
+			for (unsigned i = 0; i < params->queries; i++) {
+				const bench_query_t *query = &corpus[(offset + i) % corpus_size];
+				if (kind == BENCH_KINDS || query->kind == kind) {
+					values[count++] = worker->latency[i];
+				}
+			}
+			for (unsigned k = 0; k < BENCH_KINDS; k++) {
+				if (kind == BENCH_KINDS || k == kind) {
+					allocs += worker->allocs[k];
+					bytes += worker->bytes[k];
+				}
+			}
+		}
+
+		printf("%-10s %10zu %10.2f %10.2f %10.1f %10.0f\n",
+		       kind == BENCH_KINDS ? "total" : kind_names[kind], count,
+		       percentile_us(values, count, 50), percentile_us(values, count, 99),
+		       count > 0 ? (double)allocs / count : 0,
+		       count > 0 ? (double)bytes / count : 0);
+	}
+
+	double qps = 0;
+	for (unsigned t = 0; t < params->threads; t++) {
+		qps += params->queries / (workers[t].elapsed_ms / 1e3);
+	}
+	printf("threads %u, %.0f qps/thread, %.0f qps\n",
+	       params->threads, qps / params->threads, qps);
+
+	if (params->cache_size > 0) {
+		resp_cache_stats_t stats = { 0 };
+		knot_zonedb_foreach(workers[0].server->zone_db, cache_stats_cb, &stats);
+		uint64_t lookups = stats.hits + stats.misses;
+		printf("response cache: %.1f %% hits, %"PRIu64" bytes\n",
+		       lookups > 0 ? 100.0 * stats.hits / lookups : 0, stats.size);
+	}
+
+	free(values);
+}
+
+static int run(server_t *server, const bench_params_t *params)
+{
+	size_t corpus_size = 0;
+	bench_query_t *corpus = make_corpus(server, params, &corpus_size);
+	if (corpus == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	int ret = verify_corpus(server, params, corpus, corpus_size);
+	if (ret != KNOT_EOK) {
+		free(corpus);
+		return ret;
+	}
+
+	bench_worker_t *workers = calloc(params->threads, sizeof(*workers));
+	if (workers == NULL) {
+		free(corpus);
+		return KNOT_ENOMEM;
+	}
+
+	unsigned started = 0;
+	for (; started < params->threads; started++) {
+		bench_worker_t *worker = &workers[started];
+		worker->id = started;
+		worker->server = server;
+		worker->params = params;
+		worker->corpus = corpus;
+		worker->corpus_size = corpus_size;
+		worker->latency = calloc(params->queries, sizeof(*worker->latency));
+		if (worker->latency == NULL ||
+		    pthread_create(&worker->thread, NULL, bench_worker, worker) != 0) {
+			free(worker->latency);
+			ret = KNOT_ENOMEM;
+			break;
+		}
+	}
+
+	for (unsigned t = 0; t < started; t++) {
+		pthread_join(workers[t].thread, NULL);
+		if (workers[t].ret != KNOT_EOK) {
+			ret = workers[t].ret;
+		}
+	}
+
+	if (ret == KNOT_EOK) {
+		report(params, workers, corpus, corpus_size);
+	}
+
+	for (unsigned t = 0; t < started; t++) {
+		free(workers[t].latency);
+	}
+	free(workers);
+	free(corpus);
+
+	return ret;
+}
+
+typedef struct {
+	knot_pkt_t *pkt;
+	const knot_pkt_t *query;
+	size_t messages;
+	size_t bytes;
+	size_t rrs;
+} bench_xfr_t;
+
+static int xfr_next_msg(bench_xfr_t *xfr)
+{
+	xfr->messages++;
+	xfr->bytes += xfr->pkt->size;
+
+	return knot_pkt_init_response(xfr->pkt, xfr->query);
+}
+
+/*! \brief Put node RRSets as the AXFR does, messages wrapped after 16 KiB. */
+static int xfr_put_cb(zone_node_t *node, void *data)
+{
+	bench_xfr_t *xfr = data;
+
+	for (uint16_t i = 0; i < node->rrset_count; i++) {
+		knot_rrset_t rrset = node_rrset_at(node, i);
+		uint16_t flags = KNOT_PF_NOTRUNC | KNOT_PF_ORIGTTL;
+		int ret = knot_pkt_put(xfr->pkt, 0, &rrset, flags);
+		if (ret == KNOT_ESPACE) {
+			ret = xfr_next_msg(xfr);
+			if (ret == KNOT_EOK) {
+				ret = knot_pkt_put(xfr->pkt, 0, &rrset, flags);
+			}
+		}
+		if (ret == KNOT_EOK && xfr->pkt->size > KNOT_WIRE_PTR_MAX) {
+			ret = xfr_next_msg(xfr);
+		}
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+		xfr->rrs += rrset.rrs.count;
+	}
+
+	return KNOT_EOK;
+}
+
+static int xfr_encode(zone_contents_t *contents, const knot_pkt_t *query,
+                      bool dict, bench_xfr_t *xfr, double *ns_per_rr)
+{
+	knot_pkt_t *pkt = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, NULL);
+	if (pkt == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	int ret = knot_pkt_init_response(pkt, query);
+	if (ret == KNOT_EOK && dict) {
+		ret = knot_pkt_compr_dict(pkt);
+	}
+
+	*ns_per_rr = 0;
+	for (unsigned round = 0; round < BENCH_XFR_ROUNDS && ret == KNOT_EOK; round++) {
+		*xfr = (bench_xfr_t) { .pkt = pkt, .query = query };
+		size_t base_size = pkt->size;
+
+		struct timespec begin, end;
+		clock_gettime(CLOCK_MONOTONIC, &begin);
+		ret = zone_tree_apply(contents->nodes, xfr_put_cb, xfr);
+		if (ret == KNOT_EOK) {
+			ret = zone_tree_apply(contents->nsec3_nodes, xfr_put_cb, xfr);
+		}
+		if (ret == KNOT_EOK && pkt->size > base_size) {
+			ret = xfr_next_msg(xfr);
+		}
+		clock_gettime(CLOCK_MONOTONIC, &end);
+
+		double ns = (double)elapsed_ns(&begin, &end) / MAX(xfr->rrs, 1);
+		if (round == 0 || ns < *ns_per_rr) {
+			*ns_per_rr = ns;
+		}
+	}
+
+	knot_pkt_free(pkt);
+
+	return ret;
+}
+
+/*! \brief Compare the AXFR message encoding with and without the compression dictionary. */
+static int bench_xfr(zone_contents_t *contents)
+{
+	knot_pkt_t *query = knot_pkt_new(NULL, KNOT_WIRE_MIN_PKTSIZE, NULL);
+	if (query == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	int ret = knot_pkt_put_question(query, contents->apex->owner, KNOT_CLASS_IN,
+	                                KNOT_RRTYPE_AXFR);
+	for (int dict = 0; dict <= 1 && ret == KNOT_EOK; dict++) {
+		bench_xfr_t xfr;
+		double ns_per_rr;
+		ret = xfr_encode(contents, query, dict, &xfr, &ns_per_rr);
+		if (ret == KNOT_EOK) {
+			printf("axfr %-10s %zu RRs, %zu messages, %zu bytes, %.1f bytes/RR, %.0f ns/RR\n",
+			       dict ? "dictionary" : "default", xfr.rrs, xfr.messages,
+			       xfr.bytes, (double)xfr.bytes / MAX(xfr.rrs, 1), ns_per_rr);
+		}
+	}
+
+	knot_pkt_free(query);
+
+	return ret;
+}
+
+static int init_conf(const char *storage)
+{
+	char conf_str[4096 + 512];
+	(void)snprintf(conf_str, sizeof(conf_str),
+		"server:\n"
+		"    identity: bench\n"
+		"database:\n"
+		"    storage: %s\n"
+		"zone:\n"
+		"  - domain: example.\n",
+		storage);
+
+	return test_conf(conf_str, NULL);
+}
+
+static int insert_zone(server_t *server, zone_contents_t *contents,
+                       const bench_params_t *params)
+{
+	zone_t *zone = zone_new(contents->apex->owner);
+	if (zone == NULL) {
+		zone_contents_deep_free(contents);
+		return KNOT_ENOMEM;
+	}
+	zone->server = server;
+	zone->contents = contents;
+	zone->resp_cache_max_size = params->cache_size;
+
+	knot_zonedb_free(&server->zone_db);
+	server->zone_db = knot_zonedb_new();
+	if (server->zone_db == NULL) {
+		zone_free(&zone);
+		return KNOT_ENOMEM;
+	}
+
+	return knot_zonedb_insert(server->zone_db, zone);
+}
+
+static void print_help(const char *program)
+{
+	printf("Usage: %s [parameters]\n"
+	       "\n"
+	       "Parameters:\n"
+	       " -n <num>  Number of host names in the zone (default %u).\n"
+	       " -t <num>  Number of processing threads (default %u).\n"
+	       " -q <num>  Number of queries per thread (default %u).\n"
+	       " -l <num>  Number of records in the large RRset (default %u).\n"
+	       " -i <num>  Number of NSEC3 iterations (default 0).\n"
+	       " -c <num>  Response cache size in bytes (default 0).\n"
+	       " -u        Unsigned zone, no DNSSEC records.\n"
+	       " -h        Print the program help.\n",
+	       program, BENCH_NAMES, BENCH_THREADS, BENCH_QUERIES, BENCH_LARGE);
+}
+
+static bool parse_num(const char *str, unsigned *num, unsigned min)
+{
+	char *end = NULL;
+	unsigned long val = strtoul(str, &end, 10);
+	if (*str == '\0' || *end != '\0' || val < min || val > UINT_MAX) {
+		return false;
+	}
+	*num = val;
+
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	bench_params_t params = {
+		.names = BENCH_NAMES,
+		.threads = BENCH_THREADS,
+		.queries = BENCH_QUERIES,
+		.large = BENCH_LARGE,
+		.dnssec = true
+	};
+
+	int opt;
+	while ((opt = getopt(argc, argv, "n:t:q:l:i:c:uh")) != -1) {
+		bool valid = true;
+		switch (opt) {
+		case 'n': valid = parse_num(optarg, &params.names, BENCH_RATIO); break;
+		case 't': valid = parse_num(optarg, &params.threads, 1); break;
+		case 'q': valid = parse_num(optarg, &params.queries, 1); break;
+		case 'l': valid = parse_num(optarg, &params.large, 1); break;
+		case 'i': valid = parse_num(optarg, &params.iterations, 0); break;
+		case 'c': valid = parse_num(optarg, &params.cache_size, 0); break;
+		case 'u': params.dnssec = false; break;
+		case 'h': print_help(argv[0]); return EXIT_SUCCESS;
+		default:  valid = false;
+		}
+		if (!valid) {
+			print_help(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	zone_contents_t *contents = synth_zone(&params);
+	if (contents == NULL) {
+		fprintf(stderr, "failed to generate the zone\n");
+		return EXIT_FAILURE;
+	}
+	printf("zone: %zu nodes, %zu NSEC3 nodes, %s, NSEC3 iterations %u\n",
+	       zone_tree_count(contents->nodes), zone_tree_count(contents->nsec3_nodes),
+	       params.dnssec ? "signed" : "unsigned", params.iterations);
+
+	char *storage = test_mkdtemp();
+	if (storage == NULL) {
+		zone_contents_deep_free(contents);
+		return EXIT_FAILURE;
+	}
+
+	server_t server;
+	int ret = init_conf(storage);
+	if (ret == KNOT_EOK) {
+		ret = server_init(&server, 1);
+		if (ret == KNOT_EOK) {
+			ret = insert_zone(&server, contents, &params);
+			if (ret == KNOT_EOK) {
+				ret = run(&server, &params);
+			}
+			if (ret == KNOT_EOK) {
+				ret = bench_xfr(contents);
+			}
+			server_deinit(&server);
+		} else {
+			zone_contents_deep_free(contents);
+		}
+		conf_free(conf());
+	} else {
+		zone_contents_deep_free(contents);
+	}
+	if (ret != KNOT_EOK) {
+		fprintf(stderr, "benchmark failed (%s)\n", knot_strerror(ret));
+	}
+
+	test_rm_rf(storage);
+	free(storage);
+
+	return ret == KNOT_EOK ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,206 @@
+/*  Copyright (C) 2021 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "knot/zone/adjust.h"
+#include "knot/zone/zone-image.h"
+#include "knot/zone/zonefile.h"
+#include "libknot/libknot.h"
+#include "contrib/time.h"
+
+/*
+ * Benchmark of the zone loading from a zone image compared to the zone file
+ * parsing. A synthetic zone file is generated and loaded repeatedly, both
+ * ways followed by the full zone adjustment as done before the zone is
+ * served. The minimum time of the given number of rounds is reported.
+ *
+ * Run via 'make bench', parameters can be passed via the BENCH_FLAGS
+ * variable, e.g. make bench BENCH_FLAGS="-n 1000000 -r 3".
+ */
+
+#define BENCH_NAMES		200000
+#define BENCH_ROUNDS		5
+#define BENCH_DELEG_RATIO	50	/* Every Nth name is a delegation with glue. */
+
+static int write_zonefile(const char *path, unsigned long names)
+{
+	FILE *file = fopen(path, "w");
+	if (file == NULL) {
+		return KNOT_EFILE;
+	}
+
+	fprintf(file, "$ORIGIN example.\n$TTL 3600\n"
+	              "@ SOA ns admin 1 3600 3600 3600 3600\n"
+	              "@ NS ns\nns A 192.0.2.1\n");
+	for (unsigned long i = 0; i < names; ++i) {
+		unsigned a = (i >> 16) & 0xff, b = (i >> 8) & 0xff, c = i & 0xff;
+		if (i % BENCH_DELEG_RATIO == 0) {
+			fprintf(file, "d%lu NS ns.d%lu\nns.d%lu A 10.%u.%u.%u\n",
+			        i, i, i, a, b, c);
+		} else {
+			fprintf(file, "h%lu A 10.%u.%u.%u\nh%lu TXT \"host %lu\"\n",
+			        i, a, b, c, i, i);
+		}
+	}
+
+	return (fclose(file) == 0) ? KNOT_EOK : KNOT_EFILE;
+}
+
+static int load_text(const char *path, const knot_dname_t *apex,
+                     zone_contents_t **contents)
+{
+	zloader_t zl;
+	int ret = zonefile_open(&zl, path, apex, SEMCHECK_MANDATORY_ONLY, time(NULL));
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+	sem_handler_t handler = { .cb = err_handler_logger };
+	zl.err_handler = &handler;
+	*contents = zonefile_load(&zl);
+	zonefile_close(&zl);
+
+	return (*contents != NULL) ? KNOT_EOK : KNOT_ERROR;
+}
+
+static int load_image(const char *path, const char *zonefile,
+                      const knot_dname_t *apex, zone_contents_t **contents)
+{
+	return zone_image_load(path, zonefile, apex, contents);
+}
+
+/*! \brief Load the zone one way, return the load and adjust times in ms. */
+static int timed_load(const char *zonefile, const char *image,
+                      const knot_dname_t *apex, double *load_ms, double *adjust_ms)
+{
+	struct timespec begin, loaded, end;
+	zone_contents_t *contents = NULL;
+
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	int ret = (image == NULL) ? load_text(zonefile, apex, &contents) :
+	                            load_image(image, zonefile, apex, &contents);
+	clock_gettime(CLOCK_MONOTONIC, &loaded);
+	if (ret == KNOT_EOK) {
+		ret = zone_adjust_full(contents, 1);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	zone_contents_deep_free(contents);
+
+	*load_ms = time_diff_ms(&begin, &loaded);
+	*adjust_ms = time_diff_ms(&loaded, &end);
+
+	return ret;
+}
+
+static int bench(const char *zonefile, const char *image, const knot_dname_t *apex,
+                 unsigned long rounds, const char *label)
+{
+	double load_min = 0, adjust_min = 0, total_min = 0;
+	for (unsigned long i = 0; i < rounds; ++i) {
+		double load_ms, adjust_ms;
+		int ret = timed_load(zonefile, image, apex, &load_ms, &adjust_ms);
+		if (ret != KNOT_EOK) {
+			fprintf(stderr, "%s: failed to load (%s)\n", label, knot_strerror(ret));
+			return ret;
+		}
+		if (i == 0 || load_ms + adjust_ms < total_min) {
+			load_min = load_ms;
+			adjust_min = adjust_ms;
+			total_min = load_ms + adjust_ms;
+		}
+	}
+
+	printf("%-6s load %9.1f ms  adjust %9.1f ms  total %9.1f ms\n",
+	       label, load_min, adjust_min, total_min);
+
+	return KNOT_EOK;
+}
+
+static bool parse_num(const char *arg, unsigned long *num, unsigned long min)
+{
+	char *end = NULL;
+	unsigned long val = strtoul(arg, &end, 10);
+	if (*arg == '\0' || *end != '\0' || val < min || val > UINT16_MAX * 256UL) {
+		fprintf(stderr, "invalid parameter value '%s'\n", arg);
+		return false;
+	}
+	*num = val;
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned long names = BENCH_NAMES, rounds = BENCH_ROUNDS;
+
+	opterr = 0;
+	int opt;
+	while ((opt = getopt(argc, argv, "n:r:")) != -1) {
+		bool valid = true;
+		switch (opt) {
+		case 'n': valid = parse_num(optarg, &names, 1); break;
+		case 'r': valid = parse_num(optarg, &rounds, 1); break;
+		default: break;
+		}
+		if (!valid) {
+			return EXIT_FAILURE;
+		}
+	}
+
+	char zonefile[] = "/tmp/bench_zone_image.XXXXXX";
+	int fd = mkstemp(zonefile);
+	if (fd < 0) {
+		return EXIT_FAILURE;
+	}
+	close(fd);
+
+	knot_dname_t *apex = knot_dname_from_str_alloc("example.");
+	char *image = zone_image_path(zonefile);
+	int ret = (apex != NULL && image != NULL) ? write_zonefile(zonefile, names) : KNOT_ENOMEM;
+
+	// Store the image of the parsed zone file.
+	struct stat st;
+	zone_contents_t *contents = NULL;
+	if (ret == KNOT_EOK) {
+		ret = (stat(zonefile, &st) == 0) ? load_text(zonefile, apex, &contents) :
+		                                   KNOT_EFILE;
+	}
+	if (ret == KNOT_EOK) {
+		ret = zone_image_write(image, zonefile, &st.st_mtim, contents);
+		zone_contents_deep_free(contents);
+	}
+
+	if (ret == KNOT_EOK) {
+		printf("%lu names, %lu rounds\n", names, rounds);
+		ret = bench(zonefile, NULL, apex, rounds, "text");
+	}
+	if (ret == KNOT_EOK) {
+		ret = bench(zonefile, image, apex, rounds, "image");
+	}
+
+	if (image != NULL) {
+		unlink(image);
+	}
+	unlink(zonefile);
+	free(image);
+	knot_dname_free(apex, NULL);
+
+	return (ret == KNOT_EOK) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
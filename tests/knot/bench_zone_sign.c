@@ -0,0 +1,243 @@
+/*  Copyright (C) 2021 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../libdnssec/sample_keys.h"
+#include "libdnssec/crypto.h"
+#include "libdnssec/error.h"
+#include "libdnssec/key.h"
+#include "knot/dnssec/zone-nsec.h"
+#include "knot/dnssec/zone-sign.h"
+#include "knot/updates/zone-update.h"
+#include "knot/zone/adjust.h"
+#include "knot/zone/zone.h"
+#include "libknot/libknot.h"
+#include "contrib/time.h"
+
+/*
+ * Benchmark of the parallel zone signing. A synthetic NSEC-signed zone is
+ * signed from scratch with one thread and then with the given number of
+ * threads, the NSEC chain creation is not included in the timing.
+ *
+ * Run via 'make bench', parameters can be passed via the BENCH_FLAGS
+ * variable, e.g. make bench BENCH_FLAGS="-n 1000000 -t 8".
+ */
+
+#define BENCH_NAMES		20000
+#define BENCH_THREADS		4
+#define BENCH_DELEG_RATIO	50	/* Every Nth name is a delegation with glue. */
+
+static int add_rr(zone_contents_t *zone, const char *owner_str, uint16_t type,
+                  const uint8_t *rdata, uint16_t rdlen)
+{
+	knot_dname_t *owner = knot_dname_from_str_alloc(owner_str);
+	if (owner == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	knot_rrset_t rr;
+	knot_rrset_init(&rr, owner, type, KNOT_CLASS_IN, 3600);
+	int ret = knot_rrset_add_rdata(&rr, rdata, rdlen, NULL);
+	if (ret == KNOT_EOK) {
+		zone_node_t *unused = NULL;
+		ret = zone_contents_add_rr(zone, &rr, &unused);
+	}
+	knot_rrset_clear(&rr, NULL);
+
+	return ret;
+}
+
+static int add_ns(zone_contents_t *zone, const char *owner_str, const char *target_str)
+{
+	uint8_t rdata[KNOT_DNAME_MAXLEN];
+	if (knot_dname_from_str(rdata, target_str, sizeof(rdata)) == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	return add_rr(zone, owner_str, KNOT_RRTYPE_NS, rdata, knot_dname_size(rdata));
+}
+
+static zone_contents_t *synth_zone(const knot_dname_t *apex, unsigned names)
+{
+	zone_contents_t *zone = zone_contents_new(apex, false);
+	if (zone == NULL) {
+		return NULL;
+	}
+
+	const uint8_t soa[] = "\x02ns\x07""example\x00\x05""admin\x07""example\x00"
+	                      "\x00\x00\x00\x01\x00\x00\x0e\x10\x00\x00\x0e\x10"
+	                      "\x00\x00\x0e\x10\x00\x00\x0e\x10";
+	int ret = add_rr(zone, "example.", KNOT_RRTYPE_SOA, soa, sizeof(soa) - 1);
+	if (ret == KNOT_EOK) {
+		ret = add_ns(zone, "example.", "ns.example.");
+	}
+
+	char owner[KNOT_DNAME_TXT_MAXLEN], target[KNOT_DNAME_TXT_MAXLEN];
+	for (unsigned i = 0; i < names && ret == KNOT_EOK; ++i) {
+		uint8_t addr[4] = { 192, (i >> 16) & 0xff, (i >> 8) & 0xff, i & 0xff };
+		if (i % BENCH_DELEG_RATIO == 0) {
+			(void)snprintf(owner, sizeof(owner), "d%u.example.", i);
+			(void)snprintf(target, sizeof(target), "ns.d%u.example.", i);
+			ret = add_ns(zone, owner, target);
+			if (ret == KNOT_EOK) {
+				ret = add_rr(zone, target, KNOT_RRTYPE_A, addr, sizeof(addr));
+			}
+		} else {
+			(void)snprintf(owner, sizeof(owner), "h%u.example.", i);
+			ret = add_rr(zone, owner, KNOT_RRTYPE_A, addr, sizeof(addr));
+		}
+	}
+
+	if (ret != KNOT_EOK) {
+		zone_contents_deep_free(zone);
+		return NULL;
+	}
+
+	return zone;
+}
+
+static int timed_sign(zone_t *zone, zone_keyset_t *keyset, unsigned names,
+                      unsigned threads, double *ms)
+{
+	zone_contents_t *contents = synth_zone(zone->name, names);
+	if (contents == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	zone_update_t update;
+	int ret = zone_update_from_contents(&update, zone, contents, UPDATE_FULL);
+	if (ret != KNOT_EOK) {
+		zone_contents_deep_free(contents);
+		return ret;
+	}
+
+	knot_kasp_policy_t policy = {
+		.rrsig_lifetime = 14 * 24 * 3600,
+		.signing_threads = threads,
+	};
+	knot_kasp_zone_t kasp_zone = { .dname = zone->name };
+	kdnssec_ctx_t ctx = {
+		.now = knot_time(),
+		.zone = &kasp_zone,
+		.policy = &policy,
+	};
+
+	ret = zone_adjust_contents(update.new_cont, adjust_cb_flags, NULL,
+	                           false, true, 1, update.a_ctx->node_ptrs);
+	if (ret == KNOT_EOK) {
+		ret = knot_zone_create_nsec_chain(&update, &ctx);
+	}
+	if (ret == KNOT_EOK) {
+		struct timespec begin, end;
+		knot_time_t expire = 0;
+		clock_gettime(CLOCK_MONOTONIC, &begin);
+		ret = knot_zone_sign(&update, keyset, &ctx, &expire);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		*ms = time_diff_ms(&begin, &end);
+	}
+
+	zone_update_clear(&update);
+
+	return ret;
+}
+
+static bool parse_num(const char *arg, unsigned long *num, unsigned long min)
+{
+	char *end = NULL;
+	unsigned long val = strtoul(arg, &end, 10);
+	if (*arg == '\0' || *end != '\0' || val < min || val > UINT16_MAX * 256UL) {
+		fprintf(stderr, "invalid parameter value '%s'\n", arg);
+		return false;
+	}
+	*num = val;
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned long names = BENCH_NAMES, threads = BENCH_THREADS;
+
+	opterr = 0;
+	int opt;
+	while ((opt = getopt(argc, argv, "n:t:")) != -1) {
+		bool valid = true;
+		switch (opt) {
+		case 'n': valid = parse_num(optarg, &names, 1); break;
+		case 't': valid = parse_num(optarg, &threads, 1); break;
+		default: break;
+		}
+		if (!valid) {
+			return EXIT_FAILURE;
+		}
+	}
+
+	dnssec_crypto_init();
+
+	knot_dname_t *apex = knot_dname_from_str_alloc("example.");
+	zone_t *zone = zone_new(apex);
+	knot_dname_free(apex, NULL);
+
+	dnssec_key_t *key = NULL;
+	int ret = dnssec_key_new(&key);
+	if (ret == DNSSEC_EOK) {
+		ret = dnssec_key_set_dname(key, zone->name);
+	}
+	if (ret == DNSSEC_EOK) {
+		ret = dnssec_key_set_rdata(key, &SAMPLE_ECDSA_KEY.rdata);
+	}
+	if (ret == DNSSEC_EOK) {
+		ret = dnssec_key_load_pkcs8(key, &SAMPLE_ECDSA_KEY.pem);
+	}
+	if (ret != DNSSEC_EOK) {
+		fprintf(stderr, "failed to load key\n");
+		return EXIT_FAILURE;
+	}
+
+	zone_key_t zone_key = {
+		.key = key,
+		.is_ksk = true,
+		.is_zsk = true,
+		.is_active = true,
+		.is_public = true,
+		.is_ready = true,
+	};
+	zone_keyset_t keyset = { .count = 1, .keys = &zone_key };
+
+	printf("%lu names, ECDSAP256SHA256\n", names);
+
+	double single = 0, multi = 0;
+	ret = timed_sign(zone, &keyset, names, 1, &single);
+	if (ret == KNOT_EOK) {
+		printf("%-16s %10.0f ms\n", "1 thread", single);
+		ret = timed_sign(zone, &keyset, names, threads, &multi);
+	}
+	if (ret == KNOT_EOK) {
+		printf("%2lu %-13s %10.0f ms, speedup %.2f\n", threads, "threads",
+		       multi, single / multi);
+	} else {
+		fprintf(stderr, "signing failed (%s)\n", knot_strerror(ret));
+	}
+
+	dnssec_key_free(key);
+	zone_free(&zone);
+	dnssec_crypto_cleanup();
+
+	return (ret == KNOT_EOK) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
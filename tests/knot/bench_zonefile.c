@@ -0,0 +1,227 @@
+/*  Copyright (C) 2021 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "knot/zone/zonefile.c"
+#include "contrib/time.h"
+
+/*
+ * Benchmark of the parallel zone file parsing. A synthetic zone file is
+ * loaded serially and then with the given number of threads. Then the
+ * parallel loading is split into its phases, both run in one thread: parsing
+ * of the parts, which scales with the threads, and the insertion of the parsed
+ * records into the zone, which doesn't. The insertion share bounds the
+ * achievable speedup.
+ *
+ * Run via 'make bench', parameters can be passed via the BENCH_FLAGS
+ * variable, e.g. make bench BENCH_FLAGS="-n 1000000 -t 8".
+ */
+
+#define BENCH_NAMES		500000
+#define BENCH_THREADS		4
+#define BENCH_DELEG_RATIO	50	/* Every Nth name is a delegation with glue. */
+
+static int write_zonefile(const char *path, unsigned long names)
+{
+	FILE *file = fopen(path, "w");
+	if (file == NULL) {
+		return KNOT_EFILE;
+	}
+
+	fprintf(file, "$ORIGIN example.\n$TTL 3600\n"
+	              "@ SOA ns admin 1 3600 3600 3600 3600\n"
+	              "@ NS ns\nns A 192.0.2.1\n");
+	for (unsigned long i = 0; i < names; ++i) {
+		unsigned a = (i >> 16) & 0xff, b = (i >> 8) & 0xff, c = i & 0xff;
+		if (i % BENCH_DELEG_RATIO == 0) {
+			fprintf(file, "d%lu NS ns.d%lu\nns.d%lu A 10.%u.%u.%u\n",
+			        i, i, i, a, b, c);
+		} else {
+			fprintf(file, "h%lu A 10.%u.%u.%u\nh%lu TXT \"host %lu\"\n",
+			        i, a, b, c, i, i);
+			fprintf(file, "h%lu AAAA 2001:db8::%x:%x\n", i, a, b << 8 | c);
+		}
+	}
+
+	return (fclose(file) == 0) ? KNOT_EOK : KNOT_EFILE;
+}
+
+static int open_loader(zloader_t *zl, const char *path, const knot_dname_t *apex,
+                       sem_handler_t *handler)
+{
+	int ret = zonefile_open(zl, path, apex, SEMCHECK_MANDATORY_ONLY, time(NULL));
+	if (ret == KNOT_EOK) {
+		zl->err_handler = handler;
+	}
+	return ret;
+}
+
+static int timed_load(const char *path, const knot_dname_t *apex, unsigned threads,
+                      double *ms)
+{
+	sem_handler_t handler = { .cb = err_handler_logger };
+	zloader_t zl;
+	int ret = open_loader(&zl, path, apex, &handler);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+	zl.threads = threads;
+
+	struct timespec begin, end;
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	zone_contents_t *contents = zonefile_load(&zl);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	*ms = time_diff_ms(&begin, &end);
+
+	zonefile_close(&zl);
+	zone_contents_deep_free(contents);
+
+	return (contents != NULL) ? KNOT_EOK : KNOT_ERROR;
+}
+
+/*! \brief Parse all parts and then insert them, both in this thread. */
+static int timed_phases(const char *path, const knot_dname_t *apex, unsigned threads,
+                        double *parse_ms, double *insert_ms)
+{
+	sem_handler_t handler = { .cb = err_handler_logger };
+	zloader_t zl;
+	int ret = open_loader(&zl, path, apex, &handler);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	const char *start = zl.scanner.input.start, *end = zl.scanner.input.end;
+	size_t max_parts = MIN((end - start) / PART_SIZE_MIN, threads * PARTS_PER_THREAD);
+	zparallel_t ctx = {
+		.source = path,
+		.origin = "example.",
+		.parts = calloc(MAX(max_parts, 1), sizeof(zpart_t))
+	};
+	zs_scanner_t *s = malloc(sizeof(*s));
+	if (ctx.parts == NULL || s == NULL) {
+		ret = KNOT_ENOMEM;
+		goto finish;
+	}
+	ctx.count = split_parts(start, end, ctx.parts, max_parts);
+	if (ctx.count <= 1) {
+		ret = KNOT_ERANGE;
+		goto finish;
+	}
+
+	struct timespec begin, parsed, inserted;
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	for (size_t i = 0; i < ctx.count; i++) {
+		parse_part(&ctx, &ctx.parts[i], s);
+		if (ctx.parts[i].ret != KNOT_EOK || ctx.parts[i].errors > 0) {
+			ret = KNOT_EMALF;
+			goto finish;
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &parsed);
+	for (size_t i = 0; i < ctx.count && ret == KNOT_EOK; i++) {
+		ret = insert_part(zl.creator, &ctx.parts[i]);
+	}
+	if (ret == KNOT_EOK) {
+		ret = zcreator_flush(zl.creator);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &inserted);
+
+	*parse_ms = time_diff_ms(&begin, &parsed);
+	*insert_ms = time_diff_ms(&parsed, &inserted);
+finish:
+	for (size_t i = 0; ctx.parts != NULL && i < ctx.count; i++) {
+		mp_delete(ctx.parts[i].mm.ctx);
+	}
+	free(ctx.parts);
+	free(s);
+	zone_contents_deep_free(zl.creator->z);
+	zonefile_close(&zl);
+
+	return ret;
+}
+
+static bool parse_num(const char *arg, unsigned long *num, unsigned long min,
+                      unsigned long max)
+{
+	char *end = NULL;
+	unsigned long val = strtoul(arg, &end, 10);
+	if (*arg == '\0' || *end != '\0' || val < min || val > max) {
+		fprintf(stderr, "invalid parameter value '%s'\n", arg);
+		return false;
+	}
+	*num = val;
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned long names = BENCH_NAMES, threads = BENCH_THREADS;
+
+	opterr = 0;
+	int opt;
+	while ((opt = getopt(argc, argv, "n:t:")) != -1) {
+		bool valid = true;
+		switch (opt) {
+		case 'n': valid = parse_num(optarg, &names, 1, UINT16_MAX * 256UL); break;
+		case 't': valid = parse_num(optarg, &threads, 2, 255); break;
+		default: break;
+		}
+		if (!valid) {
+			return EXIT_FAILURE;
+		}
+	}
+
+	char zonefile[] = "/tmp/bench_zonefile.XXXXXX";
+	int fd = mkstemp(zonefile);
+	if (fd < 0) {
+		return EXIT_FAILURE;
+	}
+	close(fd);
+
+	knot_dname_t *apex = knot_dname_from_str_alloc("example.");
+	int ret = (apex != NULL) ? write_zonefile(zonefile, names) : KNOT_ENOMEM;
+
+	double serial = 0, parallel = 0, parse = 0, insert = 0;
+	if (ret == KNOT_EOK) {
+		ret = timed_load(zonefile, apex, 1, &serial);
+	}
+	if (ret == KNOT_EOK) {
+		ret = timed_load(zonefile, apex, threads, &parallel);
+	}
+	if (ret == KNOT_EOK) {
+		ret = timed_phases(zonefile, apex, threads, &parse, &insert);
+	}
+	if (ret == KNOT_EOK) {
+		printf("%lu names, %ld CPUs\n", names, sysconf(_SC_NPROCESSORS_ONLN));
+		printf("serial load     %9.1f ms\n", serial);
+		printf("%3lu threads     %9.1f ms, speedup %.2f\n", threads, parallel,
+		       serial / parallel);
+		printf("parts parsing   %9.1f ms (one thread)\n", parse);
+		printf("insertion       %9.1f ms (%.0f %%), max speedup %.2f\n", insert,
+		       100 * insert / (parse + insert), (parse + insert) / insert);
+	} else {
+		fprintf(stderr, "failed (%s)\n", knot_strerror(ret));
+	}
+
+	unlink(zonefile);
+	knot_dname_free(apex, NULL);
+
+	return (ret == KNOT_EOK) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
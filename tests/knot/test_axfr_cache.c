@@ -0,0 +1,164 @@
+/*  Copyright (C) 2021 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <tap/basic.h>
+
+#include "knot/nameserver/axfr.c"
+
+#define QNAME        "\x07""example"
+#define ANSWER_POS   (KNOT_WIRE_HEADER_SIZE + sizeof(QNAME) + 2 * sizeof(uint16_t))
+#define MSG_COUNT    100
+#define CACHE_LIMIT  (MSG_COUNT * 1000)
+
+/*! \brief Fake AXFR message, the answer section is filled with the index. */
+static void fill_msg(knot_pkt_t *pkt, unsigned idx, uint16_t answer_size)
+{
+	memset(pkt->wire, 0, ANSWER_POS);
+	knot_wire_set_qdcount(pkt->wire, 1);
+	knot_wire_set_ancount(pkt->wire, idx + 1);
+	memcpy(pkt->wire + KNOT_WIRE_HEADER_SIZE, QNAME, sizeof(QNAME));
+	memset(pkt->wire + ANSWER_POS, idx & 0xff, answer_size);
+	pkt->size = ANSWER_POS + answer_size;
+}
+
+static uint16_t msg_size(unsigned idx)
+{
+	return 1 + (idx * 37) % 1000;
+}
+
+static bool check_msg(const knot_pkt_t *pkt, unsigned idx)
+{
+	uint16_t size = msg_size(idx);
+	if (pkt->size != ANSWER_POS + size ||
+	    knot_wire_get_ancount(pkt->wire) != idx + 1) {
+		return false;
+	}
+	for (uint16_t i = 0; i < size; i++) {
+		if (pkt->wire[ANSWER_POS + i] != (idx & 0xff)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static void test_add(struct axfr_cache *cache, knot_pkt_t *pkt)
+{
+	int ret = KNOT_EOK;
+	size_t total = 0;
+	uint16_t max_msg = 0;
+	for (unsigned i = 0; i < MSG_COUNT && ret == KNOT_EOK; i++) {
+		fill_msg(pkt, i, msg_size(i));
+		ret = axfr_cache_add(cache, pkt);
+		total += msg_size(i);
+		max_msg = MAX(max_msg, msg_size(i));
+	}
+	is_int(KNOT_EOK, ret, "axfr cache: add messages");
+	ok(cache->msg_count == MSG_COUNT && cache->size == total,
+	   "axfr cache: message count and size");
+	ok(cache->max_size >= total && cache->max_size <= cache->limit,
+	   "axfr cache: allocated size within limit");
+	is_int(max_msg, cache->max_msg_size, "axfr cache: largest message");
+
+	bool valid = true;
+	size_t offset = 0;
+	for (unsigned i = 0; i < MSG_COUNT; i++) {
+		const axfr_cache_msg_t *msg = &cache->msgs[i];
+		valid = valid && msg->offset == offset && msg->size == msg_size(i) &&
+		        msg->ancount == i + 1 && cache->data[msg->offset] == (i & 0xff);
+		offset += msg->size;
+	}
+	ok(valid, "axfr cache: stored messages");
+}
+
+static void test_limit(struct axfr_cache *cache, knot_pkt_t *pkt)
+{
+	size_t count = cache->msg_count, size = cache->size;
+
+	fill_msg(pkt, 0, cache->limit - cache->size + 1);
+	int ret = axfr_cache_add(cache, pkt);
+	is_int(KNOT_ESPACE, ret, "axfr cache: over the limit");
+	ok(cache->msg_count == count && cache->size == size,
+	   "axfr cache: unchanged over the limit");
+
+	fill_msg(pkt, 0, cache->limit - cache->size);
+	ret = axfr_cache_add(cache, pkt);
+	is_int(KNOT_EOK, ret, "axfr cache: up to the limit");
+	ok(cache->size == cache->limit && cache->max_size == cache->limit,
+	   "axfr cache: full");
+
+	/* Remove the extra message. */
+	cache->msg_count = count;
+	cache->size = size;
+}
+
+static void test_put(struct axfr_cache *cache, knot_pkt_t *pkt)
+{
+	knotd_qdata_t qdata = { 0 };
+	struct axfr_proc axfr = { .cache = cache };
+
+	/* Different message layout. */
+	fill_msg(pkt, 0, 0);
+	pkt->size = ANSWER_POS - 1;
+	int ret = axfr_cache_put(pkt, &qdata, &axfr);
+	ok(ret == KNOT_ESPACE && axfr.cache_msg == 0, "axfr cache: layout mismatch");
+
+	/* Not enough space for the largest message. */
+	fill_msg(pkt, 0, 0);
+	pkt->reserved = pkt->max_size - ANSWER_POS - msg_size(0) + 1;
+	ret = axfr_cache_put(pkt, &qdata, &axfr);
+	ok(ret == KNOT_ESPACE && axfr.cache_msg == 0, "axfr cache: no space");
+	pkt->reserved = 0;
+
+	bool valid = true;
+	ret = KNOT_ESPACE;
+	for (unsigned i = 0; i < MSG_COUNT && ret == KNOT_ESPACE; i++) {
+		fill_msg(pkt, 0, 0);
+		knot_wire_set_ancount(pkt->wire, 0);
+		ret = axfr_cache_put(pkt, &qdata, &axfr);
+		valid = valid && check_msg(pkt, i);
+	}
+	ok(ret == KNOT_EOK && axfr.cache_msg == MSG_COUNT, "axfr cache: all messages put");
+	ok(valid, "axfr cache: messages restored");
+	ok(axfr.proc.stats.messages == MSG_COUNT, "axfr cache: transfer statistics");
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	knot_pkt_t *pkt = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, NULL);
+	ok(pkt != NULL, "axfr cache: create packet");
+	if (pkt == NULL) {
+		return 1;
+	}
+
+	struct axfr_cache *cache = calloc(1, sizeof(*cache));
+	cache->limit = CACHE_LIMIT;
+	cache->answer_pos = ANSWER_POS;
+
+	test_add(cache, pkt);
+	test_limit(cache, pkt);
+	test_put(cache, pkt);
+
+	axfr_cache_free(cache);
+	axfr_cache_free(AXFR_CACHE_BUILDING);
+	axfr_cache_free(AXFR_CACHE_FAILED);
+	ok(true, "axfr cache: free placeholders");
+
+	knot_pkt_free(pkt);
+
+	return 0;
+}
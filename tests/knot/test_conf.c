@@ -255,6 +255,53 @@ static void test_mix_ref(void)
 	test_conf_free();
 }
 
+static void test_conf_xdp(void)
+{
+	int ret = test_conf("", NULL);
+	is_int(KNOT_EOK, ret, "Prepare empty configuration");
+
+	conf_val_t val = conf_get(conf(), C_XDP, C_RING_SIZE);
+	is_int(4096, conf_int(&val), "default ring size");
+	val = conf_get(conf(), C_XDP, C_FRAME_SIZE);
+	is_int(2048, conf_int(&val), "default frame size");
+	val = conf_get(conf(), C_XDP, C_HUGEPAGES);
+	ok(!conf_bool(&val), "default huge pages");
+	val = conf_get(conf(), C_XDP, C_SHARED_UMEM);
+	ok(!conf_bool(&val), "default shared UMEM");
+	test_conf_free();
+
+	const char *conf_str =
+		"xdp:\n"
+		"  ring-size: 1024\n"
+		"  frame-size: 4096\n"
+		"  hugepages: on\n"
+		"  shared-umem: on\n";
+
+	ret = test_conf(conf_str, NULL);
+	is_int(KNOT_EOK, ret, "Prepare XDP configuration");
+
+	val = conf_get(conf(), C_XDP, C_RING_SIZE);
+	is_int(1024, conf_int(&val), "ring size");
+	val = conf_get(conf(), C_XDP, C_FRAME_SIZE);
+	is_int(4096, conf_int(&val), "frame size");
+	val = conf_get(conf(), C_XDP, C_HUGEPAGES);
+	ok(conf_bool(&val), "huge pages");
+	val = conf_get(conf(), C_XDP, C_SHARED_UMEM);
+	ok(conf_bool(&val), "shared UMEM");
+	test_conf_free();
+
+	ret = test_conf("xdp:\n  ring-size: 1000\n", NULL);
+	is_int(KNOT_EINVAL, ret, "ring size not a power of 2");
+	ret = test_conf("xdp:\n  ring-size: 32\n", NULL);
+	is_int(KNOT_ERANGE, ret, "ring size too small");
+	ret = test_conf("xdp:\n  ring-size: 2097152\n", NULL);
+	is_int(KNOT_ERANGE, ret, "ring size too big");
+	ret = test_conf("xdp:\n  frame-size: 3072\n", NULL);
+	is_int(KNOT_EINVAL, ret, "unsupported frame size");
+	ret = test_conf("xdp:\n  frame-size: 1024\n", NULL);
+	is_int(KNOT_ERANGE, ret, "frame size too small");
+}
+
 int main(int argc, char *argv[])
 {
 	plan_lazy();
@@ -268,5 +315,8 @@ int main(int argc, char *argv[])
 	diag("mixed references");
 	test_mix_ref();
 
+	diag("XDP configuration");
+	test_conf_xdp();
+
 	return 0;
 }
@@ -918,7 +918,8 @@ static void test_conf_io_list(void)
 	      "server.udp-max-payload-ipv4\n"
 	      "server.udp-max-payload-ipv6\n"
 	      "server.edns-client-subnet\n"
-	      "server.answer-rotation";
+	      "server.answer-rotation\n"
+	      "server.xfr-full-compression";
 	ok(strcmp(ref, out) == 0, "compare result");
 }
 
@@ -941,6 +942,7 @@ static const yp_item_t desc_server[] = {
 	{ C_UDP_MAX_PAYLOAD_IPV6, YP_TINT,  YP_VNONE },
 	{ C_ECS,                  YP_TBOOL, YP_VNONE },
 	{ C_ANS_ROTATION,         YP_TBOOL, YP_VNONE },
+	{ C_XFR_FULL_COMPR,       YP_TBOOL, YP_VNONE },
 	{ NULL }
 };
 
@@ -950,6 +952,7 @@ static const yp_item_t desc_xdp[] = {
 	{ C_TCP_INBUF_MAX_SIZE, YP_TINT,  YP_VNONE },
 	{ C_TCP_IDLE_CLOSE,     YP_TINT,  YP_VNONE },
 	{ C_TCP_IDLE_RESET,     YP_TINT,  YP_VNONE },
+	{ C_TCP_RESEND,         YP_TINT,  YP_VNONE },
 	{ C_ROUTE_CHECK,        YP_TBOOL, YP_VNONE },
 	{ NULL }
 };
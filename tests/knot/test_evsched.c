@@ -0,0 +1,186 @@
+/*  Copyright (C) 2021 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <tap/basic.h>
+
+#include "knot/common/evsched.h"
+#include "libknot/errcode.h"
+
+#define EVENTS		2000
+#define EVENTS_SPREAD	600	/* Milliseconds, covers two wheel levels. */
+
+typedef struct {
+	uint64_t deadline;  /*!< Earliest allowed run time. */
+	unsigned runs;
+	bool early;
+} ev_log_t;
+
+static pthread_mutex_t mx = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t now_ms(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000ULL + ts.tv_nsec / 1000000;
+}
+
+static void ev_callback(event_t *ev)
+{
+	ev_log_t *log = ev->data;
+
+	pthread_mutex_lock(&mx);
+	log->runs++;
+	log->early |= (now_ms() < log->deadline);
+	pthread_mutex_unlock(&mx);
+}
+
+static void ev_schedule(event_t *ev, uint32_t dt)
+{
+	ev_log_t *log = ev->data;
+
+	pthread_mutex_lock(&mx);
+	log->deadline = now_ms() + dt;
+	log->runs = 0;
+	log->early = false;
+	pthread_mutex_unlock(&mx);
+
+	evsched_schedule(ev, dt);
+}
+
+static unsigned ev_runs(event_t *ev)
+{
+	ev_log_t *log = ev->data;
+
+	pthread_mutex_lock(&mx);
+	unsigned runs = log->runs;
+	pthread_mutex_unlock(&mx);
+
+	return runs;
+}
+
+static bool wait_runs(event_t *ev, unsigned runs, unsigned timeout_ms)
+{
+	for (unsigned i = 0; i < timeout_ms / 10 && ev_runs(ev) < runs; i++) {
+		usleep(10000);
+	}
+
+	return ev_runs(ev) == runs;
+}
+
+static void interrupt_handle(int s)
+{
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	struct sigaction sa;
+	sa.sa_handler = interrupt_handle;
+	sigemptyset(&sa.sa_mask);
+	sa.sa_flags = 0;
+	sigaction(SIGALRM, &sa, NULL); // Interrupt
+
+	evsched_t sched;
+	int ret = evsched_init(&sched, NULL);
+	is_int(KNOT_EOK, ret, "init scheduler");
+	evsched_start(&sched);
+
+	ev_log_t log = { 0 };
+	event_t *ev = evsched_event_create(&sched, ev_callback, &log);
+	ok(ev != NULL, "create event");
+
+	// Immediate event.
+	ev_schedule(ev, 0);
+	ok(wait_runs(ev, 1, 1000) && !log.early, "run immediate event");
+
+	// Delayed event.
+	ev_schedule(ev, 50);
+	ok(wait_runs(ev, 1, 1000) && !log.early, "run delayed event");
+
+	// Event on a higher wheel level.
+	ev_schedule(ev, 300);
+	ok(wait_runs(ev, 1, 2000) && !log.early, "run cascaded event");
+
+	// Rescheduled sooner.
+	ev_schedule(ev, 100000);
+	ev_schedule(ev, 20);
+	ok(wait_runs(ev, 1, 1000) && !log.early, "run rescheduled event");
+
+	// Rescheduled later.
+	ev_schedule(ev, 10);
+	ev_schedule(ev, 200);
+	usleep(100000);
+	is_int(0, ev_runs(ev), "rescheduled event not run sooner");
+	ok(wait_runs(ev, 1, 1000) && !log.early, "run postponed event");
+
+	// Canceled event.
+	ev_schedule(ev, 50);
+	evsched_cancel(ev);
+	usleep(150000);
+	is_int(0, ev_runs(ev), "canceled event not run");
+
+	// Canceled distant event.
+	ev_schedule(ev, 100000000);
+	usleep(20000);
+	evsched_cancel(ev);
+	ev_schedule(ev, 10);
+	ok(wait_runs(ev, 1, 1000) && !log.early, "run event after cancel");
+
+	// Paused scheduler.
+	evsched_pause(&sched);
+	ev_schedule(ev, 0);
+	usleep(100000);
+	is_int(0, ev_runs(ev), "event not run while paused");
+	evsched_resume(&sched);
+	ok(wait_runs(ev, 1, 1000), "run event after resume");
+
+	evsched_event_free(ev);
+
+	// Many events.
+	event_t *evs[EVENTS];
+	ev_log_t logs[EVENTS] = { { 0 } };
+	srandom(1);
+	for (unsigned i = 0; i < EVENTS; i++) {
+		evs[i] = evsched_event_create(&sched, ev_callback, &logs[i]);
+		ev_schedule(evs[i], random() % EVENTS_SPREAD);
+	}
+	usleep(EVENTS_SPREAD * 1000);
+	bool all_run = true, early = false;
+	for (unsigned i = 0; i < EVENTS; i++) {
+		all_run &= wait_runs(evs[i], 1, 1000);
+		early |= logs[i].early;
+		evsched_cancel(evs[i]);
+		evsched_event_free(evs[i]);
+	}
+	ok(all_run, "run all events once");
+	ok(!early, "no event run early");
+
+	// Scheduled events are freed with the scheduler.
+	ev = evsched_event_create(&sched, ev_callback, &log);
+	ev_schedule(ev, 100000);
+
+	evsched_stop(&sched);
+	evsched_join(&sched);
+	evsched_deinit(&sched);
+
+	return 0;
+}
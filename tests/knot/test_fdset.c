@@ -134,6 +134,26 @@ int main(int argc, char *argv[])
 	ret = fdset_poll(&fdset, &it, 0, 100);
 	ok(ret == 0, "fdset_poll return 3");
 
+	/* Switch watched events of a descriptor. */
+	int fds3[2];
+	ret = pipe(fds3);
+	ok(ret >= 0, "create pipe 3");
+	ret = fdset_add(&fdset, fds3[1], FDSET_POLLIN, &fds3);
+	ok(ret == 0 && fdset_get_ctx(&fdset, 0) == &fds3, "add pipe 3 with context");
+	ret = fdset_poll(&fdset, &it, 0, 10);
+	ok(ret == 0, "fdset_poll nothing to read");
+	ret = fdset_set_events(&fdset, 0, FDSET_POLLOUT);
+	ok(ret == KNOT_EOK, "fdset_set_events");
+	ret = fdset_poll(&fdset, &it, 0, 100);
+	ok(ret == 1 && fdset_it_is_pollout(&it) && !fdset_it_is_pollin(&it),
+	   "fdset can write");
+	ret = fdset_set_events(&fdset, 0, FDSET_POLLIN);
+	ok(ret == KNOT_EOK, "fdset_set_events back");
+	ret = fdset_poll(&fdset, &it, 0, 10);
+	ok(ret == 0, "fdset_poll nothing to read again");
+	ret = fdset_remove(&fdset, 0);
+	ok(ret == KNOT_EOK, "fdset remove pipe 3");
+	close(fds3[0]);
 
 	close(fds2[1]);
 	if (fd2_dup >= 0) {
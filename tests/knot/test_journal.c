@@ -15,6 +15,7 @@
  */
 
 #include <assert.h>
+#include <pthread.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -27,6 +28,7 @@
 #include "knot/journal/journal_read.h"
 #include "knot/journal/journal_write.h"
 
+#include "contrib/string.h"
 #include "libknot/attribute.h"
 #include "libknot/libknot.h"
 #include "knot/zone/zone.h"
@@ -37,6 +39,9 @@
 #define RAND_RR_PAYLOAD 64
 #define MIN_SOA_SIZE 22
 
+#define BATCH_ZONES 8
+#define BATCH_CHANGESETS 20
+
 char *test_dir_name;
 
 knot_lmdb_db_t jdb;
@@ -301,6 +306,43 @@ static int load_j_list(zone_journal_t *zj, bool zij, uint32_t serial,
 	return ret;
 }
 
+/*! \brief Compare reading the journal by RRSets and by single RRs in place. */
+static int read_rr_eq(zone_journal_t *zj, uint32_t serial)
+{
+	journal_read_t *read_rrset = NULL, *read_rr = NULL;
+	int ret = journal_read_begin(*zj, false, serial, &read_rrset);
+	if (ret == KNOT_EOK) {
+		ret = journal_read_begin(*zj, false, serial, &read_rr);
+	}
+
+	knot_rrset_t rrset = { 0 };
+	journal_rr_t rr;
+	while (ret == KNOT_EOK && journal_read_rrset(read_rrset, &rrset, true)) {
+		knot_rdata_t *rdata = rrset.rrs.rdata;
+		for (uint16_t i = 0; ret == KNOT_EOK && i < rrset.rrs.count; i++) {
+			if (!journal_read_rr(read_rr, &rr, true) ||
+			    !knot_dname_is_equal(rr.owner, rrset.owner) ||
+			    rr.type != rrset.type || rr.rclass != rrset.rclass ||
+			    rr.ttl != rrset.ttl || rr.len != rdata->len ||
+			    memcmp(rr.data, rdata->data, rr.len) != 0) {
+				ret = KNOT_ERROR;
+			}
+			rdata = knot_rdataset_next(rdata);
+		}
+		journal_read_clear_rrset(&rrset);
+	}
+	if (ret == KNOT_EOK && journal_read_rr(read_rr, &rr, true)) {
+		ret = KNOT_ERROR;
+	}
+	ret = journal_read_get_error(read_rrset, ret);
+	ret = journal_read_get_error(read_rr, ret);
+
+	journal_read_end(read_rrset);
+	journal_read_end(read_rr);
+
+	return ret;
+}
+
 /*! \brief Test behavior with real changesets. */
 static void test_store_load(const knot_dname_t *apex)
 {
@@ -361,6 +403,9 @@ static void test_store_load(const knot_dname_t *apex)
 	changesets_free(&l);
 	journal_read_end(read);
 
+	ret = read_rr_eq(&jj, 1);
+	is_int(KNOT_EOK, ret, "journal: read single RRs in place (%s)", knot_strerror(ret));
+
 	ret = journal_set_flushed(jj);
 	is_int(KNOT_EOK, ret, "journal: flush after overfill (%s)", knot_strerror(ret));
 	ret = journal_sem_check(jj);
@@ -850,6 +895,87 @@ static void test_stress(const knot_dname_t *apex)
 	test_stress_base(apex, 4000, 10 * 1024 * 1024);
 }
 
+typedef struct {
+	zone_journal_t j;
+	changeset_t *chs[BATCH_CHANGESETS];
+	int ret;
+} batch_thread_t;
+
+static void *batch_insert(void *arg)
+{
+	batch_thread_t *t = arg;
+	for (int i = 0; i < BATCH_CHANGESETS && t->ret == KNOT_EOK; i++) {
+		t->ret = journal_insert(t->j, t->chs[i], NULL);
+	}
+	return NULL;
+}
+
+/*! \brief Test concurrent inserts into multiple zones in batched transactions. */
+static void test_batch(const knot_dname_t *apex)
+{
+	set_conf(1000, 512 * 1024, apex);
+
+	char *batch_dir = sprintf_alloc("%s/batch", test_dir_name);
+	knot_lmdb_db_t bdb;
+	knot_lmdb_init(&bdb, batch_dir, 16 * 1024 * 1024,
+	               journal_env_flags(JOURNAL_MODE_ROBUST, false), NULL);
+	bdb.batch_window = 2;
+	int ret = knot_lmdb_open(&bdb);
+	is_int(KNOT_EOK, ret, "journal batch: open robust DB (%s)", knot_strerror(ret));
+
+	knot_dname_storage_t zones[BATCH_ZONES];
+	batch_thread_t threads[BATCH_ZONES] = { 0 };
+	for (int z = 0; z < BATCH_ZONES; z++) {
+		char zone_str[16];
+		(void)snprintf(zone_str, sizeof(zone_str), "zone%d.", z);
+		(void)knot_dname_from_str(zones[z], zone_str, sizeof(zones[z]));
+		threads[z].j = (zone_journal_t){ &bdb, zones[z], conf() };
+		for (int i = 0; i < BATCH_CHANGESETS; i++) {
+			threads[z].chs[i] = changeset_new(zones[z]);
+			init_random_changeset(threads[z].chs[i], i, i + 1, 16, zones[z], false);
+		}
+	}
+
+	pthread_t tids[BATCH_ZONES];
+	for (int z = 0; z < BATCH_ZONES; z++) {
+		(void)pthread_create(&tids[z], NULL, batch_insert, &threads[z]);
+	}
+	bool inserted = true;
+	for (int z = 0; z < BATCH_ZONES; z++) {
+		(void)pthread_join(tids[z], NULL);
+		inserted = inserted && threads[z].ret == KNOT_EOK;
+	}
+	ok(inserted, "journal batch: concurrent inserts");
+
+	bool stored = true;
+	for (int z = 0; z < BATCH_ZONES; z++) {
+		journal_read_t *read = NULL;
+		list_t l;
+		ret = load_j_list(&threads[z].j, false, 0, &read, &l);
+		stored = stored && ret == KNOT_EOK && list_size(&l) == BATCH_CHANGESETS &&
+		         changesets_eq(threads[z].chs[0], HEAD(l));
+		changesets_free(&l);
+		journal_read_end(read);
+	}
+	ok(stored, "journal batch: all changesets stored");
+
+	knot_lmdb_batch_stats_t stats;
+	knot_lmdb_batch_stats(&bdb, &stats);
+	ok(stats.writes == BATCH_ZONES * BATCH_CHANGESETS, "journal batch: write count");
+	ok(stats.commits > 0 && stats.commits <= stats.writes &&
+	   stats.max_writes <= BATCH_ZONES, "journal batch: batch sizes");
+
+	for (int z = 0; z < BATCH_ZONES; z++) {
+		for (int i = 0; i < BATCH_CHANGESETS; i++) {
+			changeset_free(threads[z].chs[i]);
+		}
+	}
+	knot_lmdb_deinit(&bdb);
+	free(batch_dir);
+
+	unset_conf();
+}
+
 int main(int argc, char *argv[])
 {
 	plan_lazy();
@@ -871,6 +997,8 @@ int main(int argc, char *argv[])
 
 	test_stress(apex);
 
+	test_batch(apex);
+
 	knot_lmdb_deinit(&jdb);
 
 	test_rm_rf(test_dir_name);
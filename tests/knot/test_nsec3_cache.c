@@ -0,0 +1,226 @@
+/*  Copyright (C) 2021 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <tap/basic.h>
+
+#include "knot/nameserver/nsec_proofs.c"
+#include "knot/zone/adjust.h"
+
+#define HASH_LEN 20
+
+/*! \brief Hash filled with a byte, the first byte selects the cache slot. */
+static const uint8_t *hash(uint8_t first, uint8_t fill)
+{
+	static uint8_t hashes[4][HASH_LEN];
+	static unsigned idx = 0;
+
+	uint8_t *h = hashes[idx++ % 4];
+	memset(h, fill, HASH_LEN);
+	h[0] = first;
+	return h;
+}
+
+static void test_hash_covered(void)
+{
+	uint8_t from[4] = { 0x20 }, to[4] = { 0x80 }, h[4] = { 0 };
+
+	h[0] = 0x50;
+	ok(hash_covered(h, from, to, sizeof(h)), "hash covered: inside interval");
+	h[0] = 0x20;
+	ok(!hash_covered(h, from, to, sizeof(h)), "hash covered: interval start excluded");
+	h[0] = 0x80;
+	ok(!hash_covered(h, from, to, sizeof(h)), "hash covered: interval end excluded");
+	h[0] = 0x10;
+	ok(!hash_covered(h, from, to, sizeof(h)), "hash covered: before interval");
+
+	// Last NSEC3 of the chain, the interval wraps around.
+	from[0] = 0xf0; to[0] = 0x20;
+	h[0] = 0xf8;
+	ok(hash_covered(h, from, to, sizeof(h)), "hash covered: wrap-around, chain end");
+	h[0] = 0x10;
+	ok(hash_covered(h, from, to, sizeof(h)), "hash covered: wrap-around, chain start");
+	h[0] = 0x50;
+	ok(!hash_covered(h, from, to, sizeof(h)), "hash covered: wrap-around, outside");
+	h[0] = 0xf0;
+	ok(!hash_covered(h, from, to, sizeof(h)), "hash covered: wrap-around, start excluded");
+	h[0] = 0x20;
+	ok(!hash_covered(h, from, to, sizeof(h)), "hash covered: wrap-around, end excluded");
+
+	// Single NSEC3 covers everything but itself.
+	to[0] = 0xf0;
+	h[0] = 0x50;
+	ok(hash_covered(h, from, to, sizeof(h)), "hash covered: single NSEC3");
+	h[0] = 0xf0;
+	ok(!hash_covered(h, from, to, sizeof(h)), "hash covered: single NSEC3 itself");
+
+	// Difference in the last byte.
+	memset(from, 0x33, sizeof(from)); memset(to, 0x33, sizeof(to)); memset(h, 0x33, sizeof(h));
+	from[3] = 0x01; to[3] = 0x03; h[3] = 0x02;
+	ok(hash_covered(h, from, to, sizeof(h)), "hash covered: last byte");
+}
+
+static int add_rr(zone_contents_t *zone, const knot_dname_t *owner, uint16_t type,
+                  const uint8_t *rdata, uint16_t rdlen)
+{
+	knot_rrset_t rr;
+	knot_rrset_init(&rr, (knot_dname_t *)owner, type, KNOT_CLASS_IN, 3600);
+	int ret = knot_rrset_add_rdata(&rr, rdata, rdlen, NULL);
+	if (ret == KNOT_EOK) {
+		zone_node_t *unused = NULL;
+		ret = zone_contents_add_rr(zone, &rr, &unused);
+	}
+	knot_rdataset_clear(&rr.rrs, NULL);
+
+	return ret;
+}
+
+static int add_nsec3(zone_contents_t *zone, const uint8_t *owner_hash,
+                     const uint8_t *next_hash)
+{
+	uint8_t rdata[6 + HASH_LEN] = { DNSSEC_NSEC3_ALGORITHM_SHA1, 0, 0, 0, 0, HASH_LEN };
+	memcpy(rdata + 6, next_hash, HASH_LEN);
+
+	knot_dname_storage_t owner;
+	int ret = knot_nsec3_hash_to_dname(owner, sizeof(owner), owner_hash, HASH_LEN,
+	                                   zone->apex->owner);
+	if (ret == KNOT_EOK) {
+		ret = add_rr(zone, owner, KNOT_RRTYPE_NSEC3, rdata, sizeof(rdata));
+	}
+	return ret;
+}
+
+static const zone_node_t *nsec3_node(const zone_contents_t *zone, const uint8_t *h)
+{
+	knot_dname_storage_t owner;
+	if (knot_nsec3_hash_to_dname(owner, sizeof(owner), h, HASH_LEN,
+	                             zone->apex->owner) != KNOT_EOK) {
+		return NULL;
+	}
+	return zone_contents_find_nsec3_node(zone, owner);
+}
+
+/*!
+ * NSEC3 chain 0x40.. -> 0x88.. -> 0xf0.. -> 0x18.. and the 0x18.. NSEC3 pointing
+ * to 0x88.. instead of 0x40.. (a broken chain).
+ */
+static zone_contents_t *nsec3_zone(void)
+{
+	knot_dname_t *apex = knot_dname_from_str_alloc("example.");
+	zone_contents_t *zone = zone_contents_new(apex, true);
+	knot_dname_free(apex, NULL);
+	if (zone == NULL) {
+		return NULL;
+	}
+
+	const uint8_t nsec3param[] = { DNSSEC_NSEC3_ALGORITHM_SHA1, 0, 0, 0, 0 };
+	int ret = add_rr(zone, zone->apex->owner, KNOT_RRTYPE_NSEC3PARAM,
+	                 nsec3param, sizeof(nsec3param));
+	if (ret == KNOT_EOK) {
+		ret = add_nsec3(zone, hash(0x18, 0), hash(0x88, 0));
+	}
+	if (ret == KNOT_EOK) {
+		ret = add_nsec3(zone, hash(0x40, 0), hash(0x88, 0));
+	}
+	if (ret == KNOT_EOK) {
+		ret = add_nsec3(zone, hash(0x88, 0), hash(0xf0, 0));
+	}
+	if (ret == KNOT_EOK) {
+		ret = add_nsec3(zone, hash(0xf0, 0), hash(0x18, 0));
+	}
+	if (ret == KNOT_EOK) {
+		ret = zone_adjust_full(zone, 1);
+	}
+	if (ret != KNOT_EOK) {
+		zone_contents_deep_free(zone);
+		return NULL;
+	}
+
+	return zone;
+}
+
+static void test_cover(const zone_contents_t *zone)
+{
+	const zone_node_t *n18 = nsec3_node(zone, hash(0x18, 0));
+	const zone_node_t *n40 = nsec3_node(zone, hash(0x40, 0));
+	const zone_node_t *n88 = nsec3_node(zone, hash(0x88, 0));
+	const zone_node_t *nf0 = nsec3_node(zone, hash(0xf0, 0));
+	ok(n18 != NULL && n40 != NULL && n88 != NULL && nf0 != NULL,
+	   "nsec3 cache: zone nodes");
+
+	struct nsec3_cache *cache = nsec3_cache_new(zone);
+	ok(cache != NULL && cache->hash_len == HASH_LEN, "nsec3 cache: create");
+	if (cache == NULL) {
+		return;
+	}
+	is_int(32 - NSEC3_CACHE_MIN_BITS, cache->shift, "nsec3 cache: minimal size");
+
+	// Slots are selected by the hash prefix (the first 4 bits here).
+	ok(cover_get(cache, hash(0x50, 0x11)) == NULL, "nsec3 cache: empty slot miss");
+	cover_put(cache, zone, hash(0x50, 0x11), n40);
+	ok(cover_get(cache, hash(0x50, 0x11)) == n40, "nsec3 cache: hit, same hash");
+	ok(cover_get(cache, hash(0x5f, 0xff)) == n40, "nsec3 cache: hit, other hash in slot");
+	ok(cover_get(cache, hash(0x60, 0x00)) == NULL, "nsec3 cache: neighboring slot miss");
+
+	// The interval ends within the slot.
+	cover_put(cache, zone, hash(0x84, 0x11), n40);
+	ok(cover_get(cache, hash(0x86, 0x22)) == n40, "nsec3 cache: hit before interval end");
+	ok(cover_get(cache, hash(0x88, 0x00)) == NULL, "nsec3 cache: next NSEC3 miss");
+	ok(cover_get(cache, hash(0x8c, 0x11)) == NULL, "nsec3 cache: after interval end miss");
+
+	// Fill-once slots, a filled slot isn't replaced by another interval.
+	cover_put(cache, zone, hash(0x8c, 0x11), n88);
+	nsec3_cache_cover_t *slot = cover_slot(cache, hash(0x8c, 0x11));
+	ok(slot->state == SLOT_READY && slot->cover == n40, "nsec3 cache: slot not replaced");
+	ok(cover_get(cache, hash(0x8c, 0x11)) == NULL, "nsec3 cache: other interval miss");
+	ok(cover_get(cache, hash(0x84, 0x11)) == n40, "nsec3 cache: original interval hit");
+
+	// The last NSEC3, its interval wraps around.
+	cover_put(cache, zone, hash(0xf8, 0x11), nf0);
+	ok(cover_get(cache, hash(0xff, 0xff)) == nf0, "nsec3 cache: wrap-around, chain end");
+	cover_put(cache, zone, hash(0x04, 0x11), nf0);
+	ok(cover_get(cache, hash(0x00, 0x00)) == nf0, "nsec3 cache: wrap-around, chain start");
+	cover_put(cache, zone, hash(0x12, 0x11), nf0);
+	ok(cover_get(cache, hash(0x17, 0xff)) == nf0, "nsec3 cache: wrap-around, chain first");
+	ok(cover_get(cache, hash(0x1c, 0x11)) == NULL, "nsec3 cache: wrap-around, after end");
+
+	// Intervals not matching the zone aren't stored.
+	cover_put(cache, zone, hash(0x2c, 0x11), n18);
+	slot = cover_slot(cache, hash(0x2c, 0x11));
+	ok(slot->state == SLOT_EMPTY, "nsec3 cache: broken chain not stored");
+	cover_put(cache, zone, hash(0x60, 0x11), n88);
+	slot = cover_slot(cache, hash(0x60, 0x11));
+	ok(slot->state == SLOT_EMPTY, "nsec3 cache: hash not covered not stored");
+
+	nsec3_cache_free(cache);
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	test_hash_covered();
+
+	zone_contents_t *zone = nsec3_zone();
+	ok(zone != NULL, "nsec3 cache: create zone");
+	if (zone != NULL) {
+		test_cover(zone);
+		zone_contents_deep_free(zone);
+	}
+
+	nsec3_cache_free(NSEC3_CACHE_FAILED);
+
+	return 0;
+}
@@ -19,10 +19,12 @@
 #include <tap/files.h>
 #include <string.h>
 #include <stdlib.h>
+#include <urcu.h>
 
 #include "libknot/descriptor.h"
 #include "libknot/packet/wire.h"
 #include "knot/nameserver/process_query.h"
+#include "knot/nameserver/xfr.h"
 #include "test_server.h"
 #include "contrib/sockaddr.h"
 #include "contrib/ucw/mempool.h"
@@ -161,6 +163,19 @@ int main(int argc, char *argv[])
 	knot_pkt_put(query, KNOT_COMPR_HINT_NONE, &soa_rr, 0);
 	exec_query(&proc, "IN/ixfr", query, KNOT_RCODE_NOTAUTH);
 
+	/* Transfer continuation with replaced zone contents. */
+	struct xfr_proc xfer = { .contents_id = zone->contents->id };
+	knotd_qdata_extra_t extra = { .ext = &xfer };
+	knotd_qdata_t qdata = { .query = query, .params = &params, .extra = &extra };
+	rcu_read_lock();
+	ok(xfr_contents_current(&qdata), "ns: transferred zone contents current");
+	zone_contents_t *orig_contents = zone->contents;
+	zone->contents = zone_contents_new(zone->name, false);
+	ok(!xfr_contents_current(&qdata), "ns: replaced zone contents detected");
+	rcu_read_unlock();
+	zone_contents_deep_free(zone->contents);
+	zone->contents = orig_contents;
+
 	/* \note Tests below are not possible without proper zone and zone data. */
 	/* #189 Process UPDATE query. */
 	/* #189 Process AXFR client. */
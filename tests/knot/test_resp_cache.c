@@ -0,0 +1,248 @@
+/*  Copyright (C) 2021 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <tap/basic.h>
+#include <tap/files.h>
+#include <urcu.h>
+
+#include "knot/nameserver/process_query.h"
+#include "knot/nameserver/query_module.h"
+#include "knot/nameserver/resp_cache.h"
+#include "test_server.h"
+#include "contrib/sockaddr.h"
+#include "contrib/ucw/mempool.h"
+
+#define CACHE_SIZE 65536
+
+static const knot_dname_t *NXDOMAIN_DNAME = (const uint8_t *)"\x02""nx";
+static const knot_dname_t *NXDOMAIN_UPPER = (const uint8_t *)"\x02""NX";
+static const knot_dname_t *WILDCARD_DNAME = (const uint8_t *)"\x01""*";
+static const knot_dname_t *EXPANDED_DNAME = (const uint8_t *)"\x03""foo";
+
+static bool wildcard_seen;
+
+/*! \brief Process the query, the answer is stored in the answer packet. */
+static bool resolve(knot_layer_t *layer, knot_pkt_t *query, knot_pkt_t *answer,
+                    const knot_dname_t *qname, uint16_t qtype, uint16_t id)
+{
+	knot_pkt_clear(query);
+	knot_pkt_put_question(query, qname, KNOT_CLASS_IN, qtype);
+	knot_wire_set_id(query->wire, id);
+	if (knot_pkt_parse(query, 0) != KNOT_EOK) {
+		return false;
+	}
+
+	knot_pkt_clear(answer);
+	knot_layer_reset(layer);
+	knot_layer_consume(layer, query);
+	knot_layer_produce(layer, answer);
+
+	return layer->state == KNOT_STATE_DONE &&
+	       knot_wire_get_id(answer->wire) == id;
+}
+
+static resp_cache_stats_t cache_stats(const zone_t *zone)
+{
+	resp_cache_stats_t ret = { 0 };
+
+	rcu_read_lock();
+	resp_cache_stats(rcu_dereference(zone->contents), &ret);
+	rcu_read_unlock();
+
+	return ret;
+}
+
+static bool stats_equal(const zone_t *zone, uint64_t hits, uint64_t misses)
+{
+	resp_cache_stats_t stats = cache_stats(zone);
+	return stats.hits == hits && stats.misses == misses;
+}
+
+/*! \brief Compare the statistics increments since \a base. */
+static bool stats_added(const zone_t *zone, const resp_cache_stats_t *base,
+                        uint64_t hits, uint64_t misses)
+{
+	return stats_equal(zone, base->hits + hits, base->misses + misses);
+}
+
+/*! \brief Compare answers ignoring the message ID. */
+static bool answer_equal(const knot_pkt_t *a, const knot_pkt_t *b)
+{
+	return a->size == b->size && a->size > 2 &&
+	       memcmp(a->wire + 2, b->wire + 2, a->size - 2) == 0;
+}
+
+static knotd_state_t noop_hook(knotd_state_t state, knot_pkt_t *pkt,
+                               knotd_qdata_t *qdata, knotd_mod_t *mod)
+{
+	return state;
+}
+
+/*! \brief Records the wildcard hit the same way as RRL classifies the response. */
+static knotd_state_t wildcard_hook(knotd_state_t state, knot_pkt_t *pkt,
+                                   knotd_qdata_t *qdata, knotd_mod_t *mod)
+{
+	wildcard_seen = !EMPTY_LIST(qdata->extra->wildcards);
+	return state;
+}
+
+/*! \brief Set zone query plan with one module hook. */
+static void set_module(zone_t *zone, const knotd_mod_api_t *api,
+                       knotd_stage_t stage, knotd_mod_hook_f hook)
+{
+	query_plan_free(zone->query_plan);
+	zone->query_plan = NULL;
+	if (api == NULL) {
+		return;
+	}
+
+	zone->query_plan = query_plan_create();
+	knotd_mod_t mod = { .plan = zone->query_plan, .api = api };
+	(void)knotd_mod_hook(&mod, stage, hook);
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	knot_mm_t mm;
+	mm_ctx_mempool(&mm, MM_DEFAULT_BLKSIZE);
+
+	knot_layer_t layer = { 0 };
+	knot_layer_init(&layer, &mm, process_query_layer());
+
+	char *temp_dir = test_mkdtemp();
+	ok(temp_dir != NULL, "make temporary directory");
+
+	server_t server;
+	int ret = create_fake_server(&server, layer.mm, temp_dir);
+	is_int(KNOT_EOK, ret, "resp cache: fake server initialization");
+	if (ret != KNOT_EOK) {
+		goto fatal;
+	}
+
+	zone_t *zone = knot_zonedb_find(server.zone_db, ROOT_DNAME);
+	zone->resp_cache_max_size = CACHE_SIZE;
+
+	knot_pkt_t *query = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, NULL);
+	knot_pkt_t *first = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, NULL);
+	knot_pkt_t *answer = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, NULL);
+
+	struct sockaddr_storage remote;
+	sockaddr_set(&remote, AF_INET, "127.0.0.1", 53);
+	knotd_qdata_params_t params = {
+		.remote = &remote,
+		.server = &server
+	};
+	knot_layer_begin(&layer, &params);
+
+	/* Miss and hit. */
+	ok(resolve(&layer, query, first, ROOT_DNAME, KNOT_RRTYPE_SOA, 1) &&
+	   stats_equal(zone, 0, 1), "resp cache: first query miss");
+	ok(knot_wire_get_ancount(first->wire) == 1, "resp cache: first answer");
+	ok(resolve(&layer, query, answer, ROOT_DNAME, KNOT_RRTYPE_SOA, 2) &&
+	   stats_equal(zone, 1, 1), "resp cache: repeated query hit");
+	ok(answer_equal(first, answer), "resp cache: cached answer equal");
+	ok(cache_stats(zone).size > 0, "resp cache: memory usage");
+
+	/* Different key. */
+	ok(resolve(&layer, query, answer, ROOT_DNAME, KNOT_RRTYPE_NS, 3) &&
+	   stats_equal(zone, 1, 2), "resp cache: other QTYPE miss");
+
+	/* Negative answer, original QNAME case. */
+	ok(resolve(&layer, query, first, NXDOMAIN_DNAME, KNOT_RRTYPE_A, 4) &&
+	   stats_equal(zone, 1, 3), "resp cache: NXDOMAIN miss");
+	ok(resolve(&layer, query, answer, NXDOMAIN_UPPER, KNOT_RRTYPE_A, 5) &&
+	   stats_equal(zone, 2, 3), "resp cache: NXDOMAIN hit");
+	ok(knot_wire_get_rcode(answer->wire) == KNOT_RCODE_NXDOMAIN &&
+	   knot_wire_get_nscount(answer->wire) == 1, "resp cache: NXDOMAIN answer");
+	ok(memcmp(knot_pkt_qname(answer), NXDOMAIN_UPPER, 4) == 0,
+	   "resp cache: QNAME case preserved");
+
+	/* Bypass, the SOA answer could have been evicted by a colliding key. */
+	(void)resolve(&layer, query, answer, ROOT_DNAME, KNOT_RRTYPE_SOA, 6);
+	resp_cache_stats_t base = cache_stats(zone);
+	const knotd_mod_api_t changing = { .flags = KNOTD_MOD_FLAG_SCOPE_ANY };
+	set_module(zone, &changing, KNOTD_STAGE_BEGIN, noop_hook);
+	ok(resolve(&layer, query, answer, ROOT_DNAME, KNOT_RRTYPE_SOA, 7) &&
+	   stats_added(zone, &base, 0, 0), "resp cache: bypassed with module");
+
+	const knotd_mod_api_t cacheable = {
+		.flags = KNOTD_MOD_FLAG_SCOPE_ANY | KNOTD_MOD_FLAG_CACHEABLE
+	};
+	set_module(zone, &cacheable, KNOTD_STAGE_BEGIN, noop_hook);
+	ok(resolve(&layer, query, answer, ROOT_DNAME, KNOT_RRTYPE_SOA, 8) &&
+	   stats_added(zone, &base, 1, 0), "resp cache: used with cacheable module");
+	set_module(zone, NULL, KNOTD_STAGE_BEGIN, NULL);
+
+	zone->resp_cache_max_size = 0;
+	ok(resolve(&layer, query, answer, ROOT_DNAME, KNOT_RRTYPE_SOA, 9) &&
+	   stats_added(zone, &base, 1, 0), "resp cache: bypassed if disabled");
+	zone->resp_cache_max_size = CACHE_SIZE;
+
+	/* Invalidation by zone contents change. */
+	zone_contents_t *old_contents = zone->contents;
+	zone->contents = zone_contents_new(zone->name, true);
+	knot_rrset_t soa = node_rrset(old_contents->apex, KNOT_RRTYPE_SOA);
+	(void)node_add_rrset(zone->contents->apex, &soa, NULL);
+	knot_rrset_t *wildcard = knot_rrset_new(WILDCARD_DNAME, KNOT_RRTYPE_A,
+	                                        KNOT_CLASS_IN, 3600, NULL);
+	(void)knot_rrset_add_rdata(wildcard, (const uint8_t *)"\x7f\x00\x00\x01", 4, NULL);
+	zone_node_t *wildcard_node = NULL;
+	(void)zone_contents_add_rr(zone->contents, wildcard, &wildcard_node);
+	knot_rrset_free(wildcard, NULL);
+	(void)zone_adjust_full(zone->contents, 1);
+	synchronize_rcu();
+	zone_contents_deep_free(old_contents);
+
+	ok(stats_equal(zone, 0, 0) && cache_stats(zone).size == 0,
+	   "resp cache: empty after contents change");
+	ok(resolve(&layer, query, answer, ROOT_DNAME, KNOT_RRTYPE_SOA, 10) &&
+	   stats_equal(zone, 0, 1), "resp cache: miss after contents change");
+	ok(resolve(&layer, query, answer, ROOT_DNAME, KNOT_RRTYPE_SOA, 11) &&
+	   stats_equal(zone, 1, 1), "resp cache: hit after contents change");
+
+	/* Wildcard answer seen by a cacheable module (RRL). */
+	set_module(zone, &cacheable, KNOTD_STAGE_END, wildcard_hook);
+	ok(resolve(&layer, query, first, EXPANDED_DNAME, KNOT_RRTYPE_A, 12) &&
+	   stats_equal(zone, 1, 2) && wildcard_seen, "resp cache: wildcard answer miss");
+	wildcard_seen = false;
+	ok(resolve(&layer, query, answer, EXPANDED_DNAME, KNOT_RRTYPE_A, 13) &&
+	   stats_equal(zone, 2, 2), "resp cache: wildcard answer hit");
+	ok(answer_equal(first, answer), "resp cache: cached wildcard answer equal");
+	ok(wildcard_seen, "resp cache: wildcard hit restored");
+	(void)resolve(&layer, query, answer, ROOT_DNAME, KNOT_RRTYPE_SOA, 14);
+	base = cache_stats(zone);
+	wildcard_seen = false;
+	ok(resolve(&layer, query, answer, ROOT_DNAME, KNOT_RRTYPE_SOA, 15) &&
+	   stats_added(zone, &base, 1, 0) && !wildcard_seen, "resp cache: no wildcard hit");
+	set_module(zone, NULL, KNOTD_STAGE_BEGIN, NULL);
+
+	knot_pkt_free(query);
+	knot_pkt_free(first);
+	knot_pkt_free(answer);
+
+	knot_layer_finish(&layer);
+fatal:
+	mp_delete((struct mempool *)mm.ctx);
+	server_deinit(&server);
+	conf_free(conf());
+	test_rm_rf(temp_dir);
+	free(temp_dir);
+
+	return 0;
+}
@@ -0,0 +1,319 @@
+/*  Copyright (C) 2021 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+#include <tap/basic.h>
+
+#include "knot/server/tcp-handler.c"
+
+/*
+ * Simulated outgoing zone transfers to slow-reading secondaries. A fake query
+ * processing layer answers AXFR with XFR_MESSAGES large messages, TXT with
+ * MULTI_MESSAGES large messages (not as a transfer), and other queries with
+ * a single message, the secondaries read with small buffers.
+ */
+#define SLOW_CLIENTS   16
+#define XFR_MESSAGES   40
+#define MULTI_MESSAGES (3 * TCP_BATCH)
+#define XFR_MSG_SIZE   16000
+#define SLOW_READ      4096
+#define SLOW_DELAY_US  5000
+#define SOCK_BUF       8192
+
+#define QUERY_ID_XFR   0x1111
+#define QUERY_ID_OTHER 0x2222
+
+typedef struct {
+	knot_pkt_t *query;
+	unsigned produced;
+} fake_ctx_t;
+
+static int fake_begin(knot_layer_t *ctx, void *params)
+{
+	ctx->data = mm_calloc(ctx->mm, 1, sizeof(fake_ctx_t));
+	return (ctx->data != NULL) ? KNOT_STATE_CONSUME : KNOT_STATE_FAIL;
+}
+
+static int fake_consume(knot_layer_t *ctx, knot_pkt_t *pkt)
+{
+	fake_ctx_t *fake = ctx->data;
+	fake->query = pkt;
+	return KNOT_STATE_PRODUCE;
+}
+
+static int fake_produce(knot_layer_t *ctx, knot_pkt_t *pkt)
+{
+	fake_ctx_t *fake = ctx->data;
+	uint16_t qtype = knot_pkt_qtype(fake->query);
+	bool large = (qtype == KNOT_RRTYPE_AXFR || qtype == KNOT_RRTYPE_TXT);
+	unsigned count = (qtype == KNOT_RRTYPE_AXFR) ? XFR_MESSAGES :
+	                 (qtype == KNOT_RRTYPE_TXT) ? MULTI_MESSAGES : 1;
+
+	/* Query copy with padding, sequence number at the end. */
+	pkt->size = large ? XFR_MSG_SIZE : fake->query->size + sizeof(uint16_t);
+	memset(pkt->wire, 0, pkt->size);
+	memcpy(pkt->wire, fake->query->wire, fake->query->size);
+	knot_wire_set_qr(pkt->wire);
+	knot_wire_write_u16(pkt->wire + pkt->size - sizeof(uint16_t), fake->produced);
+
+	return (++fake->produced < count) ? KNOT_STATE_PRODUCE : KNOT_STATE_DONE;
+}
+
+static const knot_layer_api_t FAKE_LAYER = {
+	.begin = fake_begin,
+	.consume = fake_consume,
+	.produce = fake_produce,
+};
+
+static struct sockaddr_storage server_addr;
+static volatile bool handler_stop = false;
+static volatile int slow_finished = 0;
+static pthread_mutex_t slow_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void *server_thread(void *arg)
+{
+	tcp_context_t *tcp = arg;
+	while (!handler_stop) {
+		tcp_wait_for_events(tcp);
+	}
+	return NULL;
+}
+
+static size_t put_query(uint8_t *buf, uint16_t id, uint16_t qtype)
+{
+	uint8_t *msg = buf + sizeof(uint16_t);
+	memset(msg, 0, KNOT_WIRE_HEADER_SIZE);
+	knot_wire_set_id(msg, id);
+	knot_wire_set_qdcount(msg, 1);
+
+	static const uint8_t qname[] = "\x07""example";
+	uint8_t *pos = msg + KNOT_WIRE_HEADER_SIZE;
+	memcpy(pos, qname, sizeof(qname));
+	pos += sizeof(qname);
+	knot_wire_write_u16(pos, qtype);
+	knot_wire_write_u16(pos + sizeof(uint16_t), KNOT_CLASS_IN);
+	pos += 2 * sizeof(uint16_t);
+
+	knot_wire_write_u16(buf, pos - msg);
+	return pos - buf;
+}
+
+static int client_connect(int rcvbuf)
+{
+	int fd = socket(server_addr.ss_family, SOCK_STREAM, 0);
+	if (fd < 0) {
+		return -1;
+	}
+	if (rcvbuf > 0) {
+		(void)setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+	}
+	if (connect(fd, (struct sockaddr *)&server_addr, sockaddr_len(&server_addr)) != 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+/*! \brief Read one length-prefixed message, optionally slowly. */
+static ssize_t client_read(int fd, uint8_t *buf, bool slow)
+{
+	uint8_t len_buf[sizeof(uint16_t)];
+	if (recv(fd, len_buf, sizeof(len_buf), MSG_WAITALL) != sizeof(len_buf)) {
+		return -1;
+	}
+	size_t len = knot_wire_read_u16(len_buf), done = 0;
+	while (done < len) {
+		size_t chunk = slow ? MIN(len - done, SLOW_READ) : len - done;
+		ssize_t ret = recv(fd, buf + done, chunk, MSG_WAITALL);
+		if (ret <= 0) {
+			return -1;
+		}
+		done += ret;
+		if (slow) {
+			usleep(SLOW_DELAY_US);
+		}
+	}
+	return len;
+}
+
+static void *slow_client(void *arg)
+{
+	bool *success = arg;
+	*success = false;
+
+	int fd = client_connect(SLOW_READ);
+	if (fd < 0) {
+		return NULL;
+	}
+
+	/* Pipelined transfer and normal query. */
+	uint8_t buf[KNOT_WIRE_MAX_PKTSIZE];
+	size_t len = put_query(buf, QUERY_ID_XFR, KNOT_RRTYPE_AXFR);
+	len += put_query(buf + len, QUERY_ID_OTHER, KNOT_RRTYPE_A);
+	if (send(fd, buf, len, 0) != len) {
+		close(fd);
+		return NULL;
+	}
+
+	bool ok = true;
+	for (unsigned i = 0; ok && i < XFR_MESSAGES; i++) {
+		ssize_t ret = client_read(fd, buf, true);
+		ok = (ret == XFR_MSG_SIZE && knot_wire_get_id(buf) == QUERY_ID_XFR &&
+		      knot_wire_read_u16(buf + ret - sizeof(uint16_t)) == i);
+	}
+	if (ok) {
+		ssize_t ret = client_read(fd, buf, false);
+		ok = (ret > 0 && knot_wire_get_id(buf) == QUERY_ID_OTHER);
+	}
+	*success = ok;
+
+	pthread_mutex_lock(&slow_lock);
+	slow_finished++;
+	pthread_mutex_unlock(&slow_lock);
+
+	close(fd);
+	return NULL;
+}
+
+/*! \brief Send queries and close the sending side, read the responses slowly. */
+static bool half_closed_client(uint16_t qtype, unsigned messages)
+{
+	int fd = client_connect(SLOW_READ);
+	if (fd < 0) {
+		return false;
+	}
+
+	uint8_t buf[KNOT_WIRE_MAX_PKTSIZE];
+	size_t len = put_query(buf, QUERY_ID_XFR, qtype);
+	len += put_query(buf + len, QUERY_ID_OTHER, KNOT_RRTYPE_A);
+	bool ok = (send(fd, buf, len, 0) == len && shutdown(fd, SHUT_WR) == 0);
+
+	for (unsigned i = 0; ok && i < messages; i++) {
+		ssize_t ret = client_read(fd, buf, true);
+		ok = (ret == XFR_MSG_SIZE && knot_wire_get_id(buf) == QUERY_ID_XFR &&
+		      knot_wire_read_u16(buf + ret - sizeof(uint16_t)) == i);
+	}
+	if (ok) {
+		ssize_t ret = client_read(fd, buf, false);
+		ok = (ret > 0 && knot_wire_get_id(buf) == QUERY_ID_OTHER);
+	}
+	if (ok) { /* Closed by the server after the last response. */
+		ok = (recv(fd, buf, sizeof(buf), 0) == 0);
+	}
+
+	close(fd);
+	return ok;
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	/* Listening socket with small send buffers of accepted connections. */
+	sockaddr_set(&server_addr, AF_INET, "127.0.0.1", 0);
+	int listen_fd = net_bound_socket(SOCK_STREAM, &server_addr, 0);
+	ok(listen_fd >= 0, "TCP: bind to localhost");
+	if (listen_fd < 0) {
+		return 1;
+	}
+	int sndbuf = SOCK_BUF;
+	(void)setsockopt(listen_fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+	socklen_t addr_len = sizeof(server_addr);
+	int ret = listen(listen_fd, SLOW_CLIENTS + 2);
+	ret |= getsockname(listen_fd, (struct sockaddr *)&server_addr, &addr_len);
+	ok(ret == 0, "TCP: listen");
+
+	/* Single TCP handler thread. */
+	knot_mm_t mm;
+	mm_ctx_mempool(&mm, MM_DEFAULT_BLKSIZE);
+	tcp_context_t tcp = {
+		.client_threshold = 1,
+		.max_worker_fds = 1 + SLOW_CLIENTS + 2,
+		.idle_timeout = 10,
+		.io_timeout = 1000,
+	};
+	knot_layer_init(&tcp.layer, &mm, &FAKE_LAYER);
+	tcp.rx.iov_len = TCP_RX_SIZE;
+	tcp.rx.iov_base = malloc(TCP_RX_SIZE);
+	for (unsigned i = 0; i < TCP_BATCH; i++) {
+		tcp.ans_wire[i] = malloc(TCP_MSG_SIZE);
+	}
+	ret = fdset_init(&tcp.set, FDSET_RESIZE_STEP);
+	ok(ret == KNOT_EOK && fdset_add(&tcp.set, listen_fd, FDSET_POLLIN, NULL) == 0,
+	   "TCP: handler context");
+
+	pthread_t server;
+	pthread_create(&server, NULL, server_thread, &tcp);
+
+	/* Many slow secondaries transferring at the same time. */
+	pthread_t slow[SLOW_CLIENTS];
+	bool slow_ok[SLOW_CLIENTS];
+	for (int i = 0; i < SLOW_CLIENTS; i++) {
+		pthread_create(&slow[i], NULL, slow_client, &slow_ok[i]);
+	}
+	usleep(100000);
+
+	/* Normal query not delayed by the transfers. */
+	struct timespec begin = time_now();
+	int fd = client_connect(0);
+	uint8_t buf[KNOT_WIRE_MAX_PKTSIZE];
+	size_t len = put_query(buf, QUERY_ID_OTHER, KNOT_RRTYPE_A);
+	ret = (fd >= 0 && send(fd, buf, len, 0) == len) ? client_read(fd, buf, false) : -1;
+	struct timespec end = time_now();
+	ok(ret > 0 && knot_wire_get_id(buf) == QUERY_ID_OTHER,
+	   "TCP: normal query answered");
+	int finished = slow_finished;
+	ok(finished < SLOW_CLIENTS, "TCP: answered during transfers (%d/%d finished, %.0f ms)",
+	   finished, SLOW_CLIENTS, time_diff_ms(&begin, &end));
+	if (fd >= 0) {
+		close(fd);
+	}
+
+	int slow_success = 0;
+	for (int i = 0; i < SLOW_CLIENTS; i++) {
+		pthread_join(slow[i], NULL);
+		slow_success += slow_ok[i];
+	}
+	ok(slow_success == SLOW_CLIENTS, "TCP: all transfers complete and in order (%d/%d)",
+	   slow_success, SLOW_CLIENTS);
+
+	/* Responses finished after the client closed its side of the connection. */
+	ok(half_closed_client(KNOT_RRTYPE_TXT, MULTI_MESSAGES),
+	   "TCP: multi-message responses sent after client shutdown");
+	ok(half_closed_client(KNOT_RRTYPE_AXFR, XFR_MESSAGES),
+	   "TCP: transfer finished after client shutdown");
+
+	/* Wake up and stop the handler. */
+	handler_stop = true;
+	fd = client_connect(0);
+	pthread_join(server, NULL);
+	if (fd >= 0) {
+		close(fd);
+	}
+
+	for (unsigned i = tcp.client_threshold; i < fdset_get_length(&tcp.set); i++) {
+		tcp_conn_free(fdset_get_ctx(&tcp.set, i));
+	}
+	fdset_clear(&tcp.set);
+	close(listen_fd);
+	free(tcp.rx.iov_base);
+	for (unsigned i = 0; i < TCP_BATCH; i++) {
+		free(tcp.ans_wire[i]);
+	}
+	mp_delete(mm.ctx);
+
+	return 0;
+}
@@ -21,8 +21,9 @@
 #include <sched.h>
 #include <signal.h>
 #include <time.h>
+#include <unistd.h>
 
-#include "knot/worker/pool.h"
+#include "knot/worker/pool.c"
 #include "knot/worker/queue.h"
 
 #define THREADS 4
@@ -49,6 +50,18 @@ static unsigned executed_reset(task_log_t *log)
 	return result;
 }
 
+/*!
+ * Get number of executed tasks.
+ */
+static unsigned executed_get(task_log_t *log)
+{
+	pthread_mutex_lock(&log->mx);
+	unsigned result = log->executed;
+	pthread_mutex_unlock(&log->mx);
+
+	return result;
+}
+
 /*!
  * Simple task, just increases the counter in the log.
  */
@@ -61,10 +74,52 @@ static void task_counting(worker_task_t *task)
 	pthread_mutex_unlock(&log->mx);
 }
 
+/*!
+ * Task blocked until the gate is opened.
+ */
+typedef struct gate {
+	pthread_mutex_t mx;
+	pthread_cond_t cond;
+	bool open;
+} gate_t;
+
+static void task_blocking(worker_task_t *task)
+{
+	gate_t *gate = task->ctx;
+
+	pthread_mutex_lock(&gate->mx);
+	while (!gate->open) {
+		pthread_cond_wait(&gate->cond, &gate->mx);
+	}
+	pthread_mutex_unlock(&gate->mx);
+}
+
+/*!
+ * Wait until the number of running tasks of the class reaches the value.
+ */
+static bool wait_running(worker_pool_t *pool, worker_class_t cls, uint64_t running)
+{
+	worker_class_stats_t stats;
+	for (int i = 0; i < 500; i++) {
+		worker_pool_stats(pool, cls, &stats);
+		if (stats.running == running) {
+			return true;
+		}
+		usleep(10000);
+	}
+
+	return false;
+}
+
 static void interrupt_handle(int s)
 {
 }
 
+static void *alloc_fail(void *ctx, size_t len)
+{
+	return NULL;
+}
+
 int main(void)
 {
 	plan_lazy();
@@ -87,9 +142,28 @@ int main(void)
 		.mx = PTHREAD_MUTEX_INITIALIZER,
 	};
 
-	// schedule jobs while pool is stopped
+	// failed assignment isn't counted
 
 	worker_task_t task = { .run = task_counting, .ctx = &log };
+	knot_mm_alloc_t alloc = pool->locals[0].queues[WORKER_CLASS_NORMAL].mm_ctx.alloc;
+	for (int i = 0; i < THREADS; i++) {
+		pool->locals[i].queues[WORKER_CLASS_NORMAL].mm_ctx.alloc = alloc_fail;
+	}
+	is_int(KNOT_ENOMEM, worker_pool_assign(pool, &task), "assign without memory");
+	for (int i = 0; i < THREADS; i++) {
+		pool->locals[i].queues[WORKER_CLASS_NORMAL].mm_ctx.alloc = alloc;
+	}
+	worker_class_stats_t stats;
+	worker_pool_stats(pool, WORKER_CLASS_NORMAL, &stats);
+	bool counted = stats.queued > 0;
+	for (int i = 0; i < THREADS; i++) {
+		counted = counted || pool->locals[i].counts[WORKER_CLASS_NORMAL] > 0;
+	}
+	ok(!counted, "failed assignment not counted");
+	is_int(KNOT_EINVAL, worker_pool_assign(pool, NULL), "assign no task");
+
+	// schedule jobs while pool is stopped
+
 	for (int i = 0; i < TASKS_BATCH; i++) {
 		worker_pool_assign(pool, &task);
 	}
@@ -97,11 +171,17 @@ int main(void)
 	sched_yield();
 	ok(executed_reset(&log) == 0, "executed count before start");
 
+	// cancel a queued task
+
+	worker_task_t other = { .run = task_counting, .ctx = &log };
+	ok(worker_pool_cancel(pool, &task) && !worker_pool_cancel(pool, &other),
+	   "cancel queued task");
+
 	// start and wait for finish
 
 	worker_pool_start(pool);
 	worker_pool_wait(pool);
-	ok(executed_reset(&log) == TASKS_BATCH, "executed count after start");
+	ok(executed_reset(&log) == TASKS_BATCH - 1, "executed count after start");
 
 	// add additional jobs while pool is running
 
@@ -140,6 +220,46 @@ int main(void)
 	worker_pool_wait(pool);
 	ok(executed_reset(&log) <= THREADS, "executed count after clear");
 
+	// heavy tasks don't occupy all threads
+
+	gate_t gate = {
+		.mx = PTHREAD_MUTEX_INITIALIZER,
+		.cond = PTHREAD_COND_INITIALIZER,
+	};
+	worker_task_t heavy[THREADS];
+	for (int i = 0; i < THREADS; i++) {
+		heavy[i] = (worker_task_t) {
+			.run = task_blocking, .ctx = &gate, .cls = WORKER_CLASS_HEAVY
+		};
+		worker_pool_assign(pool, &heavy[i]);
+	}
+	ok(wait_running(pool, WORKER_CLASS_HEAVY, THREADS - 1), "heavy tasks running");
+
+	worker_task_t urgent = { .run = task_counting, .ctx = &log, .cls = WORKER_CLASS_URGENT };
+	for (int i = 0; i < TASKS_BATCH; i++) {
+		worker_pool_assign(pool, &urgent);
+	}
+	for (int i = 0; i < 500 && executed_get(&log) < TASKS_BATCH; i++) {
+		usleep(10000);
+	}
+	ok(executed_reset(&log) == TASKS_BATCH, "urgent tasks run besides heavy ones");
+
+	worker_pool_stats(pool, WORKER_CLASS_HEAVY, &stats);
+	ok(stats.queued == 1 && stats.running == THREADS - 1, "heavy tasks stats");
+
+	pthread_mutex_lock(&gate.mx);
+	gate.open = true;
+	pthread_cond_broadcast(&gate.cond);
+	pthread_mutex_unlock(&gate.mx);
+	worker_pool_wait(pool);
+
+	worker_pool_stats(pool, WORKER_CLASS_HEAVY, &stats);
+	ok(stats.queued == 0 && stats.running == 0 && stats.executed == THREADS,
+	   "heavy tasks stats after finish");
+	worker_pool_stats(pool, WORKER_CLASS_URGENT, &stats);
+	ok(stats.executed == TASKS_BATCH && stats.wait_max_usec * TASKS_BATCH >= stats.wait_usec,
+	   "urgent tasks stats");
+
 	// cleanup
 
 	worker_pool_stop(pool);
@@ -147,6 +267,8 @@ int main(void)
 	worker_pool_destroy(pool);
 
 	pthread_mutex_destroy(&log.mx);
+	pthread_mutex_destroy(&gate.mx);
+	pthread_cond_destroy(&gate.cond);
 
 	return 0;
 }
@@ -17,6 +17,12 @@
 #include <tap/basic.h>
 
 #include "knot/worker/queue.h"
+#include "libknot/errcode.h"
+
+static void *alloc_fail(void *ctx, size_t len)
+{
+	return NULL;
+}
 
 int main(void)
 {
@@ -34,10 +40,9 @@ int main(void)
 
 	// enqueue
 
-	worker_queue_enqueue(&queue, &task_one);
-	ok(1, "enqueue first");
-	worker_queue_enqueue(&queue, &task_two);
-	ok(1, "enqueue second");
+	is_int(KNOT_EOK, worker_queue_enqueue(&queue, &task_one), "enqueue first");
+	is_int(KNOT_EOK, worker_queue_enqueue(&queue, &task_two), "enqueue second");
+	is_int(KNOT_EINVAL, worker_queue_enqueue(&queue, NULL), "enqueue no task");
 
 	// dequeue
 
@@ -45,10 +50,17 @@ int main(void)
 	ok(worker_queue_dequeue(&queue) == &task_two, "dequeue second");
 	ok(worker_queue_dequeue(&queue) == NULL, "dequeue from empty");
 
+	// allocation failure
+
+	knot_mm_alloc_t alloc = queue.mm_ctx.alloc;
+	queue.mm_ctx.alloc = alloc_fail;
+	is_int(KNOT_ENOMEM, worker_queue_enqueue(&queue, &task_one), "enqueue without memory");
+	queue.mm_ctx.alloc = alloc;
+	ok(worker_queue_length(&queue) == 0, "nothing enqueued without memory");
+
 	// deinit
 
-	worker_queue_enqueue(&queue, &task_three);
-	ok(1, "enqueue third");
+	is_int(KNOT_EOK, worker_queue_enqueue(&queue, &task_three), "enqueue third");
 
 	worker_queue_deinit(&queue);
 	ok(1, "queue deinit");
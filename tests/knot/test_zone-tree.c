@@ -1,4 +1,4 @@
-/*  Copyright (C) 2020 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+/*  Copyright (C) 2021 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
 
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU General Public License as published by
@@ -14,6 +14,8 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <pthread.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <tap/basic.h>
 
@@ -76,6 +78,73 @@ static int ztree_node_counter(zone_node_t *node, void *data)
 	return KNOT_EOK;
 }
 
+#define SPLIT_NODES 10000
+#define SPLIT_THREADS 4
+
+typedef struct {
+	zone_tree_split_t *split;
+	size_t visited;
+	int ret;
+} split_arg_t;
+
+static int ztree_split_visit(zone_node_t *node, void *data)
+{
+	split_arg_t *arg = data;
+	__atomic_add_fetch(&node->children, 1, __ATOMIC_RELAXED);
+	arg->visited++;
+	return KNOT_EOK;
+}
+
+static void *ztree_split_thread(void *data)
+{
+	split_arg_t *arg = data;
+	arg->ret = zone_tree_split_apply(arg->split, ztree_split_visit, arg);
+	return NULL;
+}
+
+static void test_split(void)
+{
+	zone_tree_t *t = zone_tree_create(false);
+	zone_node_t *nodes = calloc(SPLIT_NODES, sizeof(*nodes));
+	for (unsigned i = 0; i < SPLIT_NODES; ++i) {
+		char name[32];
+		(void)snprintf(name, sizeof(name), "n%u.split.", i);
+		nodes[i].owner = knot_dname_from_str_alloc(name);
+		zone_node_t *node = nodes + i;
+		(void)zone_tree_insert(t, &node);
+	}
+
+	zone_tree_split_t split;
+	int ret = zone_tree_split_init(t, SPLIT_THREADS, &split);
+	ok(ret == KNOT_EOK && split.count > SPLIT_THREADS, "ztree: split into %zu subtrees",
+	   split.count);
+
+	pthread_t thr[SPLIT_THREADS];
+	split_arg_t args[SPLIT_THREADS] = { { 0 } };
+	for (unsigned i = 0; i < SPLIT_THREADS; ++i) {
+		args[i].split = &split;
+		pthread_create(&thr[i], NULL, ztree_split_thread, &args[i]);
+	}
+	size_t visited = 0;
+	for (unsigned i = 0; i < SPLIT_THREADS; ++i) {
+		pthread_join(thr[i], NULL);
+		ok(args[i].ret == KNOT_EOK, "ztree: split thread %u", i);
+		visited += args[i].visited;
+	}
+	bool once = true;
+	for (unsigned i = 0; i < SPLIT_NODES; ++i) {
+		once = once && (nodes[i].children == 1);
+	}
+	ok(visited == SPLIT_NODES && once, "ztree: split visits each node once");
+	zone_tree_split_deinit(&split);
+
+	for (unsigned i = 0; i < SPLIT_NODES; ++i) {
+		knot_dname_free(nodes[i].owner, NULL);
+	}
+	free(nodes);
+	zone_tree_free(&t);
+}
+
 int main(int argc, char *argv[])
 {
 	plan_lazy();
@@ -131,5 +200,9 @@ int main(int argc, char *argv[])
 
 	zone_tree_free(&t);
 	ztree_free_data();
+
+	/* 7. parallel split traversal */
+	test_split();
+
 	return 0;
 }
@@ -0,0 +1,180 @@
+/*  Copyright (C) 2021 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <tap/basic.h>
+
+#include "contrib/time.h"
+#include "knot/zone/adjust.h"
+#include "knot/zone/contents.h"
+#include "libknot/libknot.h"
+
+/*
+ * Synthetic zone for timing of the (parallel) zone adjusting. The number of
+ * generated names can be raised via KNOT_TEST_ADJUST_NODES environment
+ * variable, e.g. to a few millions, to get meaningful timings.
+ */
+#define ADJUST_NODES 50000
+#define ADJUST_THREADS 4
+#define ADJUST_DELEG_RATIO 100 /* Every Nth name is a delegation with glue. */
+
+static int add_rr(zone_contents_t *zone, const char *owner_str, uint16_t type,
+                  const uint8_t *rdata, uint16_t rdlen)
+{
+	knot_dname_t *owner = knot_dname_from_str_alloc(owner_str);
+	if (owner == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	knot_rrset_t rr;
+	knot_rrset_init(&rr, owner, type, KNOT_CLASS_IN, 3600);
+	int ret = knot_rrset_add_rdata(&rr, rdata, rdlen, NULL);
+	if (ret == KNOT_EOK) {
+		zone_node_t *unused = NULL;
+		ret = zone_contents_add_rr(zone, &rr, &unused);
+	}
+	knot_rrset_clear(&rr, NULL);
+
+	return ret;
+}
+
+static int add_name_rr(zone_contents_t *zone, const char *owner_str, uint16_t type,
+                       uint16_t pref, const char *target_str)
+{
+	uint8_t rdata[2 + KNOT_DNAME_MAXLEN];
+	size_t pos = 0;
+	if (type == KNOT_RRTYPE_MX) {
+		knot_wire_write_u16(rdata, pref);
+		pos += sizeof(uint16_t);
+	}
+	if (knot_dname_from_str(rdata + pos, target_str, sizeof(rdata) - pos) == NULL) {
+		return KNOT_EINVAL;
+	}
+	pos += knot_dname_size(rdata + pos);
+
+	return add_rr(zone, owner_str, type, rdata, pos);
+}
+
+static zone_contents_t *synth_zone(unsigned nodes)
+{
+	knot_dname_t *apex = knot_dname_from_str_alloc("example.");
+	zone_contents_t *zone = zone_contents_new(apex, true);
+	knot_dname_free(apex, NULL);
+	if (zone == NULL) {
+		return NULL;
+	}
+
+	const uint8_t soa[] = "\x02ns\x07""example\x00\x05""admin\x07""example\x00"
+	                      "\x00\x00\x00\x01\x00\x00\x0e\x10\x00\x00\x0e\x10"
+	                      "\x00\x00\x0e\x10\x00\x00\x0e\x10";
+	int ret = add_rr(zone, "example.", KNOT_RRTYPE_SOA, soa, sizeof(soa) - 1);
+	if (ret == KNOT_EOK) {
+		ret = add_name_rr(zone, "example.", KNOT_RRTYPE_NS, 0, "ns.example.");
+	}
+
+	char owner[KNOT_DNAME_TXT_MAXLEN], target[KNOT_DNAME_TXT_MAXLEN];
+	for (unsigned i = 0; i < nodes && ret == KNOT_EOK; ++i) {
+		uint8_t addr[4] = { 192, 0, (i >> 8) & 0xff, i & 0xff };
+		if (i % ADJUST_DELEG_RATIO == 0) {
+			(void)snprintf(owner, sizeof(owner), "d%u.example.", i);
+			(void)snprintf(target, sizeof(target), "ns.d%u.example.", i);
+			ret = add_name_rr(zone, owner, KNOT_RRTYPE_NS, 0, target);
+			if (ret == KNOT_EOK) {
+				ret = add_rr(zone, target, KNOT_RRTYPE_A, addr, sizeof(addr));
+			}
+		} else {
+			(void)snprintf(owner, sizeof(owner), "h%u.example.", i);
+			ret = add_rr(zone, owner, KNOT_RRTYPE_A, addr, sizeof(addr));
+			if (ret == KNOT_EOK) {
+				(void)snprintf(target, sizeof(target), "h%u.example.", i / 2);
+				ret = add_name_rr(zone, owner, KNOT_RRTYPE_MX, 10, target);
+			}
+		}
+	}
+
+	if (ret != KNOT_EOK) {
+		zone_contents_deep_free(zone);
+		return NULL;
+	}
+
+	return zone;
+}
+
+/*! \brief Order-independent fingerprint of the adjusted node data. */
+static int fingerprint_cb(zone_node_t *node, void *data)
+{
+	uint64_t *fp = data;
+	uint64_t h = node->flags;
+	for (uint16_t i = 0; i < node->rrset_count; ++i) {
+		const additional_t *add = node->rrs[i].additional;
+		for (uint16_t j = 0; add != NULL && j < add->count; ++j) {
+			h = h * 31 + (uintptr_t)add->glues[j].node;
+		}
+	}
+	*fp += h * 2654435761ULL + (uintptr_t)node->parent;
+	return KNOT_EOK;
+}
+
+static uint64_t fingerprint(zone_contents_t *zone)
+{
+	uint64_t fp = 0;
+	(void)zone_tree_apply(zone->nodes, fingerprint_cb, &fp);
+	return fp;
+}
+
+static double timed_adjust(zone_contents_t *zone, unsigned threads, int *ret)
+{
+	struct timespec begin, end;
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	*ret = zone_adjust_full(zone, threads);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	return time_diff_ms(&begin, &end);
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	unsigned nodes = ADJUST_NODES;
+	const char *env_nodes = getenv("KNOT_TEST_ADJUST_NODES");
+	if (env_nodes != NULL && atoi(env_nodes) > 0) {
+		nodes = atoi(env_nodes);
+	}
+
+	zone_contents_t *zone = synth_zone(nodes);
+	ok(zone != NULL, "zone adjust: synthetic zone with %u names", nodes);
+	if (zone == NULL) {
+		return 1;
+	}
+
+	int ret = KNOT_EOK;
+	double single = timed_adjust(zone, 1, &ret);
+	ok(ret == KNOT_EOK, "zone adjust: sequential");
+	uint64_t fp_single = fingerprint(zone);
+
+	double multi = timed_adjust(zone, ADJUST_THREADS, &ret);
+	ok(ret == KNOT_EOK, "zone adjust: parallel");
+	ok(fingerprint(zone) == fp_single, "zone adjust: parallel result equals sequential");
+
+	diag("zone adjust: %zu nodes, 1 thread %.0f ms, %u threads %.0f ms",
+	     zone_tree_count(zone->nodes), single, ADJUST_THREADS, multi);
+
+	zone_contents_deep_free(zone);
+
+	return 0;
+}
@@ -67,6 +67,27 @@ static void test_scheduling(zone_t *zone)
 	// zone_events_start
 }
 
+static void test_enqueue_failure(zone_t *zone)
+{
+	// No worker pool, the event can't be queued.
+	worker_pool_t *pool = zone->events.pool;
+	zone->events.pool = NULL;
+
+	zone_events_enqueue(zone, ZONE_EVENT_FLUSH);
+
+	pthread_mutex_lock(&zone->events.mx);
+	bool running = zone->events.running;
+	pthread_mutex_unlock(&zone->events.mx);
+	ok(!running, "enqueue failure: not running");
+
+	zone_event_type_t event = ZONE_EVENT_INVALID;
+	time_t timestamp = zone_events_get_next(zone, &event);
+	ok(timestamp > 0 && event == ZONE_EVENT_FLUSH, "enqueue failure: event kept planned");
+
+	zone_events_schedule_at(zone, ZONE_EVENT_FLUSH, 0);
+	zone->events.pool = pool;
+}
+
 int main(void)
 {
 	plan_lazy();
@@ -90,6 +111,7 @@ int main(void)
 	ok(r == KNOT_EOK, "zone events setup");
 
 	test_scheduling(&zone);
+	test_enqueue_failure(&zone);
 
 	zone_events_deinit(&zone);
 	worker_pool_destroy(pool);
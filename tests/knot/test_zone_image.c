@@ -0,0 +1,174 @@
+/*  Copyright (C) 2021 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <tap/basic.h>
+#include <tap/files.h>
+
+#include "contrib/string.h"
+#include "knot/zone/zone-image.h"
+#include "libknot/libknot.h"
+
+#define IMAGE_NODES 1000
+
+static int add_rr(zone_contents_t *zone, const char *owner_str, uint16_t type,
+                  const uint8_t *rdata, uint16_t rdlen)
+{
+	knot_dname_t *owner = knot_dname_from_str_alloc(owner_str);
+	if (owner == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	knot_rrset_t rr;
+	knot_rrset_init(&rr, owner, type, KNOT_CLASS_IN, 3600);
+	int ret = knot_rrset_add_rdata(&rr, rdata, rdlen, NULL);
+	if (ret == KNOT_EOK) {
+		zone_node_t *unused = NULL;
+		ret = zone_contents_add_rr(zone, &rr, &unused);
+	}
+	knot_rrset_clear(&rr, NULL);
+
+	return ret;
+}
+
+static zone_contents_t *synth_zone(const knot_dname_t *apex)
+{
+	zone_contents_t *zone = zone_contents_new(apex, true);
+	if (zone == NULL) {
+		return NULL;
+	}
+
+	const uint8_t soa[] = "\x02ns\x07""example\x00\x05""admin\x07""example\x00"
+	                      "\x00\x00\x00\x07\x00\x00\x0e\x10\x00\x00\x0e\x10"
+	                      "\x00\x00\x0e\x10\x00\x00\x0e\x10";
+	int ret = add_rr(zone, "example.", KNOT_RRTYPE_SOA, soa, sizeof(soa) - 1);
+
+	char owner[KNOT_DNAME_TXT_MAXLEN];
+	for (unsigned i = 0; i < IMAGE_NODES && ret == KNOT_EOK; ++i) {
+		(void)snprintf(owner, sizeof(owner), "h%u.sub%u.example.", i, i % 7);
+		uint8_t addr[4] = { 192, 0, (i >> 8) & 0xff, i & 0xff };
+		ret = add_rr(zone, owner, KNOT_RRTYPE_A, addr, sizeof(addr));
+		// Odd-sized rdata and multi-RR rdatasets.
+		uint8_t txt[] = { 2, 'a' + i % 26, 'z' };
+		for (unsigned j = 0; j <= i % 3 && ret == KNOT_EOK; ++j) {
+			txt[2] = 'z' - j;
+			ret = add_rr(zone, owner, KNOT_RRTYPE_TXT, txt, sizeof(txt));
+		}
+	}
+
+	if (ret != KNOT_EOK) {
+		zone_contents_deep_free(zone);
+		return NULL;
+	}
+
+	return zone;
+}
+
+static int compare_cb(zone_node_t *node, void *data)
+{
+	const zone_contents_t *other = data;
+
+	const zone_node_t *other_node = zone_contents_find_node(other, node->owner);
+	if (other_node == NULL || other_node->rrset_count != node->rrset_count) {
+		return KNOT_ENONODE;
+	}
+	for (uint16_t i = 0; i < node->rrset_count; i++) {
+		knot_rrset_t rr = node_rrset_at(node, i);
+		knot_rrset_t other_rr = node_rrset(other_node, rr.type);
+		if (!knot_rrset_equal(&rr, &other_rr, true)) {
+			return KNOT_ENORECORD;
+		}
+	}
+
+	return KNOT_EOK;
+}
+
+static void touch(const char *path, const char *text)
+{
+	FILE *file = fopen(path, "a");
+	if (file != NULL) {
+		fputs(text, file);
+		fclose(file);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	char *dir = test_mkdtemp();
+	if (dir == NULL) {
+		return EXIT_FAILURE;
+	}
+	char *zonefile = sprintf_alloc("%s/example.zone", dir);
+	char *image = zone_image_path(zonefile);
+	ok(image != NULL, "image path");
+
+	const knot_dname_t *apex = (const knot_dname_t *)"\x07""example";
+	zone_contents_t *zone = synth_zone(apex);
+	ok(zone != NULL, "create zone");
+
+	// The zone file contents don't matter, only its modification time.
+	touch(zonefile, "; zone file\n");
+	struct stat st;
+	ok(stat(zonefile, &st) == 0, "stat zone file");
+
+	zone_contents_t *loaded = NULL;
+	int ret = zone_image_load(image, zonefile, apex, &loaded);
+	is_int(KNOT_ENOENT, ret, "load nonexistent image");
+
+	struct timespec old_mtime = st.st_mtim;
+	old_mtime.tv_sec--;
+	ret = zone_image_write(image, zonefile, &old_mtime, zone);
+	is_int(KNOT_EAGAIN, ret, "write image for modified zone file");
+
+	ret = zone_image_write(image, zonefile, &st.st_mtim, zone);
+	is_int(KNOT_EOK, ret, "write image");
+
+	ret = zone_image_load(image, zonefile, apex, &loaded);
+	is_int(KNOT_EOK, ret, "load image");
+	ok(loaded != NULL && zone_contents_serial(loaded) == 7, "loaded serial");
+	ok(loaded != NULL && zone_contents_apply(zone, compare_cb, loaded) == KNOT_EOK,
+	   "loaded contents");
+	ok(loaded != NULL && zone_contents_apply(loaded, compare_cb, zone) == KNOT_EOK,
+	   "no extra contents");
+	zone_contents_deep_free(loaded);
+	loaded = NULL;
+
+	// Truncated image.
+	ok(truncate(image, 256) == 0, "truncate image");
+	ret = zone_image_load(image, zonefile, apex, &loaded);
+	is_int(KNOT_EMALF, ret, "load truncated image");
+
+	// Stale image.
+	ret = zone_image_write(image, zonefile, &st.st_mtim, zone);
+	is_int(KNOT_EOK, ret, "rewrite image");
+	touch(zonefile, "; modified\n");
+	ret = zone_image_load(image, zonefile, apex, &loaded);
+	is_int(KNOT_ENOENT, ret, "load stale image");
+
+	zone_contents_deep_free(zone);
+	test_rm_rf(dir);
+	free(image);
+	free(zonefile);
+	free(dir);
+
+	return EXIT_SUCCESS;
+}
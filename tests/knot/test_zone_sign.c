@@ -0,0 +1,230 @@
+/*  Copyright (C) 2021 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <tap/basic.h>
+
+#include "../libdnssec/sample_keys.h"
+#include "libdnssec/crypto.h"
+#include "libdnssec/error.h"
+#include "libdnssec/key.h"
+#include "knot/dnssec/zone-nsec.h"
+#include "knot/dnssec/zone-sign.h"
+#include "knot/updates/zone-update.h"
+#include "knot/zone/adjust.h"
+#include "knot/zone/zone.h"
+#include "libknot/libknot.h"
+
+#define SIGN_NODES 2000
+#define SIGN_THREADS 4
+#define SIGN_DELEG_RATIO 50 /* Every Nth name is a delegation with glue. */
+
+static int add_rr(zone_contents_t *zone, const char *owner_str, uint16_t type,
+                  const uint8_t *rdata, uint16_t rdlen)
+{
+	knot_dname_t *owner = knot_dname_from_str_alloc(owner_str);
+	if (owner == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	knot_rrset_t rr;
+	knot_rrset_init(&rr, owner, type, KNOT_CLASS_IN, 3600);
+	int ret = knot_rrset_add_rdata(&rr, rdata, rdlen, NULL);
+	if (ret == KNOT_EOK) {
+		zone_node_t *unused = NULL;
+		ret = zone_contents_add_rr(zone, &rr, &unused);
+	}
+	knot_rrset_clear(&rr, NULL);
+
+	return ret;
+}
+
+static int add_ns(zone_contents_t *zone, const char *owner_str, const char *target_str)
+{
+	uint8_t rdata[KNOT_DNAME_MAXLEN];
+	if (knot_dname_from_str(rdata, target_str, sizeof(rdata)) == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	return add_rr(zone, owner_str, KNOT_RRTYPE_NS, rdata, knot_dname_size(rdata));
+}
+
+static zone_contents_t *synth_zone(const knot_dname_t *apex, unsigned nodes)
+{
+	zone_contents_t *zone = zone_contents_new(apex, false);
+	if (zone == NULL) {
+		return NULL;
+	}
+
+	const uint8_t soa[] = "\x02ns\x07""example\x00\x05""admin\x07""example\x00"
+	                      "\x00\x00\x00\x01\x00\x00\x0e\x10\x00\x00\x0e\x10"
+	                      "\x00\x00\x0e\x10\x00\x00\x0e\x10";
+	int ret = add_rr(zone, "example.", KNOT_RRTYPE_SOA, soa, sizeof(soa) - 1);
+	if (ret == KNOT_EOK) {
+		ret = add_ns(zone, "example.", "ns.example.");
+	}
+
+	char owner[KNOT_DNAME_TXT_MAXLEN], target[KNOT_DNAME_TXT_MAXLEN];
+	for (unsigned i = 0; i < nodes && ret == KNOT_EOK; ++i) {
+		uint8_t addr[4] = { 192, 0, (i >> 8) & 0xff, i & 0xff };
+		if (i % SIGN_DELEG_RATIO == 0) {
+			(void)snprintf(owner, sizeof(owner), "d%u.example.", i);
+			(void)snprintf(target, sizeof(target), "ns.d%u.example.", i);
+			ret = add_ns(zone, owner, target);
+			if (ret == KNOT_EOK) {
+				ret = add_rr(zone, target, KNOT_RRTYPE_A, addr, sizeof(addr));
+			}
+		} else {
+			(void)snprintf(owner, sizeof(owner), "h%u.example.", i);
+			ret = add_rr(zone, owner, KNOT_RRTYPE_A, addr, sizeof(addr));
+		}
+	}
+
+	if (ret != KNOT_EOK) {
+		zone_contents_deep_free(zone);
+		return NULL;
+	}
+
+	return zone;
+}
+
+static int count_cb(zone_node_t *node, void *data)
+{
+	size_t *counts = data;
+	for (uint16_t i = 0; i < node->rrset_count; ++i) {
+		knot_rrset_t rrset = node_rrset_at(node, i);
+		if (rrset.type == KNOT_RRTYPE_RRSIG) {
+			counts[1] += rrset.rrs.count;
+		} else if (knot_zone_sign_rr_should_be_signed(node, &rrset)) {
+			counts[0]++;
+		}
+	}
+	return KNOT_EOK;
+}
+
+/*! \brief Check that each RRset to be signed has exactly one signature. */
+static bool all_signed(zone_contents_t *zone)
+{
+	size_t counts[2] = { 0 };
+	(void)zone_tree_apply(zone->nodes, count_cb, counts);
+	(void)zone_tree_apply(zone->nsec3_nodes, count_cb, counts);
+
+	return counts[0] > 0 && counts[0] == counts[1];
+}
+
+static void test_sign(zone_t *zone, knot_kasp_key_t *kasp_key, zone_keyset_t *keyset,
+                      bool nsec3, unsigned threads)
+{
+	const char *type = nsec3 ? "NSEC3" : "NSEC";
+
+	zone_contents_t *contents = synth_zone(zone->name, SIGN_NODES);
+	if (contents == NULL) {
+		ok(0, "zone sign: create %s zone", type);
+		return;
+	}
+
+	zone_update_t update;
+	int ret = zone_update_from_contents(&update, zone, contents, UPDATE_FULL);
+	if (ret != KNOT_EOK) {
+		zone_contents_deep_free(contents);
+		ok(0, "zone sign: create %s zone update", type);
+		return;
+	}
+
+	knot_kasp_policy_t policy = {
+		.nsec3_enabled = nsec3,
+		.rrsig_lifetime = 14 * 24 * 3600,
+		.signing_threads = threads,
+	};
+	knot_kasp_zone_t kasp_zone = {
+		.dname = zone->name,
+		.keys = kasp_key,
+		.num_keys = 1,
+	};
+	kdnssec_ctx_t ctx = {
+		.now = knot_time(),
+		.zone = &kasp_zone,
+		.policy = &policy,
+	};
+
+	ret = zone_adjust_contents(update.new_cont, adjust_cb_flags, NULL,
+	                           false, true, 1, update.a_ctx->node_ptrs);
+	if (ret == KNOT_EOK) {
+		ret = knot_zone_create_nsec_chain(&update, &ctx);
+	}
+	ok(ret == KNOT_EOK && (nsec3 == !zone_tree_is_empty(update.new_cont->nsec3_nodes)),
+	   "zone sign: create %s chain", type);
+
+	knot_time_t expire = 0;
+	ret = knot_zone_sign(&update, keyset, &ctx, &expire);
+	is_int(KNOT_EOK, ret, "zone sign: sign %s zone, %u threads", type, threads);
+	ok(all_signed(update.new_cont), "zone sign: %s zone fully signed", type);
+
+	// Validate the signatures.
+	ctx.validation_mode = true;
+	ret = knot_zone_sign(&update, NULL, &ctx, &expire);
+	is_int(KNOT_EOK, ret, "zone sign: validate %s zone", type);
+
+	zone_update_clear(&update);
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	dnssec_crypto_init();
+
+	knot_dname_t *apex = knot_dname_from_str_alloc("example.");
+	zone_t *zone = zone_new(apex);
+	knot_dname_free(apex, NULL);
+
+	dnssec_key_t *key = NULL;
+	int ret = dnssec_key_new(&key);
+	if (ret == DNSSEC_EOK) {
+		ret = dnssec_key_set_dname(key, zone->name);
+	}
+	if (ret == DNSSEC_EOK) {
+		ret = dnssec_key_set_rdata(key, &SAMPLE_ECDSA_KEY.rdata);
+	}
+	if (ret == DNSSEC_EOK) {
+		ret = dnssec_key_load_pkcs8(key, &SAMPLE_ECDSA_KEY.pem);
+	}
+	ok(ret == DNSSEC_EOK, "zone sign: load key");
+
+	zone_key_t zone_key = {
+		.key = key,
+		.is_ksk = true,
+		.is_zsk = true,
+		.is_active = true,
+		.is_public = true,
+		.is_ready = true,
+	};
+	zone_keyset_t keyset = { .count = 1, .keys = &zone_key };
+	knot_kasp_key_t kasp_key = { .key = key, .is_ksk = true, .is_zsk = true };
+
+	// NSEC zone has no NSEC3 tree.
+	test_sign(zone, &kasp_key, &keyset, false, 1);
+	test_sign(zone, &kasp_key, &keyset, false, SIGN_THREADS);
+	test_sign(zone, &kasp_key, &keyset, true, 1);
+	test_sign(zone, &kasp_key, &keyset, true, SIGN_THREADS);
+
+	dnssec_key_free(key);
+	zone_free(&zone);
+	dnssec_crypto_cleanup();
+
+	return 0;
+}
@@ -1,4 +1,4 @@
-/*  Copyright (C) 2019 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+/*  Copyright (C) 2021 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
 
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU General Public License as published by
@@ -35,6 +35,16 @@ static const char *zone_list[ZONE_COUNT] = {
         "b.b.b.b.net",
 };
 
+/* Names which aren't subnames of the longest stored zone with a common prefix. */
+static const char *suffix_list[][2] = {
+	{ "b.b.com",      "com" },
+	{ "ba.b.b.com",   "com" },
+	{ "aa.com",       "com" },
+	{ "x.c.a.net",    "a.net" },
+	{ "a\\000x.net",  "net" }, /* Zero byte imitating a label separator. */
+	{ "org",          "." },
+};
+
 int main(int argc, char *argv[])
 {
 	plan_lazy();
@@ -95,6 +105,23 @@ int main(int argc, char *argv[])
 	}
 	ok(nr_passed == ZONE_COUNT, "zonedb: find zones for subnames");
 
+	/* Lookup of names sharing a prefix with a deeper zone. */
+	nr_passed = 0;
+	for (unsigned i = 0; i < sizeof(suffix_list) / sizeof(suffix_list[0]); ++i) {
+		dname = knot_dname_from_str_alloc(suffix_list[i][0]);
+		knot_dname_t *zone_name = knot_dname_from_str_alloc(suffix_list[i][1]);
+		zone_t *zone = knot_zonedb_find_suffix(db, dname);
+		if (zone != NULL && knot_dname_is_equal(zone->name, zone_name)) {
+			++nr_passed;
+		} else {
+			diag("knot_zonedb_find_suffix(%s) failed", suffix_list[i][0]);
+		}
+		knot_dname_free(zone_name, NULL);
+		knot_dname_free(dname, NULL);
+	}
+	ok(nr_passed == sizeof(suffix_list) / sizeof(suffix_list[0]),
+	   "zonedb: find zones for names with common prefix");
+
 	/* Remove all zones. */
 	nr_passed = 0;
 	for (unsigned i = 0; i < ZONE_COUNT; ++i) {
@@ -0,0 +1,373 @@
+/*  Copyright (C) 2021 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <limits.h>
+#include <stdarg.h>
+#include <tap/basic.h>
+#include <tap/files.h>
+
+#include "knot/zone/zonefile.c"
+#include "knot/zone/digest.h"
+#include "contrib/time.h"
+
+/*
+ * Synthetic zone file for timing of the serial and parallel zone file
+ * parsing. The size in MiB can be raised via KNOT_TEST_ZONEFILE_SIZE
+ * environment variable to get meaningful timings.
+ */
+#define LOAD_SIZE_MIB	4
+#define LOAD_THREADS	4
+
+#define ZONE_ORIGIN	"example."
+
+/*! \brief Minimal number of parts the test texts must be split into. */
+#define SPLIT_MIN_PARTS	10
+
+typedef struct {
+	char *data;
+	size_t len;
+	size_t max;
+	uint64_t line;   /*!< Current line number. */
+} text_t;
+
+static void text_add(text_t *text, const char *fmt, ...)
+{
+	va_list args;
+	va_start(args, fmt);
+	int len = vsnprintf(NULL, 0, fmt, args);
+	va_end(args);
+
+	if (text->len + len + 1 > text->max) {
+		text->max = 2 * (text->len + len + 1);
+		text->data = realloc(text->data, text->max);
+		assert(text->data);
+	}
+
+	va_start(args, fmt);
+	(void)vsnprintf(text->data + text->len, len + 1, fmt, args);
+	va_end(args);
+
+	for (int i = 0; i < len; i++) {
+		text->line += (text->data[text->len + i] == '\n');
+	}
+	text->len += len;
+}
+
+static bool same_rrset_key(const zrecord_t *a, const zrecord_t *b)
+{
+	return knot_dname_is_equal(a->owner, b->owner) && a->type == b->type &&
+	       a->rclass == b->rclass && a->ttl == b->ttl;
+}
+
+/*! \brief Compare a record of the whole text with the same records of the parts. */
+static bool records_equal(zrecord_t *whole, knot_mm_t *mm, const zrecord_t *key,
+                          knot_rdataset_t *merged)
+{
+	// The records of an erroneous text aren't sorted.
+	return whole != NULL && same_rrset_key(whole, key) &&
+	       knot_rdataset_sort(&whole->rrs, mm) == KNOT_EOK &&
+	       knot_rdataset_sort(merged, NULL) == KNOT_EOK &&
+	       knot_rdataset_eq(&whole->rrs, merged);
+}
+
+static uint64_t line_of(const text_t *text, const char *pos)
+{
+	uint64_t line = 1;
+	for (const char *c = text->data; c < pos; c++) {
+		line += (*c == '\n');
+	}
+	return line;
+}
+
+/*!
+ * \brief Compare parsing of the text split into parts with parsing in one part.
+ *
+ * The part size is about one line, so splitting at each record start is tried.
+ */
+static void test_split(const char *name, const text_t *text, uint64_t *error_lines,
+                       size_t error_count)
+{
+	zparallel_t ctx = { .source = "test", .origin = ZONE_ORIGIN };
+	zs_scanner_t s;
+
+	zpart_t whole = { .start = text->data, .end = text->data + text->len, .line = 1 };
+	parse_part(&ctx, &whole, &s);
+	ok(whole.ret == KNOT_EOK && whole.first != NULL && whole.errors == error_count,
+	   "%s: parse in one part", name);
+
+	size_t max_parts = text->line;
+	zpart_t *parts = calloc(max_parts, sizeof(zpart_t));
+	size_t count = split_parts(text->data, text->data + text->len, parts, max_parts);
+	ok(count >= SPLIT_MIN_PARTS, "%s: split into %zu parts", name, count);
+
+	bool lines_ok = true, parsed_ok = true;
+	uint64_t errors = 0;
+	for (size_t i = 0; i < count; i++) {
+		lines_ok = lines_ok && parts[i].line == line_of(text, parts[i].start) &&
+		           (i == 0 || parts[i].start == parts[i - 1].end);
+		parse_part(&ctx, &parts[i], &s);
+		parsed_ok = parsed_ok && parts[i].ret == KNOT_EOK;
+		errors += parts[i].errors;
+	}
+	ok(lines_ok && parts[count - 1].end == text->data + text->len,
+	   "%s: part boundaries and lines", name);
+	ok(parsed_ok && errors == error_count, "%s: parse parts", name);
+
+	// Records and errors of the parts must follow the ones of the whole text.
+	// An rdataset split by a part boundary is merged first.
+	zrecord_t *rec = whole.first;
+	const zrecord_t *key = NULL;
+	knot_rdataset_t merged = { 0 };
+	size_t capacity = 0;
+	const zerror_t *err = whole.first_error;
+	bool records_ok = true, errors_ok = true;
+	size_t error_idx = 0;
+	for (size_t i = 0; i < count; i++) {
+		for (const zrecord_t *r = parts[i].first; r != NULL; r = r->next) {
+			if (key != NULL && !same_rrset_key(key, r)) {
+				records_ok = records_ok && records_equal(rec, &whole.mm, key, &merged);
+				rec = (rec != NULL) ? rec->next : NULL;
+				knot_rdataset_clear(&merged, NULL);
+				capacity = 0;
+			}
+			key = r;
+			knot_rdata_t *rr = r->rrs.rdata;
+			for (uint16_t j = 0; j < r->rrs.count; j++) {
+				records_ok = records_ok &&
+				             knot_rdataset_append(&merged, &capacity, rr, NULL) == KNOT_EOK;
+				rr = knot_rdataset_next(rr);
+			}
+		}
+		for (const zerror_t *e = parts[i].first_error; e != NULL; e = e->next) {
+			errors_ok = errors_ok && err != NULL && err->line == e->line &&
+			            err->code == e->code && error_idx < error_count &&
+			            e->line == error_lines[error_idx];
+			err = (err != NULL) ? err->next : NULL;
+			error_idx++;
+		}
+	}
+	if (key != NULL) {
+		records_ok = records_ok && records_equal(rec, &whole.mm, key, &merged);
+		rec = (rec != NULL) ? rec->next : NULL;
+		knot_rdataset_clear(&merged, NULL);
+	}
+	ok(records_ok && rec == NULL, "%s: same records", name);
+	ok(errors_ok && err == NULL && error_idx == error_count,
+	   "%s: same error lines", name);
+
+	for (size_t i = 0; i < count; i++) {
+		mp_delete(parts[i].mm.ctx);
+	}
+	mp_delete(whole.mm.ctx);
+	free(parts);
+}
+
+static void test_split_syntax(void)
+{
+	text_t text = { 0 };
+	uint64_t error_lines[8];
+	size_t errors = 0;
+
+	text_add(&text, "$TTL 300\n"
+	                "@ SOA ns admin ( 1 ; serial\n"
+	                "  3600 ; \"refresh ( \n"
+	                "  600 3600 ) 60\n"
+	                "@ NS ns\n");
+	for (unsigned i = 0; i < 40; i++) {
+		switch (i % 8) {
+		case 0:
+			text_add(&text, "a%u TXT ( \"x ; no comment ) \"\n  \"more ( \" )\n", i);
+			break;
+		case 1:
+			text_add(&text, "b%u TXT ( \"in\" ; comment \" (\n  \"parens\" ) ; )\n", i);
+			break;
+		case 2:
+			text_add(&text, "c%u MX (\n 10\n\n mail ) ; done\n", i);
+			break;
+		case 3:
+			text_add(&text, "d%u A 192.0.2.%u ; comment with \" quote\n", i, i);
+			break;
+		case 4:
+			text_add(&text, "e%u TXT \"escaped \\\" ( quote\" \\;\n", i);
+			break;
+		case 5:
+			text_add(&text, "\n; comment line ( \"\n");
+			// Unsorted rdataset, possibly split into two parts.
+			text_add(&text, "g%u A 192.0.2.2\ng%u A 192.0.2.1\n", i, i);
+			break;
+		case 6:
+			error_lines[errors++] = text.line + 1;
+			text_add(&text, "bad%u A 192.0.2.300\n", i);
+			break;
+		case 7:
+			text_add(&text, "f%u MX ( 10\n", i);
+			error_lines[errors++] = text.line + 1;
+			text_add(&text, "  mail ) extra\n");
+			break;
+		}
+	}
+
+	test_split("syntax", &text, error_lines, errors);
+	free(text.data);
+}
+
+static void test_split_directives(void)
+{
+	text_t text = { 0 };
+	uint64_t error_lines[8];
+	size_t errors = 0;
+
+	text_add(&text, "@ 100 SOA ns admin 1 3600 600 3600 60\n"
+	                "@ NS ns\n");
+	for (unsigned i = 0; i < 40; i++) {
+		switch (i % 5) {
+		case 0:
+			text_add(&text, "$TTL %u\n", 1000 + i);
+			break;
+		case 1:
+			text_add(&text, "$ORIGIN sub%u.example.\n", i);
+			break;
+		case 2:
+			text_add(&text, "a%u A 192.0.2.%u\n@ AAAA ::%u\n", i, i, i);
+			break;
+		case 3:
+			text_add(&text, "b%u MX 10 mail\n", i);
+			break;
+		case 4:
+			error_lines[errors++] = text.line + 1;
+			text_add(&text, "c%u TXT \"unterminated\n", i);
+			break;
+		}
+	}
+
+	test_split("directives", &text, error_lines, errors);
+	free(text.data);
+}
+
+static void test_split_unsupported(void)
+{
+	zpart_t parts[4];
+
+	const char *include = "@ SOA ns admin 1 2 3 4 5\n$INCLUDE file\na A 192.0.2.1\n";
+	is_int(0, split_parts(include, include + strlen(include), parts, 4),
+	       "unsupported: $INCLUDE");
+
+	const char *origin = "@ SOA ns admin 1 2 3 4 5\n$ORIGIN sub\na A 192.0.2.1\n";
+	is_int(0, split_parts(origin, origin + strlen(origin), parts, 4),
+	       "unsupported: relative $ORIGIN");
+}
+
+static zone_contents_t *load(const char *path, unsigned threads, double *time_ms)
+{
+	knot_dname_t *zone_name = knot_dname_from_str_alloc(ZONE_ORIGIN);
+	zloader_t zl;
+	int ret = zonefile_open(&zl, path, zone_name, SEMCHECK_MANDATORY_ONLY, time(NULL));
+	knot_dname_free(zone_name, NULL);
+	if (ret != KNOT_EOK) {
+		return NULL;
+	}
+
+	sem_handler_t handler = { .cb = err_handler_logger };
+	zl.err_handler = &handler;
+	zl.threads = threads;
+
+	struct timespec begin, end;
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	zone_contents_t *contents = zonefile_load(&zl);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	*time_ms = time_diff_ms(&begin, &end);
+
+	zonefile_close(&zl);
+
+	return contents;
+}
+
+static bool contents_equal(const zone_contents_t *a, const zone_contents_t *b)
+{
+	uint8_t *digest_a = NULL, *digest_b = NULL;
+	size_t size_a = 0, size_b = 0;
+	bool equal = zone_contents_digest(a, KNOT_ZONEMD_ALGORITHM_SHA384,
+	                                  &digest_a, &size_a) == KNOT_EOK &&
+	             zone_contents_digest(b, KNOT_ZONEMD_ALGORITHM_SHA384,
+	                                  &digest_b, &size_b) == KNOT_EOK &&
+	             size_a == size_b && memcmp(digest_a, digest_b, size_a) == 0;
+	free(digest_a);
+	free(digest_b);
+
+	return equal;
+}
+
+static void test_load(const char *dir)
+{
+	unsigned size_mib = LOAD_SIZE_MIB;
+	const char *env = getenv("KNOT_TEST_ZONEFILE_SIZE");
+	if (env != NULL && atoi(env) > 0) {
+		size_mib = atoi(env);
+	}
+
+	char path[PATH_MAX];
+	(void)snprintf(path, sizeof(path), "%s/" ZONE_ORIGIN "zone", dir);
+	FILE *file = fopen(path, "w");
+	ok(file != NULL, "load: create zone file");
+	if (file == NULL) {
+		return;
+	}
+
+	fprintf(file, "$TTL 3600\n@ SOA ns admin 1 3600 600 3600 60\n@ NS ns\n");
+	for (unsigned i = 0; ftell(file) < size_mib * (1 << 20); i++) {
+		fprintf(file, "h%u A 192.0.%u.%u\n"
+		              "h%u TXT ( \"host %u\" ; comment\n  \"more\" )\n"
+		              "  MX 10 h%u\n"
+		              "h%u AAAA 2001:db8::2\nh%u AAAA 2001:db8::1\n",
+		              i, (i >> 8) & 0xff, i & 0xff, i, i, i / 2, i, i);
+		if (i % 10000 == 0) {
+			fprintf(file, "$TTL %u\n", 3600 + i);
+		}
+	}
+	fclose(file);
+
+	double serial_ms = 0, parallel_ms = 0;
+	zone_contents_t *serial = load(path, 1, &serial_ms);
+	zone_contents_t *parallel = load(path, LOAD_THREADS, &parallel_ms);
+	ok(serial != NULL && parallel != NULL, "load: serial and parallel");
+	ok(serial != NULL && parallel != NULL && contents_equal(serial, parallel),
+	   "load: same contents");
+	diag("zone file %u MiB, 1 thread %.0f ms, %u threads %.0f ms",
+	     size_mib, serial_ms, LOAD_THREADS, parallel_ms);
+
+	zone_contents_deep_free(serial);
+	zone_contents_deep_free(parallel);
+	remove(path);
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	test_split_syntax();
+	test_split_directives();
+	test_split_unsupported();
+
+	char *temp_dir = test_mkdtemp();
+	ok(temp_dir != NULL, "make temporary directory");
+	if (temp_dir != NULL) {
+		test_load(temp_dir);
+		test_rm_rf(temp_dir);
+		free(temp_dir);
+	}
+
+	return 0;
+}
@@ -1,4 +1,4 @@
-/*  Copyright (C) 2018 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+/*  Copyright (C) 2021 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
 
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU General Public License as published by
@@ -14,7 +14,10 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <gnutls/crypto.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <tap/basic.h>
 
 #include "crypto.h"
@@ -82,6 +85,109 @@ static void test_hashing(void)
 	   "valid hash");
 
 	dnssec_binary_free(&hash);
+
+	uint8_t raw[32] = { 0 };
+	result = dnssec_nsec3_hash_raw(&dname, &params, raw, sizeof(raw));
+	ok(result == DNSSEC_EOK &&
+	   memcmp(raw, expected.data, expected.size) == 0,
+	   "dnssec_nsec3_hash_raw()");
+
+	result = dnssec_nsec3_hash_raw(&dname, &params, raw, expected.size - 1);
+	ok(result == DNSSEC_EINVAL, "dnssec_nsec3_hash_raw(), short buffer");
+}
+
+/*!
+ * Reference NSEC3 hashing with a digest context allocated for each hash.
+ */
+static int ctx_hash(const dnssec_binary_t *data, const dnssec_nsec3_params_t *params,
+		    uint8_t *hash)
+{
+	gnutls_hash_hd_t digest = NULL;
+	if (gnutls_hash_init(&digest, GNUTLS_DIG_SHA1) < 0) {
+		return DNSSEC_NSEC3_HASHING_ERROR;
+	}
+
+	const uint8_t *in = data->data;
+	size_t in_size = data->size;
+	for (int i = 0; i <= params->iterations; i++) {
+		gnutls_hash(digest, in, in_size);
+		gnutls_hash(digest, params->salt.data, params->salt.size);
+		gnutls_hash_output(digest, hash);
+		in = hash;
+		in_size = 20;
+	}
+
+	gnutls_hash_deinit(digest, NULL);
+
+	return DNSSEC_EOK;
+}
+
+static double time_diff_ms(const struct timespec *begin, const struct timespec *end)
+{
+	return (end->tv_sec - begin->tv_sec) * 1000.0 +
+	       (end->tv_nsec - begin->tv_nsec) / 1000000.0;
+}
+
+#define HASH_NAMES 2000
+
+static void test_hashing_random(void)
+{
+	uint8_t salt[255];
+	uint8_t name[255];
+	for (size_t i = 0; i < sizeof(salt); i++) {
+		salt[i] = rand();
+	}
+
+	dnssec_nsec3_params_t params = {
+		.algorithm = DNSSEC_NSEC3_ALGORITHM_SHA1,
+		.salt = { .data = salt }
+	};
+
+	bool match = true;
+	for (int i = 0; i < HASH_NAMES && match; i++) {
+		dnssec_binary_t data = { .data = name, .size = 1 + rand() % sizeof(name) };
+		for (size_t j = 0; j < data.size; j++) {
+			name[j] = rand();
+		}
+		params.iterations = rand() % 20;
+		params.salt.size = rand() % 2 ? rand() % sizeof(salt) : 8;
+
+		uint8_t expected[20], raw[20];
+		dnssec_binary_t hash = { 0 };
+		match = ctx_hash(&data, &params, expected) == DNSSEC_EOK &&
+			dnssec_nsec3_hash_raw(&data, &params, raw, sizeof(raw)) == DNSSEC_EOK &&
+			dnssec_nsec3_hash(&data, &params, &hash) == DNSSEC_EOK &&
+			memcmp(raw, expected, sizeof(expected)) == 0 &&
+			hash.size == sizeof(expected) &&
+			memcmp(hash.data, expected, sizeof(expected)) == 0;
+		dnssec_binary_free(&hash);
+	}
+	ok(match, "hashing of random names and parameters");
+
+	// Typical query path hashing: short name, short salt, few iterations.
+	const dnssec_binary_t data = {
+		.size = 18,
+		.data = (uint8_t *)"\x04""host""\x07""example""\x03""com"
+	};
+	params.iterations = 10;
+	params.salt.size = 8;
+
+	struct timespec t0, t1, t2;
+	uint8_t raw[20];
+	int ret = DNSSEC_EOK;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (int i = 0; i < 100 * HASH_NAMES; i++) {
+		ret |= ctx_hash(&data, &params, raw);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	for (int i = 0; i < 100 * HASH_NAMES; i++) {
+		ret |= dnssec_nsec3_hash_raw(&data, &params, raw, sizeof(raw));
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t2);
+	ok(ret == DNSSEC_EOK, "repeated hashing");
+
+	diag("NSEC3 hashing of %d names: digest context %.0f ms, raw %.0f ms",
+	     100 * HASH_NAMES, time_diff_ms(&t0, &t1), time_diff_ms(&t1, &t2));
 }
 
 static void test_clear(void)
@@ -108,6 +214,7 @@ int main(void)
 	test_length();
 	test_parsing();
 	test_hashing();
+	test_hashing_random();
 	test_clear();
 
 	return 0;
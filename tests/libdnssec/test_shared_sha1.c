@@ -0,0 +1,71 @@
+/*  Copyright (C) 2021 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <gnutls/crypto.h>
+#include <stdlib.h>
+#include <tap/basic.h>
+
+#include "sha1.c"
+
+#define MAX_SIZE (4 * SHA1_BLOCK_SIZE + 1)
+
+static void test_known(void)
+{
+	static const uint8_t abc[SHA1_DIGEST_SIZE] = {
+		0xa9, 0x99, 0x3e, 0x36, 0x47, 0x06, 0x81, 0x6a, 0xba, 0x3e,
+		0x25, 0x71, 0x78, 0x50, 0xc2, 0x6c, 0x9c, 0xd0, 0xd8, 0x9d
+	};
+
+	uint8_t digest[SHA1_DIGEST_SIZE];
+	sha1_ni((const uint8_t *)"abc", 3, digest);
+	ok(memcmp(digest, abc, sizeof(abc)) == 0, "sha1_ni() of 'abc'");
+}
+
+static void test_sizes(void)
+{
+	uint8_t data[MAX_SIZE];
+	for (size_t i = 0; i < sizeof(data); i++) {
+		data[i] = rand();
+	}
+
+	/* Including all the padding boundaries and multiple blocks. */
+	bool match = true;
+	for (size_t size = 0; size <= sizeof(data) && match; size++) {
+		uint8_t digest[SHA1_DIGEST_SIZE], expected[SHA1_DIGEST_SIZE];
+		sha1_ni(data, size, digest);
+		match = gnutls_hash_fast(GNUTLS_DIG_SHA1, data, size, expected) == 0 &&
+		        memcmp(digest, expected, sizeof(expected)) == 0;
+		if (!match) {
+			diag("mismatch for size %zu", size);
+		}
+	}
+	ok(match, "sha1_ni() matches GnuTLS for sizes 0 to %d", MAX_SIZE);
+}
+
+int main(void)
+{
+	plan_lazy();
+
+	if (!sha1_ni_available()) {
+		skip_all("SHA extensions not available");
+		return 0;
+	}
+
+	test_known();
+	test_sizes();
+
+	return 0;
+}
@@ -0,0 +1,209 @@
+/*  Copyright (C) 2021 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <getopt.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "libknot/libknot.h"
+
+/*
+ * Benchmark of building large rdatasets. The RRs are inserted in a random
+ * order one by one with knot_rdataset_add(), appended and sorted at once
+ * with knot_rdataset_append() and knot_rdataset_sort(), and merged from two
+ * halves with knot_rdataset_merge().
+ *
+ * Run via 'make bench', the largest RRset size can be passed via the
+ * BENCH_FLAGS variable, e.g. make bench BENCH_FLAGS="-l 65000". Other
+ * options are ignored as they belong to the other benchmarks.
+ */
+
+#define BENCH_RRSET_MAX		50000
+#define BENCH_RDATA_LEN		32	/* TXT-like rdata of variable length up to this. */
+
+typedef struct {
+	knot_rdata_t **rdata;
+	unsigned count;
+} corpus_t;
+
+static double elapsed_ms(const struct timespec *begin, const struct timespec *end)
+{
+	return (end->tv_sec - begin->tv_sec) * 1000.0 +
+	       (end->tv_nsec - begin->tv_nsec) / 1000000.0;
+}
+
+static int corpus_init(corpus_t *corpus, unsigned count)
+{
+	corpus->rdata = calloc(count, sizeof(*corpus->rdata));
+	if (corpus->rdata == NULL) {
+		return KNOT_ENOMEM;
+	}
+	corpus->count = count;
+
+	for (unsigned i = 0; i < count; i++) {
+		uint8_t data[BENCH_RDATA_LEN];
+		uint16_t len = 5 + i % (BENCH_RDATA_LEN - 4);
+		memset(data, 'a' + i % 26, len);
+		data[0] = len - 1;
+		// Unique prefix.
+		data[1] = i >> 24;
+		data[2] = i >> 16;
+		data[3] = i >> 8;
+		data[4] = i;
+
+		corpus->rdata[i] = malloc(knot_rdata_size(len));
+		if (corpus->rdata[i] == NULL) {
+			return KNOT_ENOMEM;
+		}
+		knot_rdata_init(corpus->rdata[i], len, data);
+	}
+
+	// Shuffle to get a random insertion order.
+	for (unsigned i = count - 1; i > 0; i--) {
+		unsigned j = random() % (i + 1);
+		knot_rdata_t *tmp = corpus->rdata[i];
+		corpus->rdata[i] = corpus->rdata[j];
+		corpus->rdata[j] = tmp;
+	}
+
+	return KNOT_EOK;
+}
+
+static void corpus_deinit(corpus_t *corpus)
+{
+	for (unsigned i = 0; corpus->rdata != NULL && i < corpus->count; i++) {
+		free(corpus->rdata[i]);
+	}
+	free(corpus->rdata);
+}
+
+static int build_add(const corpus_t *corpus, unsigned from, unsigned to,
+                     knot_rdataset_t *rrs)
+{
+	knot_rdataset_init(rrs);
+	for (unsigned i = from; i < to; i++) {
+		int ret = knot_rdataset_add(rrs, corpus->rdata[i], NULL);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
+	return KNOT_EOK;
+}
+
+static int build_append(const corpus_t *corpus, unsigned from, unsigned to,
+                        knot_rdataset_t *rrs)
+{
+	knot_rdataset_init(rrs);
+	size_t capacity = 0;
+	for (unsigned i = from; i < to; i++) {
+		int ret = knot_rdataset_append(rrs, &capacity, corpus->rdata[i], NULL);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
+	return knot_rdataset_sort(rrs, NULL);
+}
+
+static int bench_size(unsigned count)
+{
+	corpus_t corpus = { 0 };
+	int ret = corpus_init(&corpus, count);
+	if (ret != KNOT_EOK) {
+		corpus_deinit(&corpus);
+		return ret;
+	}
+
+	knot_rdataset_t added, appended, merged, half;
+	struct timespec begin, mid, end;
+
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	ret = build_add(&corpus, 0, count, &added);
+	clock_gettime(CLOCK_MONOTONIC, &mid);
+	double add_ms = elapsed_ms(&begin, &mid);
+
+	if (ret == KNOT_EOK) {
+		ret = build_append(&corpus, 0, count, &appended);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	double append_ms = elapsed_ms(&mid, &end);
+
+	if (ret == KNOT_EOK) {
+		ret = build_append(&corpus, 0, count / 2, &merged);
+	}
+	if (ret == KNOT_EOK) {
+		ret = build_append(&corpus, count / 2, count, &half);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	if (ret == KNOT_EOK) {
+		ret = knot_rdataset_merge(&merged, &half, NULL);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	double merge_ms = elapsed_ms(&begin, &end);
+
+	if (ret == KNOT_EOK && (!knot_rdataset_eq(&added, &appended) ||
+	                        !knot_rdataset_eq(&added, &merged))) {
+		fprintf(stderr, "rdataset mismatch for %u RRs\n", count);
+		ret = KNOT_ERROR;
+	}
+	if (ret == KNOT_EOK) {
+		printf("%8u RRs: add %10.2f ms, append+sort %8.2f ms, merge halves %8.2f ms\n",
+		       count, add_ms, append_ms, merge_ms);
+	}
+
+	knot_rdataset_clear(&added, NULL);
+	knot_rdataset_clear(&appended, NULL);
+	knot_rdataset_clear(&merged, NULL);
+	knot_rdataset_clear(&half, NULL);
+	corpus_deinit(&corpus);
+
+	return ret;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned max = BENCH_RRSET_MAX;
+
+	opterr = 0;
+	int opt;
+	while ((opt = getopt(argc, argv, "l:")) != -1) {
+		if (opt == 'l') {
+			char *end = NULL;
+			unsigned long val = strtoul(optarg, &end, 10);
+			if (*optarg == '\0' || *end != '\0' || val < 2 || val > UINT16_MAX) {
+				fprintf(stderr, "invalid RRset size '%s'\n", optarg);
+				return EXIT_FAILURE;
+			}
+			max = val;
+		}
+	}
+
+	srandom(1);
+	for (unsigned count = 100; count < max; count *= 10) {
+		if (bench_size(count) != KNOT_EOK) {
+			return EXIT_FAILURE;
+		}
+	}
+	if (bench_size(max) != KNOT_EOK) {
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
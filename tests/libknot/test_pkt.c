@@ -14,6 +14,7 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <stdio.h>
 #include <tap/basic.h>
 
 #include "libknot/libknot.h"
@@ -64,6 +65,108 @@ static void packet_match(knot_pkt_t *in, knot_pkt_t *out)
 	is_int(NAMECOUNT, rr_matched, "pkt: RR content match");
 }
 
+#define DICT_NAMES 200
+
+static knot_rrset_t *dict_rrset(unsigned i, knot_mm_t *mm)
+{
+	char owner[KNOT_DNAME_TXT_MAXLEN], target[KNOT_DNAME_TXT_MAXLEN];
+	(void)snprintf(owner, sizeof(owner), "h%u.sub%u.example.com.", i, i % 4);
+	(void)snprintf(target, sizeof(target), "mx%u.sub%u.example.com.", i % 8, i % 3);
+
+	uint8_t rdata[2 + KNOT_DNAME_MAXLEN] = { 0, 10 };
+	knot_dname_t *dname = knot_dname_from_str_alloc(owner);
+	if (dname == NULL ||
+	    knot_dname_from_str(rdata + 2, target, sizeof(rdata) - 2) == NULL) {
+		knot_dname_free(dname, NULL);
+		return NULL;
+	}
+
+	knot_rrset_t *rr = knot_rrset_new(dname, KNOT_RRTYPE_MX, KNOT_CLASS_IN, TTL, mm);
+	knot_dname_free(dname, NULL);
+	if (rr != NULL) {
+		(void)knot_rrset_add_rdata(rr, rdata, 2 + knot_dname_size(rdata + 2), mm);
+	}
+
+	return rr;
+}
+
+/*! \brief Write the RRSets, return the number of written ones. */
+static unsigned dict_write(knot_pkt_t *pkt, knot_rrset_t **rrsets, unsigned count,
+                           bool dict, size_t limit)
+{
+	knot_dname_t *qname = knot_dname_from_str_alloc("example.com.");
+	knot_pkt_clear(pkt);
+	pkt->max_size = limit;
+	(void)knot_pkt_put_question(pkt, qname, KNOT_CLASS_IN, KNOT_RRTYPE_AXFR);
+	knot_dname_free(qname, NULL);
+	if (dict) {
+		(void)knot_pkt_compr_dict(pkt);
+	}
+
+	unsigned written = 0;
+	while (written < count &&
+	       knot_pkt_put(pkt, 0, rrsets[written], KNOT_PF_NOTRUNC) == KNOT_EOK) {
+		written++;
+	}
+
+	return written;
+}
+
+/*! \brief Parse the packet and compare with the written RRSets. */
+static bool dict_match(knot_pkt_t *pkt, knot_rrset_t **rrsets, unsigned count,
+                       knot_mm_t *mm)
+{
+	knot_pkt_t *in = knot_pkt_new(pkt->wire, pkt->size, mm);
+	bool match = (in != NULL && knot_pkt_parse(in, 0) == KNOT_EOK &&
+	              in->rrset_count == count);
+	for (unsigned i = 0; match && i < count; i++) {
+		match = knot_rrset_equal(&in->rr[i], rrsets[i], true);
+	}
+	knot_pkt_free(in);
+
+	return match;
+}
+
+static void test_compr_dict(knot_mm_t *mm)
+{
+	knot_rrset_t *rrsets[DICT_NAMES];
+	for (unsigned i = 0; i < DICT_NAMES; i++) {
+		rrsets[i] = dict_rrset(i, mm);
+		assert(rrsets[i]);
+	}
+
+	knot_pkt_t *pkt = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, mm);
+	assert(pkt);
+
+	/* Reference message with the default compression. */
+	unsigned written = dict_write(pkt, rrsets, DICT_NAMES, false, KNOT_WIRE_MAX_PKTSIZE);
+	ok(written == DICT_NAMES && dict_match(pkt, rrsets, DICT_NAMES, mm),
+	   "pkt: compression without dictionary");
+	size_t plain_size = pkt->size;
+
+	written = dict_write(pkt, rrsets, DICT_NAMES, true, KNOT_WIRE_MAX_PKTSIZE);
+	ok(written == DICT_NAMES && dict_match(pkt, rrsets, DICT_NAMES, mm),
+	   "pkt: compression with dictionary");
+	ok(pkt->size < plain_size, "pkt: dictionary compression is better (%zu < %zu)",
+	   pkt->size, plain_size);
+
+	/* Names of an overflowing RRSet mustn't be used for compression. */
+	bool valid = true;
+	for (size_t limit = 256; limit < 1024 && valid; limit += 7) {
+		written = dict_write(pkt, rrsets, DICT_NAMES, true, limit);
+		pkt->max_size = KNOT_WIRE_MAX_PKTSIZE;
+		valid = written < DICT_NAMES &&
+		        knot_pkt_put(pkt, 0, rrsets[written], KNOT_PF_NOTRUNC) == KNOT_EOK &&
+		        dict_match(pkt, rrsets, written + 1, mm);
+	}
+	ok(valid, "pkt: compression with dictionary after overflow");
+
+	knot_pkt_free(pkt);
+	for (unsigned i = 0; i < DICT_NAMES; i++) {
+		knot_rrset_free(rrsets[i], mm);
+	}
+}
+
 int main(int argc, char *argv[])
 {
 	plan_lazy();
@@ -193,6 +296,12 @@ int main(int argc, char *argv[])
 		knot_rrset_free(rrsets[i], NULL);
 	}
 	free(tsig_key.secret.data);
+
+	/*
+	 * Compression dictionary tests.
+	 */
+	test_compr_dict(&mm);
+
 	mp_delete((struct mempool *)mm.ctx);
 
 	return 0;
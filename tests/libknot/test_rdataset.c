@@ -196,6 +196,54 @@ int main(int argc, char *argv[])
 	              rdataset.rdata == NULL;
 	ok(subtract_ok, "rdataset: subtract last.");
 
+	// Test append and sort
+	size_t capacity = 0;
+	ok(knot_rdataset_append(NULL, &capacity, rdata_gt, NULL) == KNOT_EINVAL,
+	   "rdataset: append NULL.");
+	ok(knot_rdataset_append(&rdataset, &capacity, rdata_gt, NULL) == KNOT_EOK &&
+	   knot_rdataset_append(&rdataset, &capacity, rdata_lo, NULL) == KNOT_EOK &&
+	   knot_rdataset_append(&rdataset, &capacity, rdata_gt, NULL) == KNOT_EOK &&
+	   rdataset.count == 3 && capacity >= rdataset.size &&
+	   knot_rdata_cmp(rdataset.rdata, rdata_gt) == 0, "rdataset: append.");
+	ret = knot_rdataset_sort(&rdataset, NULL);
+	bool sort_ok = ret == KNOT_EOK && rdataset.count == 2 &&
+	               rdataset.size == rdataset_size(&rdataset) &&
+	               knot_rdata_cmp(knot_rdataset_at(&rdataset, 0), rdata_lo) == 0 &&
+	               knot_rdata_cmp(knot_rdataset_at(&rdataset, 1), rdata_gt) == 0;
+	ok(sort_ok, "rdataset: sort and deduplicate.");
+
+	// Test merge of larger sets
+	knot_rdataset_t even, odd;
+	knot_rdataset_init(&even);
+	knot_rdataset_init(&odd);
+	size_t even_cap = 0, odd_cap = 0;
+	for (int i = 99; i >= 0; i--) {
+		uint8_t buf[knot_rdata_size(2)];
+		knot_rdata_t *rdata = (knot_rdata_t *)buf;
+		uint8_t num[2] = { i / 10, i % 10 };
+		knot_rdata_init(rdata, 1 + (i % 2), num);
+		if (i % 2 == 0) {
+			ret = knot_rdataset_append(&even, &even_cap, rdata, NULL);
+		} else {
+			ret = knot_rdataset_append(&odd, &odd_cap, rdata, NULL);
+		}
+		assert(ret == KNOT_EOK);
+	}
+	ok(knot_rdataset_sort(&even, NULL) == KNOT_EOK &&
+	   knot_rdataset_sort(&odd, NULL) == KNOT_EOK, "rdataset: sort larger.");
+	ret = knot_rdataset_merge(&even, &odd, NULL);
+	merge_ok = ret == KNOT_EOK && even.size == rdataset_size(&even);
+	for (uint16_t i = 1; merge_ok && i < even.count; i++) {
+		merge_ok = knot_rdata_cmp(knot_rdataset_at(&even, i - 1),
+		                          knot_rdataset_at(&even, i)) < 0;
+	}
+	ok(merge_ok, "rdataset: merge larger keeps the sorted order.");
+	size_t merged_count = even.count;
+	ret = knot_rdataset_merge(&even, &odd, NULL);
+	ok(ret == KNOT_EOK && even.count == merged_count, "rdataset: merge larger duplicates.");
+	knot_rdataset_clear(&even, NULL);
+	knot_rdataset_clear(&odd, NULL);
+
 	knot_rdataset_clear(&copy, NULL);
 	knot_rdataset_clear(&rdataset, NULL);
 	knot_rdataset_clear(&rdataset_lo, NULL);
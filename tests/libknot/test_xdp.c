@@ -0,0 +1,188 @@
+/*  Copyright (C) 2021 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <tap/basic.h>
+
+#include "libknot/xdp/xdp.c"
+
+static void test_geometry(void)
+{
+	struct knot_xdp_umem *umem = NULL;
+
+	int ret = umem_new(NULL, 1, &umem);
+	is_int(KNOT_EOK, ret, "geometry: defaults");
+	if (ret == KNOT_EOK) {
+		is_int(KNOT_XDP_RING_SIZE_DEFAULT, umem->ring_size, "geometry: default ring size");
+		is_int(KNOT_XDP_FRAME_SIZE_DEFAULT, umem->frame_size, "geometry: default frame size");
+		ok(umem->size == (size_t)KNOT_XDP_FRAME_SIZE_DEFAULT * 2 * KNOT_XDP_RING_SIZE_DEFAULT,
+		   "geometry: default size");
+		ok(!umem->hugepages, "geometry: no huge pages by default");
+		umem_free(umem);
+	}
+
+	knot_xdp_config_t config = { .ring_size = 64, .frame_size = 4096 };
+	ret = umem_new(&config, 3, &umem);
+	is_int(KNOT_EOK, ret, "geometry: three sockets");
+	if (ret == KNOT_EOK) {
+		ok(umem->size == 4096 * 2 * 64 * 3, "geometry: three sockets size");
+		is_int(3 * 64, umem->tx_free_count, "geometry: shared TX pool size");
+		umem_free(umem);
+	}
+
+	config.hugepages = true;
+	ret = umem_new(&config, 1, &umem);
+	is_int(KNOT_EOK, ret, "geometry: huge pages");
+	if (ret == KNOT_EOK) {
+		ok(umem->hugepages && umem->size == HUGEPAGE_SIZE,
+		   "geometry: size rounded up to huge page");
+		umem_free(umem);
+	}
+
+	config.ring_size = 8192;
+	ret = umem_new(&config, 1, &umem);
+	is_int(KNOT_EOK, ret, "geometry: huge pages, big ring");
+	if (ret == KNOT_EOK) {
+		ok(umem->size == 4096 * 2 * 8192, "geometry: size already aligned");
+		umem_free(umem);
+	}
+
+	const uint32_t bad_rings[] = { 100, 32, 2 * RING_SIZE_MAX };
+	for (size_t i = 0; i < sizeof(bad_rings) / sizeof(bad_rings[0]); i++) {
+		config = (knot_xdp_config_t) { .ring_size = bad_rings[i] };
+		is_int(KNOT_EINVAL, umem_new(&config, 1, &umem),
+		       "geometry: invalid ring size %u", bad_rings[i]);
+	}
+
+	const uint32_t bad_frames[] = { 1024, 3000, 8192 };
+	for (size_t i = 0; i < sizeof(bad_frames) / sizeof(bad_frames[0]); i++) {
+		config = (knot_xdp_config_t) { .frame_size = bad_frames[i] };
+		is_int(KNOT_EINVAL, umem_new(&config, 1, &umem),
+		       "geometry: invalid frame size %u", bad_frames[i]);
+	}
+
+	config = (knot_xdp_config_t) { .ring_size = RING_SIZE_MAX };
+	is_int(KNOT_EINVAL, umem_new(&config, 4096, &umem),
+	       "geometry: too many frames");
+
+	is_int(KNOT_EINVAL, knot_xdp_umem_init(&umem, NULL, 0), "geometry: no sockets");
+	is_int(KNOT_EINVAL, knot_xdp_umem_init(NULL, NULL, 1), "geometry: no output");
+}
+
+static bool tx_frames_valid(const struct kxsk_umem *umem)
+{
+	for (uint32_t i = 0; i < umem->tx_free_count; i++) {
+		if (umem->tx_free_indices[i] >= umem->shared->sockets * umem->ring_size) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static void test_private_pool(void)
+{
+	knot_xdp_config_t config = { .ring_size = 64 };
+	struct knot_xdp_umem *shared = NULL;
+	int ret = umem_new(&config, 1, &shared);
+	is_int(KNOT_EOK, ret, "private pool: UMEM");
+	if (ret != KNOT_EOK) {
+		return;
+	}
+
+	struct kxsk_umem *umem = NULL;
+	ret = configure_xsk_umem(shared, &umem);
+	is_int(KNOT_EOK, ret, "private pool: socket");
+	if (ret == KNOT_EOK) {
+		ok(umem->tx_owned == 64 && umem->tx_free_count == 64 && umem->tx_max == 64,
+		   "private pool: all TX frames owned by the socket");
+		ok(tx_frames_valid(umem), "private pool: TX frames");
+		is_int(0, tx_pool_take(umem), "private pool: nothing to take");
+		tx_pool_return(umem, 0);
+		is_int(64, umem->tx_free_count, "private pool: nothing returned");
+		free(umem);
+	}
+
+	umem_free(shared);
+}
+
+static void test_shared_pool(void)
+{
+	knot_xdp_config_t config = { .ring_size = 64 };
+	struct knot_xdp_umem *shared = NULL;
+	int ret = umem_new(&config, 2, &shared);
+	is_int(KNOT_EOK, ret, "shared pool: UMEM");
+	if (ret != KNOT_EOK) {
+		return;
+	}
+
+	struct kxsk_umem *a = NULL, *b = NULL, *c = NULL;
+	ret = configure_xsk_umem(shared, &a);
+	shared->used++;
+	is_int(KNOT_EOK, ret, "shared pool: socket A");
+	ret = configure_xsk_umem(shared, &b);
+	shared->used++;
+	is_int(KNOT_EOK, ret, "shared pool: socket B");
+	is_int(KNOT_ESPACE, configure_xsk_umem(shared, &c), "shared pool: no more sockets");
+	if (a == NULL || b == NULL) {
+		goto cleanup;
+	}
+
+	ok(a->tx_owned == 0 && a->tx_free_count == 0 && a->tx_max == 128,
+	   "shared pool: TX frames left in the pool");
+
+	// A busy socket takes more than its share, up to the ring capacity.
+	is_int(TX_POOL_BATCH, tx_pool_take(a), "shared pool: take a batch");
+	while (tx_pool_take(a) > 0) {
+	}
+	ok(a->tx_owned == 128 && a->tx_free_count == 128 && shared->tx_free_count == 0,
+	   "shared pool: busy socket took all");
+	ok(tx_frames_valid(a), "shared pool: TX frames");
+	is_int(0, tx_pool_take(b), "shared pool: pool exhausted");
+
+	// The surplus returns to the pool for the others.
+	tx_pool_return(a, TX_POOL_BATCH);
+	ok(a->tx_owned == TX_POOL_BATCH && a->tx_free_count == TX_POOL_BATCH &&
+	   shared->tx_free_count == 128 - TX_POOL_BATCH, "shared pool: surplus returned");
+	is_int(TX_POOL_BATCH, tx_pool_take(b), "shared pool: other socket takes");
+	ok(tx_frames_valid(b), "shared pool: other TX frames");
+
+	bool unique = true;
+	for (uint32_t i = 0; i < a->tx_free_count; i++) {
+		for (uint32_t j = 0; j < b->tx_free_count; j++) {
+			unique = unique && a->tx_free_indices[i] != b->tx_free_indices[j];
+		}
+	}
+	ok(unique, "shared pool: no frame owned twice");
+
+	tx_pool_return(a, 0);
+	tx_pool_return(b, 0);
+	ok(a->tx_owned == 0 && b->tx_owned == 0 && shared->tx_free_count == 128,
+	   "shared pool: all frames back");
+cleanup:
+	free(a);
+	free(b);
+	umem_free(shared);
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	test_geometry();
+	test_private_pool();
+	test_shared_pool();
+
+	return 0;
+}
@@ -32,6 +32,11 @@ size_t sent_syns = 0;
 size_t sent_fins = 0;
 uint32_t sent_seqno = 0;
 uint32_t sent_ackno = 0;
+size_t sent_data_segs = 0;
+size_t sent_data_bytes = 0;
+uint32_t sent_data_seqno = 0;
+uint32_t sent_data_end = 0;
+uint32_t sent_fin_seqno = 0;
 
 knot_xdp_socket_t *test_sock = NULL;
 
@@ -129,6 +134,30 @@ static int mock_send_nocheck(_unused_ knot_xdp_socket_t *sock, const knot_xdp_ms
 	return KNOT_EOK;
 }
 
+static int mock_send_data(_unused_ knot_xdp_socket_t *sock, const knot_xdp_msg_t msgs[],
+                          uint32_t n_msgs, _unused_ uint32_t *sent)
+{
+	ok(n_msgs <= 20, "send: not too many at once");
+	for (uint32_t i = 0; i < n_msgs; i++) {
+		const knot_xdp_msg_t *msg = msgs + i;
+		if (msg->flags & KNOT_XDP_MSG_FIN) {
+			sent_fins++;
+			sent_fin_seqno = msg->seqno;
+		}
+		if (msg->payload.iov_len == 0) {
+			continue;
+		}
+		ok(msg->flags & KNOT_XDP_MSG_ACK, "send: data with ACK");
+		ok(msg->payload.iov_len <= test_conn->mss, "send: data segment size");
+		if (sent_data_segs++ == 0) {
+			sent_data_seqno = msg->seqno;
+		}
+		sent_data_bytes += msg->payload.iov_len;
+		sent_data_end = msg->seqno + msg->payload.iov_len;
+	}
+	return KNOT_EOK;
+}
+
 static void clean_table(void)
 {
 	(void)tcp_cleanup(test_table, 0, UINT32_MAX, NULL);
@@ -140,6 +169,8 @@ static void clean_sent(void)
 	sent_rsts = 0;
 	sent_syns = 0;
 	sent_fins = 0;
+	sent_data_segs = 0;
+	sent_data_bytes = 0;
 }
 
 static void check_sent(size_t expect_acks, size_t expect_rsts, size_t expect_syns, size_t expect_fins)
@@ -330,7 +361,7 @@ void test_close(void)
 	knot_tcp_relay_free(&relays);
 
 	msg.flags &= ~KNOT_XDP_MSG_FIN;
-	prepare_seqack(&msg, 0, 0);
+	prepare_seqack(&msg, 0, 1);
 	ret = knot_tcp_relay(test_sock, &msg, 1, test_table, NULL, &relays, NULL);
 	is_int(KNOT_EOK, ret, "close: relay 2 OK");
 	check_sent(0, 0, 0, 0);
@@ -371,7 +402,7 @@ void test_many(void)
 
 	uint32_t reset_count = 0, close_count = 0;
 	ret = knot_tcp_sweep(test_table, test_sock, UINT32_MAX, timeout_time, UINT32_MAX,
-	                     0, 0, &close_count, &reset_count);
+	                     UINT32_MAX, 0, 0, &close_count, &reset_count);
 	is_int(KNOT_EOK, ret, "many/timeout1: OK");
 	is_int(CONNS - 1, close_count, "many/timeout1: close count");
 	is_int(0, reset_count, "may/timeout1: reset count");
@@ -379,7 +410,7 @@ void test_many(void)
 
 	close_count = 0;
 	ret = knot_tcp_sweep(test_table, test_sock, UINT32_MAX, UINT32_MAX, timeout_time,
-	                     0, 0, &close_count, &reset_count);
+	                     UINT32_MAX, 0, 0, &close_count, &reset_count);
 	is_int(KNOT_EOK, ret, "many/timeout2: OK");
 	is_int(0, close_count, "many/timeout2: close count");
 	is_int(CONNS - 1, reset_count, "may/timeout2: reset count");
@@ -437,7 +468,7 @@ void test_ibufs_size(void)
 	// now free some
 	uint32_t reset_count = 0, close_count = 0;
 	ret = knot_tcp_sweep(test_table, test_sock, UINT32_MAX, UINT32_MAX, UINT32_MAX,
-	                     0, 8, &close_count, &reset_count);
+	                     UINT32_MAX, 0, 8, &close_count, &reset_count);
 	is_int(KNOT_EOK, ret, "inbufs: timeout OK");
 	check_sent(0, 2, 0, 0);
 	is_int(0, close_count, "inbufs: close count");
@@ -451,6 +482,205 @@ void test_ibufs_size(void)
 	clean_table();
 }
 
+static void check_sent_data(size_t expect_segs, size_t expect_bytes, uint32_t expect_seqno,
+                            const char *msg)
+{
+	is_int(expect_segs, sent_data_segs, "%s: sent segments", msg);
+	is_int(expect_bytes, sent_data_bytes, "%s: sent bytes", msg);
+	is_int(expect_seqno, sent_data_seqno, "%s: first seqno", msg);
+	clean_sent();
+}
+
+void test_outbufs(void)
+{
+	knot_xdp_msg_t msg;
+	knot_tcp_relay_dynarray_t relays = { 0 };
+	prepare_msg(&msg, KNOT_XDP_MSG_SYN, 3000, 1);
+	msg.win = 1000;
+	int ret = knot_tcp_relay(test_sock, &msg, 1, test_table, NULL, &relays, NULL);
+	is_int(KNOT_EOK, ret, "outbufs: open OK");
+	test_conn = knot_tcp_relay_dynarray_arr(&relays)[0].conn;
+	knot_tcp_relay_free(&relays);
+	clean_sent();
+
+	uint32_t base = test_conn->ackno;
+	prepare_msg(&msg, KNOT_XDP_MSG_ACK, 3000, 1);
+	msg.seqno = test_conn->seqno;
+	msg.ackno = base;
+	msg.win = 1000;
+	ret = knot_tcp_relay(test_sock, &msg, 1, test_table, NULL, &relays, NULL);
+	is_int(KNOT_EOK, ret, "outbufs: establish OK");
+	is_int(0, relays.size, "outbufs: nothing to send");
+	uint8_t data[2000] = { 0 };
+	knot_tcp_relay_t rl = { .conn = test_conn };
+	ret = knot_tcp_relay_answer(&relays, &rl, test_table, data, sizeof(data));
+	is_int(KNOT_EOK, ret, "outbufs: answer OK");
+	ok(test_conn->outbufs != NULL, "outbufs: answer queued");
+	is_int(sizeof(data) + 2, test_conn->outbufs->len, "outbufs: queued length");
+	is_int(sizeof(data) + 2, test_table->inbufs_total, "outbufs: counted in buffers");
+
+	// The window allows only a part of the answer.
+	ret = knot_tcp_send(test_sock, knot_tcp_relay_dynarray_arr(&relays), relays.size);
+	is_int(KNOT_EOK, ret, "outbufs: send OK");
+	check_sent_data(2, 1000, base, "outbufs/window");
+	is_int(base + 1000, test_conn->ackno, "outbufs: sent seqno");
+	knot_tcp_relay_free(&relays);
+
+	// Partial ACK moves the window.
+	msg.ackno = base + test_conn->mss;
+	ret = knot_tcp_relay(test_sock, &msg, 1, test_table, NULL, &relays, NULL);
+	is_int(KNOT_EOK, ret, "outbufs: ACK OK");
+	is_int(1, relays.size, "outbufs: continue sending");
+	ret = knot_tcp_send(test_sock, knot_tcp_relay_dynarray_arr(&relays), relays.size);
+	is_int(KNOT_EOK, ret, "outbufs: send 2 OK");
+	check_sent_data(1, test_conn->mss, base + 1000, "outbufs/ack");
+	ok(test_conn->outbufs != NULL, "outbufs: partially acked kept");
+	knot_tcp_relay_free(&relays);
+
+	// Unacknowledged data is resent after the timeout.
+	uint32_t reset_count = 0, close_count = 0;
+	ret = knot_tcp_sweep(test_table, test_sock, UINT32_MAX, UINT32_MAX, UINT32_MAX,
+	                     0, 0, 0, &close_count, &reset_count);
+	is_int(KNOT_EOK, ret, "outbufs: resend OK");
+	is_int(0, close_count + reset_count, "outbufs: no close or reset");
+	check_sent_data(2, 1000, base + test_conn->mss, "outbufs/resend");
+	is_int(base + 1000 + test_conn->mss, test_conn->ackno, "outbufs: resend keeps seqno");
+
+	// Full ACK with a large window sends the rest.
+	msg.ackno = test_conn->ackno;
+	msg.win = UINT16_MAX;
+	ret = knot_tcp_relay(test_sock, &msg, 1, test_table, NULL, &relays, NULL);
+	is_int(KNOT_EOK, ret, "outbufs: ACK 2 OK");
+	ret = knot_tcp_send(test_sock, knot_tcp_relay_dynarray_arr(&relays), relays.size);
+	is_int(KNOT_EOK, ret, "outbufs: send 3 OK");
+	check_sent_data(1, sizeof(data) + 2 - 1000 - test_conn->mss,
+	                base + 1000 + test_conn->mss, "outbufs/rest");
+	knot_tcp_relay_free(&relays);
+
+	msg.ackno = test_conn->ackno;
+	ret = knot_tcp_relay(test_sock, &msg, 1, test_table, NULL, &relays, NULL);
+	is_int(KNOT_EOK, ret, "outbufs: ACK 3 OK");
+	is_int(0, relays.size, "outbufs: nothing to send");
+	ok(test_conn->outbufs == NULL, "outbufs: all acked");
+	is_int(0, test_table->inbufs_total, "outbufs: buffers released");
+	ok(EMPTY_LIST(*tcp_table_resend(test_table)), "outbufs: resend timer stopped");
+
+	clean_table();
+}
+
+/*!
+ * \brief Open a connection with the given window and queue an answer of the given length.
+ */
+static knot_tcp_conn_t *open_with_answer(knot_xdp_msg_t *msg, uint16_t port, uint16_t win,
+                                         size_t answer_len)
+{
+	knot_tcp_relay_dynarray_t relays = { 0 };
+	prepare_msg(msg, KNOT_XDP_MSG_SYN, port, 1);
+	msg->win = win;
+	(void)knot_tcp_relay(test_sock, msg, 1, test_table, NULL, &relays, NULL);
+	knot_tcp_conn_t *conn = knot_tcp_relay_dynarray_arr(&relays)[0].conn;
+	knot_tcp_relay_free(&relays);
+	test_conn = conn;
+
+	prepare_msg(msg, KNOT_XDP_MSG_ACK, port, 1);
+	msg->seqno = conn->seqno;
+	msg->ackno = conn->ackno;
+	msg->win = win;
+	(void)knot_tcp_relay(test_sock, msg, 1, test_table, NULL, &relays, NULL);
+	knot_tcp_relay_free(&relays);
+
+	uint8_t data[answer_len];
+	memset(data, 0, answer_len);
+	knot_tcp_relay_t rl = { .conn = conn };
+	(void)knot_tcp_relay_answer(&relays, &rl, test_table, data, answer_len);
+	(void)knot_tcp_send(test_sock, knot_tcp_relay_dynarray_arr(&relays), relays.size);
+	knot_tcp_relay_free(&relays);
+	clean_sent();
+
+	return conn;
+}
+
+void test_close_data(void)
+{
+	knot_xdp_msg_t msg;
+	knot_tcp_relay_dynarray_t relays = { 0 };
+	(void)open_with_answer(&msg, 4000, 1000, 2000);
+	uint32_t end = test_conn->ackno + 2002 - 1000;
+
+	// The window doesn't allow sending of all the data, FIN must wait.
+	knot_tcp_relay_t rl = { .answer = XDP_TCP_CLOSE, .conn = test_conn };
+	int ret = knot_tcp_send(test_sock, &rl, 1);
+	is_int(KNOT_EOK, ret, "close data: send close OK");
+	is_int(0, sent_fins, "close data: no FIN before data");
+	is_int(XDP_TCP_FIN_PENDING, test_conn->state, "close data: FIN pending");
+
+	// The rest of the data is followed by FIN.
+	msg.ackno = test_conn->ackno;
+	msg.win = UINT16_MAX;
+	ret = knot_tcp_relay(test_sock, &msg, 1, test_table, NULL, &relays, NULL);
+	is_int(KNOT_EOK, ret, "close data: ACK OK");
+	is_int(1, relays.size, "close data: continue sending");
+	ret = knot_tcp_send(test_sock, knot_tcp_relay_dynarray_arr(&relays), relays.size);
+	is_int(KNOT_EOK, ret, "close data: send OK");
+	knot_tcp_relay_free(&relays);
+	is_int(end, sent_data_end, "close data: all data sent");
+	is_int(1, sent_fins, "close data: FIN sent");
+	is_int(end, sent_fin_seqno, "close data: FIN after the last byte");
+	is_int(XDP_TCP_CLOSING, test_conn->state, "close data: closing");
+	clean_sent();
+
+	// ACK of the data only keeps the connection.
+	msg.ackno = end;
+	ret = knot_tcp_relay(test_sock, &msg, 1, test_table, NULL, &relays, NULL);
+	is_int(KNOT_EOK, ret, "close data: data ACK OK");
+	ok(tcp_table_find(test_table, &msg) == test_conn, "close data: FIN not acked yet");
+	knot_tcp_relay_free(&relays);
+
+	msg.ackno = end + 1;
+	ret = knot_tcp_relay(test_sock, &msg, 1, test_table, NULL, &relays, NULL);
+	is_int(KNOT_EOK, ret, "close data: FIN ACK OK");
+	ok(tcp_table_find(test_table, &msg) == NULL, "close data: connection removed");
+	is_int(0, test_table->inbufs_total, "close data: buffers released");
+	knot_tcp_relay_free(&relays);
+
+	clean_table();
+}
+
+void test_resend_deadline(void)
+{
+	const uint32_t timeout = 200000;
+	knot_xdp_msg_t msg_a, msg_b;
+	knot_tcp_relay_dynarray_t relays = { 0 };
+
+	knot_tcp_conn_t *conn_a = open_with_answer(&msg_a, 5000, UINT16_MAX, 100);
+	usleep(timeout);
+	knot_tcp_conn_t *conn_b = open_with_answer(&msg_b, 5001, UINT16_MAX, 100);
+
+	// Peer activity without acknowledging any data doesn't postpone the resend.
+	msg_a.ackno = conn_a->acked;
+	int ret = knot_tcp_relay(test_sock, &msg_a, 1, test_table, NULL, &relays, NULL);
+	is_int(KNOT_EOK, ret, "resend deadline: duplicate ACK OK");
+	is_int(0, relays.size, "resend deadline: nothing to send");
+
+	uint32_t reset_count = 0, close_count = 0;
+	ret = knot_tcp_sweep(test_table, test_sock, UINT32_MAX, UINT32_MAX, UINT32_MAX,
+	                     timeout, 0, 0, &close_count, &reset_count);
+	is_int(KNOT_EOK, ret, "resend deadline: sweep OK");
+	is_int(0, close_count + reset_count, "resend deadline: no close or reset");
+	check_sent_data(1, 102, conn_a->acked, "resend deadline/expired");
+	ok(tcp_resend_node_conn(HEAD(*tcp_table_resend(test_table))) == conn_b,
+	   "resend deadline: restarted timer last");
+
+	// The timers aren't expired now.
+	ret = knot_tcp_sweep(test_table, test_sock, UINT32_MAX, UINT32_MAX, UINT32_MAX,
+	                     timeout, 0, 0, &close_count, &reset_count);
+	is_int(KNOT_EOK, ret, "resend deadline: sweep 2 OK");
+	is_int(0, sent_data_segs, "resend deadline: not expired");
+
+	clean_table();
+	ok(EMPTY_LIST(*tcp_table_resend(test_table)), "resend deadline: timers removed");
+}
+
 static void init_mock(knot_xdp_socket_t **socket, void *send_mock)
 {
 	*socket = calloc(1, sizeof(**socket));
@@ -477,6 +707,12 @@ int main(int argc, char *argv[])
 
 	test_ibufs_size();
 
+	knot_xdp_deinit(test_sock);
+	init_mock(&test_sock, mock_send_data);
+	test_outbufs();
+	test_close_data();
+	test_resend_deadline();
+
 	knot_xdp_deinit(test_sock);
 	init_mock(&test_sock, mock_send_nocheck);
 	test_many();
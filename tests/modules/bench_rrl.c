@@ -0,0 +1,178 @@
+/*  Copyright (C) 2021 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <getopt.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "libdnssec/crypto.h"
+#include "libknot/libknot.h"
+#include "contrib/sockaddr.h"
+#include "contrib/time.h"
+#include "knot/modules/rrl/functions.c"
+
+/*
+ * Benchmark of the RRL table throughput. Each thread queries the table from
+ * pseudo-random source addresses, first a single thread, then the given
+ * number of threads in parallel. The queries from different source prefixes
+ * mostly hit different table shards, so the throughput should scale with
+ * the number of threads.
+ *
+ * Run via 'make bench', parameters can be passed via the BENCH_FLAGS
+ * variable, e.g. make bench BENCH_FLAGS="-q 1000000 -t 4".
+ */
+
+#define BENCH_SIZE		196613
+#define BENCH_RATE		10
+#define BENCH_QUERIES		500000		/* Per thread. */
+#define BENCH_THREADS_MAX	64
+
+typedef struct {
+	rrl_table_t *rrl;
+	rrl_req_t *req;
+	knot_dname_t *zone;
+	struct sockaddr_storage addr;
+	unsigned long count;
+} bench_t;
+
+static void *bench_runnable(void *arg)
+{
+	bench_t *b = arg;
+	struct sockaddr_in *ipv4 = (struct sockaddr_in *)&b->addr;
+	uint32_t seed = ipv4->sin_addr.s_addr;
+	for (unsigned long i = 0; i < b->count; ++i) {
+		seed = seed * 1103515245 + 12345; /* Cheap LCG, not to measure RNG. */
+		ipv4->sin_addr.s_addr = seed;
+		(void)rrl_query(b->rrl, &b->addr, b->req, b->zone, NULL);
+	}
+	return NULL;
+}
+
+/*! \brief Run \a threads parallel queriers, return elapsed time in ms. */
+static double run_parallel(bench_t *bench, unsigned long threads)
+{
+	pthread_t thr[BENCH_THREADS_MAX];
+	struct timespec begin, end;
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	for (unsigned long i = 0; i < threads; ++i) {
+		pthread_create(thr + i, NULL, bench_runnable, bench + i);
+	}
+	for (unsigned long i = 0; i < threads; ++i) {
+		pthread_join(thr[i], NULL);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	return time_diff_ms(&begin, &end);
+}
+
+static void bench_init(bench_t *bench, unsigned long threads, rrl_table_t *rrl,
+                       rrl_req_t *req, knot_dname_t *zone, unsigned long count)
+{
+	for (unsigned long i = 0; i < threads; ++i) {
+		bench[i] = (bench_t) {
+			.rrl = rrl, .req = req, .zone = zone, .count = count
+		};
+		char addr_str[16];
+		(void)snprintf(addr_str, sizeof(addr_str), "10.%u.0.1", (unsigned)i);
+		sockaddr_set(&bench[i].addr, AF_INET, addr_str, 0);
+	}
+}
+
+static bool parse_num(const char *arg, unsigned long *num, unsigned long min,
+                      unsigned long max)
+{
+	char *end = NULL;
+	unsigned long val = strtoul(arg, &end, 10);
+	if (*arg == '\0' || *end != '\0' || val < min || val > max) {
+		fprintf(stderr, "invalid parameter value '%s'\n", arg);
+		return false;
+	}
+	*num = val;
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned long queries = BENCH_QUERIES;
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	unsigned long threads = (cpus > 1) ? cpus : 2;
+	if (threads > BENCH_THREADS_MAX) {
+		threads = BENCH_THREADS_MAX;
+	}
+
+	opterr = 0;
+	int opt;
+	while ((opt = getopt(argc, argv, "q:t:")) != -1) {
+		bool valid = true;
+		switch (opt) {
+		case 'q': valid = parse_num(optarg, &queries, 1, UINT32_MAX); break;
+		case 't': valid = parse_num(optarg, &threads, 1, BENCH_THREADS_MAX); break;
+		default: break;
+		}
+		if (!valid) {
+			return EXIT_FAILURE;
+		}
+	}
+
+	dnssec_crypto_init();
+
+	knot_pkt_t *query = knot_pkt_new(NULL, 512, NULL);
+	knot_dname_t *zone = knot_dname_from_str_alloc("rrl.");
+	bench_t *bench = calloc(threads, sizeof(bench_t));
+	if (query == NULL || zone == NULL || bench == NULL ||
+	    knot_pkt_put_question(query, zone, KNOT_CLASS_IN, KNOT_RRTYPE_A) != KNOT_EOK) {
+		return EXIT_FAILURE;
+	}
+
+	uint8_t rbuf[512];
+	memcpy(rbuf, query->wire, query->size);
+	knot_wire_flags_set_qr(rbuf);
+	rrl_req_t req = {
+		.wire = rbuf,
+		.len = query->size,
+		.query = query
+	};
+
+	/* Both runs start with an empty table. */
+	rrl_table_t *rrl = rrl_create(BENCH_SIZE, BENCH_RATE);
+	if (rrl == NULL) {
+		return EXIT_FAILURE;
+	}
+	printf("%u shards, %lu queries per thread, %ld CPUs\n",
+	       rrl->shard_count, queries, cpus);
+	bench_init(bench, threads, rrl, &req, zone, queries);
+	double single = run_parallel(bench, 1);
+	printf("%3u thread  %12.0f qps\n", 1, queries * 1000.0 / single);
+	rrl_destroy(rrl);
+
+	rrl = rrl_create(BENCH_SIZE, BENCH_RATE);
+	if (rrl == NULL) {
+		return EXIT_FAILURE;
+	}
+	bench_init(bench, threads, rrl, &req, zone, queries);
+	double multi = run_parallel(bench, threads);
+	printf("%3lu threads %12.0f qps, speedup %.2f\n", threads,
+	       queries * threads * 1000.0 / multi, single * threads / multi);
+	rrl_destroy(rrl);
+
+	free(bench);
+	knot_dname_free(zone, NULL);
+	knot_pkt_free(query);
+	dnssec_crypto_cleanup();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,202 @@
+/*  Copyright (C) 2021 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <netinet/in.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <tap/basic.h>
+
+#include "knot/modules/dnsproxy/async_fwd.h"
+#include "contrib/net.h"
+#include "contrib/sockaddr.h"
+#include "libknot/libknot.h"
+
+#define TIMEOUT 1000
+
+static int bound_socket(struct sockaddr_storage *addr)
+{
+	sockaddr_set(addr, AF_INET, "127.0.0.1", 0);
+	int fd = net_bound_socket(SOCK_DGRAM, addr, 0);
+	socklen_t len = sizeof(*addr);
+	if (fd >= 0 && getsockname(fd, (struct sockaddr *)addr, &len) != 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+static ssize_t recv_timed(int fd, uint8_t *buf, size_t len, int timeout)
+{
+	struct pollfd pfd = { .fd = fd, .events = POLLIN };
+	if (poll(&pfd, 1, timeout) != 1) {
+		return -1;
+	}
+	return recv(fd, buf, len, 0);
+}
+
+static knot_pkt_t *make_query(uint16_t id, const char *qname)
+{
+	knot_pkt_t *pkt = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, NULL);
+	knot_dname_t *name = knot_dname_from_str_alloc(qname);
+	if (pkt == NULL || name == NULL ||
+	    knot_pkt_put_question(pkt, name, KNOT_CLASS_IN, KNOT_RRTYPE_A) != KNOT_EOK) {
+		knot_pkt_free(pkt);
+		knot_dname_free(name, NULL);
+		return NULL;
+	}
+	knot_dname_free(name, NULL);
+	knot_wire_set_id(pkt->wire, id);
+	// Lower-case the question as the query processing does.
+	knot_dname_to_lower(pkt->wire + KNOT_WIRE_HEADER_SIZE);
+	return pkt;
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	struct sockaddr_storage upstream_addr, client_addr, server_addr;
+	int upstream = bound_socket(&upstream_addr);
+	int client = bound_socket(&client_addr);
+	int server = bound_socket(&server_addr);
+	ok(upstream >= 0 && client >= 0 && server >= 0, "async_fwd: sockets");
+
+	async_fwd_t *fwd = async_fwd_new(&upstream_addr, NULL, TIMEOUT);
+	ok(fwd != NULL, "async_fwd: create");
+	if (fwd == NULL) {
+		return 1;
+	}
+
+	// Forward two queries.
+	const knot_dname_t *orig_qnames[] = {
+		(const knot_dname_t *)"\x03""WwW""\x07""example""\x03""com",
+		(const knot_dname_t *)"\x04""mail""\x07""EXAMPLE""\x03""com",
+	};
+	knot_pkt_t *q1 = make_query(1111, "www.example.com.");
+	knot_pkt_t *q2 = make_query(2222, "mail.example.com.");
+	ok(q1 != NULL && q2 != NULL, "async_fwd: queries");
+	int ret = async_fwd_query(fwd, 0, q1, orig_qnames[0], NULL, server, NULL, &client_addr);
+	ok(ret == KNOT_EOK, "async_fwd: forward first query");
+	ret = async_fwd_query(fwd, 0, q2, orig_qnames[1], NULL, server, NULL, &client_addr);
+	ok(ret == KNOT_EOK, "async_fwd: forward second query");
+
+	// Receive them upstream.
+	uint8_t up[2][KNOT_WIRE_MAX_PKTSIZE];
+	ssize_t up_len[2];
+	struct sockaddr_storage from[2];
+	for (int i = 0; i < 2; i++) {
+		socklen_t from_len = sizeof(from[i]);
+		up_len[i] = recvfrom(upstream, up[i], sizeof(up[i]), 0,
+		                     (struct sockaddr *)&from[i], &from_len);
+	}
+	ok(up_len[0] == q1->size && up_len[1] == q2->size, "async_fwd: upstream received");
+	ok(knot_wire_get_id(up[0]) != knot_wire_get_id(up[1]), "async_fwd: distinct upstream IDs");
+
+	// Answer in the reverse order, the second response with upper-case QNAME.
+	knot_dname_to_lower(up[1] + KNOT_WIRE_HEADER_SIZE);
+	up[1][KNOT_WIRE_HEADER_SIZE + 1] = 'M';
+	for (int i = 1; i >= 0; i--) {
+		knot_wire_set_qr(up[i]);
+		knot_wire_set_rcode(up[i], KNOT_RCODE_NXDOMAIN);
+		(void)sendto(upstream, up[i], up_len[i], 0, (struct sockaddr *)&from[i],
+		             sockaddr_len(&from[i]));
+	}
+
+	uint8_t resp[KNOT_WIRE_MAX_PKTSIZE];
+	ssize_t len = recv_timed(client, resp, sizeof(resp), TIMEOUT);
+	ok(len == q2->size && knot_wire_get_id(resp) == 2222 &&
+	   memcmp(resp + KNOT_WIRE_HEADER_SIZE, orig_qnames[1],
+	          knot_dname_size(orig_qnames[1])) == 0,
+	   "async_fwd: second response, out of order");
+	len = recv_timed(client, resp, sizeof(resp), TIMEOUT);
+	ok(len == q1->size && knot_wire_get_id(resp) == 1111 &&
+	   knot_wire_get_rcode(resp) == KNOT_RCODE_NXDOMAIN &&
+	   memcmp(resp + KNOT_WIRE_HEADER_SIZE, orig_qnames[0],
+	          knot_dname_size(orig_qnames[0])) == 0,
+	   "async_fwd: first response");
+
+	// Unanswered query times out.
+	ret = async_fwd_query(fwd, 1, q1, NULL, NULL, server, NULL, &client_addr);
+	ok(ret == KNOT_EOK, "async_fwd: forward unanswered query");
+	len = recv_timed(client, resp, sizeof(resp), 2 * TIMEOUT);
+	ok(len > 0 && knot_wire_get_id(resp) == 1111 && knot_wire_get_qr(resp) &&
+	   knot_wire_get_rcode(resp) == KNOT_RCODE_SERVFAIL &&
+	   knot_wire_get_arcount(resp) == 0,
+	   "async_fwd: SERVFAIL on timeout");
+
+	// The SERVFAIL keeps the response OPT. The server socket is closed
+	// meanwhile, the forwarder answers through its own one.
+	knot_rrset_t opt_rr;
+	ret = knot_edns_init(&opt_rr, 1232, 0, KNOT_EDNS_VERSION, NULL);
+	knot_edns_set_do(&opt_rr);
+	ok(ret == KNOT_EOK, "async_fwd: response OPT");
+	ret = async_fwd_query(fwd, 2, q2, NULL, &opt_rr, server, NULL, &client_addr);
+	ok(ret == KNOT_EOK, "async_fwd: forward unanswered EDNS query");
+	close(server);
+	len = recv_timed(client, resp, sizeof(resp), 2 * TIMEOUT);
+	knot_pkt_t *pkt = knot_pkt_new(resp, (len > 0) ? len : 0, NULL);
+	ok(len > 0 && knot_pkt_parse(pkt, 0) == KNOT_EOK &&
+	   knot_wire_get_id(resp) == 2222 &&
+	   knot_wire_get_rcode(resp) == KNOT_RCODE_SERVFAIL &&
+	   pkt->opt_rr != NULL && knot_edns_get_payload(pkt->opt_rr) == 1232 &&
+	   knot_edns_do(pkt->opt_rr),
+	   "async_fwd: SERVFAIL with EDNS from own socket");
+	knot_pkt_free(pkt);
+	knot_rrset_clear(&opt_rr, NULL);
+
+	// Drop the queries left unanswered above, the next one is read instead.
+	while (recv_timed(upstream, up[0], sizeof(up[0]), 0) > 0);
+
+	// Wildcard socket needs the query destination address.
+	struct sockaddr_storage any_addr;
+	sockaddr_set(&any_addr, AF_INET, "0.0.0.0", 0);
+	int any = net_bound_socket(SOCK_DGRAM, &any_addr, 0);
+	ret = async_fwd_query(fwd, 0, q1, NULL, NULL, any, NULL, &client_addr);
+	ok(any >= 0 && ret == KNOT_ENOTSUP, "async_fwd: wildcard socket without destination");
+
+	// The response from a wildcard socket has the query destination as the source.
+	struct sockaddr_storage dst_addr;
+	socklen_t dst_len = sizeof(dst_addr);
+	(void)getsockname(any, (struct sockaddr *)&dst_addr, &dst_len);
+	((struct sockaddr_in *)&dst_addr)->sin_addr.s_addr = htonl(0x7f000002); // 127.0.0.2
+	ret = async_fwd_query(fwd, 0, q1, NULL, NULL, any, &dst_addr, &client_addr);
+	ok(ret == KNOT_EOK, "async_fwd: forward from wildcard socket");
+	socklen_t from_len = sizeof(from[0]);
+	up_len[0] = recvfrom(upstream, up[0], sizeof(up[0]), 0,
+	                     (struct sockaddr *)&from[0], &from_len);
+	knot_wire_set_qr(up[0]);
+	(void)sendto(upstream, up[0], up_len[0], 0, (struct sockaddr *)&from[0],
+	             sockaddr_len(&from[0]));
+	struct sockaddr_storage resp_from = { 0 };
+	from_len = sizeof(resp_from);
+	struct pollfd pfd = { .fd = client, .events = POLLIN };
+	len = (poll(&pfd, 1, TIMEOUT) == 1) ?
+	      recvfrom(client, resp, sizeof(resp), 0, (struct sockaddr *)&resp_from, &from_len) : -1;
+	ok(len == q1->size && knot_wire_get_id(resp) == 1111 &&
+	   sockaddr_cmp(&resp_from, &dst_addr, false) == 0,
+	   "async_fwd: response from the query destination");
+	close(any);
+
+	async_fwd_free(fwd);
+	knot_pkt_free(q1);
+	knot_pkt_free(q2);
+	close(upstream);
+	close(client);
+
+	return 0;
+}
@@ -1,4 +1,4 @@
-/*  Copyright (C) 2018 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+/*  Copyright (C) 2021 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
 
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU General Public License as published by
@@ -16,11 +16,16 @@
 
 #include <tap/basic.h>
 #include <assert.h>
+#include <signal.h>
+#include <unistd.h>
 
-#include "knot/modules/onlinesign/nsec_next.h"
+// Replaces the static module object, if any, in the linked library.
+#define KNOTD_MOD_STATIC
+#include "knot/modules/onlinesign/onlinesign.c"
 #include "libknot/consts.h"
 #include "libknot/dname.h"
 #include "libknot/errcode.h"
+#include "libknot/rrset.h"
 
 /*!
  * \brief Assert that a domain name in a static buffer is valid.
@@ -58,6 +63,186 @@ static void _test_nsec_next(const char *msg,
 	_test_nsec_next(msg, input, apex, expected); \
 }
 
+static void test_rrsig_cache(void)
+{
+	rrsig_cache_t *cache = rrsig_cache_new(16);
+	ok(cache != NULL, "rrsig_cache, create");
+	if (cache == NULL) {
+		return;
+	}
+
+	knot_rrset_t rr, rr_other, sigs, out;
+	knot_rrset_init(&rr, (knot_dname_t *)"\x03""www""\x07""example""\x03""com",
+	                KNOT_RRTYPE_A, KNOT_CLASS_IN, 3600);
+	knot_rrset_add_rdata(&rr, (const uint8_t *)"\xc0\x00\x02\x01", 4, NULL);
+	knot_rrset_init(&rr_other, rr.owner, KNOT_RRTYPE_A, KNOT_CLASS_IN, 3600);
+	knot_rrset_add_rdata(&rr_other, (const uint8_t *)"\xc0\x00\x02\x02", 4, NULL);
+	knot_rrset_init(&sigs, rr.owner, KNOT_RRTYPE_RRSIG, KNOT_CLASS_IN, 3600);
+	knot_rrset_add_rdata(&sigs, (const uint8_t *)"fake signature", 14, NULL);
+	knot_rrset_init_empty(&out);
+
+	ok(!rrsig_cache_get(cache, &rr, 100, &out.rrs, NULL), "rrsig_cache, empty");
+
+	rrsig_cache_put(cache, &rr, &sigs.rrs, 200);
+	ok(rrsig_cache_get(cache, &rr, 100, &out.rrs, NULL) &&
+	   knot_rdataset_eq(&out.rrs, &sigs.rrs), "rrsig_cache, hit");
+	knot_rdataset_clear(&out.rrs, NULL);
+
+	ok(!rrsig_cache_get(cache, &rr_other, 100, &out.rrs, NULL),
+	   "rrsig_cache, different rdata");
+	rr.ttl = 60;
+	ok(!rrsig_cache_get(cache, &rr, 100, &out.rrs, NULL),
+	   "rrsig_cache, different TTL");
+	rr.ttl = 3600;
+
+	ok(!rrsig_cache_get(cache, &rr, 200, &out.rrs, NULL), "rrsig_cache, expired");
+
+	rrsig_cache_put(cache, &rr, &sigs.rrs, 200);
+	rrsig_cache_clear(cache);
+	ok(!rrsig_cache_get(cache, &rr, 100, &out.rrs, NULL), "rrsig_cache, cleared");
+
+	knot_rdataset_clear(&rr.rrs, NULL);
+	knot_rdataset_clear(&rr_other.rrs, NULL);
+	knot_rdataset_clear(&sigs.rrs, NULL);
+	rrsig_cache_free(cache);
+}
+
+/*! \brief Event task state shared with the test. */
+static struct {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	bool started;
+	bool finished;
+} task_state = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.cond = PTHREAD_COND_INITIALIZER,
+};
+
+/*!
+ * \brief Event task finishing only after events_stop() started waiting.
+ */
+static void task_slow(worker_task_t *task)
+{
+	knotd_mod_t *mod = task->ctx;
+	online_sign_ctx_t *ctx = knotd_mod_ctx(mod);
+
+	pthread_mutex_lock(&task_state.lock);
+	task_state.started = true;
+	pthread_cond_broadcast(&task_state.cond);
+	pthread_mutex_unlock(&task_state.lock);
+
+	bool frozen = false;
+	while (!frozen) {
+		usleep(1000);
+		pthread_mutex_lock(&ctx->event_mutex);
+		frozen = ctx->event_frozen;
+		pthread_mutex_unlock(&ctx->event_mutex);
+	}
+	usleep(10000);
+
+	task_state.finished = true;
+	events_done(ctx, knot_time());
+}
+
+static void interrupt_handle(int s)
+{
+}
+
+static void test_events(void)
+{
+	struct sigaction sa;
+	sa.sa_handler = interrupt_handle;
+	sigemptyset(&sa.sa_mask);
+	sa.sa_flags = 0;
+	sigaction(SIGALRM, &sa, NULL); // Interrupt
+
+	server_t server = { 0 };
+	server.workers = worker_pool_create(1);
+	int ret = evsched_init(&server.sched, NULL);
+	ok(server.workers != NULL && ret == KNOT_EOK, "events, init");
+
+	online_sign_ctx_t ctx = { 0 };
+	pthread_mutex_init(&ctx.event_mutex, NULL);
+	pthread_mutex_init(&ctx.event_reschedule_lock, NULL);
+	pthread_cond_init(&ctx.event_done, NULL);
+	knotd_mod_t mod = { .server = &server, .ctx = &ctx };
+
+	// The pool isn't started, the queued task must be dropped.
+	ret = events_start(&mod, &ctx);
+	ctx.event_task.run = task_slow;
+	events_dispatch(ctx.event);
+	ok(ret == KNOT_EOK && ctx.event_running, "events, task queued");
+	events_stop(&mod, &ctx);
+	ok(!ctx.event_running && ctx.event == NULL, "events, queued task cancelled");
+
+	worker_pool_start(server.workers);
+	worker_pool_wait(server.workers);
+	ok(!task_state.started, "events, cancelled task not run");
+
+	// The running task must be waited for.
+	ctx.event_frozen = false;
+	ret = events_start(&mod, &ctx);
+	ctx.event_task.run = task_slow;
+	events_dispatch(ctx.event);
+	pthread_mutex_lock(&task_state.lock);
+	while (!task_state.started) {
+		pthread_cond_wait(&task_state.cond, &task_state.lock);
+	}
+	pthread_mutex_unlock(&task_state.lock);
+	events_stop(&mod, &ctx);
+	ok(ret == KNOT_EOK && task_state.finished && !ctx.event_running,
+	   "events, running task waited for");
+
+	worker_pool_stop(server.workers);
+	worker_pool_join(server.workers);
+	worker_pool_destroy(server.workers);
+	evsched_deinit(&server.sched);
+	pthread_mutex_destroy(&ctx.event_mutex);
+	pthread_mutex_destroy(&ctx.event_reschedule_lock);
+	pthread_cond_destroy(&ctx.event_done);
+}
+
+static void test_keys_publish(void)
+{
+	online_sign_ctx_t ctx = { .rrsig_cache = rrsig_cache_new(16) };
+	knotd_mod_t mod = { .ctx = &ctx };
+
+	knot_rrset_t rr, sigs, out;
+	knot_rrset_init(&rr, (knot_dname_t *)"\x03""www""\x07""example""\x03""com",
+	                KNOT_RRTYPE_A, KNOT_CLASS_IN, 3600);
+	knot_rrset_add_rdata(&rr, (const uint8_t *)"\xc0\x00\x02\x01", 4, NULL);
+	knot_rrset_init(&sigs, rr.owner, KNOT_RRTYPE_RRSIG, KNOT_CLASS_IN, 3600);
+	knot_rrset_add_rdata(&sigs, (const uint8_t *)"fake signature", 14, NULL);
+	knot_rrset_init_empty(&out);
+
+	rcu_register_thread();
+
+	// Old signatures are dropped with the keys.
+	rrsig_cache_put(ctx.rrsig_cache, &rr, &sigs.rrs, 200);
+	online_keys_t *keys = calloc(1, sizeof(*keys));
+	keys_publish(&ctx, keys);
+	rcu_read_lock();
+	ok(rcu_dereference(ctx.keys) == keys &&
+	   !rrsig_cache_get(ctx.rrsig_cache, &rr, 100, &out.rrs, NULL),
+	   "keys, publish");
+	ok(pre_routine(KNOTD_IN_STATE_HIT, NULL, NULL, &mod) == KNOTD_IN_STATE_HIT,
+	   "keys, queries allowed");
+	rcu_read_unlock();
+
+	// No keys make the zone doomed.
+	keys_publish(&ctx, NULL);
+	rcu_read_lock();
+	ok(pre_routine(KNOTD_IN_STATE_HIT, NULL, NULL, &mod) == KNOTD_IN_STATE_ERROR,
+	   "keys, doomed zone");
+	rcu_read_unlock();
+
+	rcu_unregister_thread();
+
+	knot_rdataset_clear(&rr.rrs, NULL);
+	knot_rdataset_clear(&sigs.rrs, NULL);
+	rrsig_cache_free(ctx.rrsig_cache);
+}
+
 int main(int argc, char *argv[])
 {
 	plan_lazy();
@@ -199,5 +384,9 @@ int main(int argc, char *argv[])
 		APEX
 	);
 
+	test_rrsig_cache();
+	test_events();
+	test_keys_publish();
+
 	return 0;
 }
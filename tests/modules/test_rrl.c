@@ -1,4 +1,4 @@
-/*  Copyright (C) 2019 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+/*  Copyright (C) 2021 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
 
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU General Public License as published by
@@ -15,11 +15,13 @@
  */
 
 #include <tap/basic.h>
+#include <pthread.h>
 
 #include "libdnssec/crypto.h"
 #include "libdnssec/random.h"
 #include "libknot/libknot.h"
 #include "contrib/sockaddr.h"
+#include "contrib/time.h"
 #include "knot/modules/rrl/functions.c"
 #include "stdio.h"
 
@@ -28,6 +30,125 @@
 #define RRL_SIZE 196613
 #define RRL_THREADS 8
 #define RRL_INSERTS (RRL_SIZE/(5*RRL_THREADS)) /* lf = 1/5 */
+#define RRL_PREFIXES 256 /* Candidate source prefixes for the shard test. */
+
+/*! \brief Parallel query runnable data. */
+struct query_data {
+	rrl_table_t *rrl;
+	rrl_req_t *rq;
+	knot_dname_t *zone;
+	struct sockaddr_storage addr;
+	unsigned count;
+	int limited;
+};
+
+static void *rrl_query_runnable(void *arg)
+{
+	struct query_data *d = (struct query_data *)arg;
+	for (unsigned i = 0; i < d->count; ++i) {
+		if (rrl_query(d->rrl, &d->addr, d->rq, d->zone, NULL) != KNOT_EOK) {
+			d->limited++;
+		}
+	}
+	return NULL;
+}
+
+/*! \brief Run \a threads parallel queriers. */
+static void rrl_run_parallel(struct query_data *data, unsigned threads)
+{
+	pthread_t thr[RRL_THREADS];
+	for (unsigned i = 0; i < threads; ++i) {
+		pthread_create(thr + i, NULL, &rrl_query_runnable, data + i);
+	}
+	for (unsigned i = 0; i < threads; ++i) {
+		pthread_join(thr[i], NULL);
+	}
+}
+
+static void rrl_parallel_init(struct query_data *data, unsigned threads,
+                              rrl_table_t *rrl, rrl_req_t *rq, knot_dname_t *zone,
+                              unsigned count)
+{
+	for (unsigned i = 0; i < threads; ++i) {
+		data[i] = (struct query_data) {
+			.rrl = rrl, .rq = rq, .zone = zone, .count = count
+		};
+		char addr_str[16];
+		(void)snprintf(addr_str, sizeof(addr_str), "10.%u.0.1", i);
+		sockaddr_set(&data[i].addr, AF_INET, addr_str, 0);
+	}
+}
+
+/*! \brief Get the index of the shard serving the request from \a addr. */
+static unsigned rrl_shard_of(rrl_table_t *rrl, const struct sockaddr_storage *addr,
+                             rrl_req_t *rq, knot_dname_t *zone)
+{
+	uint8_t buf[RRL_CLSBLK_MAXLEN];
+	rrl_shard_t *shard = NULL;
+	rrl_item_t *b = rrl_hash(rrl, addr, rq, zone, time(NULL), &shard, buf, sizeof(buf));
+	if (b == NULL) {
+		return rrl->shard_count;
+	}
+	pthread_mutex_unlock(&shard->lock);
+	return shard - rrl->shards;
+}
+
+/*!
+ * \brief Check that requests from different source prefixes are spread over
+ *        the shards and don't contend for one lock.
+ */
+static void rrl_shards(rrl_table_t *rrl, rrl_req_t *rq, knot_dname_t *zone)
+{
+	is_int(RRL_SHARD_COUNT, rrl->shard_count, "rrl: shard count");
+
+	/* Pick the source prefixes served by distinct shards. */
+	struct sockaddr_storage addr[RRL_THREADS];
+	unsigned shard_ids[RRL_THREADS];
+	unsigned found = 0;
+	bool same_prefix = true;
+	for (unsigned i = 0; i < RRL_PREFIXES && found < RRL_THREADS; ++i) {
+		char addr_str[16];
+		(void)snprintf(addr_str, sizeof(addr_str), "10.%u.0.1", i);
+		sockaddr_set(&addr[found], AF_INET, addr_str, 0);
+		unsigned id = rrl_shard_of(rrl, &addr[found], rq, zone);
+
+		/* Another address from the same prefix shares the shard. */
+		struct sockaddr_storage sibling;
+		(void)snprintf(addr_str, sizeof(addr_str), "10.%u.0.200", i);
+		sockaddr_set(&sibling, AF_INET, addr_str, 0);
+		same_prefix = same_prefix && rrl_shard_of(rrl, &sibling, rq, zone) == id;
+
+		bool unique = id < rrl->shard_count;
+		for (unsigned j = 0; j < found; ++j) {
+			unique = unique && shard_ids[j] != id;
+		}
+		if (unique) {
+			shard_ids[found++] = id;
+		}
+	}
+	ok(same_prefix, "rrl: same prefix maps to the same shard");
+	is_int(RRL_THREADS, found, "rrl: different prefixes map to different shards");
+
+	/* Hold the first shard lock, the other prefixes must not wait for it. */
+	uint8_t buf[RRL_CLSBLK_MAXLEN];
+	rrl_shard_t *held = NULL;
+	if (found < RRL_THREADS ||
+	    rrl_hash(rrl, &addr[0], rq, zone, time(NULL), &held, buf, sizeof(buf)) == NULL) {
+		skip("rrl: no contention between shards");
+		return;
+	}
+	bool free_locks = true;
+	for (unsigned i = 1; i < found; ++i) {
+		pthread_mutex_t *lock = &rrl->shards[shard_ids[i]].lock;
+		if (pthread_mutex_trylock(lock) == 0) {
+			pthread_mutex_unlock(lock);
+		} else {
+			free_locks = false;
+		}
+	}
+	pthread_mutex_unlock(&held->lock);
+	ok(free_locks, "rrl: no contention between shards");
+}
 
 /* Disabled as default as it depends on random input.
  * Table may be consistent even if some collision occur (and they may occur).
@@ -54,23 +175,26 @@ static void* rrl_runnable(void *arg)
 	struct runnable_data *d = (struct runnable_data *)arg;
 	struct sockaddr_storage addr;
 	memcpy(&addr, d->addr, sizeof(struct sockaddr_storage));
-	int lock = -1;
+	uint8_t buf[RRL_CLSBLK_MAXLEN];
+	rrl_shard_t *shard = NULL;
 	uint32_t now = time(NULL);
 	struct bucketmap *m = malloc(RRL_INSERTS * sizeof(struct bucketmap));
 	for (unsigned i = 0; i < RRL_INSERTS; ++i) {
 		m[i].i = dnssec_random_uint32_t();
 		((struct sockaddr_in *) &addr)->sin_addr.s_addr = m[i].i;
-		rrl_item_t *b = rrl_hash(d->rrl, &addr, d->rq, d->zone, now, &lock);
-		rrl_unlock(d->rrl, lock);
+		rrl_item_t *b = rrl_hash(d->rrl, &addr, d->rq, d->zone, now,
+		                         &shard, buf, sizeof(buf));
 		m[i].x = b->netblk;
+		pthread_mutex_unlock(&shard->lock);
 	}
 	for (unsigned i = 0; i < RRL_INSERTS; ++i) {
 		((struct sockaddr_in *) &addr)->sin_addr.s_addr = m[i].i;
-		rrl_item_t *b = rrl_hash(d->rrl, &addr, d->rq, d->zone, now, &lock);
-		rrl_unlock(d->rrl, lock);
+		rrl_item_t *b = rrl_hash(d->rrl, &addr, d->rq, d->zone, now,
+		                         &shard, buf, sizeof(buf));
 		if (b->netblk != m[i].x) {
 			d->passed = 0;
 		}
+		pthread_mutex_unlock(&shard->lock);
 	}
 	free(m);
 	return NULL;
@@ -153,16 +277,49 @@ int main(int argc, char *argv[])
 	rrl_classify(buf, sizeof(buf), &addr6, &rq, qname);
 	is_int(0, memcmp(buf, expectedv6, sizeof(expectedv6)), "rrl: IPv6 hash input buffer");
 
+	/* 4. Shard mapping of distinct subnets. */
+	rrl_shards(rrl, &rq, zone);
+
+	/* 5. Parallel unlimited requests from distinct subnets. */
+	struct query_data qd[RRL_THREADS];
+	rrl_parallel_init(qd, RRL_THREADS, rrl, &rq, zone, rate * RRL_CAPACITY);
+	rrl_run_parallel(qd, RRL_THREADS);
+	ret = 0;
+	for (unsigned i = 0; i < RRL_THREADS; ++i) {
+		ret += qd[i].limited;
+	}
+	is_int(0, ret, "rrl: parallel unlimited requests");
+
+	/* 6. Parallel requests sharing one bucket. The bucket is refilled by at
+	 *    most 'rate' tokens per elapsed second, so the bounds hold even
+	 *    if the second changes during the run. */
+	unsigned shared_count = 10 * rate * RRL_CAPACITY;
+	rrl_parallel_init(qd, RRL_THREADS, rrl, &rq, zone, shared_count);
+	for (unsigned i = 0; i < RRL_THREADS; ++i) {
+		sockaddr_set(&qd[i].addr, AF_INET, "10.255.0.1", 0);
+	}
+	uint32_t begin = time_now().tv_sec;
+	rrl_run_parallel(qd, RRL_THREADS);
+	uint32_t elapsed = time_now().tv_sec - begin;
+	unsigned passed = 0;
+	for (unsigned i = 0; i < RRL_THREADS; ++i) {
+		passed += shared_count - qd[i].limited;
+	}
+	ok(passed >= rate * RRL_CAPACITY &&
+	   passed <= rate * RRL_CAPACITY * (elapsed + 2),
+	   "rrl: parallel requests limited by shared bucket (%u passed in %u s)",
+	   passed, elapsed);
+
 #ifdef ENABLE_TIMED_TESTS
-	/* 5. limited request */
+	/* 7. limited request */
 	ret = rrl_query(rrl, &addr, &rq, zone, NULL);
 	is_int(KNOT_ELIMIT, ret, "rrl: throttled IPv4 request");
 
-	/* 6. limited IPv6 request */
+	/* 8. limited IPv6 request */
 	ret = rrl_query(rrl, &addr6, &rq, zone, NULL);
 	is_int(KNOT_ELIMIT, ret, "rrl: throttled IPv6 request");
 
-	/* 8. hopscotch test */
+	/* 9. hopscotch test */
 	struct runnable_data rd = {
 		1, rrl, &addr, &rq, zone
 	};